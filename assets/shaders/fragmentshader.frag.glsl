@@ -1,17 +1,33 @@
 #version 410
 #pragma shader_stage(fragment)
 
-out vec4 FragColor;
-in vec2  TexCoord;
+// Features, defined by OkShaderVariants:
+// TEXTURED       Sample the texture, instead of the flat color
+// TEXTURE_ARRAY  Sample textureArray at Layer, with TEXTURED
 
-uniform sampler2D texture0;
-uniform bool      hasTexture;
-uniform vec4      wireframeColor;
+out vec4      FragColor;
+in vec2       TexCoord;
+flat in float Layer;
+
+#if defined(TEXTURE_ARRAY)
+uniform sampler2DArray textureArray;  // Texture unit 1
+#elif defined(TEXTURED)
+uniform sampler2D texture0;  // Texture unit 0
+#endif
+
+// Object being drawn, a record of the object ring (OkObjectUniforms)
+layout(std140) uniform OkObject {
+  mat4  model;
+  vec4  color;  // Color of untextured draws
+  float layer;
+};
 
 void main() {
-  if (hasTexture) {
-    FragColor = texture(texture0, TexCoord);
-  } else {
-    FragColor = wireframeColor;
-  }
+#if defined(TEXTURE_ARRAY)
+  FragColor = texture(textureArray, vec3(TexCoord, Layer));
+#elif defined(TEXTURED)
+  FragColor = texture(texture0, TexCoord);
+#else
+  FragColor = color;
+#endif
 }
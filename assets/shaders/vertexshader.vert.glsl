@@ -1,16 +1,42 @@
 #version 410
 #pragma shader_stage(vertex)
 
+// Features, defined by OkShaderVariants:
+// INSTANCED  Take the world matrix and layer from the instance attributes
+
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoord;
+#ifdef INSTANCED
+layout(location = 3) in mat4 aInstanceModel;  // Locations 3 to 6
+layout(location = 7) in float aInstanceLayer;
+#endif
+
+// Camera, shared by every program (OkFrameUniforms)
+layout(std140) uniform OkFrame {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec4 cameraPosition;
+};
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Object being drawn, a record of the object ring (OkObjectUniforms)
+layout(std140) uniform OkObject {
+  mat4  model;
+  vec4  color;
+  float layer;  // Layer of an array texture
+};
 
-out vec2 TexCoord;
+out vec2       TexCoord;
+flat out float Layer;
 
 void main() {
-  gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef INSTANCED
+  mat4 world = aInstanceModel;
+  Layer      = aInstanceLayer;
+#else
+  mat4 world = model;
+  Layer      = layer;
+#endif
+  gl_Position = viewProjection * world * vec4(aPos, 1.0);
   TexCoord    = aTexCoord;
 }
@@ -14,6 +14,68 @@ OkConfig::OkConfig() {
   boolValues["graphics.textures"]    = true;
   boolValues["graphics.drawCameras"] = true;
 
+  // Skip the objects outside the view frustum of the camera
+  boolValues["graphics.frustum-culling"] = true;
+
+  // Minimum number of grouped items sharing a mesh and texture to draw them
+  // with one instanced draw call, 0 disables instancing
+  intValues["graphics.instancing-min-items"] = 2;
+
+  // Bytes of the ring buffer holding the per-object uniforms of the draws,
+  // it is orphaned and written again from its start when full
+  intValues["graphics.object-buffer-bytes"] = 1024 * 1024;
+
+  // Store mesh geometry in shared pages of this many bytes of vertices (and
+  // of indices), and share of their free space scattered outside the largest
+  // free range that triggers their compaction
+  boolValues["graphics.geometry-pool"]           = true;
+  intValues["graphics.geometry-page-bytes"]      = 8 * 1024 * 1024;
+  floatValues["graphics.geometry-fragmentation"] = 0.5f;
+
+  // Spatial index of the scenes: half the size of the octree root cube, and
+  // maximum depth of its nodes
+  floatValues["scene.octree-size"] = 4096.0f;
+  intValues["scene.octree-depth"]  = 8;
+
+  // Size of the cubes static items are baked by, each cube gets its own
+  // batches so they are still culled
+  floatValues["scene.static-chunk-size"] = 64.0f;
+
+  // Imported meshes: weld duplicate vertices and reorder them for the vertex
+  // cache, and cache cost ratio allowed to reorder triangles against overdraw
+  boolValues["importer.optimize-meshes"]     = true;
+  floatValues["importer.overdraw-threshold"] = 1.05f;
+
+  // Save imported meshes in binary files next to their source, and load them
+  // from there while the source does not change
+  boolValues["importer.mesh-cache"] = true;
+
+  // Threads parsing large files, 0 uses all the cores
+  intValues["importer.threads"] = 0;
+
+  // Vertex layout of imported meshes: keep normals, packed in 32 bits, and
+  // store texture coordinates as half floats (precise to about 1/2048 of
+  // the texture, off by default as large textures need more)
+  boolValues["importer.normals"]        = true;
+  boolValues["importer.packed-normals"] = true;
+  boolValues["importer.half-texcoords"] = false;
+
+  // Background loading: worker threads reading and decoding assets (0 uses
+  // all the cores but one), and milliseconds per frame spent uploading them
+  intValues["loader.threads"]         = 0;
+  floatValues["loader.upload-budget"] = 2.0f;
+
+  // Upload loaded textures level by level, smallest first, through a pixel
+  // buffer, and bytes per frame uploaded that way
+  boolValues["loader.stream-textures"]     = true;
+  intValues["loader.texture-upload-bytes"] = 4 * 1024 * 1024;
+
+  // Video memory for textures in MiB, 0 for no budget. Over budget, textures
+  // not bound for a number of frames lose their largest mipmap levels, and
+  // get them back from their file once used again
+  floatValues["textures.memory-budget"] = 512.0f;
+  intValues["textures.idle-frames"]     = 120;
+
   // Window settings
   intValues["window.width"]  = 800;
   intValues["window.height"] = 600;
@@ -24,9 +86,26 @@ OkConfig::OkConfig() {
   // OpenGL settings
   intValues["opengl.infolog.size"] = 512;
 
+  // Save linked shader programs to disk, and load them from there instead of
+  // compiling them while the sources and the driver do not change
+  boolValues["shaders.program-cache"] = true;
+
+  // Directory of the cached programs, empty for the cache directory of the
+  // user (okinawa/shaders under XDG_CACHE_HOME, ~/.cache, ~/Library/Caches
+  // or LOCALAPPDATA)
+  stringValues["shaders.program-cache-dir"] = "";
+
   // Calculate time per frame from FPS
   float timePerFrame = 1000.0f / 60.0f;  // Using hardcoded FPS value
   floatValues["graphics.time-per-frame"] = timePerFrame;
+
+  // Frame pacing: time before the frame deadline spent yielding instead of
+  // sleeping, to absorb the OS sleep granularity
+  floatValues["graphics.frame-sleep-margin"] = 2.0f;
+
+  // Fixed step simulation settings
+  floatValues["simulation.time-per-step"]     = timePerFrame;
+  intValues["simulation.max-steps-per-frame"] = 5;
   // NOLINTEND(readability-magic-numbers)
 }
 
@@ -67,6 +146,15 @@ void OkConfig::setBool(const std::string &key, bool value) {
   getConfig().boolValues[key] = value;
 }
 
+/**
+ * @brief Set a string value in the configuration.
+ * @param key   The key for the configuration value.
+ * @param value The string value to set.
+ */
+void OkConfig::setString(const std::string &key, const std::string &value) {
+  getConfig().stringValues[key] = value;
+}
+
 /**
  * @brief Get an integer value from the configuration.
  * @param key The key for the configuration value.
@@ -108,3 +196,17 @@ bool OkConfig::getBool(const std::string &key) {
     return false;
   }
 }
+
+/**
+ * @brief Get a string value from the configuration.
+ * @param key The key for the configuration value.
+ * @return The string value associated with the key.
+ */
+std::string OkConfig::getString(const std::string &key) {
+  try {
+    return getConfig().stringValues.at(key);
+  } catch (const std::exception &e) {
+    OkLogger::error("Config", "Failed to get string value for key: " + key);
+    return "";
+  }
+}
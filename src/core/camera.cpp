@@ -2,6 +2,9 @@
 #include "camera.hpp"
 #include "../config/config.hpp"
 #include "../core/gl_config.hpp"
+#include "../core/gl_state.hpp"
+#include "../render/queue.hpp"
+#include "../shaders/program.hpp"
 #include "core.hpp"
 #include "core/object.hpp"
 #include "math/point.hpp"
@@ -69,12 +72,16 @@ void OkCamera::setPerspective(float fovDegrees, float nearPlane,
  * @brief Update the view matrix based on the camera's position and direction.
  *        This method recalculates the view matrix using the current position,
  *        front vector, and up vector.
+ *        The position is interpolated between simulation steps, while the
+ *        rotation is used as is, since it follows the mouse directly and is
+ *        not advanced by the simulation.
  */
 void OkCamera::updateView() {
-  OkPoint   worldPos = getPosition();  // Get transformed world position
-  glm::vec3 pos(worldPos.x(), worldPos.y(), worldPos.z());
+  // Interpolated world transform, read from the transform cache
+  const glm::mat4 &cameraMatrix = getRenderMatrix();
+  glm::vec3        pos(cameraMatrix[3]);
 
-  OkRotation worldRot = getRotation();  // Get transformed world rotation
+  OkRotation worldRot = getRotation();  // Get cached world rotation
   OkPoint    forward  = worldRot.getForwardVector();
   OkPoint    up       = worldRot.getUpVector();  // Get up vector from rotation
   glm::vec3  frontVec = forward.toVec3();
@@ -155,32 +162,19 @@ void OkCamera::drawSelf() {
                                 8, 9, 10,          // Pyramid sides
                                 8, 10, 11, 8, 11, 12, 8, 12, 9};
 
-      // Get current shader program
-      GLint current_program;
-      glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
-      if (current_program == 0)
+      // Get current shader program, or its untextured variant
+      OkShaderProgram *program = OkShaderProgram::getCurrent();
+      if (program != nullptr)
+        program = program->getVariant(0);
+      if (program == nullptr)
         return;
+      program->use();
 
-      // Set the model matrix uniform using the inverse of the view matrix
-      // This ensures the visualization matches exactly what the camera sees
-      GLint modelLoc = glGetUniformLocation(current_program, "model");
-      if (modelLoc != -1) {
-        glm::mat4 invView = glm::inverse(view);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(invView));
-      }
-
-      // Disable texturing for camera visualization
-      GLint hasTexLoc = glGetUniformLocation(current_program, "hasTexture");
-      if (hasTexLoc != -1) {
-        glUniform1i(hasTexLoc, 0);
-      }
-
-      // Set wireframe color
-      GLint colorLoc = glGetUniformLocation(current_program, "wireframeColor");
-      if (colorLoc != -1) {
-        glUniform4f(colorLoc, 0.2f, 0.8f, 0.2f,
-                    1.0f);  // Green color for camera
-      }
+      // Set the model matrix using the inverse of the view matrix, this
+      // ensures the visualization matches exactly what the camera sees,
+      // with the wireframe color (green for the camera)
+      OkRenderQueue::setObject(program, glm::inverse(view),
+                               glm::vec4(0.2f, 0.8f, 0.2f, 1.0f));
 
       // Create and bind temporary VAO/VBO/EBO
       GLuint VAO, VBO, EBO;
@@ -188,7 +182,7 @@ void OkCamera::drawSelf() {
       glGenBuffers(1, &VBO);
       glGenBuffers(1, &EBO);
 
-      glBindVertexArray(VAO);
+      OkGLState::bindVertexArray(VAO);
 
       // Buffer vertex data
       glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -211,13 +205,12 @@ void OkCamera::drawSelf() {
       glEnableVertexAttribArray(1);
 
       // Draw in wireframe mode
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+      OkGLState::polygonMode(GL_LINE);
       glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(unsigned int),
                      GL_UNSIGNED_INT, nullptr);
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
       // Clean up
-      glDeleteVertexArrays(1, &VAO);
+      OkGLState::deleteVertexArray(VAO);
       glDeleteBuffers(1, &VBO);
       glDeleteBuffers(1, &EBO);
     }
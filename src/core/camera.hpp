@@ -23,6 +23,8 @@ public:
   const glm::mat4 &getProjection() const { return projection; }
   const float     *getViewPtr() const { return glm::value_ptr(view); }
   const float *getProjectionPtr() const { return glm::value_ptr(projection); }
+  float        getNear() const { return near; }
+  float        getFar() const { return far; }
 
   // Update and render
   void stepSelf(float dt) override;
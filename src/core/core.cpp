@@ -1,11 +1,18 @@
 #include "core.hpp"
 #include "../config/config.hpp"
+#include "../handlers/geometry.hpp"
+#include "../handlers/loader.hpp"
+#include "../handlers/streamer.hpp"
+#include "../handlers/textures.hpp"
 #include "../input/input.hpp"
+#include "../render/uniforms.hpp"
 #include "../shaders/shaders.hpp"
+#include "../shaders/variants.hpp"
 #include "../utils/assets.hpp"
 #include "../utils/logger.hpp"
 #include "core/camera.hpp"
 #include "gl_config.hpp"
+#include "gl_state.hpp"
 #include "handlers/scenes.hpp"
 #include "math/rotation.hpp"
 #include "scene/scene.hpp"
@@ -19,10 +26,12 @@
 // Static member initialization
 GLFWwindow             *OkCore::_window = nullptr;
 std::vector<OkCamera *> OkCore::_cameras;
-int                     OkCore::_currentCamera = 0;
-OkSceneHandler         *OkCore::_sceneHandler  = nullptr;
-GLuint                  OkCore::_shaderProgram = 0;
-OkInput                *OkCore::_input         = nullptr;
+int                     OkCore::_currentCamera  = 0;
+OkSceneHandler         *OkCore::_sceneHandler   = nullptr;
+OkShaderVariants       *OkCore::_shaderVariants = nullptr;
+OkShaderProgram        *OkCore::_shaderProgram  = nullptr;
+OkInput                *OkCore::_input          = nullptr;
+OkFramePacer           *OkCore::_framePacer     = nullptr;
 
 /**
  * @brief Initialize the core engine.
@@ -63,6 +72,13 @@ bool OkCore::initialize() {
   // Initialize input system
   _input = new OkInput(_window, &OkCore::mouseCallback);
 
+  // Initialize frame pacing and fixed step simulation
+  _framePacer =
+      new OkFramePacer(OkConfig::getFloat("graphics.time-per-frame"),
+                       OkConfig::getFloat("simulation.time-per-step"),
+                       OkConfig::getInt("simulation.max-steps-per-frame"),
+                       OkConfig::getFloat("graphics.frame-sleep-margin"));
+
   OkLogger::info("Core", "Engine initialized successfully");
   return true;
 }
@@ -90,17 +106,27 @@ void OkCore::exit() {
   delete _input;
   _input = nullptr;
 
+  delete _framePacer;
+  _framePacer = nullptr;
+
+  // Stop background loading, dropped loads release their assets while the
+  // OpenGL context still exists
+  OkAssetLoader::getInstance()->cleanup();
+  OkTextureStreamer::getInstance()->cleanup();
+  OkUniformBuffers::getInstance()->cleanup();
+  OkGeometryPool::getInstance()->cleanup();
+
   // Delete all cameras
   for (int i = 0; i < _cameras.size(); i++) {
     delete _cameras[i];
   }
   _cameras.clear();
 
-  // Make sure we clean up OpenGL resources before destroying window
-  if (_shaderProgram != 0) {
-    glDeleteProgram(_shaderProgram);
-    _shaderProgram = 0;
-  }
+  // Make sure we clean up OpenGL resources before destroying window, the
+  // variants own the program
+  delete _shaderVariants;
+  _shaderVariants = nullptr;
+  _shaderProgram  = nullptr;
 
   // Release OpenGL context before destroying window
   if (_window != nullptr) {
@@ -142,12 +168,17 @@ bool OkCore::initializeOpenGL(int width, int height) {
   glfwMakeContextCurrent(_window);
   glViewport(0, 0, width, height);
 
+  // New context, nothing is known about its state yet
+  OkGLState::invalidate();
+
   return true;
 }
 
 /**
  * @brief Initialize shaders for the engine.
- *        This method compiles and links the vertex and fragment shaders.
+ *        This method builds the untextured variant of the engine shaders
+ *        (compiled, or loaded from the program cache), the other variants
+ *        are built the first time something is drawn with them.
  * @return True if initialization was successful, false otherwise.
  */
 bool OkCore::initializeShaders() {
@@ -161,31 +192,36 @@ bool OkCore::initializeShaders() {
     return false;
   }
 
-  GLuint vertexShader =
-      OkShader::compile(vertexShaderSource, GL_VERTEX_SHADER, "vertex");
-  GLuint fragmentShader =
-      OkShader::compile(fragmentShaderSource, GL_FRAGMENT_SHADER, "fragment");
-
-  if (!vertexShader || !fragmentShader) {
+  _shaderVariants =
+      new OkShaderVariants(vertexShaderSource, fragmentShaderSource);
+  _shaderProgram = _shaderVariants->get(0);
+  if (!_shaderProgram) {
     return false;
   }
 
-  _shaderProgram =
-      OkShader::createProgram(vertexShaderSource, fragmentShaderSource);
+  if (!_shaderProgram->hasBlock(OkUniformBlock::Frame) ||
+      !_shaderProgram->hasBlock(OkUniformBlock::Object)) {
+    OkLogger::error("Core", "Cannot find OkFrame/OkObject uniform blocks");
+  }
 
-  return _shaderProgram != 0;
+  return true;
 }
 
 /**
  * @brief Main loop of the engine.
  *        This method runs the main loop, processing input, updating the scene,
  *        and rendering the scene.
- * @param stepCallback Callback function for updating the scene.
- * @param drawCallback Callback function for rendering the scene.
+ *        The simulation advances in fixed steps of simulation.time-per-step
+ *        (possibly several, or none, per frame), while frames are paced to
+ *        graphics.time-per-frame by sleeping instead of spinning. Drawing
+ *        interpolates object transforms between the last two steps.
+ * @param stepCallback Callback function for updating the scene, called once
+ *        per fixed step with the step time.
+ * @param drawCallback Callback function for rendering the scene, called once
+ *        per frame with the real frame time.
  *        These callbacks are optional and can be used to add custom behavior
  *        during the main loop.
  * @note The loop will run until the window is closed.
- *       The step and draw callbacks are called every frame.
  */
 void OkCore::loop(const OkCoreCallback &stepCallback,
                   const OkCoreCallback &drawCallback) {
@@ -194,26 +230,35 @@ void OkCore::loop(const OkCoreCallback &stepCallback,
     return;
   }
 
-  double lastFrameTime = glfwGetTime() * 1000.0;
-  float  timePerFrame  = OkConfig::getFloat("graphics.time-per-frame");
+  _framePacer->reset();
 
   while (!glfwWindowShouldClose(_window)) {
-    double currentTime = glfwGetTime() * 1000.0;
-    double deltaTime   = currentTime - lastFrameTime;
+    int   steps = _framePacer->beginFrame();
+    float dt    = _framePacer->getTimePerStep();
 
-    if (deltaTime >= timePerFrame) {
-      lastFrameTime = currentTime;
-      float dt      = (float)deltaTime;
+    // Process input
+    _input->process();
 
-      // Process input
-      _input->process();
+    // Handle camera switching based on input state
+    OkInputState state = _input->getState();
+    if (state.changeCamera != -1) {
+      switchCamera(state.changeCamera);
+    }
 
-      // Handle camera switching based on input state
-      OkInputState state = _input->getState();
-      if (state.changeCamera != -1) {
-        switchCamera(state.changeCamera);
-      }
+    // Keep the textures within their memory budget, then create the assets
+    // loaded in the background since the last frame, so items waiting for
+    // them are stepped and drawn with them, and upload the next mipmap
+    // levels of streaming textures
+    OkTextureHandler::getInstance()->update();
+    OkAssetLoader::getInstance()->update(
+        OkConfig::getFloat("loader.upload-budget"));
+    OkTextureStreamer::getInstance()->update(
+        OkConfig::getInt("loader.texture-upload-bytes"));
 
+    OkScene *currentScene = _sceneHandler->getCurrentScene();
+
+    // Fixed step simulation
+    for (int i = 0; i < steps; i++) {
       // User step callback first to process input
       if (stepCallback) {
         stepCallback(dt);
@@ -222,57 +267,69 @@ void OkCore::loop(const OkCoreCallback &stepCallback,
       // Call step function for the current camera
       _cameras[_currentCamera]->step(dt);
 
-      OkScene *currentScene = _sceneHandler->getCurrentScene();
-
       // Update current scene
       if (currentScene) {
         currentScene->step(dt);
       }
+    }
 
-      // Render
-      glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-      glEnable(GL_DEPTH_TEST);
-      glUseProgram(_shaderProgram);
-
-      // Set view and projection matrices
-      GLint viewLoc = glGetUniformLocation(_shaderProgram, "view");
-      GLint projLoc = glGetUniformLocation(_shaderProgram, "projection");
+    // Compact the geometry pages left fragmented by freed meshes
+    OkGeometryPool::getInstance()->update();
 
-      // Use the current camera for view and projection
-      glUniformMatrix4fv(viewLoc, 1, GL_FALSE,
-                         _cameras[_currentCamera]->getViewPtr());
-      glUniformMatrix4fv(projLoc, 1, GL_FALSE,
-                         _cameras[_currentCamera]->getProjectionPtr());
+    // Render
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    OkGLState::enable(GL_DEPTH_TEST);
 
-      if (viewLoc == -1 || projLoc == -1) {
-        OkLogger::error("Core", "Cannot find view/projection uniforms");
-      }
+    // Update camera transforms (this rebuilds the view matrices of the cameras
+    // that moved), then upload the current camera once for all the programs
+    for (int i = 0; i < _cameras.size(); ++i) {
+      _cameras[i]->updateTransform();
+    }
+    OkUniformBuffers::getInstance()->setFrame(
+        _cameras[_currentCamera]->getView(),
+        _cameras[_currentCamera]->getProjection());
+    _shaderProgram->use();
+
+    // Draw current scene
+    if (currentScene) {
+      currentScene->draw(_cameras[_currentCamera]);
+    }
 
-      // Draw current scene
-      if (currentScene) {
-        currentScene->draw();
-      }
+    // User draw callback
+    if (drawCallback) {
+      drawCallback(_framePacer->getFrameDelta());
+    }
 
-      // User draw callback
-      if (drawCallback) {
-        drawCallback(dt);
-      }
+    // Draw cameras (both for debugging and to render elements attached to
+    // cameras, like interfaces)
+    for (int i = 0; i < _cameras.size(); ++i) {
+      _cameras[i]->draw();
+    }
 
-      // Draw cameras (both for debugging and to render elements attached to
-      // cameras, like interfaces)
-      for (int i = 0; i < _cameras.size(); ++i) {
-        _cameras[i]->draw();
-      }
+    glfwSwapBuffers(_window);
+    glfwPollEvents();
 
-      glfwSwapBuffers(_window);
-      glfwPollEvents();
-    }
+    // Give the core back to the OS until the next frame is due
+    _framePacer->waitForNextFrame();
   }
 
   exit();
 }
 
+/**
+ * @brief Get the interpolation factor for the frame being drawn.
+ *        It is the fraction of a simulation step accumulated but not yet
+ *        simulated, used to blend between the last two simulation states.
+ * @return The interpolation factor, 1 if there is no frame pacer.
+ */
+float OkCore::getInterpolationAlpha() {
+  if (!_framePacer) {
+    return 1.0f;
+  }
+  return _framePacer->getAlpha();
+}
+
 /**
  * @brief Mouse callback function for handling mouse movement.
  *        This function updates the camera direction based on mouse movement.
@@ -3,7 +3,10 @@
 
 #include "../handlers/scenes.hpp"
 #include "../input/input.hpp"
+#include "../shaders/program.hpp"
+#include "../shaders/variants.hpp"
 #include "./camera.hpp"
+#include "./pacer.hpp"
 #include "gl_config.hpp"
 #include <functional>
 #include <vector>
@@ -31,10 +34,17 @@ public:
   static OkSceneHandler *getSceneHandler() { return _sceneHandler; }
 
   // Getters
-  static OkCamera   *getCamera() { return _cameras[_currentCamera]; }
-  static GLFWwindow *getWindow() { return _window; }
-  static GLuint      getShaderProgram() { return _shaderProgram; }
-  static OkInput    *getInput() { return _input; }
+  static OkCamera        *getCamera() { return _cameras[_currentCamera]; }
+  static GLFWwindow      *getWindow() { return _window; }
+  static OkShaderProgram *getShaderProgram() { return _shaderProgram; }
+  static OkInput         *getInput() { return _input; }
+
+  // Variants of the engine shaders, getShaderProgram is the untextured one
+  static OkShaderVariants *getShaderVariants() { return _shaderVariants; }
+
+  // Frame pacing
+  static OkFramePacer *getFramePacer() { return _framePacer; }
+  static float         getInterpolationAlpha();
 
   // Camera management
   static void addCamera(OkCamera *camera);
@@ -48,8 +58,10 @@ private:
   static std::vector<OkCamera *> _cameras;
   static int                     _currentCamera;
   static OkSceneHandler         *_sceneHandler;
-  static GLuint                  _shaderProgram;
+  static OkShaderVariants       *_shaderVariants;
+  static OkShaderProgram        *_shaderProgram;
   static OkInput                *_input;
+  static OkFramePacer           *_framePacer;
 
   static void mouseCallback(GLFWwindow *window, double xpos, double ypos);
 };
@@ -0,0 +1,279 @@
+#include "gl_state.hpp"
+#include "gl_config.hpp"
+#include <unordered_map>
+
+// Value of a shadowed binding that is not known
+static const GLuint unknown = ~0u;
+
+// Static member initialization
+GLuint OkGLState::_program     = unknown;
+GLuint OkGLState::_vertexArray = unknown;
+int    OkGLState::_activeUnit  = -1;
+GLenum OkGLState::_polygonMode = unknown;
+
+// Texture bindings start at 0, as in a new context
+GLuint OkGLState::_textures[maxTextureUnits][TargetCount] = {};
+
+std::unordered_map<GLenum, bool> OkGLState::_capabilities;
+
+long OkGLState::_issued[static_cast<int>(OkGLStateCall::Count)]  = {};
+long OkGLState::_skipped[static_cast<int>(OkGLStateCall::Count)] = {};
+
+/**
+ * @brief Forget all the shadowed state.
+ *        The next change of every piece of state is always sent to the
+ *        driver. Call it after creating a context, or after code outside the
+ *        engine changed the state directly.
+ */
+void OkGLState::invalidate() {
+  _program     = unknown;
+  _vertexArray = unknown;
+  _activeUnit  = -1;
+  _polygonMode = unknown;
+
+  for (int unit = 0; unit < maxTextureUnits; unit++) {
+    for (int target = 0; target < TargetCount; target++) {
+      _textures[unit][target] = unknown;
+    }
+  }
+
+  _capabilities.clear();
+}
+
+/**
+ * @brief Count a state change as issued or skipped.
+ * @param call    The kind of state change.
+ * @param changed Whether the new value differs from the shadow.
+ * @return True if the change has to be sent to the driver.
+ */
+bool OkGLState::_issue(OkGLStateCall call, bool changed) {
+  int index = static_cast<int>(call);
+  if (changed) {
+    _issued[index]++;
+  } else {
+    _skipped[index]++;
+  }
+  return changed;
+}
+
+/**
+ * @brief Get the index of a tracked texture target.
+ * @param target The texture target.
+ * @return The index in the per-unit bindings, or -1 if it is not tracked.
+ */
+int OkGLState::_targetIndex(GLenum target) {
+  switch (target) {
+  case GL_TEXTURE_2D:
+    return Texture2D;
+  case GL_TEXTURE_2D_ARRAY:
+    return Texture2DArray;
+  case GL_TEXTURE_CUBE_MAP:
+    return TextureCubeMap;
+  default:
+    return -1;
+  }
+}
+
+/**
+ * @brief Bind a shader program.
+ * @param program The program to bind, 0 to unbind.
+ */
+void OkGLState::useProgram(GLuint program) {
+  if (_issue(OkGLStateCall::Program, program != _program)) {
+    glUseProgram(program);
+    _program = program;
+  }
+}
+
+/**
+ * @brief Bind a vertex array object.
+ * @param vao The vertex array to bind, 0 to unbind.
+ */
+void OkGLState::bindVertexArray(GLuint vao) {
+  if (_issue(OkGLStateCall::VertexArray, vao != _vertexArray)) {
+    glBindVertexArray(vao);
+    _vertexArray = vao;
+  }
+}
+
+/**
+ * @brief Select the active texture unit.
+ * @param unit The texture unit, starting at 0.
+ */
+void OkGLState::activeTexture(int unit) {
+  if (_issue(OkGLStateCall::ActiveTexture, unit != _activeUnit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    _activeUnit = unit;
+  }
+}
+
+/**
+ * @brief Bind a texture to a texture unit.
+ *        The active unit is only changed when the binding is issued.
+ * @param target  The texture target (GL_TEXTURE_2D, ...).
+ * @param texture The texture to bind, 0 to unbind.
+ * @param unit    The texture unit, starting at 0.
+ */
+void OkGLState::bindTexture(GLenum target, GLuint texture, int unit) {
+  int  index   = _targetIndex(target);
+  bool tracked = index != -1 && unit >= 0 && unit < maxTextureUnits;
+
+  if (!_issue(OkGLStateCall::Texture,
+              !tracked || _textures[unit][index] != texture)) {
+    return;
+  }
+
+  activeTexture(unit);
+  glBindTexture(target, texture);
+
+  if (tracked) {
+    _textures[unit][index] = texture;
+  }
+}
+
+/**
+ * @brief Set the polygon rasterization mode for front and back faces.
+ * @param mode GL_FILL, GL_LINE or GL_POINT.
+ */
+void OkGLState::polygonMode(GLenum mode) {
+  if (_issue(OkGLStateCall::PolygonMode, mode != _polygonMode)) {
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    _polygonMode = mode;
+  }
+}
+
+/**
+ * @brief Enable a server-side capability (GL_DEPTH_TEST, ...).
+ * @param capability The capability.
+ */
+void OkGLState::enable(GLenum capability) {
+  setEnabled(capability, true);
+}
+
+/**
+ * @brief Disable a server-side capability (GL_DEPTH_TEST, ...).
+ * @param capability The capability.
+ */
+void OkGLState::disable(GLenum capability) {
+  setEnabled(capability, false);
+}
+
+/**
+ * @brief Enable or disable a server-side capability.
+ * @param capability The capability.
+ * @param enabled    The new state.
+ */
+void OkGLState::setEnabled(GLenum capability, bool enabled) {
+  auto it      = _capabilities.find(capability);
+  bool changed = it == _capabilities.end() || it->second != enabled;
+
+  if (!_issue(OkGLStateCall::Capability, changed)) {
+    return;
+  }
+
+  if (enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+  _capabilities[capability] = enabled;
+}
+
+/**
+ * @brief Delete a shader program.
+ *        OpenGL keeps a deleted program in use until another one is bound,
+ *        so if it was bound the shadow forgets it (its name could be reused).
+ * @param program The program to delete.
+ */
+void OkGLState::deleteProgram(GLuint program) {
+  if (program == 0) {
+    return;
+  }
+
+  glDeleteProgram(program);
+  if (_program == program) {
+    _program = unknown;
+  }
+}
+
+/**
+ * @brief Delete a vertex array object.
+ *        If it was bound, OpenGL reverts the binding to 0.
+ * @param vao The vertex array to delete.
+ */
+void OkGLState::deleteVertexArray(GLuint vao) {
+  if (vao == 0) {
+    return;
+  }
+
+  glDeleteVertexArrays(1, &vao);
+  if (_vertexArray == vao) {
+    _vertexArray = 0;
+  }
+}
+
+/**
+ * @brief Delete a texture.
+ *        OpenGL reverts the bindings of a deleted texture to 0 in every unit.
+ * @param texture The texture to delete.
+ */
+void OkGLState::deleteTexture(GLuint texture) {
+  if (texture == 0) {
+    return;
+  }
+
+  glDeleteTextures(1, &texture);
+  for (int unit = 0; unit < maxTextureUnits; unit++) {
+    for (int target = 0; target < TargetCount; target++) {
+      if (_textures[unit][target] == texture) {
+        _textures[unit][target] = 0;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Get the number of state changes sent to the driver.
+ * @param call The kind of state change.
+ * @return The number of issued calls since the last reset.
+ */
+long OkGLState::getIssuedCalls(OkGLStateCall call) {
+  if (call == OkGLStateCall::Count) {
+    return 0;
+  }
+  return _issued[static_cast<int>(call)];
+}
+
+/**
+ * @brief Get the number of redundant state changes dropped.
+ * @param call The kind of state change.
+ * @return The number of skipped calls since the last reset.
+ */
+long OkGLState::getSkippedCalls(OkGLStateCall call) {
+  if (call == OkGLStateCall::Count) {
+    return 0;
+  }
+  return _skipped[static_cast<int>(call)];
+}
+
+/**
+ * @brief Get the total number of redundant state changes dropped.
+ * @return The number of skipped calls of all kinds since the last reset.
+ */
+long OkGLState::getSkippedCalls() {
+  long total = 0;
+  for (int i = 0; i < static_cast<int>(OkGLStateCall::Count); i++) {
+    total += _skipped[i];
+  }
+  return total;
+}
+
+/**
+ * @brief Reset the issued and skipped counters.
+ */
+void OkGLState::resetCounters() {
+  for (int i = 0; i < static_cast<int>(OkGLStateCall::Count); i++) {
+    _issued[i]  = 0;
+    _skipped[i] = 0;
+  }
+}
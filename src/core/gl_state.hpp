@@ -0,0 +1,80 @@
+#ifndef OK_GL_STATE_HPP
+#define OK_GL_STATE_HPP
+
+#include "gl_config.hpp"
+#include <unordered_map>
+
+// Kinds of state changes tracked by OkGLState
+enum class OkGLStateCall {
+  Program,
+  VertexArray,
+  ActiveTexture,
+  Texture,
+  PolygonMode,
+  Capability,
+  Count
+};
+
+/**
+ * @brief Shadow copy of the OpenGL state changed by the engine.
+ *        State changes are compared against the shadow and only reach the
+ *        driver when they actually change something. Every engine call site
+ *        must go through this class, otherwise the shadow gets out of sync
+ *        (call invalidate() after touching the state directly).
+ */
+class OkGLState {
+public:
+  // Static class - no instantiation
+  OkGLState() = delete;
+
+  // Number of texture units tracked
+  static const int maxTextureUnits = 16;
+
+  // Forget the shadowed state, next changes are always issued
+  static void invalidate();
+
+  // Program and vertex array
+  static void useProgram(GLuint program);
+  static void bindVertexArray(GLuint vao);
+
+  // Textures
+  static void activeTexture(int unit);
+  static void bindTexture(GLenum target, GLuint texture, int unit = 0);
+
+  // Rasterization
+  static void polygonMode(GLenum mode);
+  static void enable(GLenum capability);
+  static void disable(GLenum capability);
+  static void setEnabled(GLenum capability, bool enabled);
+
+  // Deletion, also drops the objects from the shadow
+  static void deleteProgram(GLuint program);
+  static void deleteVertexArray(GLuint vao);
+  static void deleteTexture(GLuint texture);
+
+  // Counters
+  static long getIssuedCalls(OkGLStateCall call);
+  static long getSkippedCalls(OkGLStateCall call);
+  static long getSkippedCalls();
+  static void resetCounters();
+
+private:
+  // Texture targets tracked per unit, others are always issued
+  enum TextureTarget { Texture2D, Texture2DArray, TextureCubeMap, TargetCount };
+
+  static int  _targetIndex(GLenum target);
+  static bool _issue(OkGLStateCall call, bool changed);
+
+  static GLuint _program;
+  static GLuint _vertexArray;
+  static int    _activeUnit;
+  static GLuint _textures[maxTextureUnits][TargetCount];
+  static GLenum _polygonMode;
+
+  static std::unordered_map<GLenum, bool> _capabilities;
+
+  static long _issued[static_cast<int>(OkGLStateCall::Count)];
+  static long _skipped[static_cast<int>(OkGLStateCall::Count)];
+};
+
+#endif
@@ -1,5 +1,10 @@
 #include "object.hpp"
 #include "../config/config.hpp"
+#include "../render/queue.hpp"
+#include "../scene/octree.hpp"
+#include "../shaders/program.hpp"
+#include "core.hpp"
+#include "gl_state.hpp"
 #include "gl_config.hpp"
 #include "math/point.hpp"
 #include "math/rotation.hpp"
@@ -27,11 +32,35 @@ OkObject::OkObject(const std::string &name) {
   maxVRot  = OkPoint(0.0f, 0.0f, 0.0f);
   accelRot = OkPoint(0.0f, 0.0f, 0.0f);
 
+  previousPosition = position;
+  previousRotation = rotation;
+  hasPreviousState = false;
+
   _parent      = nullptr;
   _firstChild  = nullptr;
   _nextSibling = nullptr;
 
   drawOriginAxis = false;  // Default to not showing axes
+
+  // Transform caches start dirty and are built on first use
+  localMatrix         = glm::mat4(1.0f);
+  worldMatrix         = glm::mat4(1.0f);
+  worldRotationMatrix = glm::mat4(1.0f);
+  renderMatrix        = glm::mat4(1.0f);
+  localDirty          = true;
+  worldDirty          = true;
+  worldRotationDirty  = true;
+  transformChanged    = true;
+  subtreeDirty        = true;
+  moving              = false;
+  renderInterpolated  = false;
+
+  // Unknown until the first transform pass
+  bounds        = OkBoundingSphere::unbounded();
+  subtreeBounds = OkBoundingSphere::unbounded();
+  subtreeSize   = 1;
+
+  _octree = nullptr;
 }
 
 /**
@@ -39,6 +68,10 @@ OkObject::OkObject(const std::string &name) {
  *        Cleans up the object and detaches from parent.
  */
 OkObject::~OkObject() {
+  if (_octree) {
+    _octree->remove(this);
+  }
+
   detachFromParent();
   detachAllChildren();
 }
@@ -47,15 +80,13 @@ OkObject::~OkObject() {
  * @brief Get the position of the object in world coordinates.
  *        If the object has a parent, the position is transformed by the
  *        parent's rotation and position.
+ *        The value is cached and only recalculated after a change in this
+ *        object or in one of its ancestors.
  * @return The world position of the object.
  */
 OkPoint OkObject::getPosition() const {
-  if (_parent) {
-    // Transform local position by parent's transform
-    OkPoint worldPos = _parent->getRotation().transformPoint(position);
-    return worldPos + _parent->getPosition();
-  }
-  return position;
+  resolveWorldTransform();
+  return worldPosition;
 }
 
 /**
@@ -68,7 +99,8 @@ OkPoint OkObject::getPosition() const {
  */
 void OkObject::setPosition(float x, float y, float z) {
   position = OkPoint(x, y, z);
-  updateTransform();
+  localDirty = true;
+  markTransformDirty();
 }
 
 /**
@@ -80,7 +112,8 @@ void OkObject::setPosition(float x, float y, float z) {
 void OkObject::setPosition(const OkPoint &newPosition) {
   // OkPoint copy assignment operator
   position = newPosition;
-  updateTransform();
+  localDirty = true;
+  markTransformDirty();
 }
 
 /**
@@ -93,7 +126,8 @@ void OkObject::setPosition(const OkPoint &newPosition) {
  */
 void OkObject::move(float dx, float dy, float dz) {
   position = position + OkPoint(dx, dy, dz);
-  updateTransform();
+  localDirty = true;
+  markTransformDirty();
 }
 
 /**
@@ -103,10 +137,17 @@ void OkObject::move(float dx, float dy, float dz) {
  * @return The world rotation of the object.
  */
 OkRotation OkObject::getRotation() const {
-  if (_parent) {
-    return _parent->getRotation().combine(rotation);
+  if (!_parent) {
+    return rotation;
   }
-  return rotation;
+
+  // Euler angles are only extracted on demand, and once per change
+  resolveWorldTransform();
+  if (worldRotationDirty) {
+    worldRotation      = _parent->getRotation().combine(rotation);
+    worldRotationDirty = false;
+  }
+  return worldRotation;
 }
 
 /**
@@ -119,7 +160,8 @@ OkRotation OkObject::getRotation() const {
  */
 void OkObject::setRotation(float x, float y, float z) {
   rotation.setRotation(x, y, z);
-  updateTransform();
+  localDirty = true;
+  markTransformDirty();
 }
 
 /**
@@ -131,7 +173,8 @@ void OkObject::setRotation(float x, float y, float z) {
 void OkObject::setRotation(const OkRotation &newRotation) {
   // OkPoint copy assignment operator
   rotation = newRotation;
-  updateTransform();
+  localDirty = true;
+  markTransformDirty();
 }
 
 /**
@@ -144,7 +187,8 @@ void OkObject::setRotation(const OkRotation &newRotation) {
  */
 void OkObject::rotate(float dx, float dy, float dz) {
   rotation.rotate(dx, dy, dz);
-  updateTransform();
+  localDirty = true;
+  markTransformDirty();
 }
 
 /**
@@ -178,7 +222,7 @@ void OkObject::attachTo(OkObject *parent) {
     parent->_firstChild = this;
   }
 
-  updateTransform();
+  markTransformDirty();
 }
 
 /**
@@ -200,9 +244,12 @@ void OkObject::detachFromParent() {
     *curr = _nextSibling;
   }
 
+  // The bounds of the former ancestors must be rebuilt without this subtree
+  _parent->markSubtreeDirty();
+
   _parent      = nullptr;
   _nextSibling = nullptr;
-  updateTransform();
+  markTransformDirty();
 }
 
 /**
@@ -216,47 +263,236 @@ void OkObject::detachAllChildren() {
 }
 
 /**
- * @brief Get the transformation matrix for this object.
- *        This method combines the parent's transformation with the local
- *        transformation.
- * @return The transformation matrix as a glm::mat4.
+ * @brief Build a local transformation matrix.
+ *        Translation, then rotation around the position, then scaling.
+ * @param localPosition The position in parent coordinates.
+ * @param localRotation The rotation in parent coordinates.
+ * @return The local transformation matrix as a glm::mat4.
  */
-glm::mat4 OkObject::getTransformMatrix() const {
-  // First build local transform in correct order
+glm::mat4 OkObject::buildLocalMatrix(const OkPoint    &localPosition,
+                                     const OkRotation &localRotation) const {
   glm::mat4 localMatrix(1.0f);
 
   // 1. First translate (move to position)
-  localMatrix = glm::translate(
-      localMatrix, glm::vec3(position.x(), position.y(), position.z()));
+  localMatrix = glm::translate(localMatrix, localPosition.toVec3());
 
   // 2. Then rotate (around position)
-  localMatrix = localMatrix * rotation.getMatrix();
+  localMatrix = localMatrix * localRotation.getMatrix();
 
   // 3. Finally scale (from position)
-  localMatrix =
-      glm::scale(localMatrix, glm::vec3(scaling.x(), scaling.y(), scaling.z()));
+  localMatrix = glm::scale(localMatrix, scaling.toVec3());
+
+  return localMatrix;
+}
+
+/**
+ * @brief Get the transformation matrix for this object.
+ *        This is the parent's transformation combined with the local
+ *        transformation. The result is cached and only recalculated after a
+ *        change in this object or in one of its ancestors.
+ * @return The world transformation matrix as a glm::mat4.
+ */
+const glm::mat4 &OkObject::getTransformMatrix() const {
+  resolveWorldTransform();
+  return worldMatrix;
+}
+
+/**
+ * @brief Get the transformation matrix used for drawing.
+ *        While the object (or an ancestor) is moving, this is the world
+ *        transform interpolated between the state at the start of the last
+ *        simulation step and the current one, as computed by the last
+ *        updateTransform pass. Otherwise it is the world transform.
+ * @return The render transformation matrix as a glm::mat4.
+ */
+const glm::mat4 &OkObject::getRenderMatrix() const {
+  if (renderInterpolated) {
+    return renderMatrix;
+  }
+  return getTransformMatrix();
+}
+
+/**
+ * @brief Flag the world transform of this object and its descendants as
+ *        dirty, and the subtree of all its ancestors as needing a pass.
+ *        Flags are only set, the matrices are rebuilt lazily.
+ */
+void OkObject::markTransformDirty() {
+  if (!worldDirty || !transformChanged) {
+    worldDirty         = true;
+    worldRotationDirty = true;
+    transformChanged   = true;
+
+    // Descendants inherit the change
+    OkObject *current = _firstChild;
+    while (current != nullptr) {
+      current->markTransformDirty();
+      current = current->getNextSibling();
+    }
+  }
+
+  markSubtreeDirty();
+}
+
+/**
+ * @brief Flag this object and its ancestors as needing a transform pass.
+ *        When the root of the hierarchy gets flagged, the spatial index it
+ *        belongs to is notified.
+ */
+void OkObject::markSubtreeDirty() {
+  OkObject *current = this;
+  while (current != nullptr && !current->subtreeDirty) {
+    current->subtreeDirty = true;
+    if (current->_parent == nullptr && current->_octree) {
+      current->_octree->markDirty(current);
+    }
+    current = current->_parent;
+  }
+}
+
+/**
+ * @brief Rebuild the cached world transform if it is dirty.
+ *        The parent is resolved first, so the cost is proportional to the
+ *        number of dirty ancestors, not to the depth of the hierarchy.
+ */
+void OkObject::resolveWorldTransform() const {
+  if (!worldDirty) {
+    return;
+  }
+
+  if (localDirty) {
+    localMatrix = buildLocalMatrix(position, rotation);
+    localDirty  = false;
+  }
 
-  // Apply parent transform if exists (parent * local for proper inheritance)
   if (_parent) {
-    return _parent->getTransformMatrix() * localMatrix;
+    _parent->resolveWorldTransform();
+    worldMatrix         = _parent->worldMatrix * localMatrix;
+    worldRotationMatrix = _parent->worldRotationMatrix * rotation.getMatrix();
+
+    // Local position transformed by the parent's rotation and position
+    glm::vec4 offset =
+        _parent->worldRotationMatrix * glm::vec4(position.toVec3(), 1.0f);
+    worldPosition = _parent->worldPosition + OkPoint(glm::vec3(offset));
+  } else {
+    worldMatrix         = localMatrix;
+    worldRotationMatrix = rotation.getMatrix();
+    worldPosition       = position;
   }
 
-  return localMatrix;
+  worldRotationDirty = true;
+  worldDirty         = false;
 }
 
-// Final transform update that enforces hierarchy
+/**
+ * @brief Per-frame transform pass, using the interpolation factor of the
+ *        current frame.
+ */
 void OkObject::updateTransform() {
-  // First update our local transform
-  updateTransformSelf();
+  updateTransform(OkCore::getInterpolationAlpha());
+}
+
+/**
+ * @brief Per-frame transform pass.
+ *        Walks the hierarchy top-down, rebuilding the world transforms that
+ *        changed and the interpolated render transforms of moving objects.
+ *        Subtrees without changes are skipped entirely.
+ * @param alpha Interpolation factor, 0 is the state at the start of the last
+ *              simulation step and 1 the current one.
+ */
+void OkObject::updateTransform(float alpha) {
+  bool parentChanged = _parent && _parent->renderInterpolated;
+  propagateTransform(alpha, parentChanged);
+}
+
+/**
+ * @brief Recursive part of the transform pass.
+ * @param alpha         Interpolation factor.
+ * @param parentChanged True if the render transform of the parent changed in
+ *                      this pass, which forces a visit of this subtree.
+ * @return True if this subtree is still being interpolated and must be
+ *         visited again in the next pass.
+ */
+bool OkObject::propagateTransform(float alpha, bool parentChanged) {
+  if (!parentChanged && !subtreeDirty) {
+    return false;
+  }
+
+  bool worldChanged = transformChanged;
+  if (worldChanged) {
+    resolveWorldTransform();
+    transformChanged = false;
+  }
+
+  // Interpolate while this object or an ancestor is moving
+  bool wasInterpolated    = renderInterpolated;
+  bool parentInterpolated = _parent && _parent->renderInterpolated;
+  renderInterpolated =
+      parentInterpolated || (moving && hasPreviousState && alpha < 1.0f);
+
+  if (renderInterpolated) {
+    glm::mat4 localRender = localMatrix;
+    if (moving && hasPreviousState) {
+      localRender =
+          buildLocalMatrix(previousPosition.lerp(position, alpha),
+                           previousRotation.interpolate(rotation, alpha));
+    }
+    renderMatrix =
+        _parent ? _parent->getRenderMatrix() * localRender : localRender;
+  }
+
+  bool renderChanged = worldChanged || renderInterpolated || wasInterpolated;
+  if (renderChanged) {
+    updateTransformSelf();
+  }
 
   // Then recursively update all children's transforms
+  bool      stillDirty = renderInterpolated;
+  OkObject *current    = _firstChild;
+  while (current != nullptr) {
+    stillDirty |= current->propagateTransform(alpha, renderChanged);
+    current = current->getNextSibling();
+  }
+
+  updateBounds(renderChanged);
+
+  subtreeDirty = stillDirty;
+  return stillDirty;
+}
+
+/**
+ * @brief Rebuild the world bounds after a transform pass.
+ *        The subtree bound is merged from the bounds of the children, which
+ *        are up to date since they were visited first (or did not change).
+ * @param renderChanged True if the render transform of this object changed,
+ *                      so its own bound must be transformed again.
+ */
+void OkObject::updateBounds(bool renderChanged) {
+  if (renderChanged) {
+    bounds = getLocalBounds().transformed(getRenderMatrix());
+  }
+
+  subtreeBounds = bounds;
+  subtreeSize   = 1;
+
   OkObject *current = _firstChild;
   while (current != nullptr) {
-    current->updateTransform();
+    subtreeBounds.merge(current->subtreeBounds);
+    subtreeSize += current->subtreeSize;
     current = current->getNextSibling();
   }
 }
 
+/**
+ * @brief Get the bound of this object in local coordinates.
+ *        Objects without geometry draw themselves in immediate mode, so
+ *        their extent is unknown and they are never culled.
+ * @return The local bound.
+ */
+OkBoundingSphere OkObject::getLocalBounds() const {
+  return OkBoundingSphere::unbounded();
+}
+
 /**
  * @brief Update the object's state for the current frame.
  *        This method processes movement and rotation based on speed and
@@ -267,6 +503,11 @@ void OkObject::updateTransform() {
 void OkObject::step(float dt) {
   float frameTime = dt / OkConfig::getFloat("graphics.time-per-frame");
 
+  // Keep the state before this step for interpolated drawing
+  previousPosition = position;
+  previousRotation = rotation;
+  hasPreviousState = true;
+
   // Process movement if there's any speed
   if (speed.x() != 0 || speed.y() != 0 || speed.z() != 0) {
     // Check if speed exceeds maxVel
@@ -287,6 +528,15 @@ void OkObject::step(float dt) {
   // Call the derived class's specific update logic
   stepSelf(dt);
 
+  // Moving objects are interpolated when drawn, and the object must be
+  // visited by the next transform pass when it starts or stops moving
+  bool nowMoving = !(position == previousPosition) ||
+                   !(rotation == previousRotation);
+  if (nowMoving != moving) {
+    moving = nowMoving;
+    markSubtreeDirty();
+  }
+
   // Update children recursively (this stays in OkObject)
   OkObject *current = _firstChild;
   while (current != nullptr) {
@@ -318,6 +568,73 @@ void OkObject::draw() {
   }
 }
 
+/**
+ * @brief Add the object and its children to a render queue.
+ *        Same sequence as draw(), but the draws are queued to be sorted
+ *        instead of issued right away, and the subtrees outside the view
+ *        frustum of the queue are skipped.
+ * @param queue The render queue.
+ */
+void OkObject::submit(OkRenderQueue &queue) {
+  submitCulled(queue, false);
+}
+
+/**
+ * @brief Recursive part of submit.
+ *        Once a subtree bound is fully inside the frustum, its descendants are
+ *        submitted without further tests.
+ * @param queue         The render queue.
+ * @param insideFrustum True if an ancestor is fully inside the frustum.
+ */
+void OkObject::submitCulled(OkRenderQueue &queue, bool insideFrustum) {
+  bool selfVisible = true;
+
+  if (!insideFrustum && queue.isCulling()) {
+    const OkFrustum &frustum = queue.getFrustum();
+
+    OkCullResult result = frustum.test(subtreeBounds);
+    if (result == OkCullResult::Outside) {
+      queue.countCulled(subtreeSize);
+      return;
+    }
+
+    insideFrustum = result == OkCullResult::Inside;
+    if (!insideFrustum && _firstChild != nullptr) {
+      selfVisible = frustum.test(bounds) != OkCullResult::Outside;
+    }
+  }
+
+  if (selfVisible) {
+    // Call the derived class's specific submission logic
+    submitSelf(queue);
+    queue.countVisible(1);
+
+    // Only draw axes if enabled for this object
+    if (drawOriginAxis) {
+      queue.addCustom(this, OkDrawPass::Debug);
+    }
+  } else {
+    queue.countCulled(1);
+  }
+
+  // Submit children recursively
+  OkObject *current = _firstChild;
+  while (current != nullptr) {
+    current->submitCulled(queue, insideFrustum);
+    current = current->getNextSibling();
+  }
+}
+
+/**
+ * @brief Add the draw packets of this object to a render queue.
+ *        Objects that do not know how to build packets are drawn in immediate
+ *        mode, their drawSelf is called when the queue is flushed.
+ * @param queue The render queue.
+ */
+void OkObject::submitSelf(OkRenderQueue &queue) {
+  queue.addCustom(this);
+}
+
 /**
  * @brief Draw coordinate axis for this object using its transform matrix.
  *        Shows X (red), Y (green), and Z (blue) axes using simple OpenGL.
@@ -338,7 +655,7 @@ void OkObject::drawAxis() const {
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
 
-  glBindVertexArray(VAO);
+  OkGLState::bindVertexArray(VAO);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER, sizeof(axisVertices), axisVertices,
                GL_STATIC_DRAW);
@@ -347,48 +664,34 @@ void OkObject::drawAxis() const {
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
   glEnableVertexAttribArray(0);
 
-  // Get current shader program to reuse it
-  GLint current_program;
-  glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
-
-  if (current_program != 0) {
-    // Get model matrix uniform location
-    GLint modelLoc = glGetUniformLocation(current_program, "model");
-    if (modelLoc != -1) {
-      glm::mat4 model = getTransformMatrix();
-      glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    }
+  // Get current shader program to reuse it, or its untextured variant
+  OkShaderProgram *program = OkShaderProgram::getCurrent();
+  if (program != nullptr) {
+    program = program->getVariant(0);
+  }
 
-    // Try to disable texturing
-    GLint hasTexLoc = glGetUniformLocation(current_program, "hasTexture");
-    if (hasTexLoc != -1) {
-      glUniform1i(hasTexLoc, 0);
-    }
+  if (program != nullptr) {
+    program->use();
 
-    // Draw each axis with different colors
-    GLint colorLoc = glGetUniformLocation(current_program, "wireframeColor");
+    // Draw each axis with different colors, without texture
 
     // Draw X-axis in red
-    if (colorLoc != -1) {
-      glUniform4f(colorLoc, 1.0f, 0.0f, 0.0f, 1.0f);
-    }
+    OkRenderQueue::setObject(program, getRenderMatrix(),
+                             glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
     glDrawArrays(GL_LINES, 0, 2);
 
     // Draw Y-axis in green
-    if (colorLoc != -1) {
-      glUniform4f(colorLoc, 0.0f, 1.0f, 0.0f, 1.0f);
-    }
+    OkRenderQueue::setObject(program, getRenderMatrix(),
+                             glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
     glDrawArrays(GL_LINES, 2, 2);
 
     // Draw Z-axis in blue
-    if (colorLoc != -1) {
-      glUniform4f(colorLoc, 0.0f, 0.0f, 1.0f, 1.0f);
-    }
+    OkRenderQueue::setObject(program, getRenderMatrix(),
+                             glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
     glDrawArrays(GL_LINES, 4, 2);
   }
 
   // Clean up temporary buffers
-  glBindVertexArray(0);
   glDeleteBuffers(1, &VBO);
-  glDeleteVertexArrays(1, &VAO);
+  OkGLState::deleteVertexArray(VAO);
 }
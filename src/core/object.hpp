@@ -3,12 +3,22 @@
 
 #include "../math/point.hpp"
 #include "../math/rotation.hpp"
+#include "../render/frustum.hpp"
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <string>
 
+class OkOctree;
+class OkRenderQueue;
+
 class OkObject {
+  // The render queue calls drawSelf for objects drawn in immediate mode
+  friend class OkRenderQueue;
+
+  // The octree of the scene indexes root objects and updates them
+  friend class OkOctree;
+
 protected:
   std::string name;
 
@@ -16,6 +26,12 @@ protected:
   OkRotation rotation;
   OkPoint    scaling;
 
+  // State at the start of the last simulation step, used to interpolate
+  // between steps when drawing
+  OkPoint    previousPosition;
+  OkRotation previousRotation;
+  bool       hasPreviousState;
+
   // Physics
   OkPoint speed;
   float   maxVel;
@@ -34,12 +50,63 @@ protected:
   // Flags
   bool drawOriginAxis;  // Flag to draw origin axis
 
+  // Cached transforms, rebuilt lazily when flagged as dirty
+  mutable glm::mat4  localMatrix;
+  mutable glm::mat4  worldMatrix;
+  mutable glm::mat4  worldRotationMatrix;  // Rotation only, no translation
+  mutable OkPoint    worldPosition;
+  mutable OkRotation worldRotation;
+  glm::mat4          renderMatrix;  // Interpolated world matrix for drawing
+
+  // Transform dirty flags
+  // A dirty world transform implies dirty world transforms in all the
+  // descendants, and a dirty subtree implies dirty subtrees in all the
+  // ancestors, so marking can stop as soon as it finds a flag already set
+  mutable bool localDirty;          // Local matrix must be rebuilt
+  mutable bool worldDirty;          // World transform must be rebuilt
+  mutable bool worldRotationDirty;  // World Euler angles must be rebuilt
+  bool         transformChanged;    // World changed since the last pass
+  bool         subtreeDirty;        // This object or a descendant needs a pass
+  bool         moving;              // Moved during the last simulation step
+  bool         renderInterpolated;  // renderMatrix differs from worldMatrix
+
+  // Bounds in world coordinates, rebuilt by the transform pass from the
+  // render matrix
+  OkBoundingSphere bounds;         // This object only
+  OkBoundingSphere subtreeBounds;  // This object and all its descendants
+  int              subtreeSize;    // Number of objects in the subtree
+
+  // Spatial index notified when the subtree of this (root) object changes
+  OkOctree *_octree;
+
+  // Bound in local coordinates, by default infinite so objects drawing in
+  // immediate mode are never culled
+  virtual OkBoundingSphere getLocalBounds() const;
+
+  // Build a local matrix from a position and rotation (scaling applied too)
+  glm::mat4 buildLocalMatrix(const OkPoint    &localPosition,
+                             const OkRotation &localRotation) const;
+
+  // Transform cache maintenance
+  void markTransformDirty();
+  void markSubtreeDirty();
+  void resolveWorldTransform() const;
+  bool propagateTransform(float alpha, bool parentChanged);
+  void updateBounds(bool renderChanged);
+
+  // Recursive part of submit, insideFrustum skips the culling tests
+  void submitCulled(OkRenderQueue &queue, bool insideFrustum);
+
   // Pure virtual method for derived classes to implement their specific drawing
   // and update
   virtual void drawSelf()            = 0;
   virtual void stepSelf(float dt)    = 0;
   virtual void updateTransformSelf() = 0;
 
+  // Add the draw packets of this object to a render queue, by default the
+  // object is drawn in immediate mode with drawSelf
+  virtual void submitSelf(OkRenderQueue &queue);
+
 public:
   OkObject(const std::string &name);
   virtual ~OkObject();
@@ -62,7 +129,11 @@ public:
 
   // Scale
   OkPoint getScaling() const { return scaling; }
-  void    setScaling(float x, float y, float z) { scaling = OkPoint(x, y, z); }
+  void    setScaling(float x, float y, float z) {
+    scaling    = OkPoint(x, y, z);
+    localDirty = true;
+    markTransformDirty();
+  }
 
   // Physics
   OkPoint getSpeed() const { return speed; }
@@ -84,17 +155,32 @@ public:
   OkObject *getFirstChild() const { return _firstChild; }
   OkObject *getParent() const { return _parent; }
 
-  // Transform matrix
-  glm::mat4 getTransformMatrix() const;
+  // Transform matrix (cached world transform)
+  const glm::mat4 &getTransformMatrix() const;
+
+  // Transform matrix interpolated between the last two simulation steps, as
+  // computed by the last updateTransform pass
+  const glm::mat4 &getRenderMatrix() const;
 
-  // Final transform update that enforces hierarchy
+  // Per-frame transform pass that enforces hierarchy, it only visits the
+  // subtrees that changed or are being interpolated
   virtual void updateTransform() final;
+  void         updateTransform(float alpha);
 
   // Final step method that enforces the update sequence
   virtual void step(float dt) final;
 
   // Final draw method that enforces the drawing sequence
   virtual void draw() final;
+
+  // World bounds computed by the last updateTransform pass
+  const OkBoundingSphere &getBounds() const { return bounds; }
+  const OkBoundingSphere &getSubtreeBounds() const { return subtreeBounds; }
+  int                     getSubtreeSize() const { return subtreeSize; }
+
+  // Final method that adds this object and its children to a render queue,
+  // skipping the subtrees outside the view frustum of the queue
+  virtual void submit(OkRenderQueue &queue) final;
 };
 
 #endif
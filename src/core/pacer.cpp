@@ -0,0 +1,114 @@
+#include "pacer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+/**
+ * @brief Constructor for the OkFramePacer class.
+ * @param timePerFrame     Target time between rendered frames.
+ * @param timePerStep      Fixed time simulated by every step.
+ * @param maxStepsPerFrame Maximum number of steps run in a single frame.
+ * @param sleepMargin      Time before the deadline where the pacer stops
+ *                         sleeping and yields instead, to absorb the coarse
+ *                         granularity of the OS sleep.
+ */
+OkFramePacer::OkFramePacer(float timePerFrame, float timePerStep,
+                           int maxStepsPerFrame, float sleepMargin) {
+  this->timePerFrame     = std::max(timePerFrame, 0.0f);
+  this->timePerStep      = timePerStep > 0.0f ? timePerStep : timePerFrame;
+  this->maxStepsPerFrame = std::max(maxStepsPerFrame, 1);
+  this->sleepMargin      = std::max(sleepMargin, 0.0f);
+
+  origin = Clock::now();
+  reset();
+}
+
+/**
+ * @brief Restart timing from the current instant.
+ *        The accumulator starts holding a full step, so the first frame
+ *        always simulates once before drawing.
+ */
+void OkFramePacer::reset() {
+  accumulator   = timePerStep;
+  lastFrameTime = now();
+  nextDeadline  = lastFrameTime + timePerFrame;
+  frameDelta    = 0.0f;
+  alpha         = 0.0f;
+  droppedSteps  = 0;
+}
+
+/**
+ * @brief Get the current time.
+ * @return Milliseconds since the pacer was created.
+ */
+double OkFramePacer::now() const {
+  return std::chrono::duration<double, std::milli>(Clock::now() - origin)
+      .count();
+}
+
+/**
+ * @brief Start a new frame.
+ *        Measures the real time elapsed since the previous frame and feeds it
+ *        into the fixed step accumulator.
+ * @return The number of fixed steps to simulate in this frame.
+ */
+int OkFramePacer::beginFrame() {
+  double currentTime = now();
+  double elapsed     = currentTime - lastFrameTime;
+  lastFrameTime      = currentTime;
+
+  return advance(elapsed);
+}
+
+/**
+ * @brief Add elapsed time to the accumulator and consume it in fixed steps.
+ * @param elapsed The real time elapsed since the previous frame.
+ * @return The number of fixed steps to simulate.
+ * @note  If more than maxStepsPerFrame steps are pending (for example after a
+ *        long stall), the excess is dropped so the simulation does not try to
+ *        catch up forever.
+ */
+int OkFramePacer::advance(double elapsed) {
+  frameDelta = static_cast<float>(std::max(elapsed, 0.0));
+  accumulator += frameDelta;
+
+  int steps = static_cast<int>(accumulator / timePerStep);
+  accumulator -= steps * static_cast<double>(timePerStep);
+
+  if (steps > maxStepsPerFrame) {
+    droppedSteps += steps - maxStepsPerFrame;
+    steps = maxStepsPerFrame;
+  }
+
+  alpha = static_cast<float>(accumulator / timePerStep);
+  return steps;
+}
+
+/**
+ * @brief Wait until the next frame is due.
+ *        Sleeps while the deadline is further than the sleep margin, then
+ *        yields the thread for the remaining time. The core is released to
+ *        the OS for almost the whole wait instead of spinning on the clock.
+ */
+void OkFramePacer::waitForNextFrame() {
+  double currentTime = now();
+
+  // If we are more than a frame late, resynchronize instead of rushing
+  // several frames back to back
+  if (currentTime - nextDeadline > timePerFrame) {
+    nextDeadline = currentTime;
+  }
+
+  double remaining = nextDeadline - currentTime;
+  while (remaining > sleepMargin) {
+    std::this_thread::sleep_for(
+        std::chrono::duration<double, std::milli>(remaining - sleepMargin));
+    remaining = nextDeadline - now();
+  }
+
+  while (now() < nextDeadline) {
+    std::this_thread::yield();
+  }
+
+  nextDeadline += timePerFrame;
+}
@@ -0,0 +1,59 @@
+#ifndef OK_PACER_HPP
+#define OK_PACER_HPP
+
+#include <chrono>
+
+/**
+ * @brief Frame scheduler for the engine main loop.
+ *        It paces rendered frames with a hybrid sleep/yield wait instead of
+ *        busy-waiting, and drives the simulation with a fixed timestep
+ *        accumulator. The leftover time in the accumulator is exposed as an
+ *        interpolation factor so drawing can blend between the last two
+ *        simulation states.
+ *        All times are expressed in milliseconds.
+ */
+class OkFramePacer {
+public:
+  OkFramePacer(float timePerFrame, float timePerStep, int maxStepsPerFrame,
+               float sleepMargin = 2.0f);
+
+  // Restart timing from the current instant
+  void reset();
+
+  // Measure the elapsed time and return the number of fixed steps to run
+  int beginFrame();
+
+  // Feed an elapsed time into the accumulator (used by beginFrame)
+  int advance(double elapsed);
+
+  // Sleep (and then yield) until the next frame is due
+  void waitForNextFrame();
+
+  // Getters
+  float getTimePerFrame() const { return timePerFrame; }
+  float getTimePerStep() const { return timePerStep; }
+  int   getMaxStepsPerFrame() const { return maxStepsPerFrame; }
+  float getFrameDelta() const { return frameDelta; }
+  float getAlpha() const { return alpha; }
+  long  getDroppedSteps() const { return droppedSteps; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  double now() const;
+
+  float timePerFrame;      // Target time between rendered frames
+  float timePerStep;       // Fixed simulation step
+  int   maxStepsPerFrame;  // Upper bound of steps to avoid a spiral of death
+  float sleepMargin;       // Time before the deadline spent yielding
+
+  Clock::time_point origin;
+  double            accumulator;    // Simulation time not consumed yet
+  double            lastFrameTime;  // Start of the previous frame
+  double            nextDeadline;   // When the next frame should start
+  float             frameDelta;     // Real time elapsed in the last frame
+  float             alpha;          // Interpolation factor [0, 1)
+  long              droppedSteps;   // Steps discarded by the step limit
+};
+
+#endif
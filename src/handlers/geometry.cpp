@@ -0,0 +1,479 @@
+#include "geometry.hpp"
+#include "../config/config.hpp"
+#include "../core/gl_config.hpp"
+#include "../core/gl_state.hpp"
+#include "../item/mesh.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+OkGeometryPool *OkGeometryPool::instance = nullptr;
+
+/**
+ * @brief Constructor for the OkGeometryPool class.
+ *        This class is a singleton, pages are created with the first meshes.
+ */
+OkGeometryPool::OkGeometryPool() : movedBytes(0) {}
+
+/**
+ * @brief Destructor for the OkGeometryPool class.
+ *        Releases the buffers.
+ */
+OkGeometryPool::~OkGeometryPool() {
+  cleanup();
+}
+
+/**
+ * @brief Get the singleton instance of the OkGeometryPool.
+ *        This method creates the instance if it doesn't exist.
+ * @return Pointer to the OkGeometryPool instance.
+ */
+OkGeometryPool *OkGeometryPool::getInstance() {
+  if (!instance) {
+    instance = new OkGeometryPool();
+  }
+
+  return instance;
+}
+
+/**
+ * @brief Tell if new meshes are stored in the pool.
+ * @return True if graphics.geometry-pool is set.
+ */
+bool OkGeometryPool::isEnabled() {
+  return OkConfig::getBool("graphics.geometry-pool");
+}
+
+/**
+ * @brief Get the size of an index.
+ * @param indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ * @return The size in bytes.
+ */
+size_t OkGeometryPool::_indexSize(GLenum indexType) {
+  return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+/**
+ * @brief Create a page, with room for graphics.geometry-page-bytes of
+ *        vertices and as many bytes of indices, or for the given counts if
+ *        they need more.
+ * @param layout      The vertex layout of the page.
+ * @param indexType   The index type of the page.
+ * @param vertexCount The number of vertices the page must hold.
+ * @param indexCount  The number of indices the page must hold.
+ * @return The index of the page.
+ */
+size_t OkGeometryPool::_createPage(const OkVertexLayout &layout,
+                                   GLenum indexType, size_t vertexCount,
+                                   size_t indexCount) {
+  size_t bytes = static_cast<size_t>(
+      std::max(OkConfig::getInt("graphics.geometry-page-bytes"), 0));
+  size_t stride = layout.getStride();
+
+  Page *page           = new Page();
+  page->layout         = layout;
+  page->indexType      = indexType;
+  page->instanceBuffer = 0;
+  page->vertexRanges.reset(std::max(bytes / stride, vertexCount));
+  page->indexRanges.reset(std::max(bytes / _indexSize(indexType), indexCount));
+
+  glGenVertexArrays(1, &page->vao);
+  OkGLState::bindVertexArray(page->vao);
+
+  glGenBuffers(1, &page->vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, page->vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(page->vertexRanges.getCapacity() *
+                                       stride),
+               nullptr, GL_STATIC_DRAW);
+  layout.setAttributes();
+
+  // The index buffer binding is part of the vertex array
+  glGenBuffers(1, &page->indexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(page->indexRanges.getCapacity() *
+                                       _indexSize(indexType)),
+               nullptr, GL_STATIC_DRAW);
+
+  OkGLState::bindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Reuse the slot of a deleted page, allocations store the index
+  for (size_t i = 0; i < pages.size(); i++) {
+    if (pages[i] == nullptr) {
+      pages[i] = page;
+      return i;
+    }
+  }
+  pages.push_back(page);
+  return pages.size() - 1;
+}
+
+/**
+ * @brief Delete a page and its buffers.
+ * @param index The index of the page.
+ */
+void OkGeometryPool::_deletePage(size_t index) {
+  Page *page = pages[index];
+  if (page == nullptr) {
+    return;
+  }
+
+  OkGLState::deleteVertexArray(page->vao);
+  glDeleteBuffers(1, &page->vertexBuffer);
+  glDeleteBuffers(1, &page->indexBuffer);
+  if (page->instanceBuffer != 0) {
+    glDeleteBuffers(1, &page->instanceBuffer);
+  }
+
+  delete page;
+  pages[index] = nullptr;
+}
+
+/**
+ * @brief Take the vertex and index ranges of an allocation in a page.
+ * @param page       The page.
+ * @param allocation The allocation, its counts set.
+ * @return True if both ranges were taken.
+ */
+bool OkGeometryPool::_place(Page *page, Allocation *allocation) {
+  if (!page->vertexRanges.allocate(allocation->vertexCount,
+                                   allocation->firstVertex)) {
+    return false;
+  }
+  if (!page->indexRanges.allocate(allocation->indexCount,
+                                  allocation->firstIndex)) {
+    page->vertexRanges.free(allocation->firstVertex, allocation->vertexCount);
+    return false;
+  }
+
+  page->allocations.push_back(allocation);
+  return true;
+}
+
+/**
+ * @brief Upload the data of an allocation to its ranges.
+ *        The copy target is used, so the bindings of the vertex arrays are
+ *        left untouched.
+ * @param page       The page of the allocation.
+ * @param allocation The allocation.
+ */
+void OkGeometryPool::_upload(const Page       *page,
+                             const Allocation *allocation) const {
+  size_t stride    = page->layout.getStride();
+  size_t indexSize = _indexSize(page->indexType);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, page->vertexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  static_cast<GLintptr>(allocation->firstVertex * stride),
+                  static_cast<GLsizeiptr>(allocation->vertexCount * stride),
+                  allocation->vertices);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, page->indexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  static_cast<GLintptr>(allocation->firstIndex * indexSize),
+                  static_cast<GLsizeiptr>(allocation->indexCount * indexSize),
+                  allocation->indices);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * @brief Store the geometry of a mesh.
+ *        It goes to the first page of its layout and index type with room
+ *        for it. If the room is only there once a page is compacted, the
+ *        page is compacted, otherwise a new page is created.
+ * @param layout      The vertex layout.
+ * @param indexType   GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ * @param vertices    The vertex data, kept by the caller while stored.
+ * @param vertexCount The number of vertices.
+ * @param indices     The index data, kept by the caller while stored.
+ * @param indexCount  The number of indices.
+ * @return The allocation, nullptr for meshes without vertices.
+ */
+OkGeometryPool::Allocation *
+OkGeometryPool::allocate(const OkVertexLayout &layout, GLenum indexType,
+                         const unsigned char *vertices, size_t vertexCount,
+                         const void *indices, size_t indexCount) {
+  if (vertices == nullptr || vertexCount == 0) {
+    return nullptr;
+  }
+
+  Allocation *allocation  = new Allocation();
+  allocation->vertices    = vertices;
+  allocation->indices     = indices;
+  allocation->vertexCount = vertexCount;
+  allocation->indexCount  = indices ? indexCount : 0;
+
+  size_t found = pages.size();
+  for (size_t i = 0; i < pages.size() && found == pages.size(); i++) {
+    Page *page = pages[i];
+    if (page && page->layout == layout && page->indexType == indexType &&
+        _place(page, allocation)) {
+      found = i;
+    }
+  }
+
+  // Holes left by freed meshes may add up to enough room
+  for (size_t i = 0; i < pages.size() && found == pages.size(); i++) {
+    Page *page = pages[i];
+    if (page && page->layout == layout && page->indexType == indexType &&
+        page->vertexRanges.getFree() >= vertexCount &&
+        page->indexRanges.getFree() >= allocation->indexCount) {
+      _compact(page);
+      if (_place(page, allocation)) {
+        found = i;
+      }
+    }
+  }
+
+  if (found == pages.size()) {
+    found = _createPage(layout, indexType, vertexCount, allocation->indexCount);
+    _place(pages[found], allocation);
+  }
+
+  allocation->page = found;
+  _upload(pages[found], allocation);
+  return allocation;
+}
+
+/**
+ * @brief Give back the ranges of a mesh. Pages left empty are deleted.
+ * @param allocation The allocation, deleted.
+ */
+void OkGeometryPool::free(Allocation *allocation) {
+  if (allocation == nullptr) {
+    return;
+  }
+
+  Page *page = pages[allocation->page];
+  page->vertexRanges.free(allocation->firstVertex, allocation->vertexCount);
+  page->indexRanges.free(allocation->firstIndex, allocation->indexCount);
+
+  std::vector<Allocation *> &allocations = page->allocations;
+  allocations.erase(
+      std::find(allocations.begin(), allocations.end(), allocation));
+  if (allocations.empty()) {
+    _deletePage(allocation->page);
+  }
+
+  delete allocation;
+}
+
+/**
+ * @brief Get the vertex array of the page of a mesh.
+ * @param allocation The allocation of the mesh.
+ * @return The vertex array name.
+ */
+GLuint OkGeometryPool::getVAO(const Allocation *allocation) const {
+  return pages[allocation->page]->vao;
+}
+
+/**
+ * @brief Get the instance buffer of the page of a mesh, creating it on the
+ *        first call. It is shared by all the meshes of the page, every
+ *        instanced draw streams its instances to it first.
+ * @param allocation The allocation of the mesh.
+ * @return The instance buffer name.
+ */
+GLuint OkGeometryPool::getInstanceBuffer(const Allocation *allocation) {
+  Page *page = pages[allocation->page];
+  if (page->instanceBuffer != 0) {
+    return page->instanceBuffer;
+  }
+
+  glGenBuffers(1, &page->instanceBuffer);
+
+  OkGLState::bindVertexArray(page->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, page->instanceBuffer);
+  OkMesh::setInstanceAttributes();
+
+  OkGLState::bindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  return page->instanceBuffer;
+}
+
+/**
+ * @brief Get the byte offset of the first index of a mesh.
+ * @param allocation The allocation of the mesh.
+ * @return The offset, as given to the draw calls.
+ */
+GLintptr OkGeometryPool::getIndexOffset(const Allocation *allocation) const {
+  return static_cast<GLintptr>(
+      allocation->firstIndex * _indexSize(pages[allocation->page]->indexType));
+}
+
+/**
+ * @brief Move the meshes of a page to the start of its buffers, in the
+ *        order they are stored, leaving all the free room at the end.
+ *        Moved meshes are uploaded again from their data in memory.
+ * @param page The page.
+ * @return The number of bytes uploaded.
+ */
+size_t OkGeometryPool::_compact(Page *page) {
+  std::vector<Allocation *> sorted = page->allocations;
+  std::vector<bool>         moved(sorted.size(), false);
+
+  // Vertices and indices are compacted separately, each in offset order
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Allocation *a, const Allocation *b) {
+              return a->firstVertex < b->firstVertex;
+            });
+  size_t vertexEnd = 0;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    if (sorted[i]->firstVertex != vertexEnd) {
+      sorted[i]->firstVertex = vertexEnd;
+      moved[i]               = true;
+    }
+    vertexEnd += sorted[i]->vertexCount;
+  }
+
+  std::vector<Allocation *> byIndex = sorted;
+  std::sort(byIndex.begin(), byIndex.end(),
+            [](const Allocation *a, const Allocation *b) {
+              return a->firstIndex < b->firstIndex;
+            });
+  size_t indexEnd = 0;
+  for (size_t i = 0; i < byIndex.size(); i++) {
+    if (byIndex[i]->firstIndex != indexEnd) {
+      byIndex[i]->firstIndex = indexEnd;
+      size_t position =
+          std::find(sorted.begin(), sorted.end(), byIndex[i]) - sorted.begin();
+      moved[position] = true;
+    }
+    indexEnd += byIndex[i]->indexCount;
+  }
+
+  // Everything before the ends is taken, the rest is one free range
+  size_t offset = 0;
+  page->vertexRanges.reset(page->vertexRanges.getCapacity());
+  page->vertexRanges.allocate(vertexEnd, offset);
+  page->indexRanges.reset(page->indexRanges.getCapacity());
+  page->indexRanges.allocate(indexEnd, offset);
+
+  size_t bytes = 0;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    if (moved[i]) {
+      _upload(page, sorted[i]);
+      bytes += sorted[i]->vertexCount * page->layout.getStride() +
+               sorted[i]->indexCount * _indexSize(page->indexType);
+    }
+  }
+
+  movedBytes += bytes;
+  return bytes;
+}
+
+/**
+ * @brief Compact the pages where the free room is too scattered to hold
+ *        new meshes: more than graphics.geometry-fragmentation of their free
+ *        vertices or indices lies outside the largest free range.
+ *        Called once per frame by the main loop.
+ * @return The number of bytes uploaded again.
+ */
+size_t OkGeometryPool::update() {
+  float threshold = OkConfig::getFloat("graphics.geometry-fragmentation");
+
+  size_t bytes = 0;
+  for (size_t i = 0; i < pages.size(); i++) {
+    Page *page = pages[i];
+    if (page && (page->vertexRanges.getFragmentation() > threshold ||
+                 page->indexRanges.getFragmentation() > threshold)) {
+      bytes += _compact(page);
+    }
+  }
+  return bytes;
+}
+
+/**
+ * @brief Compact all the pages.
+ * @return The number of bytes uploaded again.
+ */
+size_t OkGeometryPool::defragment() {
+  size_t bytes = 0;
+  for (size_t i = 0; i < pages.size(); i++) {
+    if (pages[i]) {
+      bytes += _compact(pages[i]);
+    }
+  }
+  return bytes;
+}
+
+/**
+ * @brief Get the number of pages.
+ * @return The number of pages holding meshes.
+ */
+size_t OkGeometryPool::getPageCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < pages.size(); i++) {
+    if (pages[i]) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Get the number of meshes stored.
+ * @return The number of allocations.
+ */
+size_t OkGeometryPool::getAllocationCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < pages.size(); i++) {
+    if (pages[i]) {
+      count += pages[i]->allocations.size();
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Get the bytes of vertices and indices stored.
+ * @return The number of bytes, holes excluded.
+ */
+size_t OkGeometryPool::getUsedBytes() const {
+  size_t bytes = 0;
+  for (size_t i = 0; i < pages.size(); i++) {
+    const Page *page = pages[i];
+    if (page) {
+      bytes += page->vertexRanges.getUsed() * page->layout.getStride() +
+               page->indexRanges.getUsed() * _indexSize(page->indexType);
+    }
+  }
+  return bytes;
+}
+
+/**
+ * @brief Release the buffers of all the pages.
+ *        Pages still holding meshes keep their bookkeeping, so the meshes
+ *        can still be freed, but they cannot be drawn anymore. Must be
+ *        called while the OpenGL context exists.
+ */
+void OkGeometryPool::cleanup() {
+  for (size_t i = 0; i < pages.size(); i++) {
+    Page *page = pages[i];
+    if (page == nullptr) {
+      continue;
+    }
+
+    if (page->allocations.empty()) {
+      _deletePage(i);
+      continue;
+    }
+
+    OkLogger::warning("Geometry", "Releasing a page still holding " +
+                                      std::to_string(page->allocations.size()) +
+                                      " meshes");
+    OkGLState::deleteVertexArray(page->vao);
+    glDeleteBuffers(1, &page->vertexBuffer);
+    glDeleteBuffers(1, &page->indexBuffer);
+    glDeleteBuffers(1, &page->instanceBuffer);
+    page->vao            = 0;
+    page->vertexBuffer   = 0;
+    page->indexBuffer    = 0;
+    page->instanceBuffer = 0;
+  }
+}
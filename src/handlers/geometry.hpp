@@ -0,0 +1,114 @@
+#ifndef OK_GEOMETRY_HPP
+#define OK_GEOMETRY_HPP
+
+#include "../core/gl_config.hpp"
+#include "../item/layout.hpp"
+#include "../render/allocator.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Shared buffers holding the geometry of the meshes.
+ *        Meshes with the same vertex layout and index type are packed in
+ *        pages: one large vertex buffer and one large index buffer, drawn
+ *        through a single vertex array, with ranges handed out by an offset
+ *        allocator. Draws select their mesh with a base vertex and an index
+ *        offset, so consecutive draws from a page never rebind the vertex
+ *        array, and compatible ones are merged into multi-draw calls.
+ *        Freed ranges leave holes; pages where the free space is too
+ *        scattered are compacted by uploading the meshes again from their
+ *        data in memory, at lower offsets.
+ */
+class OkGeometryPool {
+public:
+  // Place of a mesh in the pool, updated when its page is compacted
+  struct Allocation {
+    size_t page;         // Index of the page
+    size_t firstVertex;  // Base vertex of the draws
+    size_t firstIndex;   // Index offset of the draws, in indices
+    size_t vertexCount;
+    size_t indexCount;
+
+    // Data of the mesh, which must outlive the allocation
+    const unsigned char *vertices;
+    const void          *indices;
+  };
+
+private:
+  // Buffers of meshes sharing a vertex layout and index type
+  struct Page {
+    OkVertexLayout   layout;
+    GLenum           indexType;
+    GLuint           vao;
+    GLuint           vertexBuffer;
+    GLuint           indexBuffer;
+    GLuint           instanceBuffer;  // Shared by the instanced draws
+    OkRangeAllocator vertexRanges;    // In vertices
+    OkRangeAllocator indexRanges;     // In indices
+
+    std::vector<Allocation *> allocations;
+  };
+
+  std::vector<Page *> pages;       // Empty pages are deleted, nullptr slots
+  size_t              movedBytes;  // Uploaded again by compaction
+
+  // Private constructor - singleton
+  OkGeometryPool();
+
+  // Singleton instance
+  static OkGeometryPool *instance;
+
+  size_t _createPage(const OkVertexLayout &layout, GLenum indexType,
+                     size_t vertexCount, size_t indexCount);
+  void   _deletePage(size_t index);
+  bool   _place(Page *page, Allocation *allocation);
+  void   _upload(const Page *page, const Allocation *allocation) const;
+  size_t _compact(Page *page);
+
+  static size_t _indexSize(GLenum indexType);
+
+public:
+  // Delete copy constructor and assignment
+  OkGeometryPool(const OkGeometryPool &)            = delete;
+  OkGeometryPool &operator=(const OkGeometryPool &) = delete;
+
+  // Get singleton instance
+  static OkGeometryPool *getInstance();
+
+  // Enabled by graphics.geometry-pool
+  static bool isEnabled();
+
+  // Store the geometry of a mesh, nullptr if it cannot be stored
+  Allocation *allocate(const OkVertexLayout &layout, GLenum indexType,
+                       const unsigned char *vertices, size_t vertexCount,
+                       const void *indices, size_t indexCount);
+
+  // Give back the ranges of a mesh
+  void free(Allocation *allocation);
+
+  // Vertex array and instance buffer of the page of a mesh
+  GLuint getVAO(const Allocation *allocation) const;
+  GLuint getInstanceBuffer(const Allocation *allocation);
+
+  // Byte offset of the first index of a mesh, as given to the draw calls
+  GLintptr getIndexOffset(const Allocation *allocation) const;
+
+  // Main thread, once per frame: compact the pages whose free space is
+  // scattered above graphics.geometry-fragmentation
+  size_t update();
+
+  // Compact all the pages, returns the bytes uploaded again
+  size_t defragment();
+
+  // Getters
+  size_t getPageCount() const;
+  size_t getAllocationCount() const;
+  size_t getUsedBytes() const;
+  size_t getMovedBytes() const { return movedBytes; }
+
+  // Cleanup: release all the buffers, meshes still stored can only be freed
+  void cleanup();
+  ~OkGeometryPool();
+};
+
+#endif
@@ -0,0 +1,306 @@
+#include "loader.hpp"
+#include "../config/config.hpp"
+#include "../utils/logger.hpp"
+#include "meshes.hpp"
+#include "textures.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+/**
+ * @brief Create a load request.
+ * @param name   The name of the request, also the name of its asset in the
+ *               mesh or texture handler.
+ * @param work   Function run on a worker thread, returning false on error.
+ * @param upload Function run on the main thread after the work, returning
+ *               false on error.
+ */
+OkLoadRequest::OkLoadRequest(const std::string &name, Work work,
+                             Upload upload)
+    : name(name), state(OkLoadState::Pending), work(std::move(work)),
+      upload(std::move(upload)), cancelled(false), texture(nullptr),
+      mesh(nullptr) {}
+
+/**
+ * @brief Destructor for the OkLoadRequest class.
+ *        Releases the reference the request holds on its asset.
+ */
+OkLoadRequest::~OkLoadRequest() {
+  if (texture) {
+    OkTextureHandler::getInstance()->removeReference(name);
+  }
+  if (mesh) {
+    OkMeshHandler::getInstance()->removeReference(name);
+  }
+}
+
+/**
+ * @brief Add a function called on the main thread when the load finishes,
+ *        successfully or not. If it already finished, it is called now.
+ * @param owner    The object waiting for the load, used to cancel.
+ * @param function The callback.
+ */
+void OkLoadRequest::then(const void *owner, Callback function) {
+  if (isDone()) {
+    function(*this);
+    return;
+  }
+  callbacks.emplace_back(owner, std::move(function));
+  cancelled = false;
+}
+
+/**
+ * @brief Tell that an owner no longer needs the result.
+ *        Its callbacks are dropped. If no callback is left, a worker skips
+ *        the work if it did not start it yet.
+ * @param owner The object that was waiting for the load.
+ */
+void OkLoadRequest::cancel(const void *owner) {
+  callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(),
+                                 [owner](const auto &entry) {
+                                   return entry.first == owner;
+                                 }),
+                  callbacks.end());
+  if (callbacks.empty()) {
+    cancelled = true;
+  }
+}
+
+/**
+ * @brief Set the final state of the request and call its callbacks.
+ * @param success True if the asset is ready.
+ */
+void OkLoadRequest::finish(bool success) {
+  state = success ? OkLoadState::Ready : OkLoadState::Failed;
+
+  // Callbacks run once, and may add or cancel callbacks while running
+  std::vector<std::pair<const void *, Callback>> pending;
+  pending.swap(callbacks);
+  for (std::pair<const void *, Callback> &entry : pending) {
+    entry.second(*this);
+  }
+}
+
+OkAssetLoader *OkAssetLoader::instance = nullptr;
+
+/**
+ * @brief Constructor for the OkAssetLoader class.
+ *        This class is a singleton, its workers start with the first load.
+ */
+OkAssetLoader::OkAssetLoader() : active(0), stopping(false) {}
+
+/**
+ * @brief Destructor for the OkAssetLoader class.
+ *        Stops the workers and drops the requests.
+ */
+OkAssetLoader::~OkAssetLoader() {
+  cleanup();
+}
+
+/**
+ * @brief Get the singleton instance of the OkAssetLoader.
+ *        This method creates the instance if it doesn't exist.
+ * @return Pointer to the OkAssetLoader instance.
+ */
+OkAssetLoader *OkAssetLoader::getInstance() {
+  if (!instance) {
+    instance = new OkAssetLoader();
+  }
+
+  return instance;
+}
+
+/**
+ * @brief Start the worker threads, loader.threads of them, or one less than
+ *        the number of cores if it is 0, leaving one to the main thread.
+ */
+void OkAssetLoader::_startWorkers() {
+  int count = OkConfig::getInt("loader.threads");
+  if (count <= 0) {
+    count = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+  }
+  count = std::max(count, 1);
+
+  stopping = false;
+  workers.reserve(count);
+  for (int i = 0; i < count; i++) {
+    workers.emplace_back(&OkAssetLoader::_workerLoop, this);
+  }
+
+  OkLogger::info("Loader",
+                 "Started " + std::to_string(count) + " loader threads");
+}
+
+/**
+ * @brief Body of the worker threads: run the work of queued requests and
+ *        hand them over to the main thread for their upload.
+ */
+void OkAssetLoader::_workerLoop() {
+  while (true) {
+    std::shared_ptr<OkLoadRequest> request;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+      if (stopping) {
+        return;
+      }
+      request = std::move(jobs.front());
+      jobs.pop_front();
+      active++;
+    }
+
+    bool success = !request->isCancelled();
+    if (success && request->work) {
+      success = request->work();
+    }
+
+    // The request is moved, so it is never released on this thread
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.push_back({std::move(request), success});
+      active--;
+    }
+    jobDone.notify_all();
+  }
+}
+
+/**
+ * @brief Queue a load.
+ * @param name   The name of the request, also the name of its asset in the
+ *               mesh or texture handler.
+ * @param work   Function run on a worker thread: file reading, decoding or
+ *               parsing. It must not use OpenGL.
+ * @param upload Function run on the main thread by update after the work
+ *               succeeded: creation of the OpenGL objects.
+ * @return The request, pending until its upload.
+ */
+std::shared_ptr<OkLoadRequest>
+OkAssetLoader::load(const std::string &name, OkLoadRequest::Work work,
+                    OkLoadRequest::Upload upload) {
+  std::shared_ptr<OkLoadRequest> request =
+      std::make_shared<OkLoadRequest>(name, std::move(work), std::move(upload));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (workers.empty()) {
+      _startWorkers();
+    }
+    jobs.push_back(request);
+  }
+  jobAdded.notify_one();
+
+  return request;
+}
+
+/**
+ * @brief Upload finished requests.
+ * @param budget Time available in milliseconds. At least one request is
+ *               uploaded if any is waiting, so loading always progresses.
+ * @return The number of requests finished.
+ */
+int OkAssetLoader::_upload(double budget) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+
+  int count = 0;
+  while (true) {
+    Finished next;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (finished.empty()) {
+        break;
+      }
+      next = std::move(finished.front());
+      finished.pop_front();
+    }
+
+    OkLoadRequest &request = *next.request;
+    bool           success = next.success && !request.isCancelled();
+    if (success && request.upload) {
+      success = request.upload(request);
+    }
+    request.finish(success);
+    count++;
+
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    if (elapsed.count() >= budget) {
+      break;
+    }
+  }
+
+  return count;
+}
+
+/**
+ * @brief Upload the requests whose work is done, for up to a time budget.
+ *        Called once per frame by the main loop, on the thread owning the
+ *        OpenGL context.
+ * @param budget Time available in milliseconds.
+ * @return The number of requests finished.
+ */
+int OkAssetLoader::update(float budget) {
+  return _upload(budget);
+}
+
+/**
+ * @brief Wait for all the queued requests and upload them, without a
+ *        budget. Uploads can queue new requests, which are waited for too.
+ */
+void OkAssetLoader::finishAll() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobDone.wait(lock, [this] { return jobs.empty() && active == 0; });
+      if (finished.empty()) {
+        return;
+      }
+    }
+    _upload(std::numeric_limits<double>::infinity());
+  }
+}
+
+/**
+ * @brief Get the number of requests not finished yet.
+ * @return Requests queued, being worked, or waiting for their upload.
+ */
+int OkAssetLoader::getPendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return static_cast<int>(jobs.size() + finished.size()) + active;
+}
+
+/**
+ * @brief Stop the workers and fail the requests not finished yet.
+ *        Work being done is completed first. Must be called while the
+ *        OpenGL context exists, as dropped requests release their assets.
+ */
+void OkAssetLoader::cleanup() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobAdded.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+
+  std::deque<std::shared_ptr<OkLoadRequest>> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    dropped.swap(jobs);
+    for (Finished &entry : finished) {
+      dropped.push_back(std::move(entry.request));
+    }
+    finished.clear();
+    stopping = false;
+  }
+
+  for (std::shared_ptr<OkLoadRequest> &request : dropped) {
+    request->finish(false);
+  }
+}
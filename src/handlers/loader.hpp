@@ -0,0 +1,151 @@
+#ifndef OK_LOADER_HPP
+#define OK_LOADER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class OkMesh;
+class OkTexture;
+
+// State of an asynchronous load
+enum class OkLoadState : std::uint8_t {
+  Pending,  // Queued, being read or waiting for its upload
+  Ready,    // Uploaded, the asset can be used
+  Failed    // Could not be read or uploaded, or dropped by cleanup
+};
+
+/**
+ * @brief Handle of an asynchronous load, shared by the loader and its
+ *        callers.
+ *        The work function runs on a worker thread and does the file reading
+ *        and decoding, the upload function runs on the main thread and
+ *        creates the OpenGL objects. The asset created by the upload is held
+ *        by the request, with one reference in its handler (named as the
+ *        request), released when the last owner of the request drops it.
+ *        Everything but the work function is used on the main thread only.
+ */
+class OkLoadRequest {
+public:
+  using Work     = std::function<bool()>;
+  using Upload   = std::function<bool(OkLoadRequest &request)>;
+  using Callback = std::function<void(OkLoadRequest &request)>;
+
+  OkLoadRequest(const std::string &name, Work work = nullptr,
+                Upload upload = nullptr);
+  ~OkLoadRequest();
+
+  // Delete copy constructor and assignment
+  OkLoadRequest(const OkLoadRequest &)            = delete;
+  OkLoadRequest &operator=(const OkLoadRequest &) = delete;
+
+  const std::string &getName() const { return name; }
+  OkLoadState        getState() const { return state; }
+  bool isDone() const { return state != OkLoadState::Pending; }
+
+  // Asset created by the upload, the request owns one reference
+  OkTexture *getTexture() const { return texture; }
+  OkMesh    *getMesh() const { return mesh; }
+  void       setTexture(OkTexture *loadedTexture) { texture = loadedTexture; }
+  void       setMesh(OkMesh *loadedMesh) { mesh = loadedMesh; }
+
+  // Call a function when the load finishes, right away if it already did.
+  // Several owners can wait for the same request
+  void then(const void *owner, Callback callback);
+
+  // An owner no longer needs the result: its callbacks are dropped, and if
+  // no owner is left the work is skipped if it did not start yet
+  void cancel(const void *owner);
+  bool isCancelled() const { return cancelled; }
+
+  // Set the final state and call the callback
+  void finish(bool success);
+
+private:
+  friend class OkAssetLoader;
+
+  std::string       name;
+  OkLoadState       state;
+  Work              work;
+  Upload            upload;
+  std::atomic<bool> cancelled;
+
+  // Callbacks and the owners that set them
+  std::vector<std::pair<const void *, Callback>> callbacks;
+
+  OkTexture *texture;
+  OkMesh    *mesh;
+};
+
+/**
+ * @brief Asynchronous asset loader.
+ *        Requests are read and decoded by a pool of worker threads, and
+ *        uploaded to the GPU by update, on the main thread, within a time
+ *        budget per frame, so loading never stalls a frame for long.
+ *        Worker threads are started with the first request.
+ */
+class OkAssetLoader {
+private:
+  // Request whose work is done, waiting for its upload
+  struct Finished {
+    std::shared_ptr<OkLoadRequest> request;
+    bool                           success;
+  };
+
+  std::vector<std::thread>                   workers;
+  std::deque<std::shared_ptr<OkLoadRequest>> jobs;      // Waiting for a worker
+  std::deque<Finished>                       finished;  // Waiting for upload
+  int                                        active;    // Jobs being worked
+  bool                                       stopping;
+
+  mutable std::mutex      mutex;
+  std::condition_variable jobAdded;
+  std::condition_variable jobDone;
+
+  void _startWorkers();
+  void _workerLoop();
+  int  _upload(double budget);
+
+  // Private constructor - singleton
+  OkAssetLoader();
+
+  // Singleton instance
+  static OkAssetLoader *instance;
+
+public:
+  // Delete copy constructor and assignment
+  OkAssetLoader(const OkAssetLoader &)            = delete;
+  OkAssetLoader &operator=(const OkAssetLoader &) = delete;
+
+  // Get singleton instance
+  static OkAssetLoader *getInstance();
+
+  // Queue a load, returning its handle
+  std::shared_ptr<OkLoadRequest> load(const std::string    &name,
+                                      OkLoadRequest::Work   work,
+                                      OkLoadRequest::Upload upload);
+
+  // Main thread, once per frame: upload finished requests for up to budget
+  // milliseconds, at least one if any is waiting
+  int update(float budget);
+
+  // Main thread: wait for every queued request and upload all of them
+  void finishAll();
+
+  // Requests queued or waiting for their upload
+  int getPendingCount() const;
+
+  // Cleanup: stop the workers and fail the requests not finished yet
+  void cleanup();
+  ~OkAssetLoader();
+};
+
+#endif
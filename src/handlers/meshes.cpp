@@ -0,0 +1,318 @@
+#include "meshes.hpp"
+#include "../utils/logger.hpp"
+#include "item/mesh.hpp"
+#include "registry.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+OkMeshHandler *OkMeshHandler::instance = nullptr;
+
+/**
+ * @brief Constructor for the OkMeshHandler class.
+ *        This class is a singleton that manages meshes.
+ */
+OkMeshHandler::OkMeshHandler() = default;
+
+/**
+ * @brief Destructor for the OkMeshHandler class.
+ *        This method cleans up all meshes.
+ */
+OkMeshHandler::~OkMeshHandler() {
+  cleanup();
+}
+
+/**
+ * @brief Get the singleton instance of the OkMeshHandler.
+ *        This method creates the instance if it doesn't exist.
+ * @return Pointer to the OkMeshHandler instance.
+ */
+OkMeshHandler *OkMeshHandler::getInstance() {
+  if (!instance) {
+    instance = new OkMeshHandler();
+  }
+
+  return instance;
+}
+
+/**
+ * @brief Get a mesh by name.
+ *        This method looks the mesh up without changing its reference count,
+ *        so the pointer is only valid while someone else holds one.
+ * @param name The name of the mesh.
+ * @return Pointer to the OkMesh if found, nullptr otherwise.
+ */
+OkMesh *OkMeshHandler::getMesh(const std::string &name) const {
+  return meshes.get(meshes.find(name));
+}
+
+/**
+ * @brief Get a mesh by handle.
+ *        This method resolves the handle without changing the reference
+ *        count of the mesh.
+ * @param handle The handle of the mesh.
+ * @return Pointer to the OkMesh, nullptr if the handle is stale.
+ */
+OkMesh *OkMeshHandler::getMesh(OkHandle handle) const {
+  return meshes.get(handle);
+}
+
+/**
+ * @brief Get the handle of a mesh, to look it up or reference it later
+ *        without its name.
+ * @param name The name of the mesh.
+ * @return The handle, invalid if the mesh is not found.
+ */
+OkHandle OkMeshHandler::getHandle(const std::string &name) const {
+  return meshes.find(name);
+}
+
+/**
+ * @brief Get a mesh by name and add a reference to it.
+ * @param name The name of the mesh.
+ * @return Pointer to the OkMesh if found, nullptr otherwise.
+ *         The caller must release it with removeReference.
+ */
+OkMesh *OkMeshHandler::acquireMesh(const std::string &name) {
+  return meshes.get(meshes.acquire(name));
+}
+
+/**
+ * @brief Store a new mesh with a reference count of 1.
+ *        If another thread stored a mesh with the same name meanwhile, that
+ *        one gets the reference and the new one is deleted.
+ * @param name The name of the mesh.
+ * @param mesh The mesh, owned by the handler from now on.
+ * @return Pointer to the stored OkMesh, nullptr if the registry is full.
+ */
+OkMesh *OkMeshHandler::_store(const std::string &name, OkMesh *mesh) {
+  OkMesh *stored = meshes.get(meshes.add(name, mesh));
+  if (stored != mesh) {
+    delete mesh;
+  }
+
+  if (!stored) {
+    OkLogger::error("MeshHandler", "No room for mesh '" + name + "'");
+  }
+  return stored;
+}
+
+/**
+ * @brief Create a mesh under a name, with 5-float vertices.
+ *        If a mesh with that name already exists, its reference count is
+ *        incremented and it is returned, the data is ignored. Otherwise a new
+ *        mesh is created with a reference count of 1.
+ * @param name        The name of the mesh (a file path, for example).
+ * @param vertexData  The vertex data.
+ * @param vertexCount The number of floats in the vertex data.
+ * @param indexData   The index data.
+ * @param indexCount  The number of indices.
+ * @return Pointer to the OkMesh.
+ */
+OkMesh *OkMeshHandler::createMesh(const std::string  &name,
+                                  const float        *vertexData,
+                                  long                vertexCount,
+                                  const unsigned int *indexData,
+                                  long                indexCount) {
+  return createMesh(name, OkVertexLayout::standard(), vertexData, 5,
+                    vertexCount / 5, indexData, indexCount);
+}
+
+/**
+ * @brief Create a mesh under a name, storing its vertices in a layout.
+ *        If a mesh with that name already exists, its reference count is
+ *        incremented and it is returned, the data is ignored. Otherwise a new
+ *        mesh is created with a reference count of 1.
+ * @param name         The name of the mesh (a file path, for example).
+ * @param layout       The layout the vertices are stored in.
+ * @param vertexData   The float vertex data, see OkVertexLayout::pack.
+ * @param vertexStride The number of floats per vertex in vertexData.
+ * @param vertexCount  The number of vertices.
+ * @param indexData    The index data.
+ * @param indexCount   The number of indices.
+ * @return Pointer to the OkMesh.
+ */
+OkMesh *OkMeshHandler::createMesh(const std::string    &name,
+                                  const OkVertexLayout &layout,
+                                  const float *vertexData, int vertexStride,
+                                  long vertexCount,
+                                  const unsigned int *indexData,
+                                  long                indexCount) {
+  // First check if it already exists
+  OkMesh *existing = acquireMesh(name);
+  if (existing) {
+    return existing;
+  }
+
+  // Create new mesh
+  OkMesh *mesh = new OkMesh(layout, vertexData, vertexStride, vertexCount,
+                            indexData, indexCount);
+
+  // Store with reference count 1
+  mesh = _store(name, mesh);
+  if (!mesh) {
+    return nullptr;
+  }
+
+  OkLogger::info("MeshHandler",
+                 "Created mesh '" + name + "' with " +
+                     std::to_string(vertexCount) + " vertices of " +
+                     std::to_string(layout.getStride()) + " bytes and " +
+                     std::to_string(indexCount) + " indices");
+  return mesh;
+}
+
+/**
+ * @brief Create a mesh under a name, reading its data in place from a file.
+ *        If a mesh with that name already exists, its reference count is
+ *        incremented and it is returned. Otherwise the file stays mapped for
+ *        the lifetime of the new mesh.
+ * @param name        The name of the mesh.
+ * @param file        The mapped file holding the data.
+ * @param layout      The layout of the vertices.
+ * @param vertexData  The vertex data, inside the file.
+ * @param vertexCount The number of vertices.
+ * @param indexData   The index data, inside the file.
+ * @param indexType   GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ * @param indexCount  The number of indices.
+ * @param center      The center of the bounding box of the vertices.
+ * @param radius      Half the diagonal of the bounding box.
+ * @return Pointer to the OkMesh.
+ */
+OkMesh *OkMeshHandler::createMesh(const std::string                  &name,
+                                  std::shared_ptr<const OkMappedFile> file,
+                                  const OkVertexLayout               &layout,
+                                  const void *vertexData, long vertexCount,
+                                  const void *indexData, GLenum indexType,
+                                  long indexCount, const glm::vec3 &center,
+                                  float radius) {
+  OkMesh *existing = acquireMesh(name);
+  if (existing) {
+    return existing;
+  }
+
+  OkMesh *mesh =
+      new OkMesh(std::move(file), layout, vertexData, vertexCount, indexData,
+                 indexType, indexCount, center, radius);
+
+  mesh = _store(name, mesh);
+  if (!mesh) {
+    return nullptr;
+  }
+
+  OkLogger::info("MeshHandler", "Created mesh '" + name + "' with " +
+                                    std::to_string(vertexCount) +
+                                    " vertices and " +
+                                    std::to_string(indexCount) +
+                                    " indices, mapped from file");
+  return mesh;
+}
+
+/**
+ * @brief Create a mesh keyed by the hash of its content.
+ *        Identical geometry created several times is stored only once. On a
+ *        hash collision with different content, a new name is used.
+ * @param vertexData  The vertex data.
+ * @param vertexCount The number of floats in the vertex data.
+ * @param indexData   The index data.
+ * @param indexCount  The number of indices.
+ * @param outName     Receives the name of the mesh, used to release it.
+ * @return Pointer to the OkMesh.
+ */
+OkMesh *OkMeshHandler::createMeshFromData(const float        *vertexData,
+                                          long                vertexCount,
+                                          const unsigned int *indexData,
+                                          long                indexCount,
+                                          std::string        &outName) {
+  uint64_t hash = OkMesh::hash(vertexData, vertexCount, indexData, indexCount);
+
+  char hashName[32];
+  std::snprintf(hashName, sizeof(hashName), "mesh:%016llx",
+                static_cast<unsigned long long>(hash));
+
+  // Find the mesh with this content, skipping collisions
+  std::string name = hashName;
+  for (int suffix = 1;; suffix++) {
+    const OkMesh *mesh = getMesh(name);
+    if (!mesh ||
+        mesh->matches(vertexData, vertexCount, indexData, indexCount)) {
+      break;
+    }
+    name = std::string(hashName) + "#" + std::to_string(suffix);
+  }
+
+  outName = name;
+  return createMesh(name, vertexData, vertexCount, indexData, indexCount);
+}
+
+/**
+ * @brief Add a reference to a mesh.
+ *        This method increments the reference count of the mesh.
+ * @param name The name of the mesh.
+ */
+void OkMeshHandler::addReference(const std::string &name) {
+  meshes.acquire(name);
+}
+
+/**
+ * @brief Add a reference to a mesh by handle.
+ * @param handle The handle of the mesh.
+ */
+void OkMeshHandler::addReference(OkHandle handle) {
+  meshes.acquire(handle);
+}
+
+/**
+ * @brief Remove a reference to a mesh.
+ *        This method decrements the reference count of the mesh.
+ *        If the reference count reaches zero, the mesh is deleted.
+ *        If the mesh is not found, no action is taken.
+ * @param name The name of the mesh.
+ */
+void OkMeshHandler::removeReference(const std::string &name) {
+  if (meshes.release(meshes.find(name))) {
+    OkLogger::info("MeshHandler", "Removing mesh: " + name);
+  }
+}
+
+/**
+ * @brief Remove a reference to a mesh by handle.
+ *        If the reference count reaches zero, the mesh is deleted and the
+ *        handle becomes stale.
+ * @param handle The handle of the mesh.
+ */
+void OkMeshHandler::removeReference(OkHandle handle) {
+  std::string name = meshes.getName(handle);
+  if (meshes.release(handle)) {
+    OkLogger::info("MeshHandler", "Removing mesh: " + name);
+  }
+}
+
+/**
+ * @brief Get the reference count of a mesh.
+ * @param name The name of the mesh.
+ * @return The reference count, 0 if the mesh is not found.
+ */
+int OkMeshHandler::getReferenceCount(const std::string &name) const {
+  return meshes.getReferenceCount(meshes.find(name));
+}
+
+/**
+ * @brief Cleanup all meshes.
+ *        This method deletes all meshes, whatever their reference count.
+ */
+void OkMeshHandler::cleanup() {
+  meshes.clear();
+}
+
+/**
+ * @brief Get the names of all meshes.
+ * @return Vector of mesh names, in no particular order.
+ */
+std::vector<std::string> OkMeshHandler::getMeshNames() const {
+  return meshes.getNames();
+}
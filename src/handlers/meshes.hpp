@@ -0,0 +1,80 @@
+#ifndef OK_MESHES_HPP
+#define OK_MESHES_HPP
+
+#include "../item/mesh.hpp"
+#include "registry.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+class OkMeshHandler {
+private:
+  // Meshes by name (file path or content hash), with their reference count
+  OkRegistry<OkMesh> meshes;
+
+  OkMesh *_store(const std::string &name, OkMesh *mesh);
+
+  // Private constructor - singleton
+  OkMeshHandler();
+
+  // Singleton instance
+  static OkMeshHandler *instance;
+
+public:
+  // Delete copy constructor and assignment
+  OkMeshHandler(const OkMeshHandler &)            = delete;
+  OkMeshHandler &operator=(const OkMeshHandler &) = delete;
+
+  // Get singleton instance
+  static OkMeshHandler *getInstance();
+
+  // Get an existing mesh by name or handle, without adding a reference
+  // (returns nullptr if not found)
+  OkMesh  *getMesh(const std::string &name) const;
+  OkMesh  *getMesh(OkHandle handle) const;
+  OkHandle getHandle(const std::string &name) const;
+
+  // Get an existing mesh by name and add a reference to it
+  OkMesh *acquireMesh(const std::string &name);
+
+  std::vector<std::string> getMeshNames() const;
+  int                      getReferenceCount(const std::string &name) const;
+
+  // Create and store a mesh under a name (a file path, for example), with
+  // 5-float vertices or float vertices converted to a layout
+  OkMesh *createMesh(const std::string &name, const float *vertexData,
+                     long vertexCount, const unsigned int *indexData,
+                     long indexCount);
+  OkMesh *createMesh(const std::string &name, const OkVertexLayout &layout,
+                     const float *vertexData, int vertexStride,
+                     long vertexCount, const unsigned int *indexData,
+                     long indexCount);
+
+  // Create and store a mesh reading its data in place from a mapped file
+  OkMesh *createMesh(const std::string                  &name,
+                     std::shared_ptr<const OkMappedFile> file,
+                     const OkVertexLayout &layout, const void *vertexData,
+                     long vertexCount, const void *indexData,
+                     GLenum indexType, long indexCount,
+                     const glm::vec3 &center, float radius);
+
+  // Create and store a mesh keyed by the hash of its content, the name is
+  // returned in outName
+  OkMesh *createMeshFromData(const float *vertexData, long vertexCount,
+                             const unsigned int *indexData, long indexCount,
+                             std::string &outName);
+
+  // Reference counting, safe from any thread, but meshes must be deleted on
+  // the main thread
+  void addReference(const std::string &name);
+  void addReference(OkHandle handle);
+  void removeReference(const std::string &name);
+  void removeReference(OkHandle handle);
+
+  // Cleanup
+  void cleanup();
+  ~OkMeshHandler();
+};
+
+#endif
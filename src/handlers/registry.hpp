@@ -0,0 +1,393 @@
+#ifndef OK_REGISTRY_HPP
+#define OK_REGISTRY_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Handle to a resource stored in an OkRegistry: the index of its slot
+ *        and the generation of the slot when the resource was added. A slot
+ *        reused by another resource has a new generation, so stale handles
+ *        resolve to nothing. The default handle is never valid.
+ */
+class OkHandle {
+public:
+  static const uint32_t indexBits      = 20;
+  static const uint32_t generationBits = 32 - indexBits;
+  static const uint32_t maxIndex       = (1u << indexBits) - 1;
+  static const uint32_t maxGeneration  = (1u << generationBits) - 1;
+
+  OkHandle() : value(0) {}
+  OkHandle(uint32_t index, uint32_t generation)
+      : value((generation << indexBits) | index) {}
+
+  // Getters
+  uint32_t getIndex() const { return value & maxIndex; }
+  uint32_t getGeneration() const { return value >> indexBits; }
+  uint32_t getValue() const { return value; }
+  bool     isValid() const { return value != 0; }
+
+  bool operator==(const OkHandle &other) const { return value == other.value; }
+  bool operator!=(const OkHandle &other) const { return value != other.value; }
+
+private:
+  uint32_t value;
+};
+
+/**
+ * @brief Reference counted resources, addressed by handle or by name.
+ *        Handles resolve in constant time, without locks: slots live in
+ *        pages that never move, and each slot packs its generation and
+ *        reference count in one atomic word, so a reference is only taken
+ *        while the generation matches. Names are looked up in a hash split
+ *        in shards, each with its own mutex, so loader threads and the main
+ *        thread rarely wait for each other.
+ *        The resource is deleted by the thread dropping the last reference,
+ *        resources owning OpenGL objects must be released on the main thread.
+ */
+template <typename T> class OkRegistry {
+public:
+  OkRegistry() : slotCount(0), count(0) {
+    for (std::atomic<Slot *> &page : pages) {
+      page.store(nullptr);
+    }
+  }
+
+  ~OkRegistry() {
+    clear();
+    for (std::atomic<Slot *> &page : pages) {
+      delete[] page.load();
+    }
+  }
+
+  // Delete copy constructor and assignment
+  OkRegistry(const OkRegistry &)            = delete;
+  OkRegistry &operator=(const OkRegistry &) = delete;
+
+  /**
+   * @brief Store a resource under a name, with one reference.
+   *        If the name is already taken, the resource stored under it gets a
+   *        reference and its handle is returned instead, the given resource
+   *        still belongs to the caller.
+   * @param name     The name of the resource.
+   * @param resource The resource, deleted with its last reference.
+   * @return The handle, invalid if the registry is full.
+   */
+  OkHandle add(const std::string &name, T *resource) {
+    Shard                      &shard = _getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    typename std::unordered_map<std::string, OkHandle>::iterator it =
+        shard.handles.find(name);
+    if (it != shard.handles.end() && acquire(it->second)) {
+      return it->second;
+    }
+
+    OkHandle handle = _allocate(name, resource);
+    if (handle.isValid()) {
+      shard.handles[name] = handle;
+      count++;
+    }
+    return handle;
+  }
+
+  /**
+   * @brief Find a resource by name and add a reference to it.
+   * @param name The name of the resource.
+   * @return The handle, invalid if there is no resource with that name.
+   */
+  OkHandle acquire(const std::string &name) {
+    Shard                      &shard = _getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    typename std::unordered_map<std::string, OkHandle>::iterator it =
+        shard.handles.find(name);
+    if (it != shard.handles.end() && acquire(it->second)) {
+      return it->second;
+    }
+    return OkHandle();
+  }
+
+  /**
+   * @brief Add a reference to a resource.
+   * @param handle The handle of the resource.
+   * @return True if the resource is still stored.
+   */
+  bool acquire(OkHandle handle) {
+    Slot *slot = _getSlot(handle);
+    if (!slot) {
+      return false;
+    }
+
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    while (_isAlive(state, handle)) {
+      if (slot->state.compare_exchange_weak(state, state + 1,
+                                            std::memory_order_acq_rel)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Remove a reference to a resource, deleting it with the last one.
+   *        Its handle is then stale and its name free.
+   * @param handle The handle of the resource.
+   * @return True if the resource was deleted.
+   */
+  bool release(OkHandle handle) {
+    Slot *slot = _getSlot(handle);
+    if (!slot) {
+      return false;
+    }
+
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    do {
+      if (!_isAlive(state, handle)) {
+        return false;
+      }
+    } while (!slot->state.compare_exchange_weak(state, state - 1,
+                                                std::memory_order_acq_rel));
+    if ((state & refMask) != 1) {
+      return false;
+    }
+
+    // Last reference: nobody can take a new one, free the name and the slot
+    T *resource = slot->resource.exchange(nullptr);
+    {
+      Shard                      &shard = _getShard(slot->name);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      typename std::unordered_map<std::string, OkHandle>::iterator it =
+          shard.handles.find(slot->name);
+      if (it != shard.handles.end() && it->second == handle) {
+        shard.handles.erase(it);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(freeMutex);
+      slot->state.store(_nextGeneration(handle.getGeneration()) << 32,
+                        std::memory_order_release);
+      freeSlots.push_back(handle.getIndex());
+    }
+
+    count--;
+    delete resource;
+    return true;
+  }
+
+  /**
+   * @brief Find a resource by name, without adding a reference.
+   * @param name The name of the resource.
+   * @return The handle, invalid if there is no resource with that name.
+   */
+  OkHandle find(const std::string &name) const {
+    Shard                      &shard = _getShard(name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    typename std::unordered_map<std::string, OkHandle>::const_iterator it =
+        shard.handles.find(name);
+    if (it != shard.handles.end() && getReferenceCount(it->second) > 0) {
+      return it->second;
+    }
+    return OkHandle();
+  }
+
+  /**
+   * @brief Get a resource. The caller must hold a reference to use it from
+   *        another thread than the one releasing it.
+   * @param handle The handle of the resource.
+   * @return The resource, nullptr if the handle is stale.
+   */
+  T *get(OkHandle handle) const {
+    const Slot *slot = _getSlot(handle);
+    if (!slot ||
+        !_isAlive(slot->state.load(std::memory_order_acquire), handle)) {
+      return nullptr;
+    }
+    return slot->resource.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Get the name of a resource. The caller must hold a reference.
+   * @param handle The handle of the resource.
+   * @return The name, empty if the handle is stale.
+   */
+  std::string getName(OkHandle handle) const {
+    return get(handle) ? _getSlot(handle)->name : std::string();
+  }
+
+  /**
+   * @brief Get the reference count of a resource.
+   * @param handle The handle of the resource.
+   * @return The reference count, 0 if the handle is stale.
+   */
+  int getReferenceCount(OkHandle handle) const {
+    const Slot *slot = _getSlot(handle);
+    if (!slot) {
+      return 0;
+    }
+
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    return _isAlive(state, handle) ? static_cast<int>(state & refMask) : 0;
+  }
+
+  /**
+   * @brief Get the names of all the resources.
+   * @return Vector of names, in no particular order.
+   */
+  std::vector<std::string> getNames() const {
+    std::vector<std::string> names;
+    names.reserve(count.load());
+
+    for (const Shard &shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto &entry : shard.handles) {
+        if (getReferenceCount(entry.second) > 0) {
+          names.push_back(entry.first);
+        }
+      }
+    }
+    return names;
+  }
+
+  /**
+   * @brief Call a function with every resource and its handle. Resources
+   *        released meanwhile by other threads may be skipped.
+   * @param function Called with the handle and the resource, it must not
+   *                 add or release resources.
+   */
+  template <typename Function> void forEach(Function function) const {
+    for (const Shard &shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto &entry : shard.handles) {
+        T *resource = get(entry.second);
+        if (resource) {
+          function(entry.second, resource);
+        }
+      }
+    }
+  }
+
+  // Number of resources stored
+  size_t getCount() const { return count.load(); }
+
+  /**
+   * @brief Delete all the resources, whatever their reference count.
+   *        Their handles become stale. No other thread may use the registry
+   *        meanwhile.
+   */
+  void clear() {
+    for (Shard &shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.handles.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(freeMutex);
+    freeSlots.clear();
+    for (uint32_t index = slotCount; index-- > 0;) {
+      Slot    &slot  = pages[index / pageSize].load()[index % pageSize];
+      uint64_t state = slot.state.load();
+      if ((state & refMask) != 0) {
+        slot.state.store(_nextGeneration(static_cast<uint32_t>(state >> 32))
+                         << 32);
+      }
+      delete slot.resource.exchange(nullptr);
+      freeSlots.push_back(index);
+    }
+    count = 0;
+  }
+
+private:
+  static const uint32_t pageSize   = 1024;
+  static const uint32_t pageCount  = (OkHandle::maxIndex + 1) / pageSize;
+  static const size_t   shardCount = 16;
+  static const uint64_t refMask    = 0xFFFFFFFFu;
+
+  // Generation in the high 32 bits of the state, reference count in the low
+  struct Slot {
+    std::atomic<uint64_t> state{uint64_t(1) << 32};
+    std::atomic<T *>      resource{nullptr};
+    std::string           name;  // Only written while the slot is free
+  };
+
+  // Names hashing to a shard, on their own cache line
+  struct alignas(64) Shard {
+    mutable std::mutex                        mutex;
+    std::unordered_map<std::string, OkHandle> handles;
+  };
+
+  static bool _isAlive(uint64_t state, OkHandle handle) {
+    return (state >> 32) == handle.getGeneration() && (state & refMask) > 0;
+  }
+
+  static uint64_t _nextGeneration(uint32_t generation) {
+    return generation >= OkHandle::maxGeneration ? 1 : generation + 1;
+  }
+
+  Shard &_getShard(const std::string &name) const {
+    return shards[std::hash<std::string>()(name) % shardCount];
+  }
+
+  /**
+   * @brief Find the slot of a handle, whatever its current generation.
+   * @param handle The handle.
+   * @return The slot, nullptr if it was never allocated.
+   */
+  Slot *_getSlot(OkHandle handle) const {
+    if (!handle.isValid()) {
+      return nullptr;
+    }
+
+    Slot *page = pages[handle.getIndex() / pageSize].load(
+        std::memory_order_acquire);
+    return page ? &page[handle.getIndex() % pageSize] : nullptr;
+  }
+
+  /**
+   * @brief Take a free slot, or a new one, for a resource with one reference.
+   * @param name     The name of the resource.
+   * @param resource The resource.
+   * @return The handle, invalid if every slot is taken.
+   */
+  OkHandle _allocate(const std::string &name, T *resource) {
+    std::lock_guard<std::mutex> lock(freeMutex);
+
+    uint32_t index;
+    if (!freeSlots.empty()) {
+      index = freeSlots.back();
+      freeSlots.pop_back();
+    } else if (slotCount <= OkHandle::maxIndex) {
+      index = slotCount++;
+      if (index % pageSize == 0) {
+        pages[index / pageSize].store(new Slot[pageSize],
+                                      std::memory_order_release);
+      }
+    } else {
+      return OkHandle();
+    }
+
+    Slot    &slot       = pages[index / pageSize].load()[index % pageSize];
+    uint64_t generation = slot.state.load() >> 32;
+    slot.name           = name;
+    slot.resource.store(resource, std::memory_order_release);
+    slot.state.store((generation << 32) | 1, std::memory_order_release);
+    return OkHandle(index, static_cast<uint32_t>(generation));
+  }
+
+  std::array<std::atomic<Slot *>, pageCount> pages;  // Allocated on demand
+  mutable std::array<Shard, shardCount>      shards;
+
+  std::mutex            freeMutex;  // Guards slot allocation
+  std::vector<uint32_t> freeSlots;  // Released slots, reused first
+  uint32_t              slotCount;  // Slots allocated so far
+  std::atomic<size_t>   count;      // Resources stored
+};
+
+#endif
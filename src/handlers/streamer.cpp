@@ -0,0 +1,121 @@
+#include "streamer.hpp"
+#include "../config/config.hpp"
+#include "../core/gl_config.hpp"
+#include "../item/texture.hpp"
+#include <algorithm>
+#include <cstddef>
+
+OkTextureStreamer *OkTextureStreamer::instance = nullptr;
+
+/**
+ * @brief Constructor for the OkTextureStreamer class.
+ *        This class is a singleton, its pixel buffer is created with the
+ *        first upload.
+ */
+OkTextureStreamer::OkTextureStreamer() : buffer(0), uploaded(0) {}
+
+/**
+ * @brief Destructor for the OkTextureStreamer class.
+ *        Releases the pixel buffer.
+ */
+OkTextureStreamer::~OkTextureStreamer() {
+  cleanup();
+}
+
+/**
+ * @brief Get the singleton instance of the OkTextureStreamer.
+ *        This method creates the instance if it doesn't exist.
+ * @return Pointer to the OkTextureStreamer instance.
+ */
+OkTextureStreamer *OkTextureStreamer::getInstance() {
+  if (!instance) {
+    instance = new OkTextureStreamer();
+  }
+
+  return instance;
+}
+
+/**
+ * @brief Add a texture with levels to upload.
+ * @param texture The texture, streamed after the ones added before it.
+ */
+void OkTextureStreamer::add(OkTexture *texture) {
+  textures.push_back(texture);
+}
+
+/**
+ * @brief Remove a texture, deleted before it finished streaming.
+ * @param texture The texture.
+ */
+void OkTextureStreamer::remove(OkTexture *texture) {
+  textures.erase(std::remove(textures.begin(), textures.end(), texture),
+                 textures.end());
+}
+
+/**
+ * @brief Upload the next rows of the streaming textures.
+ *        Called once per frame by the main loop, on the thread owning the
+ *        OpenGL context.
+ * @param budget Bytes available. At least one row is uploaded if any is
+ *               waiting, so streaming always progresses.
+ * @return The number of bytes uploaded.
+ */
+size_t OkTextureStreamer::update(size_t budget) {
+  if (textures.empty()) {
+    return 0;
+  }
+
+  if (buffer == 0) {
+    glGenBuffers(1, &buffer);
+  }
+
+  // Orphan the buffer, the uploads of the previous frame keep the old one
+  size_t capacity = std::max(budget, textures.front()->getStreamRowSize());
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(capacity),
+               nullptr, GL_STREAM_DRAW);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  size_t used = 0;
+  while (!textures.empty() && used < capacity) {
+    OkTexture *texture = textures.front();
+    size_t     bytes   = texture->stream(used, capacity - used);
+    if (bytes == 0) {
+      break;
+    }
+    used += bytes;
+
+    if (!texture->isStreaming()) {
+      textures.pop_front();
+    }
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  uploaded += used;
+  return used;
+}
+
+/**
+ * @brief Upload all the levels left, in as many rounds of the per-frame
+ *        budget as needed.
+ */
+void OkTextureStreamer::finishAll() {
+  size_t budget = OkConfig::getInt("loader.texture-upload-bytes");
+  while (!textures.empty()) {
+    update(budget);
+  }
+}
+
+/**
+ * @brief Release the pixel buffer and forget the streaming textures.
+ *        Must be called while the OpenGL context exists.
+ */
+void OkTextureStreamer::cleanup() {
+  textures.clear();
+  if (buffer != 0) {
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+  }
+}
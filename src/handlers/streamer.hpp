@@ -0,0 +1,58 @@
+#ifndef OK_STREAMER_HPP
+#define OK_STREAMER_HPP
+
+#include "../core/gl_config.hpp"
+#include <cstddef>
+#include <deque>
+
+class OkTexture;
+
+/**
+ * @brief Streaming texture uploads.
+ *        Textures created from a mipmap chain are uploaded a few rows at a
+ *        time through a pixel buffer object, within a number of bytes per
+ *        frame, so large textures never stall a frame. The buffer is orphaned
+ *        every frame, so the GPU can still read the previous uploads while
+ *        the new ones are written.
+ */
+class OkTextureStreamer {
+private:
+  std::deque<OkTexture *> textures;  // Streaming, in creation order
+  GLuint                  buffer;    // Pixel buffer object
+  size_t                  uploaded;  // Bytes uploaded since created
+
+  // Private constructor - singleton
+  OkTextureStreamer();
+
+  // Singleton instance
+  static OkTextureStreamer *instance;
+
+public:
+  // Delete copy constructor and assignment
+  OkTextureStreamer(const OkTextureStreamer &)            = delete;
+  OkTextureStreamer &operator=(const OkTextureStreamer &) = delete;
+
+  // Get singleton instance
+  static OkTextureStreamer *getInstance();
+
+  // Textures with levels to upload, removed when done or deleted
+  void add(OkTexture *texture);
+  void remove(OkTexture *texture);
+
+  // Main thread, once per frame: upload up to budget bytes, at least one
+  // row if any is waiting
+  size_t update(size_t budget);
+
+  // Main thread: upload everything left
+  void finishAll();
+
+  // Textures still streaming, and bytes uploaded so far
+  int    getPendingCount() const { return static_cast<int>(textures.size()); }
+  size_t getUploadedBytes() const { return uploaded; }
+
+  // Cleanup: release the pixel buffer, textures left stay incomplete
+  void cleanup();
+  ~OkTextureStreamer();
+};
+
+#endif
@@ -1,10 +1,94 @@
 #include "textures.hpp"
+#include "../config/config.hpp"
+#include "../importers/ktx2.hpp"
 #include "../utils/logger.hpp"
 #include "item/texture.hpp"
-#include <map>
+#include "loader.hpp"
+#include "registry.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stb_image.h>
 #include <string>
+#include <utility>
 #include <vector>
 
+namespace {
+// Decoded pixels, handed from a loader thread to the upload, with their
+// mipmap levels when the texture is streamed, or the levels of a KTX2 file
+struct DecodedImage {
+  unsigned char              *pixels   = nullptr;
+  int                         width    = 0;
+  int                         height   = 0;
+  int                         channels = 0;
+  std::unique_ptr<OkMipChain> mips;
+  OkCompressedImage           compressed;
+
+  DecodedImage() = default;
+  ~DecodedImage() { stbi_image_free(pixels); }
+
+  // Delete copy constructor and assignment
+  DecodedImage(const DecodedImage &)            = delete;
+  DecodedImage &operator=(const DecodedImage &) = delete;
+};
+
+/**
+ * @brief Read and decode a texture file, on a loader thread.
+ *        KTX2 files are read as they are, or replaced by an image next to
+ *        them when the driver lacks their format.
+ * @param path   The path to the texture file.
+ * @param image  Receives the pixels, or the levels of a KTX2 file.
+ * @param stream Build the mipmap levels, to stream them.
+ * @return True if the file was decoded.
+ */
+bool decodeImage(const std::string &path, DecodedImage &image, bool stream) {
+  std::string imagePath = path;
+  if (OkKtx2File::isKtx2(path)) {
+    if (OkKtx2File::read(path, image.compressed) &&
+        OkKtx2File::isSupported(image.compressed)) {
+      return true;
+    }
+
+    // Decode an image next to the file instead
+    image.compressed = OkCompressedImage();
+    imagePath        = OkKtx2File::getFallbackName(path);
+    if (imagePath.empty()) {
+      OkLogger::error("Texture", "No fallback image for texture: " + path);
+      return false;
+    }
+    OkLogger::warning("Texture", "Loading " + imagePath + " instead of " +
+                                     path);
+  }
+
+  image.pixels = stbi_load(imagePath.c_str(), &image.width, &image.height,
+                           &image.channels, 0);
+  if (!image.pixels) {
+    OkLogger::error("Texture", "Failed to load texture: " + imagePath + " (" +
+                                   std::string(stbi_failure_reason()) + ")");
+    return false;
+  }
+
+  if (stream) {
+    image.mips = std::make_unique<OkMipChain>(OkMipChain::build(
+        image.pixels, image.width, image.height, image.channels));
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+  }
+  return true;
+}
+
+/**
+ * @brief Get the video memory budget of the textures.
+ * @return The budget in bytes, 0 for no budget.
+ */
+size_t getMemoryBudget() {
+  float megabytes = std::max(OkConfig::getFloat("textures.memory-budget"),
+                             0.0f);
+  return static_cast<size_t>(megabytes * 1024.0f * 1024.0f);
+}
+}  // namespace
+
 OkTextureHandler *OkTextureHandler::instance = nullptr;
 
 /**
@@ -15,7 +99,7 @@ OkTextureHandler::OkTextureHandler() = default;
 
 /**
  * @brief Destructor for the OkTextureHandler class.
- *        This method cleans up all textures and clears the map.
+ *        This method cleans up all textures.
  */
 OkTextureHandler::~OkTextureHandler() {
   cleanup();
@@ -36,41 +120,81 @@ OkTextureHandler *OkTextureHandler::getInstance() {
 
 /**
  * @brief Get a texture by name.
- *        This method retrieves a texture from the map and increments its
- *        reference count.
+ *        This method looks the texture up without changing its reference
+ *        count, so the pointer is only valid while someone else holds one.
  * @param name The name of the texture.
  * @return Pointer to the OkTexture if found, nullptr otherwise.
- *         The reference count is incremented.
- *         The caller is responsible for managing the texture's lifetime.
- *         If the texture is not found, nullptr is returned.
  */
-OkTexture *OkTextureHandler::getTexture(const std::string &name) {
-  std::map<std::string, TextureEntry>::iterator it = textureMap.find(name);
+OkTexture *OkTextureHandler::getTexture(const std::string &name) const {
+  return textures.get(textures.find(name));
+}
 
-  if (it != textureMap.end()) {
-    it->second.refCount++;
-    return it->second.texture;
+/**
+ * @brief Get a texture by handle.
+ *        This method resolves the handle without changing the reference
+ *        count of the texture.
+ * @param handle The handle of the texture.
+ * @return Pointer to the OkTexture, nullptr if the handle is stale.
+ */
+OkTexture *OkTextureHandler::getTexture(OkHandle handle) const {
+  return textures.get(handle);
+}
+
+/**
+ * @brief Get the handle of a texture, to look it up or reference it later
+ *        without its name.
+ * @param name The name of the texture.
+ * @return The handle, invalid if the texture is not found.
+ */
+OkHandle OkTextureHandler::getHandle(const std::string &name) const {
+  return textures.find(name);
+}
+
+/**
+ * @brief Get a texture by name and add a reference to it.
+ * @param name The name of the texture.
+ * @return Pointer to the OkTexture if found, nullptr otherwise.
+ *         The caller must release it with removeReference.
+ */
+OkTexture *OkTextureHandler::acquireTexture(const std::string &name) {
+  return textures.get(textures.acquire(name));
+}
+
+/**
+ * @brief Store a new texture with a reference count of 1.
+ *        If another thread stored a texture with the same name meanwhile,
+ *        that one gets the reference and the new one is deleted.
+ * @param name    The name of the texture.
+ * @param texture The texture, owned by the handler from now on.
+ * @return Pointer to the stored OkTexture, nullptr if the registry is full.
+ */
+OkTexture *OkTextureHandler::_store(const std::string &name,
+                                    OkTexture         *texture) {
+  OkTexture *stored = textures.get(textures.add(name, texture));
+  if (stored != texture) {
+    delete texture;
   }
 
-  return nullptr;
+  if (!stored) {
+    OkLogger::error("TextureHandler", "No room for texture '" + name + "'");
+  }
+  return stored;
 }
 
 /**
  * @brief Create a texture from a file.
- *        This method checks if the texture already exists in the map.
+ *        This method checks if the texture already exists.
  *        If it does, it increments the reference count and returns the texture.
- *        If it doesn't, it creates a new texture from the file and adds it to
- *        the map with a reference count of 1.
+ *        If it doesn't, it creates a new texture from the file and stores it
+ *        with a reference count of 1.
  * @param path The path to the texture file.
  * @return Pointer to the OkTexture if created successfully, nullptr otherwise.
  */
 OkTexture *OkTextureHandler::createTextureFromFile(const std::string &path) {
   // First check if it already exists
-  std::map<std::string, TextureEntry>::iterator it = textureMap.find(path);
-
-  if (it != textureMap.end()) {
-    it->second.refCount++;
-    return it->second.texture;
+  OkTexture *existing = acquireTexture(path);
+  if (existing) {
+    return existing;
   }
 
   // Create new texture
@@ -80,22 +204,78 @@ OkTexture *OkTextureHandler::createTextureFromFile(const std::string &path) {
     return nullptr;
   }
 
-  // Add to map with reference count 1
-  TextureEntry entry;
-  entry.texture    = texture;
-  entry.refCount   = 1;
-  textureMap[path] = entry;
+  // Store with reference count 1
+  texture = _store(path, texture);
+  if (!texture) {
+    return nullptr;
+  }
 
   OkLogger::info("TextureHandler", "Created texture '" + path + "' from file");
   return texture;
 }
 
+/**
+ * @brief Load a texture from a file in the background.
+ *        The file is read and decoded on a loader thread, and the texture is
+ *        created on the main thread by OkAssetLoader::update. If the texture
+ *        already exists, the request is ready right away.
+ * @param path The path to the texture file, also the name of the texture.
+ * @return The request, holding a reference to the texture once it is ready.
+ */
+std::shared_ptr<OkLoadRequest>
+OkTextureHandler::loadTextureAsync(const std::string &path) {
+  OkTexture *texture = acquireTexture(path);
+  if (texture) {
+    std::shared_ptr<OkLoadRequest> request =
+        std::make_shared<OkLoadRequest>(path);
+    request->setTexture(texture);
+    request->finish(true);
+    return request;
+  }
+
+  std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+  bool stream = OkConfig::getBool("loader.stream-textures");
+
+  // The flag is global in stb_image, set it before any worker decodes, and
+  // workers check KTX2 formats against the list queried here
+  stbi_set_flip_vertically_on_load(true);
+  OkKtx2File::queryFormats();
+
+  OkLogger::info("TextureHandler", "Queued texture '" + path + "'");
+  return OkAssetLoader::getInstance()->load(
+      path,
+      [image, path, stream]() { return decodeImage(path, *image, stream); },
+      [this, image](OkLoadRequest &request) {
+        OkTexture *texture = nullptr;
+        if (!image->compressed.levels.empty()) {
+          texture = createCompressedTexture(request.getName(),
+                                            image->compressed);
+          image->compressed = OkCompressedImage();
+        } else if (image->mips) {
+          texture = createStreamingTexture(request.getName(),
+                                           std::move(image->mips));
+        } else {
+          texture = createTextureFromRawData(request.getName(), image->pixels,
+                                             image->width, image->height,
+                                             image->channels);
+          stbi_image_free(image->pixels);
+          image->pixels = nullptr;
+        }
+
+        if (texture) {
+          texture->setSource(request.getName());
+        }
+        request.setTexture(texture);
+        return texture != nullptr;
+      });
+}
+
 /**
  * @brief Create a texture from raw data.
- *        This method checks if the texture already exists in the map.
+ *        This method checks if the texture already exists.
  *        If it does, it increments the reference count and returns the texture.
- *        If it doesn't, it creates a new texture from the raw data and adds it
- *        to the map with a reference count of 1.
+ *        If it doesn't, it creates a new texture from the raw data and stores
+ *        it with a reference count of 1.
  * @param name    The name of the texture.
  * @param data    Pointer to the raw texture data.
  * @param width   The width of the texture.
@@ -108,10 +288,9 @@ OkTexture *OkTextureHandler::createTextureFromRawData(const std::string   &name,
                                                       int width, int height,
                                                       int channels) {
   // First check if it already exists
-  std::map<std::string, TextureEntry>::iterator it = textureMap.find(name);
-  if (it != textureMap.end()) {
-    it->second.refCount++;
-    return it->second.texture;
+  OkTexture *existing = acquireTexture(name);
+  if (existing) {
+    return existing;
   }
 
   // Create new texture
@@ -121,11 +300,11 @@ OkTexture *OkTextureHandler::createTextureFromRawData(const std::string   &name,
     return nullptr;
   }
 
-  // Add to map with reference count 1
-  TextureEntry entry;
-  entry.texture    = texture;
-  entry.refCount   = 1;
-  textureMap[name] = entry;
+  // Store with reference count 1
+  texture = _store(name, texture);
+  if (!texture) {
+    return nullptr;
+  }
 
   OkLogger::info("TextureHandler", "Created texture '" + name +
                                        "' from raw data (" +
@@ -135,16 +314,154 @@ OkTexture *OkTextureHandler::createTextureFromRawData(const std::string   &name,
   return texture;
 }
 
+/**
+ * @brief Create a texture streamed level by level.
+ *        This method checks if the texture already exists.
+ *        If it does, it increments the reference count and returns the texture.
+ *        If it doesn't, it allocates a new texture, whose levels are uploaded
+ *        by OkTextureStreamer smallest first, and stores it with a reference
+ *        count of 1.
+ * @param name The name of the texture.
+ * @param mips The image and its mipmap levels.
+ * @return Pointer to the OkTexture if created successfully, nullptr otherwise.
+ */
+OkTexture *
+OkTextureHandler::createStreamingTexture(const std::string          &name,
+                                         std::unique_ptr<OkMipChain> mips) {
+  // First check if it already exists
+  OkTexture *existing = acquireTexture(name);
+  if (existing) {
+    return existing;
+  }
+
+  if (!mips || mips->getLevels() == 0) {
+    OkLogger::error("TextureHandler", "No pixels for texture '" + name + "'");
+    return nullptr;
+  }
+
+  int        width   = mips->width;
+  int        height  = mips->height;
+  OkTexture *texture = new OkTexture(name, std::move(mips));
+
+  // Store with reference count 1
+  texture = _store(name, texture);
+  if (!texture) {
+    return nullptr;
+  }
+
+  OkLogger::info("TextureHandler", "Streaming texture '" + name + "' (" +
+                                       std::to_string(width) + "x" +
+                                       std::to_string(height) + ")");
+
+  return texture;
+}
+
+/**
+ * @brief Create a texture from an image uploaded as it is stored.
+ *        This method checks if the texture already exists.
+ *        If it does, it increments the reference count and returns the texture.
+ *        If it doesn't, it uploads the levels of the image, compressed blocks
+ *        included, and stores the texture with a reference count of 1.
+ * @param name  The name of the texture.
+ * @param image The image and its levels, usually read from a KTX2 file.
+ * @return Pointer to the OkTexture if created successfully, nullptr otherwise.
+ */
+OkTexture *
+OkTextureHandler::createCompressedTexture(const std::string       &name,
+                                          const OkCompressedImage &image) {
+  // First check if it already exists
+  OkTexture *existing = acquireTexture(name);
+  if (existing) {
+    return existing;
+  }
+
+  OkTexture *texture = new OkTexture(name, image);
+  if (!texture->isLoaded()) {
+    delete texture;
+    return nullptr;
+  }
+
+  // Store with reference count 1
+  texture = _store(name, texture);
+  if (!texture) {
+    return nullptr;
+  }
+
+  OkLogger::info("TextureHandler", "Created texture '" + name + "' with " +
+                                       std::to_string(image.levels.size()) +
+                                       " levels");
+
+  return texture;
+}
+
+/**
+ * @brief Create an array texture from stored textures.
+ *        The textures are copied to the layers of a new array texture,
+ *        stored with a reference count of 1. The textures keep their own
+ *        references, items switching to the array release them.
+ *        The name must be free: a texture already stored under it holds
+ *        other layers, so it is never returned in place of the array.
+ * @param name         The name of the array texture.
+ * @param textureNames The names of the textures, one per layer.
+ * @return Pointer to the OkTexture if created successfully, nullptr if the
+ *         name is taken, a texture is missing or they differ in size or
+ *         format.
+ */
+OkTexture *OkTextureHandler::createTextureArray(
+    const std::string &name, const std::vector<std::string> &textureNames) {
+  if (getTexture(name)) {
+    OkLogger::error("TextureHandler",
+                    "Texture '" + name + "' already exists, array not created");
+    return nullptr;
+  }
+
+  std::vector<const OkTexture *> layers;
+  layers.reserve(textureNames.size());
+  for (const std::string &textureName : textureNames) {
+    const OkTexture *layer = getTexture(textureName);
+    if (!layer) {
+      OkLogger::error("TextureHandler",
+                      "Unknown texture '" + textureName + "' for array");
+      return nullptr;
+    }
+    layers.push_back(layer);
+  }
+
+  OkTexture *texture = new OkTexture(name, layers);
+  if (!texture->isLoaded()) {
+    delete texture;
+    return nullptr;
+  }
+
+  // Store with reference count 1
+  texture = _store(name, texture);
+  if (!texture) {
+    return nullptr;
+  }
+
+  OkLogger::info("TextureHandler", "Created array texture '" + name +
+                                       "' with " +
+                                       std::to_string(layers.size()) +
+                                       " layers");
+
+  return texture;
+}
+
 /**
  * @brief Add a reference to a texture.
  *        This method increments the reference count of the texture.
  * @param name The name of the texture.
  */
 void OkTextureHandler::addReference(const std::string &name) {
-  std::map<std::string, TextureEntry>::iterator it = textureMap.find(name);
-  if (it != textureMap.end()) {
-    it->second.refCount++;
-  }
+  textures.acquire(name);
+}
+
+/**
+ * @brief Add a reference to a texture by handle.
+ * @param handle The handle of the texture.
+ */
+void OkTextureHandler::addReference(OkHandle handle) {
+  textures.acquire(handle);
 }
 
 /**
@@ -155,44 +472,226 @@ void OkTextureHandler::addReference(const std::string &name) {
  * @param name The name of the texture.
  */
 void OkTextureHandler::removeReference(const std::string &name) {
-  std::map<std::string, TextureEntry>::iterator it = textureMap.find(name);
+  if (textures.release(textures.find(name))) {
+    OkLogger::info("TextureHandler", "Removing texture: " + name);
+  }
+}
+
+/**
+ * @brief Remove a reference to a texture by handle.
+ *        If the reference count reaches zero, the texture is deleted and the
+ *        handle becomes stale.
+ * @param handle The handle of the texture.
+ */
+void OkTextureHandler::removeReference(OkHandle handle) {
+  std::string name = textures.getName(handle);
+  if (textures.release(handle)) {
+    OkLogger::info("TextureHandler", "Removing texture: " + name);
+  }
+}
+
+/**
+ * @brief Keep the textures within the video memory budget.
+ *        Over budget, textures not bound for textures.idle-frames lose their
+ *        largest mipmap levels, least recently used first, until the usage
+ *        fits. Textures with dropped levels bound in the last frame are
+ *        reloaded from their file in the background, dropping levels of the
+ *        idle textures first when the whole texture does not fit. Only
+ *        textures with a source file are ever dropped.
+ */
+void OkTextureHandler::update() {
+  OkTexture::advanceFrame();
+  uint64_t frame  = OkTexture::getFrame();
+  size_t   budget = getMemoryBudget();
+  uint64_t idle =
+      static_cast<uint64_t>(std::max(OkConfig::getInt("textures.idle-frames"),
+                                     0));
+
+  // Forget the finished reloads
+  reloads.erase(std::remove_if(reloads.begin(), reloads.end(),
+                               [](const Reload &reload) {
+                                 return reload.request->isDone();
+                               }),
+                reloads.end());
 
-  if (it != textureMap.end()) {
-    it->second.refCount--;
+  // Textures that can drop levels, and textures to reload
+  std::vector<std::pair<OkHandle, OkTexture *>> idleTextures;
+  std::vector<std::pair<OkHandle, OkTexture *>> usedTextures;
+  size_t                                        usage = 0;
+  textures.forEach([&](OkHandle handle, OkTexture *texture) {
+    usage += texture->getMemorySize();
+    if (texture->getSource().empty() || texture->isStreaming() ||
+        texture->isArray()) {
+      return;
+    }
 
-    if (it->second.refCount <= 0) {
-      OkLogger::info("TextureHandler", "Removing texture: " + name);
-      delete it->second.texture;
-      textureMap.erase(it);
+    uint64_t lastUsed = texture->getLastUsedFrame();
+    if (frame - lastUsed > idle) {
+      idleTextures.emplace_back(handle, texture);
+    } else if (texture->getDroppedLevels() > 0 && lastUsed + 1 >= frame) {
+      usedTextures.emplace_back(handle, texture);
     }
+  });
+
+  std::sort(idleTextures.begin(), idleTextures.end(),
+            [](const std::pair<OkHandle, OkTexture *> &a,
+               const std::pair<OkHandle, OkTexture *> &b) {
+              return a.second->getLastUsedFrame() <
+                     b.second->getLastUsedFrame();
+            });
+
+  // Drop levels of the idle textures, least recently used first, until the
+  // usage is down to the target
+  auto evict = [&](size_t target) {
+    for (const std::pair<OkHandle, OkTexture *> &entry : idleTextures) {
+      if (usage <= target) {
+        break;
+      }
+
+      // Each level dropped frees about three quarters of the rest
+      OkTexture *texture = entry.second;
+      size_t     excess  = usage - target;
+      size_t     size    = texture->getMemorySize();
+      int        count   = 1;
+      while (count < texture->getLevelCount() - 1 &&
+             size - (size >> (2 * count)) < excess) {
+        count++;
+      }
+
+      size_t freed = texture->dropLevels(count);
+      if (freed > 0) {
+        usage -= std::min(freed, usage);
+        stats.freedBytes += freed;
+        stats.droppedLevels += count;
+        OkLogger::info("TextureHandler",
+                       "Dropped " + std::to_string(count) +
+                           " levels of texture " + texture->getPath());
+      }
+    }
+  };
+
+  if (budget > 0 && usage > budget) {
+    evict(budget);
   }
+
+  // Textures used again get their levels back, making room with the idle
+  // textures when they do not fit
+  for (const std::pair<OkHandle, OkTexture *> &entry : usedTextures) {
+    bool reloading = false;
+    for (const Reload &reload : reloads) {
+      reloading = reloading || reload.handle == entry.first;
+    }
+
+    size_t size = entry.second->getMemorySize();
+    size_t full = size << (2 * entry.second->getDroppedLevels());
+    if (reloading || (budget > 0 && full - size > budget)) {
+      continue;
+    }
+
+    if (budget > 0 && usage + full - size > budget) {
+      evict(budget - (full - size));
+      if (usage + full - size > budget) {
+        continue;
+      }
+    }
+
+    usage += full - size;
+    _reload(entry.first, entry.second->getSource());
+  }
+}
+
+/**
+ * @brief Reload a texture from its file in the background, bringing back
+ *        its dropped levels once uploaded.
+ * @param handle The handle of the texture, skipped if it is deleted before.
+ * @param source The file of the texture.
+ */
+void OkTextureHandler::_reload(OkHandle handle, const std::string &source) {
+  std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+
+  stbi_set_flip_vertically_on_load(true);
+  OkKtx2File::queryFormats();
+
+  std::shared_ptr<OkLoadRequest> reload = OkAssetLoader::getInstance()->load(
+      source, [image, source]() { return decodeImage(source, *image, false); },
+      [this, image, handle](OkLoadRequest &request) {
+        OkTexture *texture = textures.get(handle);
+        if (!texture) {
+          return false;
+        }
+
+        std::unique_ptr<OkTexture> reloaded;
+        if (!image->compressed.levels.empty()) {
+          reloaded = std::make_unique<OkTexture>(texture->getPath(),
+                                                 image->compressed);
+        } else {
+          reloaded = std::make_unique<OkTexture>(image->pixels, image->width,
+                                                 image->height,
+                                                 image->channels);
+        }
+        if (!texture->restore(*reloaded)) {
+          return false;
+        }
+
+        stats.reloads++;
+        OkLogger::info("TextureHandler",
+                       "Reloaded texture " + request.getName());
+        return true;
+      });
+  reloads.push_back({handle, reload});
+}
+
+/**
+ * @brief Get the video memory used by the textures.
+ * @return The size in bytes of all the stored levels.
+ */
+size_t OkTextureHandler::getMemoryUsage() const {
+  size_t usage = 0;
+  textures.forEach([&usage](OkHandle, OkTexture *texture) {
+    usage += texture->getMemorySize();
+  });
+  return usage;
+}
+
+/**
+ * @brief Get the video memory statistics of the textures.
+ * @return The current usage and budget, and the counters since the last
+ *         cleanup.
+ */
+OkTextureMemoryStats OkTextureHandler::getMemoryStats() const {
+  OkTextureMemoryStats current = stats;
+  current.usage                = getMemoryUsage();
+  current.budget               = getMemoryBudget();
+  current.textures             = static_cast<int>(textures.getCount());
+  return current;
 }
 
 /**
  * @brief Cleanup all textures.
- *        This method deletes all textures in the map and clears the map.
+ *        This method deletes all textures, whatever their reference count,
+ *        and resets the memory statistics.
  */
 void OkTextureHandler::cleanup() {
-  for (const auto &entry : textureMap) {
-    delete entry.second.texture;
-  }
-
-  textureMap.clear();
+  reloads.clear();
+  textures.clear();
+  stats = OkTextureMemoryStats();
 }
 
 /**
  * @brief Get the names of all textures.
  *        This method returns a vector of strings containing the names of all
- *        textures in the map.
+ *        stored textures, in no particular order.
  * @return Vector of texture names.
  */
 std::vector<std::string> OkTextureHandler::getTextureNames() const {
-  std::vector<std::string> names;
-  names.reserve(textureMap.size());
-
-  for (const auto &entry : textureMap) {
-    names.push_back(entry.first);
-  }
+  return textures.getNames();
+}
 
-  return names;
+/**
+ * @brief Get the reference count of a texture.
+ * @param name The name of the texture.
+ * @return The reference count, 0 if the texture is not found.
+ */
+int OkTextureHandler::getReferenceCount(const std::string &name) const {
+  return textures.getReferenceCount(textures.find(name));
 }
@@ -2,19 +2,40 @@
 #define OK_TEXTURES_HPP
 
 #include "../item/texture.hpp"
-#include <map>
+#include "loader.hpp"
+#include "registry.hpp"
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
+// Video memory used by the textures, and what keeping it within the budget
+// cost so far
+struct OkTextureMemoryStats {
+  size_t usage         = 0;  // Bytes of the levels stored
+  size_t budget        = 0;  // Bytes allowed, 0 for no budget
+  size_t freedBytes    = 0;  // Bytes freed by dropping levels
+  int    droppedLevels = 0;  // Levels dropped to stay within the budget
+  int    reloads       = 0;  // Textures reloaded after being used again
+  int    textures      = 0;  // Textures stored
+};
+
 class OkTextureHandler {
 private:
-  // Map of texture name/path to texture and its reference count
-  struct TextureEntry {
-    OkTexture *texture;
-    int        refCount;
+  // Textures by name/path, with their reference count
+  OkRegistry<OkTexture> textures;
+
+  // Reload of a texture with dropped levels
+  struct Reload {
+    OkHandle                       handle;
+    std::shared_ptr<OkLoadRequest> request;
   };
 
-  std::map<std::string, TextureEntry> textureMap;
+  std::vector<Reload>  reloads;
+  OkTextureMemoryStats stats;  // Counters, the usage is computed when asked
+
+  OkTexture *_store(const std::string &name, OkTexture *texture);
+  void       _reload(OkHandle handle, const std::string &source);
 
   // Private constructor - singleton
   OkTextureHandler();
@@ -30,22 +51,60 @@ public:
   // Get singleton instance
   static OkTextureHandler *getInstance();
 
-  // Get an existing texture by name (returns nullptr if not found)
-  OkTexture *getTexture(const std::string &name);
+  // Get an existing texture by name or handle, without adding a reference
+  // (returns nullptr if not found)
+  OkTexture *getTexture(const std::string &name) const;
+  OkTexture *getTexture(OkHandle handle) const;
+  OkHandle   getHandle(const std::string &name) const;
+
+  // Get an existing texture by name and add a reference to it
+  OkTexture *acquireTexture(const std::string &name);
 
   std::vector<std::string> getTextureNames() const;
+  int                      getReferenceCount(const std::string &name) const;
 
-  // Create and store a texture from file
+  // Create and store a texture from file, decoded or read from KTX2
   OkTexture *createTextureFromFile(const std::string &path);
 
+  // Load and store a texture from file in the background, decoding it on a
+  // loader thread and uploading it on the main thread
+  std::shared_ptr<OkLoadRequest> loadTextureAsync(const std::string &path);
+
   // Create and store a texture from raw data
   OkTexture *createTextureFromRawData(const std::string   &name,
                                       const unsigned char *data, int width,
                                       int height, int channels);
 
-  // Reference counting
+  // Create and store a texture whose levels are uploaded by
+  // OkTextureStreamer over the next frames
+  OkTexture *createStreamingTexture(const std::string          &name,
+                                    std::unique_ptr<OkMipChain> mips);
+
+  // Create and store a texture whose levels are uploaded as they are, such
+  // as compressed blocks read from a KTX2 file
+  OkTexture *createCompressedTexture(const std::string       &name,
+                                     const OkCompressedImage &image);
+
+  // Create and store an array texture with a copy of stored textures of the
+  // same size and format, one per layer in the order given. Fails if the
+  // name is taken
+  OkTexture *createTextureArray(const std::string              &name,
+                                const std::vector<std::string> &textureNames);
+
+  // Main thread, once per frame: keep the textures within the video memory
+  // budget, and reload the ones used again after dropping levels
+  void update();
+
+  // Video memory statistics
+  size_t               getMemoryUsage() const;
+  OkTextureMemoryStats getMemoryStats() const;
+
+  // Reference counting, safe from any thread, but textures must be deleted
+  // on the main thread
   void addReference(const std::string &name);
+  void addReference(OkHandle handle);
   void removeReference(const std::string &name);
+  void removeReference(OkHandle handle);
 
   // Cleanup
   void cleanup();
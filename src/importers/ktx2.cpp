@@ -0,0 +1,270 @@
+#include "ktx2.hpp"
+#include "../utils/files.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Identifies KTX2 files
+static const unsigned char identifierBytes[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// Formats readable from KTX2 files
+struct OkKtx2Format {
+  uint32_t vkFormat;     // VkFormat in the file
+  GLenum   format;       // Internal format
+  GLenum   pixelFormat;  // Pixel format, 0 if compressed
+  uint32_t blockSize;    // Bytes per 4x4 block, or per pixel if uncompressed
+  int      channels;
+};
+
+// Compressed formats are listed by value, most are extensions or newer than
+// the OpenGL 4.1 headers
+static const OkKtx2Format formats[] = {
+    // 8-bit pixels
+    {9, GL_R8, GL_RED, 1, 1},
+    {16, GL_RG8, GL_RG, 2, 2},
+    {23, GL_RGB8, GL_RGB, 3, 3},
+    {29, GL_SRGB8, GL_RGB, 3, 3},
+    {37, GL_RGBA8, GL_RGBA, 4, 4},
+    {43, GL_SRGB8_ALPHA8, GL_RGBA, 4, 4},
+
+    // BC1 to BC7 (S3TC, RGTC and BPTC)
+    {131, 0x83F0, 0, 8, 3},
+    {132, 0x8C4C, 0, 8, 3},
+    {133, 0x83F1, 0, 8, 4},
+    {134, 0x8C4D, 0, 8, 4},
+    {135, 0x83F2, 0, 16, 4},
+    {136, 0x8C4E, 0, 16, 4},
+    {137, 0x83F3, 0, 16, 4},
+    {138, 0x8C4F, 0, 16, 4},
+    {139, 0x8DBB, 0, 8, 1},
+    {140, 0x8DBC, 0, 8, 1},
+    {141, 0x8DBD, 0, 16, 2},
+    {142, 0x8DBE, 0, 16, 2},
+    {143, 0x8E8F, 0, 16, 3},
+    {144, 0x8E8E, 0, 16, 3},
+    {145, 0x8E8C, 0, 16, 4},
+    {146, 0x8E8D, 0, 16, 4},
+
+    // ETC2 and EAC
+    {147, 0x9274, 0, 8, 3},
+    {148, 0x9275, 0, 8, 3},
+    {149, 0x9276, 0, 8, 4},
+    {150, 0x9277, 0, 8, 4},
+    {151, 0x9278, 0, 16, 4},
+    {152, 0x9279, 0, 16, 4},
+    {153, 0x9270, 0, 8, 1},
+    {154, 0x9271, 0, 8, 1},
+    {155, 0x9272, 0, 16, 2},
+    {156, 0x9273, 0, 16, 2},
+};
+
+std::vector<GLenum> OkKtx2File::supportedFormats;
+bool                OkKtx2File::formatsQueried = false;
+
+/**
+ * @brief Tell if a file is a KTX2 file, by its extension.
+ * @param filename The file name.
+ * @return True if the name ends with .ktx2, in any case.
+ */
+bool OkKtx2File::isKtx2(const std::string &filename) {
+  const std::string extension = ".ktx2";
+  if (filename.size() < extension.size()) {
+    return false;
+  }
+
+  std::string end = filename.substr(filename.size() - extension.size());
+  std::transform(end.begin(), end.end(), end.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return end == extension;
+}
+
+/**
+ * @brief Find the OpenGL format of a VkFormat.
+ * @param vkFormat  The format in the file.
+ * @param image     Receives the formats and number of channels.
+ * @param blockSize Receives the bytes per 4x4 block, or per pixel if the
+ *                  format is not compressed.
+ * @return True if the format is known.
+ */
+bool OkKtx2File::_getFormat(uint32_t vkFormat, OkCompressedImage &image,
+                            size_t &blockSize) {
+  for (const OkKtx2Format &entry : formats) {
+    if (entry.vkFormat == vkFormat) {
+      image.format      = entry.format;
+      image.pixelFormat = entry.pixelFormat;
+      image.channels    = entry.channels;
+      blockSize         = entry.blockSize;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Read the levels of a mapped KTX2 file.
+ *        Only 2D textures without supercompression are accepted, and every
+ *        level must have exactly the size of its blocks or pixels.
+ * @param file  The mapped file, kept open by the image.
+ * @param image Receives the image, its levels pointing into the file.
+ * @return True if the file is a valid KTX2 texture.
+ */
+bool OkKtx2File::read(std::shared_ptr<const OkMappedFile> file,
+                      OkCompressedImage                  &image) {
+  static_assert(sizeof(Header) == 80, "KTX2 header layout changed");
+
+  if (!file || !file->isOpen() || file->getSize() < sizeof(Header)) {
+    return false;
+  }
+
+  const Header *header = reinterpret_cast<const Header *>(file->getData());
+  if (std::memcmp(header->identifier, identifierBytes,
+                  sizeof(identifierBytes)) != 0) {
+    OkLogger::error("KTX2", "Not a KTX2 file");
+    return false;
+  }
+
+  size_t blockSize = 0;
+  if (!_getFormat(header->vkFormat, image, blockSize)) {
+    OkLogger::error("KTX2", "Unsupported format " +
+                                std::to_string(header->vkFormat));
+    return false;
+  }
+
+  if (header->supercompressionScheme != 0) {
+    OkLogger::error("KTX2", "Supercompressed files are not supported");
+    return false;
+  }
+
+  if (header->pixelWidth == 0 || header->pixelHeight == 0 ||
+      header->pixelDepth > 1 || header->layerCount > 1 ||
+      header->faceCount != 1 || header->levelCount > 32) {
+    OkLogger::error("KTX2", "Only 2D textures are supported");
+    return false;
+  }
+
+  // Level index, right after the header
+  uint32_t levelCount = std::max(header->levelCount, 1u);
+  if (file->getSize() < sizeof(Header) + levelCount * sizeof(LevelIndex)) {
+    return false;
+  }
+  const LevelIndex *index =
+      reinterpret_cast<const LevelIndex *>(file->getData() + sizeof(Header));
+
+  image.width  = static_cast<int>(header->pixelWidth);
+  image.height = static_cast<int>(header->pixelHeight);
+  image.levels.clear();
+
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint64_t width  = std::max(header->pixelWidth >> level, 1u);
+    uint64_t height = std::max(header->pixelHeight >> level, 1u);
+    uint64_t size   = image.isCompressed()
+                          ? ((width + 3) / 4) * ((height + 3) / 4) * blockSize
+                          : width * height * blockSize;
+
+    // Check the offset before adding, so it cannot overflow
+    if (index[level].byteLength != size ||
+        index[level].byteOffset > file->getSize() ||
+        file->getSize() - index[level].byteOffset < size) {
+      OkLogger::error("KTX2", "Invalid level " + std::to_string(level));
+      image.levels.clear();
+      return false;
+    }
+
+    image.levels.push_back(
+        {reinterpret_cast<const unsigned char *>(file->getData()) +
+             index[level].byteOffset,
+         static_cast<size_t>(size)});
+  }
+
+  image.file = std::move(file);
+  return true;
+}
+
+/**
+ * @brief Map a KTX2 file and read its levels.
+ * @param filename The file name.
+ * @param image    Receives the image, its levels pointing into the file.
+ * @return True if the file is a valid KTX2 texture.
+ */
+bool OkKtx2File::read(const std::string &filename, OkCompressedImage &image) {
+  std::shared_ptr<const OkMappedFile> file =
+      std::make_shared<const OkMappedFile>(filename);
+  if (!file->isOpen()) {
+    OkLogger::error("KTX2", "Error opening file: " + filename);
+    return false;
+  }
+
+  if (!read(file, image)) {
+    OkLogger::error("KTX2", "Invalid KTX2 file: " + filename);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Query the compressed formats the driver accepts.
+ *        Done once, on the thread owning the OpenGL context.
+ */
+void OkKtx2File::queryFormats() {
+  if (formatsQueried) {
+    return;
+  }
+
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+  std::vector<GLint> values(std::max(count, 0));
+  if (count > 0) {
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, values.data());
+  }
+
+  supportedFormats.assign(values.begin(), values.end());
+  formatsQueried = true;
+}
+
+/**
+ * @brief Tell if the driver accepts the format of an image.
+ *        RGTC (BC4 and BC5) is core since OpenGL 3.0 and drivers may leave
+ *        it out of their list. queryFormats must have been called.
+ * @param image The image.
+ * @return True if the image can be uploaded as it is.
+ */
+bool OkKtx2File::isSupported(const OkCompressedImage &image) {
+  if (!image.isCompressed() ||
+      (image.format >= 0x8DBB && image.format <= 0x8DBE)) {
+    return true;
+  }
+
+  return std::find(supportedFormats.begin(), supportedFormats.end(),
+                   image.format) != supportedFormats.end();
+}
+
+/**
+ * @brief Find an image next to a KTX2 file, with the same name and an
+ *        extension stb_image decodes.
+ * @param filename The KTX2 file name.
+ * @return The name of the image, or an empty string if there is none.
+ */
+std::string OkKtx2File::getFallbackName(const std::string &filename) {
+  size_t      dot  = filename.find_last_of('.');
+  std::string stem = filename.substr(0, dot);
+
+  for (const char *extension : {".png", ".jpg", ".jpeg", ".tga", ".bmp"}) {
+    uint64_t size;
+    int64_t  modified;
+    if (OkFiles::getFileInfo(stem + extension, size, modified)) {
+      return stem + extension;
+    }
+  }
+
+  return "";
+}
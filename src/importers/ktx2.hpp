@@ -0,0 +1,82 @@
+#ifndef OK_KTX2_HPP
+#define OK_KTX2_HPP
+
+#include "../core/gl_config.hpp"
+#include "../item/texture.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class OkMappedFile;
+
+/**
+ * @brief KTX2 texture files, holding GPU compressed blocks (BC1 to BC7,
+ *        ETC2) or 8-bit pixels, with their mipmap levels built offline.
+ *        Files are memory mapped and their levels uploaded in place, there
+ *        is nothing to decode. Supercompressed files (Basis, Zstandard) are
+ *        not supported. Images are uploaded as stored, so they must be
+ *        written bottom row first, as OpenGL expects.
+ */
+class OkKtx2File {
+public:
+  // Static class - no instantiation
+  OkKtx2File() = delete;
+
+  // Tell KTX2 files by their extension
+  static bool isKtx2(const std::string &filename);
+
+  // Read the levels of a mapped file, or of a file mapped now
+  static bool read(std::shared_ptr<const OkMappedFile> file,
+                   OkCompressedImage                  &image);
+  static bool read(const std::string &filename, OkCompressedImage &image);
+
+  // Compressed formats accepted by the driver. The list is queried once, on
+  // the main thread, then the check can be done from any thread
+  static void queryFormats();
+  static bool isSupported(const OkCompressedImage &image);
+
+  // Image next to a KTX2 file, with the same name and a decodable extension,
+  // loaded instead when the driver lacks its format
+  static std::string getFallbackName(const std::string &filename);
+
+private:
+  /**
+   * @brief File header, followed by the level index. Data is little endian,
+   *        as on every platform the engine runs on.
+   */
+  struct Header {
+    unsigned char identifier[12];  // "«KTX 20»\r\n\x1A\n"
+    uint32_t      vkFormat;        // VkFormat of the blocks or pixels
+    uint32_t      typeSize;
+    uint32_t      pixelWidth;
+    uint32_t      pixelHeight;
+    uint32_t      pixelDepth;  // 0 for 2D textures
+    uint32_t      layerCount;  // 0 if not an array
+    uint32_t      faceCount;   // 6 for cube maps
+    uint32_t      levelCount;  // 0 asks to generate the levels
+    uint32_t      supercompressionScheme;
+    uint32_t      dfdByteOffset;
+    uint32_t      dfdByteLength;
+    uint32_t      kvdByteOffset;
+    uint32_t      kvdByteLength;
+    uint64_t      sgdByteOffset;
+    uint64_t      sgdByteLength;
+  };
+
+  // Position of each level in the file, level 0 first
+  struct LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+  };
+
+  static bool _getFormat(uint32_t vkFormat, OkCompressedImage &image,
+                         size_t &blockSize);
+
+  static std::vector<GLenum> supportedFormats;
+  static bool                formatsQueried;
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include "okmesh.hpp"
+#include "../handlers/meshes.hpp"
+#include "../utils/files.hpp"
+#include "../utils/logger.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <ios>
+#include <memory>
+#include <string>
+
+// Identifies binary mesh files
+static const char magicBytes[4] = {'O', 'K', 'M', 'S'};
+
+/**
+ * @brief Get the header of a mapped binary mesh file, checking that the file
+ *        has the current version, a known layout and exactly the size the
+ *        header announces.
+ * @param file   The mapped file.
+ * @param layout Receives the layout of the vertices.
+ * @return The header, inside the mapping, or nullptr if the file is not a
+ *         valid binary mesh.
+ */
+const OkMeshFile::Header *OkMeshFile::readHeader(const OkMappedFile &file,
+                                                 OkVertexLayout     &layout) {
+  static_assert(sizeof(Header) == 72, "Binary mesh header layout changed");
+
+  if (!file.isOpen() || file.getSize() < sizeof(Header)) {
+    return nullptr;
+  }
+
+  const Header *header = reinterpret_cast<const Header *>(file.getData());
+  if (std::memcmp(header->magic, magicBytes, sizeof(magicBytes)) != 0 ||
+      header->version != version ||
+      !OkVertexLayout::decode(header->layout, layout) ||
+      (header->indexSize != sizeof(uint16_t) &&
+       header->indexSize != sizeof(uint32_t))) {
+    return nullptr;
+  }
+
+  // 16-bit indices cannot address more vertices
+  if (header->indexSize == sizeof(uint16_t) && header->vertexCount > 65536) {
+    return nullptr;
+  }
+
+  // Check the counts before computing sizes, so they cannot overflow
+  uint64_t available   = file.getSize() - sizeof(Header);
+  uint64_t vertexBytes = layout.getStride();
+  if (header->vertexCount > available / vertexBytes ||
+      header->indexCount > available / header->indexSize ||
+      sizeof(Header) + header->vertexCount * vertexBytes +
+              header->indexCount * header->indexSize !=
+          file.getSize()) {
+    return nullptr;
+  }
+
+  return header;
+}
+
+/**
+ * @brief Create a mesh from a mapped binary mesh file.
+ *        The vertices and indices are read in place from the mapping, which
+ *        is kept by the mesh.
+ * @param file     The mapped file.
+ * @param meshName The name of the mesh in OkMeshHandler.
+ * @return The mesh, or nullptr if the file is not a valid binary mesh.
+ */
+OkMesh *OkMeshFile::createMesh(std::shared_ptr<const OkMappedFile> file,
+                               const std::string                  &meshName) {
+  OkVertexLayout layout;
+  const Header  *header = readHeader(*file, layout);
+  if (!header) {
+    return nullptr;
+  }
+
+  const char *vertices = file->getData() + sizeof(Header);
+  const char *indices  = vertices + header->vertexCount * layout.getStride();
+  GLenum      indexType =
+      header->indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT
+                                            : GL_UNSIGNED_INT;
+  glm::vec3 center(header->center[0], header->center[1], header->center[2]);
+
+  return OkMeshHandler::getInstance()->createMesh(
+      meshName, file, layout, vertices, static_cast<long>(header->vertexCount),
+      indices, indexType, static_cast<long>(header->indexCount), center,
+      header->radius);
+}
+
+/**
+ * @brief Create a mesh from a binary mesh file.
+ * @param filename The name of the file.
+ * @param meshName The name of the mesh in OkMeshHandler.
+ * @return The mesh, or nullptr if the file cannot be read or is not valid.
+ */
+OkMesh *OkMeshFile::loadMesh(const std::string &filename,
+                             const std::string &meshName) {
+  std::shared_ptr<const OkMappedFile> file =
+      std::make_shared<const OkMappedFile>(filename);
+  if (!file->isOpen()) {
+    return nullptr;
+  }
+
+  OkMesh *mesh = createMesh(file, meshName);
+  if (!mesh) {
+    OkLogger::error("MeshFile", "Invalid mesh file: " + filename);
+  }
+  return mesh;
+}
+
+/**
+ * @brief Import a binary mesh file and create an OkItem.
+ *        Importing the same file again reuses its mesh.
+ * @param filename The name of the file.
+ * @return A pointer to the created OkItem, or nullptr on failure.
+ */
+OkItem *OkMeshFile::importFile(const std::string &filename) {
+  OkMesh *mesh = OkMeshHandler::getInstance()->acquireMesh(filename);
+  if (!mesh) {
+    mesh = loadMesh(filename, filename);
+  }
+  if (!mesh) {
+    return nullptr;
+  }
+
+  return new OkItem(OkFiles::getBaseName(filename), mesh, filename);
+}
+
+/**
+ * @brief Write a binary mesh file with the geometry of a mesh, as it is
+ *        stored: in its vertex layout and with its index size.
+ *        The file is written under a temporary name and then renamed, so an
+ *        interrupted write never leaves a truncated file behind.
+ * @param filename The name of the file.
+ * @param mesh     The mesh.
+ * @param source   The file the mesh was imported from, zero if none.
+ * @return True if the file was written.
+ */
+bool OkMeshFile::writeFile(const std::string &filename, const OkMesh &mesh,
+                           const Source &source) {
+  const OkVertexLayout &layout = mesh.getLayout();
+
+  Header header;
+  std::memcpy(header.magic, magicBytes, sizeof(magicBytes));
+  header.version     = version;
+  header.layout      = layout.encode();
+  header.indexSize   = static_cast<uint32_t>(mesh.getIndexSize());
+  header.vertexCount = static_cast<uint64_t>(mesh.getVertexCount());
+  header.indexCount  = static_cast<uint64_t>(mesh.getIndexCount());
+  header.center[0]   = mesh.getCenter().x;
+  header.center[1]   = mesh.getCenter().y;
+  header.center[2]   = mesh.getCenter().z;
+  header.radius      = mesh.getRadius();
+  header.source      = source;
+
+  // Writes to a file that failed to open just set its error state
+  std::string   temporary = filename + ".tmp";
+  std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(mesh.getVertexData()),
+             static_cast<std::streamsize>(header.vertexCount *
+                                          layout.getStride()));
+  file.write(static_cast<const char *>(mesh.getIndexData()),
+             static_cast<std::streamsize>(header.indexCount *
+                                          header.indexSize));
+  file.close();
+  if (file.fail()) {
+    OkLogger::error("MeshFile", "Error writing mesh file: " + filename);
+    std::remove(temporary.c_str());
+    return false;
+  }
+
+  // Renaming over an existing file fails on some platforms
+  std::remove(filename.c_str());
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    OkLogger::error("MeshFile", "Error writing mesh file: " + filename);
+    std::remove(temporary.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Get the name of the cache file of an imported file.
+ * @param sourceFile The imported file.
+ * @return The cache file name, next to the imported file.
+ */
+std::string OkMeshFile::getCacheName(const std::string &sourceFile) {
+  return sourceFile + ".okmesh";
+}
+
+/**
+ * @brief Open and validate the cache file of an imported file.
+ *        The cache is used if the size and modification time of the source
+ *        match the ones recorded in it. If only the time differs, or the
+ *        source was modified too close to the cache to tell, the source is
+ *        hashed and the cache is used if the content did not change.
+ *        Caches stored in another layout are ignored, except that a cache
+ *        without normals is valid for any normal format, as the source may
+ *        have none. This does not use OpenGL, so it can run on any thread.
+ * @param sourceFile The imported file.
+ * @param layout     The layout the importer stores meshes in.
+ * @return The mapped cache file, or nullptr if there is no valid cache for
+ *         the source.
+ */
+std::shared_ptr<const OkMappedFile>
+OkMeshFile::openCache(const std::string    &sourceFile,
+                      const OkVertexLayout &layout) {
+  std::string cacheName = getCacheName(sourceFile);
+  Source      current;
+  uint64_t    cacheSize     = 0;
+  int64_t     cacheModified = 0;
+  if (!OkFiles::getFileInfo(sourceFile, current.size, current.modified) ||
+      !OkFiles::getFileInfo(cacheName, cacheSize, cacheModified)) {
+    return nullptr;
+  }
+
+  std::shared_ptr<const OkMappedFile> file =
+      std::make_shared<const OkMappedFile>(cacheName);
+  OkVertexLayout cacheLayout;
+  const Header  *header = readHeader(*file, cacheLayout);
+  if (!header || header->source.size != current.size ||
+      cacheLayout.texcoords != layout.texcoords ||
+      (cacheLayout.normals != layout.normals &&
+       cacheLayout.normals != OkNormalFormat::None)) {
+    OkLogger::info("MeshFile", "Ignoring outdated cache " + cacheName);
+    return nullptr;
+  }
+
+  // Times have a resolution of seconds, a source modified in the second the
+  // cache was written may have changed after it
+  if (header->source.modified != current.modified ||
+      current.modified >= cacheModified) {
+    OkMappedFile source(sourceFile);
+    if (!source.isOpen() ||
+        OkFiles::hashData(source.getData(), source.getSize()) !=
+            header->source.hash) {
+      OkLogger::info("MeshFile", "Ignoring outdated cache " + cacheName);
+      return nullptr;
+    }
+  }
+
+  return file;
+}
+
+/**
+ * @brief Create a mesh from the cache file of an imported file, if it is
+ *        valid, see openCache.
+ * @param sourceFile The imported file.
+ * @param meshName   The name of the mesh in OkMeshHandler.
+ * @param layout     The layout the importer stores meshes in.
+ * @return The mesh, or nullptr if there is no valid cache for the source.
+ */
+OkMesh *OkMeshFile::loadCache(const std::string    &sourceFile,
+                              const std::string    &meshName,
+                              const OkVertexLayout &layout) {
+  std::shared_ptr<const OkMappedFile> file = openCache(sourceFile, layout);
+  if (!file) {
+    return nullptr;
+  }
+
+  OkLogger::info("MeshFile", "Loading " + sourceFile + " from " +
+                                 getCacheName(sourceFile));
+  return createMesh(file, meshName);
+}
+
+/**
+ * @brief Write the cache file of an imported file.
+ * @param sourceFile The imported file.
+ * @param mesh       The mesh created from the imported file.
+ * @return True if the cache was written.
+ */
+bool OkMeshFile::writeCache(const std::string &sourceFile,
+                            const OkMesh      &mesh) {
+  Source       source;
+  OkMappedFile file(sourceFile);
+  if (!file.isOpen() ||
+      !OkFiles::getFileInfo(sourceFile, source.size, source.modified)) {
+    return false;
+  }
+  source.hash = OkFiles::hashData(file.getData(), file.getSize());
+
+  return writeFile(getCacheName(sourceFile), mesh, source);
+}
@@ -0,0 +1,82 @@
+#ifndef OK_OKMESH_HPP
+#define OK_OKMESH_HPP
+
+#include "../item/item.hpp"
+#include "../item/mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class OkMappedFile;
+
+/**
+ * @brief Binary mesh files, holding welded and optimized geometry ready to
+ *        be uploaded: a header with the bounds, then the interleaved
+ *        vertices in their vertex layout and the 16 or 32-bit indices.
+ *        Files are memory mapped and their data is given to the GPU in
+ *        place, without parsing or copies.
+ *        They are also used as a cache of imported files: the header records
+ *        the size, modification time and hash of the source file.
+ */
+class OkMeshFile {
+public:
+  // Static class - no instantiation
+  OkMeshFile() = delete;
+
+  // Identification of the file a mesh was imported from
+  struct Source {
+    uint64_t size;
+    int64_t  modified;  // Seconds since the epoch
+    uint64_t hash;
+  };
+
+  // Format version, files of other versions are ignored
+  static const uint32_t version = 2;
+
+  // Import a binary mesh file
+  static OkItem *importFile(const std::string &filename);
+
+  // Create a mesh from a file, stored under a name in OkMeshHandler
+  static OkMesh *loadMesh(const std::string &filename,
+                          const std::string &meshName);
+  static bool    writeFile(const std::string &filename, const OkMesh &mesh,
+                           const Source &source);
+
+  // Create a mesh from a mapped file, as returned by openCache
+  static OkMesh *createMesh(std::shared_ptr<const OkMappedFile> file,
+                            const std::string                  &meshName);
+
+  // Cache of imported files, next to the source file
+  static std::string getCacheName(const std::string &sourceFile);
+  static std::shared_ptr<const OkMappedFile>
+  openCache(const std::string &sourceFile, const OkVertexLayout &layout);
+  static OkMesh *loadCache(const std::string    &sourceFile,
+                           const std::string    &meshName,
+                           const OkVertexLayout &layout);
+  static bool    writeCache(const std::string &sourceFile,
+                            const OkMesh      &mesh);
+
+private:
+  /**
+   * @brief File header, followed by the vertices and then the indices.
+   *        Data is stored in the byte order of the machine that wrote it,
+   *        files from machines of the other order are rejected by the magic.
+   */
+  struct Header {
+    char     magic[4];     // "OKMS"
+    uint32_t version;
+    uint32_t layout;       // OkVertexLayout::encode
+    uint32_t indexSize;    // 2 or 4 bytes
+    uint64_t vertexCount;  // Number of vertices
+    uint64_t indexCount;
+    float    center[3];    // Bounding box center
+    float    radius;       // Half the bounding box diagonal
+    Source   source;
+  };
+
+  static const Header *readHeader(const OkMappedFile &file,
+                                  OkVertexLayout     &layout);
+};
+
+#endif
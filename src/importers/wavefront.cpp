@@ -1,229 +1,728 @@
 #include "wavefront.hpp"
+#include "../config/config.hpp"
+#include "../handlers/loader.hpp"
+#include "../handlers/meshes.hpp"
+#include "../item/optimizer.hpp"
+#include "../utils/files.hpp"
 #include "../utils/logger.hpp"
 #include "item/item.hpp"
+#include "okmesh.hpp"
 #include <algorithm>
+#include <charconv>
 #include <cstddef>
-#include <fstream>
-#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <string>
-#include <utility>
+#include <system_error>
+#include <thread>
 #include <vector>
 
 /**
- * @brief Method to check if the Wavefront file has texture coordinates.
- *       It reads the file line by line and looks for "vt" lines.
- * @param filename The name of the Wavefront file.
- * @return True if texture coordinates are found, false otherwise.
+ * @brief Check if a character separates tokens in a line.
+ * @param c The character.
+ * @return True for spaces, tabs and carriage returns.
  */
-bool OkWavefrontImporter::hasTextureCoordinates(const std::string &filename) {
-  std::ifstream file(filename);
-  if (!file.is_open())
-    return false;
+static bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
 
-  std::string line;
-  while (std::getline(file, line)) {
-    if (line.substr(0, 3) == "vt ") {
-      return true;
-    }
+/**
+ * @brief Skip the blanks at the cursor.
+ * @param cursor The current position.
+ * @param end    The end of the line.
+ * @return The first non-blank position, or end.
+ */
+static const char *skipBlanks(const char *cursor, const char *end) {
+  while (cursor < end && isBlank(*cursor)) {
+    cursor++;
   }
-  return false;
+  return cursor;
 }
 
 /**
- * @brief Method to parse the geometry from the Wavefront file.
- *        It reads vertices and faces, and triangulates the faces.
- * @param filename The name of the Wavefront file.
- * @param vertices The vector to store the vertex positions.
- * @param indices  The vector to store the indices of the vertices.
- * @return True if parsing was successful, false otherwise.
+ * @brief Find the end of the current line.
+ * @param cursor The current position.
+ * @param end    The end of the data.
+ * @return The position of the next line feed, or end.
  */
-bool OkWavefrontImporter::parseGeometry(const std::string         &filename,
-                                        std::vector<float>        &vertices,
-                                        std::vector<unsigned int> &indices) {
-  std::ifstream file(filename);
-  if (!file.is_open()) {
-    OkLogger::error("Wavefront", "Error opening file: " + filename);
-    return false;
-  }
+static const char *findLineEnd(const char *cursor, const char *end) {
+  const void *found = std::memchr(cursor, '\n', end - cursor);
+  return found ? static_cast<const char *>(found) : end;
+}
 
-  std::string line;
-  while (std::getline(file, line)) {
-    std::istringstream iss(line);
-    std::string        type;
-    iss >> type;
+/**
+ * @brief Count the statements of each kind in OBJ data.
+ *        This only looks at the first characters of each line, so it is much
+ *        cheaper than parsing, and lets the parser reserve all its memory.
+ * @param data The OBJ data.
+ * @param size The size of the data in bytes.
+ * @return The number of positions, texture coordinates, normals, faces and
+ *         lines.
+ */
+OkWavefrontImporter::Counts
+OkWavefrontImporter::countStatements(const char *data, size_t size) {
+  Counts counts = {0, 0, 0, 0, 0};
 
-    if (type == "v") {
-      float x, y, z;
-      if (iss >> x >> y >> z) {
-        vertices.push_back(x);
-        vertices.push_back(y);
-        vertices.push_back(z);
-      }
-    } else if (type == "f") {
-      std::vector<int> face;
-      int              idx;
-      while (iss >> idx) {
-        face.push_back(idx - 1);  // OBJ indices start at 1
+  const char *cursor = data;
+  const char *end    = data + size;
+  while (cursor < end) {
+    const char *lineEnd = findLineEnd(cursor, end);
+    const char *token   = skipBlanks(cursor, lineEnd);
+    counts.lines++;
+
+    if (lineEnd - token >= 2) {
+      if (token[0] == 'v' && isBlank(token[1])) {
+        counts.positions++;
+      } else if (token[0] == 'v' && token[1] == 't') {
+        counts.texcoords++;
+      } else if (token[0] == 'v' && token[1] == 'n') {
+        counts.normals++;
+      } else if (token[0] == 'f' && isBlank(token[1])) {
+        counts.faces++;
       }
+    }
 
-      // Triangulate face
-      for (size_t i = 2; i < face.size(); ++i) {
-        indices.push_back(face[0]);
-        indices.push_back(face[i - 1]);
-        indices.push_back(face[i]);
+    cursor = lineEnd < end ? lineEnd + 1 : end;
+  }
+
+  return counts;
+}
+
+/**
+ * @brief Split OBJ data in line-aligned chunks, one per thread.
+ *        Chunks are never smaller than minChunkSize, so small files are
+ *        parsed on the calling thread only.
+ * @param data        The OBJ data.
+ * @param size        The size of the data in bytes.
+ * @param threadCount The number of threads, 0 for all the cores.
+ * @return The chunks, in file order.
+ */
+std::vector<OkWavefrontImporter::Chunk>
+OkWavefrontImporter::splitChunks(const char *data, size_t size,
+                                 int threadCount) {
+  if (threadCount <= 0) {
+    threadCount = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  size_t chunkCount = std::min(static_cast<size_t>(std::max(threadCount, 1)),
+                               std::max(size / minChunkSize, size_t(1)));
+
+  std::vector<Chunk> chunks(chunkCount);
+  const char        *begin = data;
+  const char        *end   = data + size;
+  for (size_t i = 0; i < chunkCount; i++) {
+    // Move the split after the end of the line it falls in
+    const char *split = end;
+    if (i + 1 < chunkCount) {
+      split = std::max(data + size * (i + 1) / chunkCount, begin);
+      if (split > data) {
+        const char *lineEnd = findLineEnd(split - 1, end);
+        split               = lineEnd < end ? lineEnd + 1 : end;
       }
     }
+
+    chunks[i].begin     = begin;
+    chunks[i].end       = split;
+    chunks[i].errorLine = 0;
+    begin               = split;
   }
 
-  return true;
+  return chunks;
 }
 
 /**
- * @brief Method to parse the geometry with texture coordinates from the
- * Wavefront file. It reads vertices, texture coordinates, and faces, and
- * triangulates the faces.
- * @param filename The name of the Wavefront file.
- * @param mesh     The TempMesh structure to store the parsed data.
- * @return True if parsing was successful, false otherwise.
+ * @brief Run a function on each element of a vector, on its own thread.
+ *        The first element is processed on the calling thread. If starting a
+ *        thread or the calling thread throws, the exception is rethrown once
+ *        the started threads finish.
+ * @param items    The elements.
+ * @param function The function, called with a reference to each element.
  */
-bool OkWavefrontImporter::parseGeometryWithUV(const std::string &filename,
-                                              TempMesh          &mesh) {
-  std::ifstream file(filename);
-  if (!file.is_open()) {
-    OkLogger::error("Wavefront", "Error opening file: " + filename);
-    return false;
+template <typename T, typename Function>
+static void runParallel(std::vector<T> &items, Function function) {
+  std::vector<std::thread> threads;
+  threads.reserve(items.size());
+
+  // A joinable thread destroyed during unwinding terminates the program,
+  // so the started threads are joined before rethrowing
+  try {
+    for (size_t i = 1; i < items.size(); i++) {
+      threads.emplace_back(function, std::ref(items[i]));
+    }
+    if (!items.empty()) {
+      function(items[0]);
+    }
+  } catch (...) {
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    throw;
   }
 
-  std::string line;
-  // First pass: read vertices and texture coordinates
-  while (std::getline(file, line)) {
-    std::istringstream iss(line);
-    std::string        type;
-    iss >> type;
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+/**
+ * @brief Parse a float at the cursor, after the blanks.
+ *        std::from_chars is used where the standard library supports it for
+ *        floats, std::strtof on a copy of the token otherwise.
+ * @param cursor The current position.
+ * @param end    The end of the line.
+ * @param value  Receives the value.
+ * @return The position after the number, or nullptr if there is no number.
+ */
+const char *OkWavefrontImporter::parseFloat(const char *cursor,
+                                            const char *end, float &value) {
+  cursor = skipBlanks(cursor, end);
 
-    if (type == "v") {
-      float x, y, z;
-      if (iss >> x >> y >> z) {
-        mesh.positions.push_back(x);
-        mesh.positions.push_back(y);
-        mesh.positions.push_back(z);
+  // Neither function accepts a leading plus sign in all cases
+  if (cursor < end && *cursor == '+') {
+    cursor++;
+  }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  std::from_chars_result result = std::from_chars(cursor, end, value);
+  if (result.ec == std::errc::invalid_argument) {
+    return nullptr;
+  }
+  if (result.ec == std::errc::result_out_of_range) {
+    value = 0.0f;
+  }
+  return result.ptr;
+#else
+  char   token[64];
+  size_t length = 0;
+  while (cursor + length < end && length < sizeof(token) - 1 &&
+         !isBlank(cursor[length])) {
+    token[length] = cursor[length];
+    length++;
+  }
+  token[length] = '\0';
+
+  char *parsed = nullptr;
+  value        = std::strtof(token, &parsed);
+  if (parsed == token) {
+    return nullptr;
+  }
+  return cursor + (parsed - token);
+#endif
+}
+
+/**
+ * @brief Parse an integer index at the cursor.
+ * @param cursor The current position.
+ * @param end    The end of the line.
+ * @param value  Receives the value.
+ * @return The position after the number, or nullptr if there is no number.
+ */
+const char *OkWavefrontImporter::parseIndex(const char *cursor,
+                                            const char *end, long &value) {
+  std::from_chars_result result = std::from_chars(cursor, end, value);
+  if (result.ec != std::errc()) {
+    return nullptr;
+  }
+  return result.ptr;
+}
+
+/**
+ * @brief Turn an OBJ index into a zero-based index.
+ *        Positive indices start at 1, negative ones count back from the last
+ *        element read.
+ * @param index  The OBJ index.
+ * @param count  The number of elements read so far.
+ * @param result Receives the zero-based index.
+ * @return True if the index refers to an element already read.
+ */
+bool OkWavefrontImporter::resolveIndex(long index, size_t count,
+                                       size_t &result) {
+  if (index > 0 && static_cast<size_t>(index) <= count) {
+    result = static_cast<size_t>(index - 1);
+    return true;
+  }
+  if (index < 0 && static_cast<size_t>(-index) <= count) {
+    result = count - static_cast<size_t>(-index);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Get the vertex for a position, texture coordinates and normal,
+ *        building it if no face used that combination yet.
+ * @param position The position index.
+ * @param texcoord The texture coordinates index, -1 for none.
+ * @param normal   The normal index, -1 for none.
+ * @param state    The parsing state.
+ * @param mesh     The mesh the vertex is added to.
+ * @return The vertex index.
+ */
+unsigned int OkWavefrontImporter::getVertex(size_t position, int texcoord,
+                                            int normal, ParseState &state,
+                                            MeshData &mesh) {
+  int vertex = state.firstVertex[position];
+  while (vertex >= 0) {
+    if (state.vertexTexcoord[vertex] == texcoord &&
+        state.vertexNormal[vertex] == normal) {
+      return static_cast<unsigned int>(vertex);
+    }
+    vertex = state.nextVertex[vertex];
+  }
+
+  vertex = static_cast<int>(state.vertexTexcoord.size());
+
+  const float *xyz = &state.positions[position * 3];
+  mesh.vertices.insert(mesh.vertices.end(), xyz, xyz + 3);
+  if (texcoord >= 0) {
+    const float *uv = &state.texcoords[static_cast<size_t>(texcoord) * 2];
+    mesh.vertices.insert(mesh.vertices.end(), uv, uv + 2);
+  } else {
+    mesh.vertices.push_back(0.0f);
+    mesh.vertices.push_back(0.0f);
+  }
+  if (mesh.hasNormals && normal >= 0) {
+    const float *n = &state.normals[static_cast<size_t>(normal) * 3];
+    mesh.vertices.insert(mesh.vertices.end(), n, n + 3);
+  } else if (mesh.hasNormals) {
+    mesh.vertices.insert(mesh.vertices.end(), 3, 0.0f);
+  }
+
+  state.vertexTexcoord.push_back(texcoord);
+  state.vertexNormal.push_back(normal);
+  state.nextVertex.push_back(state.firstVertex[position]);
+  state.firstVertex[position] = vertex;
+
+  return static_cast<unsigned int>(vertex);
+}
+
+/**
+ * @brief Parse the corners of a face.
+ *        Corners can be v, v/t, v/t/n or v//n. Indices are resolved against
+ *        the elements read before the face, in this chunk and the previous
+ *        ones, so negative indices can refer to other chunks.
+ * @param cursor The position after the "f" statement.
+ * @param end    The end of the line.
+ * @param chunk  The chunk the corners are added to.
+ * @return True if all the corners are valid.
+ */
+bool OkWavefrontImporter::parseFace(const char *cursor, const char *end,
+                                    Chunk &chunk) {
+  size_t firstCorner = chunk.corners.size();
+
+  while (true) {
+    cursor = skipBlanks(cursor, end);
+    if (cursor >= end || *cursor == '#') {
+      break;
+    }
+
+    long v = 0;
+    long t = 0;  // 0 when missing
+    long n = 0;
+    cursor = parseIndex(cursor, end, v);
+    if (cursor && cursor < end && *cursor == '/') {
+      cursor++;
+      if (cursor < end && *cursor != '/') {
+        cursor = parseIndex(cursor, end, t);
       }
-    } else if (type == "vt") {
-      float u, v;
-      if (iss >> u >> v) {
-        mesh.texcoords.push_back(u);
-        mesh.texcoords.push_back(v);
+      if (cursor && cursor < end && *cursor == '/') {
+        cursor = parseIndex(cursor + 1, end, n);
       }
     }
+
+    size_t position = 0;
+    size_t texcoord = 0;
+    size_t normal   = 0;
+    if (!cursor || (cursor < end && !isBlank(*cursor)) ||
+        !resolveIndex(v, chunk.positions, position) ||
+        (t != 0 && !resolveIndex(t, chunk.texcoords, texcoord)) ||
+        (n != 0 && !resolveIndex(n, chunk.normals, normal))) {
+      chunk.corners.resize(firstCorner);
+      return false;
+    }
+
+    chunk.corners.push_back(static_cast<unsigned int>(position));
+    chunk.corners.push_back(t != 0 ? static_cast<unsigned int>(texcoord + 1)
+                                   : 0);
+    chunk.corners.push_back(n != 0 ? static_cast<unsigned int>(normal + 1)
+                                   : 0);
   }
 
-  // Second pass: read faces
-  file.clear();
-  file.seekg(0);
+  chunk.faceSizes.push_back(
+      static_cast<unsigned int>((chunk.corners.size() - firstCorner) / 3));
+  return true;
+}
+
+/**
+ * @brief Parse the statements of a chunk.
+ *        Positions, texture coordinates and normals are written in place in the
+ *        parsing state, at the offsets counted for the chunk, so chunks can
+ *        be parsed at the same time. Parsing stops at the first invalid
+ *        statement, whose line is stored in the chunk.
+ * @param chunk The chunk, with its counters set to the totals of the
+ *              previous chunks.
+ * @param state The parsing state, sized for the whole data.
+ */
+void OkWavefrontImporter::parseChunk(Chunk &chunk, ParseState &state) {
+  chunk.corners.reserve(chunk.counts.faces * 9);
+  chunk.faceSizes.reserve(chunk.counts.faces);
 
-  while (std::getline(file, line)) {
-    if (line[0] == 'f') {
-      std::istringstream               iss(line.substr(2));
-      std::vector<std::pair<int, int>> face;
+  const char *cursor = chunk.begin;
+  const char *end    = chunk.end;
+  while (cursor < end) {
+    const char *lineEnd = findLineEnd(cursor, end);
+    const char *token   = skipBlanks(cursor, lineEnd);
+    chunk.line++;
 
-      std::string vertex;
-      while (iss >> vertex) {
-        size_t slash = vertex.find('/');
-        if (slash != std::string::npos) {
-          int v = std::stoi(vertex.substr(0, slash)) - 1;
-          int t = std::stoi(vertex.substr(slash + 1)) - 1;
-          face.emplace_back(v, t);
+    bool valid = true;
+    if (lineEnd - token >= 2) {
+      if (token[0] == 'v' && isBlank(token[1])) {
+        float       xyz[3];
+        const char *next = token + 1;
+        for (int i = 0; i < 3 && next; i++) {
+          next = parseFloat(next, lineEnd, xyz[i]);
+        }
+        valid = next != nullptr;
+        if (valid) {
+          std::copy(xyz, xyz + 3, &state.positions[chunk.positions * 3]);
+          chunk.positions++;
         }
+      } else if (token[0] == 'v' && token[1] == 't') {
+        // The second coordinate is optional
+        float       uv[2] = {0.0f, 0.0f};
+        const char *next  = parseFloat(token + 2, lineEnd, uv[0]);
+        valid             = next != nullptr;
+        if (valid) {
+          next = skipBlanks(next, lineEnd);
+          if (next < lineEnd && *next != '#') {
+            valid = parseFloat(next, lineEnd, uv[1]) != nullptr;
+          }
+        }
+        if (valid) {
+          std::copy(uv, uv + 2, &state.texcoords[chunk.texcoords * 2]);
+          chunk.texcoords++;
+        }
+      } else if (token[0] == 'v' && token[1] == 'n') {
+        float       xyz[3];
+        const char *next = token + 2;
+        for (int i = 0; i < 3 && next; i++) {
+          next = parseFloat(next, lineEnd, xyz[i]);
+        }
+        valid = next != nullptr;
+        if (valid) {
+          std::copy(xyz, xyz + 3, &state.normals[chunk.normals * 3]);
+          chunk.normals++;
+        }
+      } else if (token[0] == 'f' && isBlank(token[1])) {
+        valid = parseFace(token + 2, lineEnd, chunk);
       }
+    }
 
-      // Triangulate face
-      for (size_t i = 2; i < face.size(); ++i) {
-        for (size_t j = 0; j < 3; ++j) {
-          size_t idx;
-          if (j == 0) {
-            idx = 0;
-          } else if (j == 1) {
-            idx = i - 1;
-          } else {
-            idx = i;
-          }
-          size_t v = static_cast<size_t>(face[idx].first);   // vertex index
-          size_t t = static_cast<size_t>(face[idx].second);  // texture index
+    if (!valid) {
+      chunk.errorLine = chunk.line;
+      return;
+    }
+
+    cursor = lineEnd < end ? lineEnd + 1 : end;
+  }
+}
 
-          TempVertex vertex;
-          std::copy_n(&mesh.positions[v * 3], 3, vertex.position);
-          std::copy_n(&mesh.texcoords[t * 2], 2, vertex.texcoord);
+/**
+ * @brief Build the vertices of the faces of a chunk and triangulate them as
+ *        fans. Chunks are built in file order, so vertices are numbered as
+ *        if the data had been parsed in one pass.
+ * @param chunk The parsed chunk.
+ * @param state The parsing state.
+ * @param mesh  The mesh the vertices and triangles are added to.
+ */
+void OkWavefrontImporter::buildFaces(const Chunk &chunk, ParseState &state,
+                                     MeshData &mesh) {
+  const unsigned int *corner = chunk.corners.data();
+  for (unsigned int faceSize : chunk.faceSizes) {
+    state.face.clear();
+    for (unsigned int i = 0; i < faceSize; i++, corner += 3) {
+      int texcoord = static_cast<int>(corner[1]) - 1;
+      int normal   = static_cast<int>(corner[2]) - 1;
+      state.face.push_back(
+          getVertex(corner[0], texcoord, normal, state, mesh));
+    }
 
-          mesh.vertices.push_back(vertex);
-          mesh.indices.push_back(mesh.vertices.size() - 1);
-        }
-      }
+    // Triangulate face
+    for (size_t i = 2; i < state.face.size(); ++i) {
+      mesh.indices.push_back(state.face[0]);
+      mesh.indices.push_back(state.face[i - 1]);
+      mesh.indices.push_back(state.face[i]);
+    }
+  }
+}
+
+/**
+ * @brief Parse OBJ data in memory.
+ *        Vertices are built for each distinct combination of position,
+ *        texture coordinates and normal used by the faces. If the data has
+ *        normals, vertices have 8 floats instead of 5. Statements other than
+ *        v, vt, vn and f are ignored.
+ *        Large data is split in line-aligned chunks: each thread counts and
+ *        then parses its chunk, and the vertices are built in file order, so
+ *        the result does not depend on the number of threads.
+ * @param data        The OBJ data, it does not need to be null terminated.
+ * @param size        The size of the data in bytes.
+ * @param mesh        Receives the vertices and indices.
+ * @param threadCount The number of threads, 0 for all the cores.
+ * @return True if parsing was successful, false otherwise.
+ */
+bool OkWavefrontImporter::parse(const char *data, size_t size, MeshData &mesh,
+                                int threadCount) {
+  std::vector<Chunk> chunks = splitChunks(data, size, threadCount);
+  runParallel(chunks, [](Chunk &chunk) {
+    chunk.counts = countStatements(chunk.begin, chunk.end - chunk.begin);
+  });
+
+  // Each chunk starts where the previous ones end
+  Counts total = {0, 0, 0, 0, 0};
+  for (Chunk &chunk : chunks) {
+    chunk.positions = total.positions;
+    chunk.texcoords = total.texcoords;
+    chunk.normals   = total.normals;
+    chunk.line      = total.lines;
+    total.positions += chunk.counts.positions;
+    total.texcoords += chunk.counts.texcoords;
+    total.normals += chunk.counts.normals;
+    total.faces += chunk.counts.faces;
+    total.lines += chunk.counts.lines;
+  }
+
+  ParseState state;
+  state.positions.resize(total.positions * 3);
+  state.texcoords.resize(total.texcoords * 2);
+  state.normals.resize(total.normals * 3);
+  state.firstVertex.assign(total.positions, -1);
+
+  runParallel(chunks,
+              [&state](Chunk &chunk) { parseChunk(chunk, state); });
+
+  for (const Chunk &chunk : chunks) {
+    if (chunk.errorLine != 0) {
+      OkLogger::error("Wavefront", "Invalid statement at line " +
+                                       std::to_string(chunk.errorLine));
+      return false;
     }
   }
 
+  size_t vertexCount = std::max(total.positions, total.texcoords);
+  state.nextVertex.reserve(vertexCount);
+  state.vertexTexcoord.reserve(vertexCount);
+  state.vertexNormal.reserve(vertexCount);
+
+  mesh.hasNormals = total.normals > 0;
+  mesh.vertices.clear();
+  mesh.indices.clear();
+  mesh.vertices.reserve(vertexCount * mesh.getStride());
+  mesh.indices.reserve(total.faces * 3);
+
+  for (const Chunk &chunk : chunks) {
+    buildFaces(chunk, state, mesh);
+  }
+
   return true;
 }
 
 /**
- * @brief Method to extract the item name from the filename.
- *        It removes the path and file extension.
+ * @brief Parse a Wavefront file.
+ *        The file is memory mapped and parsed without copies. Unless
+ *        importer.optimize-meshes is disabled, duplicate vertices are welded
+ *        and the buffers are reordered for the vertex cache and overdraw.
  * @param filename The name of the Wavefront file.
- * @return The item name without path and extension.
+ * @param mesh     Receives the vertices and indices.
+ * @return True if parsing was successful, false otherwise.
+ */
+bool OkWavefrontImporter::parseFile(const std::string &filename,
+                                    MeshData          &mesh) {
+  OkMappedFile file(filename);
+  if (!file.isOpen()) {
+    OkLogger::error("Wavefront", "Error opening file: " + filename);
+    return false;
+  }
+
+  if (!parse(file.getData(), file.getSize(), mesh,
+             OkConfig::getInt("importer.threads"))) {
+    return false;
+  }
+
+  if (OkConfig::getBool("importer.optimize-meshes")) {
+    OkMeshOptimizer::optimize(
+        mesh.vertices, mesh.indices, mesh.getStride(),
+        OkConfig::getFloat("importer.overdraw-threshold"));
+  }
+
+  size_t vertexCount = mesh.vertices.size() / mesh.getStride();
+  OkLogger::info("Wavefront", "Parsed " + filename + ": " +
+                                  std::to_string(vertexCount) +
+                                  " vertices and " +
+                                  std::to_string(mesh.indices.size()) +
+                                  " indices");
+  return true;
+}
+
+/**
+ * @brief Get the vertex layout imported meshes are stored in, following the
+ *        importer.normals, importer.packed-normals and importer.half-texcoords
+ *        settings.
+ * @param hasNormals Whether the file has normals.
+ * @return The vertex layout.
  */
-std::string OkWavefrontImporter::getItemName(const std::string &filename) {
-  size_t      lastSlash = filename.find_last_of("/\\");
-  std::string baseName  = (lastSlash == std::string::npos)
-                              ? filename
-                              : filename.substr(lastSlash + 1);
-  size_t      dot       = baseName.find_last_of('.');
-  return (dot == std::string::npos) ? baseName : baseName.substr(0, dot);
+OkVertexLayout OkWavefrontImporter::getLayout(bool hasNormals) {
+  OkVertexLayout layout = OkVertexLayout::standard();
+  if (OkConfig::getBool("importer.half-texcoords")) {
+    layout.texcoords = OkTexcoordFormat::Half;
+  }
+  if (hasNormals && OkConfig::getBool("importer.normals")) {
+    layout.normals = OkConfig::getBool("importer.packed-normals")
+                         ? OkNormalFormat::Packed
+                         : OkNormalFormat::Float;
+  }
+  return layout;
 }
 
 /**
  * @brief Method to import a Wavefront file and create an OkItem.
- *        It checks for texture coordinates and parses the geometry accordingly.
+ *        The geometry is stored in OkMeshHandler under the file name, so
+ *        importing the same file again reuses it without parsing. Unless
+ *        importer.mesh-cache is disabled, the imported geometry is also saved
+ *        as a binary mesh next to the file, and loaded from there while the
+ *        file does not change. Vertices are stored in the layout given by
+ *        getLayout.
  * @param filename The name of the Wavefront file.
  * @return A pointer to the created OkItem, or nullptr on failure.
  */
 OkItem *OkWavefrontImporter::importFile(const std::string &filename) {
-  bool hasUV = hasTextureCoordinates(filename);
-  OkLogger::info("Wavefront", "File " + filename +
-                                  (hasUV ? " has" : " does not have") +
-                                  " texture coordinates");
-
-  if (!hasUV) {
-    std::vector<float>        vertices;
-    std::vector<unsigned int> indices;
-
-    if (!parseGeometry(filename, vertices, indices)) {
-      OkLogger::error("Wavefront", "Failed to parse geometry from " + filename);
-      return nullptr;
-    }
+  OkMeshHandler *meshHandler = OkMeshHandler::getInstance();
+  std::string    itemName    = OkFiles::getBaseName(filename);
+  bool           useCache    = OkConfig::getBool("importer.mesh-cache");
 
-    return new OkItem(getItemName(filename), vertices.data(),
-                      static_cast<int>(vertices.size()), indices.data(),
-                      static_cast<int>(indices.size()));
+  // Reuse the mesh if the file was already imported
+  OkMesh *mesh = meshHandler->acquireMesh(filename);
+  if (mesh) {
+    OkLogger::info("Wavefront", "Reusing mesh of " + filename);
+    return new OkItem(itemName, mesh, filename);
   }
-  // else {
-  TempMesh mesh;
-  if (!parseGeometryWithUV(filename, mesh)) {
-    OkLogger::error("Wavefront",
-                    "Failed to parse geometry with UV from " + filename);
+
+  mesh = useCache ? OkMeshFile::loadCache(filename, filename, getLayout(true))
+                  : nullptr;
+  if (mesh) {
+    return new OkItem(itemName, mesh, filename);
+  }
+
+  MeshData meshData;
+  if (!parseFile(filename, meshData)) {
+    OkLogger::error("Wavefront", "Failed to parse geometry from " + filename);
     return nullptr;
   }
 
-  // Create combined vertex data (3 pos + 2 tex = 5 floats per vertex)
-  std::vector<float> vertexData;
-  vertexData.reserve(mesh.vertices.size() * 5);
+  int  stride      = meshData.getStride();
+  long vertexCount = static_cast<long>(meshData.vertices.size() / stride);
+  long indexCount  = static_cast<long>(meshData.indices.size());
+  mesh = meshHandler->createMesh(filename, getLayout(meshData.hasNormals),
+                                 meshData.vertices.data(), stride,
+                                 vertexCount, meshData.indices.data(),
+                                 indexCount);
+  if (useCache) {
+    OkMeshFile::writeCache(filename, *mesh);
+  }
+  return new OkItem(itemName, mesh, filename);
+}
 
-  for (const auto &vertex : mesh.vertices) {
-    vertexData.insert(vertexData.end(), std::begin(vertex.position),
-                      std::end(vertex.position));
-    vertexData.insert(vertexData.end(), std::begin(vertex.texcoord),
-                      std::end(vertex.texcoord));
+/**
+ * @brief Load the mesh of a Wavefront file in the background.
+ *        The binary cache is validated, or the file parsed and optimized, on
+ *        a loader thread, and the mesh is created on the main thread by
+ *        OkAssetLoader::update. A new cache is then written on a loader
+ *        thread too. If the mesh already exists, the request is ready right
+ *        away.
+ * @param filename The name of the Wavefront file, also the name of the mesh.
+ * @return The request, holding a reference to the mesh once it is ready.
+ */
+std::shared_ptr<OkLoadRequest>
+OkWavefrontImporter::loadMeshAsync(const std::string &filename) {
+  OkMeshHandler *meshHandler = OkMeshHandler::getInstance();
+  OkMesh        *mesh        = meshHandler->acquireMesh(filename);
+  if (mesh) {
+    std::shared_ptr<OkLoadRequest> request =
+        std::make_shared<OkLoadRequest>(filename);
+    request->setMesh(mesh);
+    request->finish(true);
+    return request;
   }
 
-  return new OkItem(getItemName(filename), vertexData.data(),
-                    static_cast<int>(vertexData.size()), mesh.indices.data(),
-                    static_cast<int>(mesh.indices.size()));
+  // Result of the worker: a valid cache, or the parsed geometry
+  struct Import {
+    std::shared_ptr<const OkMappedFile> cache;
+    MeshData                            meshData;
+  };
+  std::shared_ptr<Import> import   = std::make_shared<Import>();
+  bool                    useCache = OkConfig::getBool("importer.mesh-cache");
+  OkVertexLayout          layout   = getLayout(true);
+
+  return OkAssetLoader::getInstance()->load(
+      filename,
+      [import, filename, useCache, layout]() {
+        if (useCache) {
+          import->cache = OkMeshFile::openCache(filename, layout);
+          if (import->cache) {
+            return true;
+          }
+        }
+        if (!parseFile(filename, import->meshData)) {
+          OkLogger::error("Wavefront",
+                          "Failed to parse geometry from " + filename);
+          return false;
+        }
+        return true;
+      },
+      [import, useCache](OkLoadRequest &request) {
+        const std::string &name = request.getName();
+        if (import->cache) {
+          request.setMesh(OkMeshFile::createMesh(import->cache, name));
+          return request.getMesh() != nullptr;
+        }
+
+        MeshData &meshData = import->meshData;
+        int       stride   = meshData.getStride();
+        long      vertexCount =
+            static_cast<long>(meshData.vertices.size() / stride);
+        OkMesh *mesh = OkMeshHandler::getInstance()->createMesh(
+            name, getLayout(meshData.hasNormals), meshData.vertices.data(),
+            stride, vertexCount, meshData.indices.data(),
+            static_cast<long>(meshData.indices.size()));
+        request.setMesh(mesh);
+        meshData = MeshData();
+
+        // The writer holds a reference to the mesh until the file is written
+        if (useCache) {
+          OkMeshHandler::getInstance()->addReference(name);
+          std::shared_ptr<OkLoadRequest> writer =
+              OkAssetLoader::getInstance()->load(
+                  name,
+                  [mesh, name]() {
+                    return OkMeshFile::writeCache(name, *mesh);
+                  },
+                  nullptr);
+          writer->setMesh(mesh);
+        }
+        return true;
+      });
+}
+
+/**
+ * @brief Import a Wavefront file in the background.
+ *        The item is returned right away, without a mesh, and takes its mesh
+ *        when the load is ready, see loadMeshAsync.
+ * @param filename The name of the Wavefront file.
+ * @return A pointer to the created OkItem.
+ */
+OkItem *OkWavefrontImporter::importFileAsync(const std::string &filename) {
+  OkItem *item = new OkItem(OkFiles::getBaseName(filename), nullptr, "");
+  item->setPendingMesh(loadMeshAsync(filename));
+  return item;
 }
@@ -1,44 +1,119 @@
 #ifndef OK_WAVEFRONT_HPP
 #define OK_WAVEFRONT_HPP
 
+#include "../handlers/loader.hpp"
 #include "../item/item.hpp"
+#include "../item/layout.hpp"
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
 /**
  * @brief Class for importing Wavefront OBJ files.
  *        It handles the parsing of geometry and texture coordinates.
+ *        Files are memory mapped and parsed without copying lines, large
+ *        ones in line-aligned chunks on several threads. Faces can be given
+ *        as v, v/t, v/t/n or v//n.
  */
 class OkWavefrontImporter {
 public:
+  /**
+   * @brief Parsed geometry, ready for OkMesh: 5 floats per vertex
+   *        (position and texture coordinates), 8 if the file has normals,
+   *        and triangle indices.
+   */
+  struct MeshData {
+    std::vector<float>        vertices;
+    std::vector<unsigned int> indices;
+    bool                      hasNormals = false;
+
+    int getStride() const { return hasNormals ? 8 : 5; }
+  };
+
   static OkItem *importFile(const std::string &filename);
 
+  // Import a file in the background, the item gets its mesh when it is
+  // ready, or load only the mesh, named as the file
+  static OkItem *importFileAsync(const std::string &filename);
+  static std::shared_ptr<OkLoadRequest>
+  loadMeshAsync(const std::string &filename);
+
+  // Parse a file, or OBJ data in memory, 0 threads uses all the cores
+  static bool parseFile(const std::string &filename, MeshData &mesh);
+  static bool parse(const char *data, size_t size, MeshData &mesh,
+                    int threadCount = 1);
+
+  // Vertex layout of imported meshes, from the importer settings
+  static OkVertexLayout getLayout(bool hasNormals);
+
+  // Data is not split in chunks smaller than this
+  static const size_t minChunkSize = 256 * 1024;
+
 private:
   /**
-   * @brief Temporary vertex structure to hold position and texture coordinates.
+   * @brief Number of statements of each kind, counted before parsing to
+   *        reserve memory and to know where each chunk writes.
    */
-  struct TempVertex {
-    float position[3];
-    float texcoord[2];
+  struct Counts {
+    size_t positions;
+    size_t texcoords;
+    size_t normals;
+    size_t faces;
+    size_t lines;
   };
 
   /**
-   * @brief Temporary mesh structure to hold raw positions, texture coordinates,
-   *       combined vertices, and indices.
+   * @brief Line-aligned part of the data, parsed by one thread.
+   *        Attributes are written in place in the parsing state, and faces
+   *        are kept as resolved indices until vertices are built in order.
    */
-  struct TempMesh {
-    std::vector<float>        positions;  // Raw positions from file
-    std::vector<float>        texcoords;  // Raw texture coordinates
-    std::vector<TempVertex>   vertices;   // Final combined vertices
-    std::vector<unsigned int> indices;
+  struct Chunk {
+    const char               *begin;
+    const char               *end;
+    Counts                    counts;     // Statements in the chunk
+    size_t                    positions;  // Read before the current line,
+    size_t                    texcoords;  // including previous chunks
+    size_t                    normals;
+    size_t                    line;
+    std::vector<unsigned int> corners;    // Position, texcoord + 1, normal + 1
+    std::vector<unsigned int> faceSizes;  // Corners of each face
+    size_t                    errorLine;  // First invalid line, 0 if none
+  };
+
+  /**
+   * @brief Parsing state: raw attributes as read from the file, and the
+   *        vertices already built for each position, to share vertices
+   *        between faces.
+   */
+  struct ParseState {
+    std::vector<float>        positions;       // Raw positions from file
+    std::vector<float>        texcoords;       // Raw texture coordinates
+    std::vector<float>        normals;         // Raw normals
+    std::vector<int>          firstVertex;     // First vertex per position
+    std::vector<int>          nextVertex;      // Next one, same position
+    std::vector<int>          vertexTexcoord;  // Texcoord index per vertex
+    std::vector<int>          vertexNormal;    // Normal index per vertex
+    std::vector<unsigned int> face;            // Vertices of the current face
   };
 
-  static bool hasTextureCoordinates(const std::string &filename);
-  static bool parseGeometry(const std::string         &filename,
-                            std::vector<float>        &vertices,
-                            std::vector<unsigned int> &indices);
-  static bool parseGeometryWithUV(const std::string &filename, TempMesh &mesh);
-  static std::string getItemName(const std::string &filename);
+  static Counts             countStatements(const char *data, size_t size);
+  static std::vector<Chunk> splitChunks(const char *data, size_t size,
+                                        int threadCount);
+  static const char        *parseFloat(const char *cursor, const char *end,
+                                       float &value);
+  static const char        *parseIndex(const char *cursor, const char *end,
+                                       long &value);
+  static bool               resolveIndex(long index, size_t count,
+                                         size_t &result);
+  static void               parseChunk(Chunk &chunk, ParseState &state);
+  static bool               parseFace(const char *cursor, const char *end,
+                                      Chunk &chunk);
+  static void               buildFaces(const Chunk &chunk, ParseState &state,
+                                       MeshData &mesh);
+  static unsigned int       getVertex(size_t position, int texcoord,
+                                      int normal, ParseState &state,
+                                      MeshData &mesh);
 };
 
 #endif
@@ -1,17 +1,37 @@
 #include "group.hpp"
+#include "../config/config.hpp"
+#include "../handlers/meshes.hpp"
+#include "../handlers/textures.hpp"
+#include "../render/queue.hpp"
+#include "../shaders/program.hpp"
 #include "../utils/logger.hpp"
 #include "core/object.hpp"
 #include "item/item.hpp"
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <map>
 #include <string>
+#include <tuple>
 #include <vector>
 
+// Batch of a static item: chunk of space, texture, texture layer, vertex
+// layout, draw mode and wireframe flag
+using OkBakeKey = std::tuple<int, int, int, const OkTexture *, int, uint32_t,
+                             GLenum, bool>;
+
+// Numbers the meshes of the batches, their names must be unique
+static long bakeSerial = 0;
+
 /**
  * @brief Create a new item group with the given name.
  * @param name The name of the item group.
  */
 OkItemGroup::OkItemGroup(const std::string &name) : OkObject(name) {
+  instancedDrawCount = 0;
+  bakedItemCount     = 0;
   OkLogger::info("ItemGroup", "Creating item group " + name);
 }
 
@@ -21,7 +41,8 @@ OkItemGroup::OkItemGroup(const std::string &name) : OkObject(name) {
  * elsewhere.
  */
 OkItemGroup::~OkItemGroup() {
-  // Items are not deleted here as they may be managed elsewhere
+  // Items are not deleted here as they may be managed elsewhere, only the
+  // static batches are owned by the group
   clearItems();
 }
 
@@ -87,6 +108,11 @@ void OkItemGroup::removeItemByIndex(int index) {
     return;
   }
 
+  // The batches hold its geometry
+  if (items[index].baked) {
+    unbake();
+  }
+
   items.erase(items.begin() + index);
 
   OkLogger::info("ItemGroup", "Removed item at index " + std::to_string(index));
@@ -96,6 +122,7 @@ void OkItemGroup::removeItemByIndex(int index) {
  * @brief Clear all items from the group.
  */
 void OkItemGroup::clearItems() {
+  unbake();
   items.clear();
 }
 
@@ -343,15 +370,177 @@ void OkItemGroup::stepSelf(float dt) {
   }
 }
 
+/**
+ * @brief Check if two packets can be drawn by the same instanced draw.
+ * @param a The first packet.
+ * @param b The second packet.
+ * @return True if both packets only differ in their world matrix.
+ */
+bool OkItemGroup::_sameBatch(const OkDrawPacket &a, const OkDrawPacket &b) {
+  return a.pass == b.pass && a.vao == b.vao && a.texture == b.texture &&
+         a.mode == b.mode && a.indexCount == b.indexCount &&
+         a.indexType == b.indexType && a.baseVertex == b.baseVertex &&
+         a.indexOffset == b.indexOffset && a.color == b.color;
+}
+
+/**
+ * @brief Build the draws of the group for the current frame.
+ *        Visible items without children nor origin axes are batched: their
+ *        packets are sorted by state, and every run of at least
+ *        graphics.instancing-min-items packets sharing the mesh, texture and
+ *        pass becomes one instanced packet. Shorter runs keep one packet per
+ *        item, and the other items are left in unbatchedItems.
+ *        Items outside the view frustum of the queue are skipped.
+ * @param queue The render queue the draws are for, nullptr when drawing in
+ *              immediate mode.
+ */
+void OkItemGroup::_batchItems(OkRenderQueue *queue) {
+  int minItems = OkConfig::getInt("graphics.instancing-min-items");
+
+  batchEntries.clear();
+  instances.clear();
+  batchedPackets.clear();
+  unbatchedItems.clear();
+  instancedDrawCount = 0;
+
+  // Grouped items are not part of the hierarchy so they get their own
+  // transform pass
+  for (size_t i = 0; i < items.size(); i++) {
+    OkItem *item = items[i].item;
+    if (!item || items[i].baked) {
+      continue;
+    }
+
+    item->updateTransform();
+
+    bool batchable = minItems > 1 && item->getMesh() &&
+                     item->getMesh()->getVAO() != 0 &&
+                     item->getFirstChild() == nullptr &&
+                     !item->getDrawOriginAxis();
+    if (!batchable) {
+      unbatchedItems.push_back(item);
+      continue;
+    }
+
+    if (!item->getVisible()) {
+      continue;
+    }
+
+    if (queue && queue->isCulling()) {
+      if (queue->getFrustum().test(item->getBounds()) ==
+          OkCullResult::Outside) {
+        queue->countCulled(1);
+        continue;
+      }
+      queue->countVisible(1);
+    }
+
+    OkDrawPacket packets[OkItem::maxPackets];
+    int          count = item->getDrawPackets(packets);
+    for (int j = 0; j < count; j++) {
+      batchEntries.push_back({packets[j], item->getMesh()});
+    }
+  }
+
+  // Sort by state, the stable sort keeps the item order inside a batch
+  std::stable_sort(batchEntries.begin(), batchEntries.end(),
+                   [](const OkBatchEntry &a, const OkBatchEntry &b) {
+                     if (a.packet.pass != b.packet.pass) {
+                       return a.packet.pass < b.packet.pass;
+                     }
+                     if (a.packet.vao != b.packet.vao) {
+                       return a.packet.vao < b.packet.vao;
+                     }
+                     if (a.packet.texture != b.packet.texture) {
+                       return a.packet.texture < b.packet.texture;
+                     }
+                     if (a.packet.baseVertex != b.packet.baseVertex) {
+                       return a.packet.baseVertex < b.packet.baseVertex;
+                     }
+                     return a.packet.mode < b.packet.mode;
+                   });
+
+  // Instances are never reallocated once reserved, so packets can point to
+  // them until the next frame
+  instances.reserve(batchEntries.size());
+
+  size_t begin = 0;
+  while (begin < batchEntries.size()) {
+    size_t end = begin + 1;
+    while (end < batchEntries.size() &&
+           _sameBatch(batchEntries[begin].packet, batchEntries[end].packet)) {
+      end++;
+    }
+
+    if (end - begin < static_cast<size_t>(minItems)) {
+      for (size_t i = begin; i < end; i++) {
+        batchedPackets.push_back(batchEntries[i].packet);
+      }
+    } else {
+      size_t offset = instances.size();
+      for (size_t i = begin; i < end; i++) {
+        const OkDrawPacket &packet = batchEntries[i].packet;
+        instances.push_back({*packet.matrix, packet.layer});
+      }
+
+      OkDrawPacket packet   = batchEntries[begin].packet;
+      packet.instanceCount  = static_cast<GLsizei>(end - begin);
+      packet.instances      = &instances[offset];
+      packet.instanceBuffer = batchEntries[begin].mesh->getInstanceBuffer();
+      batchedPackets.push_back(packet);
+      instancedDrawCount++;
+    }
+
+    begin = end;
+  }
+}
+
 /**
  * @brief Render method called each frame.
  */
 void OkItemGroup::drawSelf() {
-  // Draw all items
-  for (size_t i = 0; i < items.size(); i++) {
-    if (items[i].item) {
-      items[i].item->draw();
+  _batchItems(nullptr);
+
+  for (size_t i = 0; i < staticBatches.size(); i++) {
+    staticBatches[i]->draw();
+  }
+
+  for (size_t i = 0; i < unbatchedItems.size(); i++) {
+    unbatchedItems[i]->draw();
+  }
+
+  OkShaderProgram *program = OkShaderProgram::getCurrent();
+  if (program == nullptr) {
+    if (!batchedPackets.empty()) {
+      OkLogger::error("ItemGroup", "No shader program in use");
     }
+    return;
+  }
+
+  for (size_t i = 0; i < batchedPackets.size(); i++) {
+    OkRenderQueue::drawPacket(batchedPackets[i], program,
+                              i > 0 ? &batchedPackets[i - 1] : nullptr);
+  }
+}
+
+/**
+ * @brief Add all the items of the group to a render queue.
+ * @param queue The render queue.
+ */
+void OkItemGroup::submitSelf(OkRenderQueue &queue) {
+  _batchItems(&queue);
+
+  // Batches are culled like any other item, chunk by chunk
+  for (size_t i = 0; i < staticBatches.size(); i++) {
+    staticBatches[i]->submit(queue);
+  }
+
+  for (size_t i = 0; i < unbatchedItems.size(); i++) {
+    unbatchedItems[i]->submit(queue);
+  }
+
+  for (size_t i = 0; i < batchedPackets.size(); i++) {
+    queue.add(batchedPackets[i]);
   }
 }
 
@@ -375,6 +564,9 @@ void OkItemGroup::setWireframe(bool wireframe) {
       items[i].item->setWireframe(wireframe);
     }
   }
+  for (size_t i = 0; i < staticBatches.size(); i++) {
+    staticBatches[i]->setWireframe(wireframe);
+  }
 }
 
 /**
@@ -387,6 +579,9 @@ void OkItemGroup::setVisible(bool visible) {
       items[i].item->setVisible(visible);
     }
   }
+  for (size_t i = 0; i < staticBatches.size(); i++) {
+    staticBatches[i]->setVisible(visible);
+  }
 }
 
 /**
@@ -400,3 +595,251 @@ void OkItemGroup::setDrawOriginAxisForAll(bool drawAxis) {
     }
   }
 }
+
+/**
+ * @brief Set the static flag of all the items in the group.
+ * @param isStatic True if the items never move, so bake can merge them.
+ */
+void OkItemGroup::setStatic(bool isStatic) {
+  for (size_t i = 0; i < items.size(); i++) {
+    if (items[i].item) {
+      items[i].item->setStatic(isStatic);
+    }
+  }
+}
+
+/**
+ * @brief Merge the static items into batches drawn as single items.
+ *        Visible static items with a loaded mesh, drawn as separate
+ *        primitives and without children nor origin axes, are grouped by the
+ *        cube of scene.static-chunk-size their bounds center falls in, and
+ *        by texture, texture layer, vertex layout, draw mode and wireframe
+ *        flag. Every group of at least two items becomes one batch, with
+ *        the geometry of the items transformed to world space. The items
+ *        stay in the group, but they are no longer updated nor drawn.
+ *        Previous batches are deleted first.
+ * @return The number of batches created.
+ */
+int OkItemGroup::bake() {
+  unbake();
+
+  float chunkSize =
+      std::max(OkConfig::getFloat("scene.static-chunk-size"), 1.0f);
+
+  std::map<OkBakeKey, std::vector<size_t>> batches;
+  for (size_t i = 0; i < items.size(); i++) {
+    OkItem *item = items[i].item;
+    if (!item || !item->getStatic() || !item->getVisible() ||
+        item->isLoading() || !item->getMesh() ||
+        item->getMesh()->getVertexCount() == 0 ||
+        item->getFirstChild() != nullptr || item->getDrawOriginAxis()) {
+      continue;
+    }
+
+    // Strips and fans cannot be concatenated
+    GLenum mode = item->getDrawMode();
+    if (mode != GL_TRIANGLES && mode != GL_LINES && mode != GL_POINTS) {
+      continue;
+    }
+
+    item->updateTransform();
+    glm::vec3 center = item->getBounds().center / chunkSize;
+
+    OkBakeKey key = std::make_tuple(
+        static_cast<int>(std::floor(center.x)),
+        static_cast<int>(std::floor(center.y)),
+        static_cast<int>(std::floor(center.z)), item->getTexture(),
+        item->getTextureLayer(), item->getMesh()->getLayout().encode(), mode,
+        item->getWireframe());
+    batches[key].push_back(i);
+  }
+
+  for (const auto &batch : batches) {
+    if (batch.second.size() < 2) {
+      continue;
+    }
+
+    std::vector<OkItem *> batchItems;
+    for (size_t i = 0; i < batch.second.size(); i++) {
+      batchItems.push_back(items[batch.second[i]].item);
+    }
+
+    OkItem *baked = _bakeBatch(batchItems);
+    if (!baked) {
+      continue;
+    }
+
+    staticBatches.push_back(baked);
+    for (size_t i = 0; i < batch.second.size(); i++) {
+      items[batch.second[i]].baked = true;
+    }
+    bakedItemCount += static_cast<int>(batch.second.size());
+  }
+
+  OkLogger::info("ItemGroup", "Baked " + std::to_string(bakedItemCount) +
+                                  " static items into " +
+                                  std::to_string(staticBatches.size()) +
+                                  " batches");
+  return static_cast<int>(staticBatches.size());
+}
+
+/**
+ * @brief Build the item drawing a batch of static items.
+ *        Vertices are transformed by the world matrix of their item, and
+ *        normals by its normal matrix, then stored in the layout of the
+ *        items. The mesh is stored in OkMeshHandler under a unique name,
+ *        and released with the batch.
+ * @param batch Items sharing the texture, vertex layout and draw state.
+ * @return The batch, with an identity transform, or nullptr on failure.
+ */
+OkItem *OkItemGroup::_bakeBatch(const std::vector<OkItem *> &batch) {
+  const OkItem         *first  = batch[0];
+  const OkVertexLayout &layout = first->getMesh()->getLayout();
+
+  std::vector<float>        vertices;
+  std::vector<unsigned int> indices;
+  for (size_t i = 0; i < batch.size(); i++) {
+    const OkMesh *mesh        = batch[i]->getMesh();
+    size_t        base        = vertices.size() / 8;
+    size_t        vertexCount = static_cast<size_t>(mesh->getVertexCount());
+
+    vertices.resize(vertices.size() + vertexCount * 8);
+    float *source = vertices.data() + base * 8;
+    layout.unpack(mesh->getVertexData(), vertexCount, source);
+
+    const glm::mat4 &matrix       = batch[i]->getRenderMatrix();
+    glm::mat4        normalMatrix = glm::transpose(glm::inverse(matrix));
+    for (size_t j = 0; j < vertexCount; j++) {
+      float    *vertex   = source + j * 8;
+      glm::vec3 position = glm::vec3(vertex[0], vertex[1], vertex[2]);
+      glm::vec3 normal   = glm::vec3(vertex[5], vertex[6], vertex[7]);
+
+      position = glm::vec3(matrix * glm::vec4(position, 1.0f));
+      normal   = glm::vec3(normalMatrix * glm::vec4(normal, 0.0f));
+      if (glm::length(normal) > 0.0f) {
+        normal = glm::normalize(normal);
+      }
+
+      vertex[0] = position.x;
+      vertex[1] = position.y;
+      vertex[2] = position.z;
+      vertex[5] = normal.x;
+      vertex[6] = normal.y;
+      vertex[7] = normal.z;
+    }
+
+    for (long j = 0; j < mesh->getIndexCount(); j++) {
+      indices.push_back(mesh->getIndex(j) + static_cast<unsigned int>(base));
+    }
+  }
+
+  long vertexCount = static_cast<long>(vertices.size() / 8);
+  long indexCount  = static_cast<long>(indices.size());
+
+  std::string meshName = name + ":static:" + std::to_string(bakeSerial++);
+  OkMesh     *mesh     = OkMeshHandler::getInstance()->createMesh(
+      meshName, layout, vertices.data(), 8, vertexCount, indices.data(),
+      indexCount);
+  if (!mesh) {
+    return nullptr;
+  }
+
+  OkItem *baked = new OkItem(meshName, mesh, meshName);
+  if (first->getTexture() && !first->getTextureName().empty()) {
+    OkTextureHandler::getInstance()->addReference(first->getTextureName());
+  }
+  baked->setTexture(first->getTextureName(), first->getTexture(),
+                    first->getTextureLayer());
+  baked->setDrawMode(first->getDrawMode());
+  baked->setWireframe(first->getWireframe());
+  baked->setStatic(true);
+
+  // Bounds in world space, computed once
+  baked->updateTransform();
+  return baked;
+}
+
+/**
+ * @brief Delete the static batches, baked items are drawn on their own.
+ */
+void OkItemGroup::unbake() {
+  for (size_t i = 0; i < staticBatches.size(); i++) {
+    delete staticBatches[i];
+  }
+  staticBatches.clear();
+
+  for (size_t i = 0; i < items.size(); i++) {
+    items[i].baked = false;
+  }
+  bakedItemCount = 0;
+}
+
+/**
+ * @brief Copy the textures of the items into array textures and switch the
+ *        items to their layer.
+ *        Textures are grouped by size and number of channels, and every
+ *        group of at least two textures becomes an array. Items then share
+ *        a texture, so those with the same mesh are drawn with one instanced
+ *        draw. Compressed, streaming and array textures are left alone.
+ * @param arrayName Name of the array textures, followed by the first
+ *                  serial number not taken by another texture.
+ * @return The number of array textures created.
+ */
+int OkItemGroup::packTextures(const std::string &arrayName) {
+  OkTextureHandler *handler = OkTextureHandler::getInstance();
+
+  // Texture names by size and format, and the items using each texture
+  std::map<std::tuple<int, int, int>, std::vector<std::string>> formats;
+  std::map<std::string, std::vector<OkItem *>>                  users;
+
+  for (size_t i = 0; i < items.size(); i++) {
+    OkItem    *item    = items[i].item;
+    OkTexture *texture = item ? item->getTexture() : nullptr;
+    if (!texture || !texture->isLoaded() || texture->isArray() ||
+        texture->isCompressed() || texture->isStreaming() ||
+        item->getTextureName().empty()) {
+      continue;
+    }
+
+    std::vector<OkItem *> &textureUsers = users[item->getTextureName()];
+    if (textureUsers.empty()) {
+      formats[std::make_tuple(texture->getWidth(), texture->getHeight(),
+                              texture->getChannels())]
+          .push_back(item->getTextureName());
+    }
+    textureUsers.push_back(item);
+  }
+
+  int count  = 0;
+  int serial = 0;
+  for (const auto &format : formats) {
+    const std::vector<std::string> &names = format.second;
+    if (names.size() < 2) {
+      continue;
+    }
+
+    // Names of arrays packed before, by this group or another, are skipped
+    std::string name = arrayName + std::to_string(serial++);
+    while (handler->getTexture(name)) {
+      name = arrayName + std::to_string(serial++);
+    }
+
+    OkTexture *array = handler->createTextureArray(name, names);
+    if (!array) {
+      continue;
+    }
+
+    for (size_t layer = 0; layer < names.size(); layer++) {
+      for (OkItem *item : users[names[layer]]) {
+        handler->addReference(name);
+        item->setTexture(name, array, static_cast<int>(layer));
+      }
+    }
+
+    // The items hold the array now
+    handler->removeReference(name);
+    count++;
+  }
+
+  return count;
+}
@@ -2,15 +2,21 @@
 #define OK_ITEM_GROUP_HPP
 
 #include "../core/object.hpp"
+#include "../render/queue.hpp"
 #include "item.hpp"
+#include "mesh.hpp"
 #include <cstddef>
+#include <glm/glm.hpp>
 #include <string>
 #include <vector>
 
 /**
  * @brief Class representing a group of OkItems that can be managed and rendered
  *        as a single unit. Items can be tagged for selective visibility
- * control.
+ * control. Items sharing a mesh and a texture are drawn with a single
+ * instanced draw call. Static items can be baked: their geometry is
+ * pre-transformed to world space and merged into a few batches, one per
+ * chunk of space and draw state, culled and drawn as single items.
  */
 class OkItemGroup : public OkObject {
 private:
@@ -18,17 +24,42 @@ private:
   struct OkTaggedItem {
     OkItem                  *item;
     std::vector<std::string> tags;
+    bool                     baked;  // Drawn by a static batch
 
     OkTaggedItem(OkItem *itm, const std::vector<std::string> &itemTags = {})
-        : item(itm), tags(itemTags) {}
+        : item(itm), tags(itemTags), baked(false) {}
   };
 
   std::vector<OkTaggedItem> items;
 
+  // Items created by bake, owning the merged geometry of the static items
+  std::vector<OkItem *> staticBatches;
+  int                   bakedItemCount;
+
+  OkItem *_bakeBatch(const std::vector<OkItem *> &batch);
+
+  // Draws of the last frame, rebuilt by _batchItems. Items sharing a mesh,
+  // texture and draw state are merged into instanced packets, whose world
+  // matrices and texture layers live in instances until the next frame
+  struct OkBatchEntry {
+    OkDrawPacket packet;
+    OkMesh      *mesh;
+  };
+
+  std::vector<OkBatchEntry> batchEntries;
+  std::vector<OkInstance>   instances;
+  std::vector<OkDrawPacket> batchedPackets;
+  std::vector<OkItem *>     unbatchedItems;  // Submitted one by one
+  int                       instancedDrawCount;
+
+  void        _batchItems(OkRenderQueue *queue);
+  static bool _sameBatch(const OkDrawPacket &a, const OkDrawPacket &b);
+
 protected:
   void drawSelf() override;
   void stepSelf(float dt) override;
   void updateTransformSelf() override;
+  void submitSelf(OkRenderQueue &queue) override;
 
 public:
   // Constructors
@@ -67,11 +98,28 @@ public:
 
   // Statistics
   int getItemCountWithTag(const std::string &tag) const;
+  int    getInstancedDrawCount() const { return instancedDrawCount; }
+  size_t getStaticBatchCount() const { return staticBatches.size(); }
+  int    getBakedItemCount() const { return bakedItemCount; }
 
   // Bulk operations on all items
   void setWireframe(bool wireframe);
   void setVisible(bool visible);
   void setDrawOriginAxisForAll(bool drawAxis);
+  void setStatic(bool isStatic);
+
+  // Merge the static items into batches, replacing the previous ones, and
+  // return the number of batches. Baked items are no longer updated nor
+  // drawn, changes to them need a new bake
+  int bake();
+
+  // Delete the batches, baked items are drawn on their own again. Removing
+  // a baked item unbakes the group
+  void unbake();
+
+  // Copy the textures of the items into array textures, one per size and
+  // format, so items differing only by texture are drawn together
+  int packTextures(const std::string &arrayName);
 };
 
 #endif  // OK_ITEM_GROUP_HPP
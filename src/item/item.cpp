@@ -1,9 +1,14 @@
 #include "item.hpp"
 #include "../config/config.hpp"
 #include "../core/gl_config.hpp"
+#include "../core/gl_state.hpp"
+#include "../handlers/meshes.hpp"
 #include "../handlers/textures.hpp"
+#include "../render/queue.hpp"
+#include "../shaders/program.hpp"
 #include "../utils/logger.hpp"
 #include "core/object.hpp"
+#include "item/mesh.hpp"
 #include "item/texture.hpp"
 #include <algorithm>
 #include <cmath>
@@ -11,10 +16,13 @@
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <memory>
 #include <string>
 
 /**
  * @brief Create a new item with the given name, vertices, and indices.
+ *        The geometry is shared through OkMeshHandler, items created with
+ *        identical data reference the same mesh.
  * @param name        The name of the item.
  * @param vertexData  The vertex data.
  * @param vertexCount The number of vertices.
@@ -29,43 +37,61 @@ OkItem::OkItem(const std::string &name, float *vertexData, long vertexCount,
                              std::to_string(vertexCount) + " vertices and " +
                              std::to_string(indexCount) + " indices");
 
-  visible       = true;
-  drawWireframe = false;
-  drawMode      = GL_TRIANGLES;  // Default drawing mode
+  _init();
 
-  numVertices = vertexCount;
-  numIndices  = indexCount;
-  texture     = nullptr;
-  textureName = "";
+  mesh = OkMeshHandler::getInstance()->createMeshFromData(
+      vertexData, vertexCount, indexData, indexCount, meshName);
+}
 
-  // Allocate and copy vertex data
-  vertices = new float[vertexCount];
-  std::memcpy(vertices, vertexData, vertexCount * sizeof(float));
-  numVertices = vertexCount;
+/**
+ * @brief Create a new item that references an existing mesh.
+ * @param name     The name of the item.
+ * @param mesh     The mesh, as returned by OkMeshHandler.
+ * @param meshName The name of the mesh in OkMeshHandler. The item takes over
+ *                 one reference, released when the item is destroyed.
+ */
+OkItem::OkItem(const std::string &name, OkMesh *mesh,
+               const std::string &meshName)
+    : OkObject(name) {
+  _init();
 
-  // Allocate and copy index data
-  indices = new unsigned int[indexCount];
-  std::memcpy(indices, indexData, indexCount * sizeof(unsigned int));
-  numIndices = indexCount;
+  this->mesh     = mesh;
+  this->meshName = meshName;
+}
 
-  _calculateRadius();
+/**
+ * @brief Set the default state shared by all constructors.
+ */
+void OkItem::_init() {
+  visible       = true;
+  drawWireframe = false;
+  drawMode      = GL_TRIANGLES;  // Default drawing mode
+  staticItem    = false;
 
-  _initBuffers();
+  mesh        = nullptr;
+  meshName    = "";
+  texture      = nullptr;
+  textureName  = "";
+  textureLayer = 0;
 }
 
 /**
  * @brief Destructor for the OkItem class.
- *        Cleans up OpenGL objects and allocated memory.
+ *        Releases the mesh and texture references.
  */
 OkItem::~OkItem() {
-  // Delete OpenGL objects
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
+  // Stop waiting for background loads
+  if (meshRequest) {
+    meshRequest->cancel(this);
+  }
+  if (textureRequest) {
+    textureRequest->cancel(this);
+  }
 
-  // Free allocated memory
-  delete[] vertices;
-  delete[] indices;
+  // Remove mesh reference, the mesh is deleted with its last item
+  if (mesh && !meshName.empty()) {
+    OkMeshHandler::getInstance()->removeReference(meshName);
+  }
 
   // Remove texture reference
   if (texture && !textureName.empty()) {
@@ -74,102 +100,35 @@ OkItem::~OkItem() {
 }
 
 /**
- * @brief Initialize OpenGL buffers for the item.
+ * @brief Create a new item sharing the mesh and texture of this one.
+ *        Only references are added, no geometry is copied. The transform
+ *        and the hierarchy are not copied.
+ * @param name The name of the new item.
+ * @return The new item.
  */
-void OkItem::_initBuffers() {
-  // Generate and bind VAO first
-  glGenVertexArrays(1, &VAO);
-  glBindVertexArray(VAO);
-
-  // Generate and set up VBO
-  glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(numVertices * sizeof(float)),
-               vertices, GL_STATIC_DRAW);
-
-  // Position attribute (3 floats)
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), nullptr);
-  glEnableVertexAttribArray(0);
-
-  // Texture coords attribute (2 floats)
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
-                        (GLvoid *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-
-  // Generate and set up EBO
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               (GLsizeiptr)(numIndices * sizeof(unsigned int)), indices,
-               GL_STATIC_DRAW);
-
-  // Unbind VAO and VBO (but not EBO while VAO is active)
-  // Unbind VAO first, then VBO and EBO
-  // You can unbind the VAO afterwards so other VAO calls won't accidentally
-  // modify this VAO, but this rarely happens. Modifying other VAOs requires a
-  // call to glBindVertexArray anyways so we generally don't unbind VAOs (nor
-  // VBOs) when it's not directly necessary.
-  glBindVertexArray(0);
-
-  // note that this is allowed, the call to glVertexAttribPointer registered
-  // VBO as the vertex attribute's bound vertex buffer object so afterwards we
-  // can safely unbind
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
-
-/**
- * @brief Calculate the radius of the item based on its vertices.
- * @note  The radius is calculated as the maximum distance from the center of
- *        the item to any vertex.
- */
-void OkItem::_calculateRadius() {
+OkItem *OkItem::createInstance(const std::string &name) const {
+  OkMeshHandler::getInstance()->addReference(meshName);
+  OkItem *instance = new OkItem(name, mesh, meshName);
 
-  // Return early if no vertices
-  if (numVertices <= 0 || !vertices) {
-    radius = 0.0f;
-    OkLogger::warning("Item", "No vertices to calculate radius");
-    return;
+  if (texture && !textureName.empty()) {
+    OkTextureHandler::getInstance()->addReference(textureName);
+    instance->setTexture(textureName, texture, textureLayer);
   }
 
-  float minX = vertices[0];
-  float maxX = vertices[0];
-  float minY = vertices[1];
-  float maxY = vertices[1];
-  float minZ = vertices[2];
-  float maxZ = vertices[2];
-
-  // Each vertex has 5 components: 3 for position (xyz) and 2 for UV
-  const int  stride            = 5;
-  const long actualVertexCount = numVertices / stride;
-
-  // Iterate through actual vertices
-  for (long i = 0; i < actualVertexCount; i++) {
-    long  offset = i * stride;
-    float x      = vertices[offset];      // Position X
-    float y      = vertices[offset + 1];  // Position Y
-    float z      = vertices[offset + 2];  // Position Z
-    // vertices[offset + 3] and [offset + 4] are UV coordinates
-
-    minX = std::min(minX, x);
-    maxX = std::max(maxX, x);
-    minY = std::min(minY, y);
-    maxY = std::max(maxY, y);
-    minZ = std::min(minZ, z);
-    maxZ = std::max(maxZ, z);
+  // Instances of an item still loading get its assets when they are ready
+  if (meshRequest) {
+    instance->setPendingMesh(meshRequest);
   }
+  if (textureRequest) {
+    instance->_waitForTexture(textureRequest);
+  }
+
+  instance->drawWireframe = drawWireframe;
+  instance->drawMode      = drawMode;
+  instance->visible       = visible;
+  instance->staticItem    = staticItem;
 
-  float width  = maxX - minX;
-  float height = maxY - minY;
-  float depth  = maxZ - minZ;
-  // Calculate radius as half the diagonal of the bounding box
-  radius = sqrt(width * width + height * height + depth * depth) * 0.5f;
-
-  OkLogger::info("Item",
-                 "Bounds: (" + std::to_string(minX) + ", " +
-                     std::to_string(minY) + ", " + std::to_string(minZ) +
-                     ") to (" + std::to_string(maxX) + ", " +
-                     std::to_string(maxY) + ", " + std::to_string(maxZ) + ")");
-  OkLogger::info("Item", "Calculated radius: " + std::to_string(radius));
+  return instance;
 }
 
 /**
@@ -182,6 +141,12 @@ void OkItem::loadTextureFromFile(const std::string &texturePath) {
     return;
   }
 
+  // A texture still loading in the background is replaced too
+  if (textureRequest) {
+    textureRequest->cancel(this);
+    textureRequest = nullptr;
+  }
+
   // Remove old texture reference if any
   if (texture && !textureName.empty()) {
     OkTextureHandler::getInstance()->removeReference(textureName);
@@ -192,8 +157,87 @@ void OkItem::loadTextureFromFile(const std::string &texturePath) {
   // Create texture through handler
   texture = OkTextureHandler::getInstance()->createTextureFromFile(texturePath);
   if (texture) {
-    textureName = texturePath;
+    textureName  = texturePath;
+    textureLayer = 0;
+  }
+}
+
+/**
+ * @brief Set the mesh of the item.
+ * @param name    The name of the mesh in OkMeshHandler. The item takes over
+ *                one reference, released when the item is destroyed.
+ * @param newMesh The mesh.
+ */
+void OkItem::setMesh(const std::string &name, OkMesh *newMesh) {
+  if (mesh && !meshName.empty()) {
+    OkMeshHandler::getInstance()->removeReference(meshName);
   }
+  mesh     = newMesh;
+  meshName = name;
+
+  // The bounds depend on the mesh
+  markTransformDirty();
+}
+
+/**
+ * @brief Take the mesh of a background load when it is ready.
+ *        Until then the item keeps its current mesh, an item without mesh is
+ *        not drawn. Several items can wait for the same request.
+ * @param request The load request, as returned by
+ *                OkWavefrontImporter::loadMeshAsync.
+ */
+void OkItem::setPendingMesh(const std::shared_ptr<OkLoadRequest> &request) {
+  if (meshRequest) {
+    meshRequest->cancel(this);
+  }
+  meshRequest = request;
+
+  request->then(this, [this](OkLoadRequest &loaded) {
+    if (loaded.getState() == OkLoadState::Ready) {
+      OkMeshHandler::getInstance()->addReference(loaded.getName());
+      setMesh(loaded.getName(), loaded.getMesh());
+    } else {
+      OkLogger::error("Item", "Failed to load mesh " + loaded.getName() +
+                                  " for item " + name);
+    }
+    meshRequest = nullptr;
+  });
+}
+
+/**
+ * @brief Take the texture of a background load when it is ready.
+ * @param request The load request.
+ */
+void OkItem::_waitForTexture(const std::shared_ptr<OkLoadRequest> &request) {
+  if (textureRequest) {
+    textureRequest->cancel(this);
+  }
+  textureRequest = request;
+
+  request->then(this, [this](OkLoadRequest &loaded) {
+    if (loaded.getState() == OkLoadState::Ready) {
+      OkTextureHandler::getInstance()->addReference(loaded.getName());
+      setTexture(loaded.getName(), loaded.getTexture());
+    }
+    textureRequest = nullptr;
+  });
+}
+
+/**
+ * @brief Load the texture of the item in the background.
+ *        The file is decoded on a loader thread and uploaded by the main
+ *        loop. Until then the item keeps its current texture, or is drawn
+ *        with a flat color if it has none.
+ * @param texturePath The path to the texture file.
+ */
+void OkItem::loadTextureAsync(const std::string &texturePath) {
+  if (texturePath.empty()) {
+    OkLogger::error("Item", "Invalid texture path");
+    return;
+  }
+
+  _waitForTexture(
+      OkTextureHandler::getInstance()->loadTextureAsync(texturePath));
 }
 
 /**
@@ -219,123 +263,137 @@ void OkItem::updateTransformSelf() {
 }
 
 /**
- * @brief Draw the item and its children.
- * @note  This method handles the rendering of the item and its children.
+ * @brief Get the bound of the item in local coordinates.
+ * @return The bounding sphere of the mesh, empty if there is no mesh.
  */
-void OkItem::drawSelf() {
-  if (!this->visible) {
-    // If the item is not visible, skip rendering
-    return;
+OkBoundingSphere OkItem::getLocalBounds() const {
+  if (mesh == nullptr) {
+    return OkBoundingSphere::empty();
   }
+  return OkBoundingSphere::sphere(mesh->getCenter(), mesh->getRadius());
+}
 
+/**
+ * @brief Build the draw packets of the item.
+ *        Textured items get a textured pass, wireframe items (or all of them
+ *        when graphics.wireframe is set) a wireframe pass, and items with
+ *        neither a flat colored one.
+ * @param packets Array of at least maxPackets packets to fill.
+ * @return The number of packets built.
+ */
+int OkItem::getDrawPackets(OkDrawPacket *packets) const {
   bool drawWireframe =
       OkConfig::getBool("graphics.wireframe") || this->drawWireframe;
   bool drawTexture =
       OkConfig::getBool("graphics.textures") && texture && texture->isLoaded();
 
-  // Verify we have a valid shader program
-  GLint current_program;
-  glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
-  if (current_program == 0) {
-    OkLogger::error("Item", "No shader program in use");
-    return;
+  OkDrawPacket packet = {};
+  packet.vao          = mesh->getVAO();
+  packet.mode         = drawMode;
+  packet.indexCount   = static_cast<GLsizei>(mesh->getIndexCount());
+  packet.indexType    = mesh->getIndexType();
+  packet.baseVertex   = mesh->getBaseVertex();
+  packet.indexOffset  = mesh->getIndexOffset();
+  packet.color        = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+  packet.matrix       = &getRenderMatrix();
+
+  int count = 0;
+
+  // Textured model
+  if (drawTexture) {
+    packets[count]         = packet;
+    packets[count].pass    = OkDrawPass::Textured;
+    packets[count].texture = texture;
+    packets[count].layer   = static_cast<float>(textureLayer);
+    count++;
   }
 
-  // Clear any previous errors
-  while (glGetError() != GL_NO_ERROR)
-    ;
+  // Second pass: wireframe
+  if (drawWireframe) {
+    packets[count]      = packet;
+    packets[count].pass = OkDrawPass::Wireframe;
+    count++;
+  }
+
+  // Fallback if no texture and no wireframe
+  if (!drawTexture && !drawWireframe) {
+    packets[count]      = packet;
+    packets[count].pass = OkDrawPass::Flat;
+    count++;
+  }
 
-  // Get model matrix from base class
-  glm::mat4 model = getTransformMatrix();
+  return count;
+}
 
-  // Set the model matrix uniform in shader
-  GLint modelLoc = glGetUniformLocation(current_program, "model");
-  if (modelLoc == -1) {
-    OkLogger::error("Item", "Cannot find model uniform in shader");
+/**
+ * @brief Add the draw packets of the item to a render queue.
+ * @param queue The render queue.
+ */
+void OkItem::submitSelf(OkRenderQueue &queue) {
+  if (!this->visible) {
+    // If the item is not visible, skip rendering
     return;
   }
-  glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-  // Verify we have valid buffers
-  if (VAO == 0) {
-    OkLogger::error("Item", "No VAO for item: " + name);
+  // Items waiting for their mesh are not drawn yet
+  if (mesh == nullptr && meshRequest) {
     return;
   }
 
-  // Bind VAO and draw
-  glBindVertexArray(VAO);
-  if (glGetError() != GL_NO_ERROR) {
-    OkLogger::error("Item", "Error binding VAO for item: " + name);
+  // Verify we have valid buffers
+  if (mesh == nullptr || mesh->getVAO() == 0) {
+    OkLogger::error("Item", "No VAO for item: " + name);
     return;
   }
 
-  // Draw textured model
-  if (drawTexture) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glActiveTexture(GL_TEXTURE0);
-    texture->bind();
-
-    // Set uniform for texture sampler
-    GLint texLoc = glGetUniformLocation(current_program, "texture0");
-    if (texLoc != -1) {
-      glUniform1i(texLoc, 0);  // Tell shader to use texture unit 0
-    } else {
-      OkLogger::error("Item", "Cannot find texture0 uniform in shader");
-    }
-
-    // Set hasTexture flag
-    GLint hasTexLoc = glGetUniformLocation(current_program, "hasTexture");
-    if (hasTexLoc != -1) {
-      glUniform1i(hasTexLoc, 1);
-    }
-
-    glDrawElements(drawMode, (GLsizei)numIndices, GL_UNSIGNED_INT, nullptr);
+  OkDrawPacket packets[maxPackets];
+  int          count = getDrawPackets(packets);
+  for (int i = 0; i < count; i++) {
+    queue.add(packets[i]);
   }
+}
 
-  // Second pass: Draw wireframe
-  if (drawWireframe) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-    GLint hasTexLoc = glGetUniformLocation(current_program, "hasTexture");
-    if (hasTexLoc != -1) {
-      glUniform1i(hasTexLoc, 0);
-    }
-
-    GLint colorLoc = glGetUniformLocation(current_program, "wireframeColor");
-    if (colorLoc != -1) {
-      glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-    }
-
-    glDrawElements(drawMode, (GLsizei)numIndices, GL_UNSIGNED_INT, nullptr);
+/**
+ * @brief Draw the item right away, without going through a render queue.
+ * @note  Children are drawn by OkObject::draw.
+ */
+void OkItem::drawSelf() {
+  if (!this->visible) {
+    // If the item is not visible, skip rendering
+    return;
   }
 
-  // Fallback if no texture and no wireframe
-  if (!drawTexture && !drawWireframe) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-    GLint hasTexLoc = glGetUniformLocation(current_program, "hasTexture");
-    if (hasTexLoc != -1) {
-      glUniform1i(hasTexLoc, 0);
-    }
+  // Verify we have a valid shader program
+  OkShaderProgram *program = OkShaderProgram::getCurrent();
+  if (program == nullptr) {
+    OkLogger::error("Item", "No shader program in use");
+    return;
+  }
 
-    GLint colorLoc = glGetUniformLocation(current_program, "wireframeColor");
-    if (colorLoc != -1) {
-      glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-    }
+  // Instanced variants take the world matrix from their attributes instead
+  OkShaderProgram *base = program->getVariant(0);
+  if (base == nullptr || (!base->hasUniform(OkUniform::Model) &&
+                          !base->hasBlock(OkUniformBlock::Object))) {
+    OkLogger::error("Item", "Cannot find model uniform in shader");
+    return;
+  }
 
-    glDrawElements(drawMode, (GLsizei)numIndices, GL_UNSIGNED_INT, nullptr);
+  // Items waiting for their mesh are not drawn yet
+  if (mesh == nullptr && meshRequest) {
+    return;
   }
 
-  // Reset polygon mode to default if needed
-  if (drawWireframe) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  // Verify we have valid buffers
+  if (mesh == nullptr || mesh->getVAO() == 0) {
+    OkLogger::error("Item", "No VAO for item: " + name);
+    return;
   }
 
-  if (texture) {
-    // static call to unbind texture, opengl does not need to know which
-    // texture was bound before, it will just unbind the currently bound
-    // texture with
-    // glBindTexture(GL_TEXTURE_2D, 0);
-    OkTexture::unbind();
+  // Polygon mode and texture bindings are not restored, every draw sets the
+  // state it needs and the GL state cache drops the unchanged calls
+  OkDrawPacket packets[maxPackets];
+  int          count = getDrawPackets(packets);
+  for (int i = 0; i < count; i++) {
+    OkRenderQueue::drawPacket(packets[i], program);
   }
 }
@@ -3,44 +3,53 @@
 
 #include "../core/gl_config.hpp"
 #include "../core/object.hpp"
+#include "../handlers/loader.hpp"
 #include "../handlers/textures.hpp"
+#include "../item/mesh.hpp"
 #include "../item/texture.hpp"
+#include "../render/queue.hpp"
+#include <memory>
 #include <string>
 
 class OkItem : public OkObject {
 private:
-  void _initBuffers();
+  void _init();
+  void _waitForTexture(const std::shared_ptr<OkLoadRequest> &request);
 
   // Flags
   bool   visible;
   bool   drawWireframe;  // Flag to control wireframe rendering
   GLenum drawMode;       // GL_TRIANGLES, GL_LINES, etc.
+  bool   staticItem;     // Never moves, can be baked by its group
 
-  // Geometry
-  float        *vertices;
-  unsigned int *indices;
-  long          numVertices;
-  long          numIndices;
-  float         radius;  // Maximum dimension
-
-  // OpenGL objects
-  GLuint VAO, VBO, EBO;
+  // Geometry, shared with other items
+  std::string meshName;  // Name of the mesh for reference counting
+  OkMesh     *mesh;
 
   // Texture
   std::string textureName;  // Name/path of the texture for reference counting
   OkTexture  *texture;
+  int         textureLayer;  // Layer used when the texture is an array
 
-protected:
-  // Geometry
-  void _calculateRadius();
+  // Assets being loaded in the background, adopted when they are ready
+  std::shared_ptr<OkLoadRequest> meshRequest;
+  std::shared_ptr<OkLoadRequest> textureRequest;
 
+protected:
   // Override OkObject's transform update
   void updateTransformSelf() override;
 
+  // Override OkObject's render queue submission
+  void submitSelf(OkRenderQueue &queue) override;
+
+  // Bounding sphere of the mesh
+  OkBoundingSphere getLocalBounds() const override;
+
 public:
   // Constructors
   OkItem(const std::string &name, float *vertexData, long vertexCount,
          unsigned int *indexData, long indexCount);
+  OkItem(const std::string &name, OkMesh *mesh, const std::string &meshName);
   ~OkItem();
 
   // Delete copy constructor and assignment
@@ -48,16 +57,38 @@ public:
   OkItem &operator=(const OkItem &) = delete;
 
   // Geometry
-  float getRadius() const { return radius; }
+  float getRadius() const { return mesh ? mesh->getRadius() : 0.0f; }
+
+  // Shared mesh
+  OkMesh            *getMesh() const { return mesh; }
+  const std::string &getMeshName() const { return meshName; }
+  void               setMesh(const std::string &name, OkMesh *newMesh);
+
+  // Take the mesh or texture of a background load when it is ready, until
+  // then the item keeps its current one (or is not drawn without a mesh)
+  void setPendingMesh(const std::shared_ptr<OkLoadRequest> &request);
+  void loadTextureAsync(const std::string &texturePath);
+  bool isLoading() const { return meshRequest || textureRequest; }
+
+  // Draw packets, at most one per pass
+  static const int maxPackets = 3;
+  int              getDrawPackets(OkDrawPacket *packets) const;
+
+  // New item sharing the mesh and texture of this one
+  OkItem *createInstance(const std::string &name) const;
 
   // Texture methods
+  OkTexture         *getTexture() const { return texture; }
+  const std::string &getTextureName() const { return textureName; }
+  int                getTextureLayer() const { return textureLayer; }
   void loadTextureFromFile(const std::string &texturePath);
-  void setTexture(const std::string &name, OkTexture *tex) {
+  void setTexture(const std::string &name, OkTexture *tex, int layer = 0) {
     if (texture && !textureName.empty()) {
       OkTextureHandler::getInstance()->removeReference(textureName);
     }
-    texture     = tex;
-    textureName = name;
+    texture      = tex;
+    textureName  = name;
+    textureLayer = layer;
   }
 
   // Flags
@@ -67,6 +98,8 @@ public:
   GLenum getDrawMode() const { return drawMode; }
   void   setVisible(bool visible) { this->visible = visible; }
   bool   getVisible() const { return visible; }
+  void   setStatic(bool isStatic) { staticItem = isStatic; }
+  bool   getStatic() const { return staticItem; }
 
   // Update and render
   void stepSelf(float dt) override;
@@ -0,0 +1,328 @@
+#include "layout.hpp"
+#include "../core/gl_config.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Get the layout of the 5-float vertices: position and texture
+ *        coordinates as floats, without normals.
+ * @return The standard layout.
+ */
+OkVertexLayout OkVertexLayout::standard() {
+  return {OkTexcoordFormat::Float, OkNormalFormat::None};
+}
+
+/**
+ * @brief Get the size of the texture coordinates of a vertex.
+ * @param format The storage format.
+ * @return The size in bytes.
+ */
+static size_t texcoordSize(OkTexcoordFormat format) {
+  switch (format) {
+  case OkTexcoordFormat::Float:
+    return 2 * sizeof(float);
+  case OkTexcoordFormat::Half:
+    return 2 * sizeof(uint16_t);
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Get the size of the normal of a vertex.
+ * @param format The storage format.
+ * @return The size in bytes.
+ */
+static size_t normalSize(OkNormalFormat format) {
+  switch (format) {
+  case OkNormalFormat::Float:
+    return 3 * sizeof(float);
+  case OkNormalFormat::Packed:
+    return sizeof(uint32_t);
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Get the size of a vertex. All the attributes have sizes multiple of
+ *        4 bytes, so every attribute stays aligned.
+ * @return The size in bytes.
+ */
+size_t OkVertexLayout::getStride() const {
+  return 3 * sizeof(float) + texcoordSize(texcoords) + normalSize(normals);
+}
+
+/**
+ * @brief Get the offset of the normal in a vertex.
+ * @return The offset in bytes.
+ */
+size_t OkVertexLayout::getNormalOffset() const {
+  return getTexcoordOffset() + texcoordSize(texcoords);
+}
+
+/**
+ * @brief Set the attribute pointers for this layout.
+ *        The vertex array and the vertex buffer must be bound. Attributes the
+ *        layout does not have are left disabled, so shaders read their
+ *        default value.
+ */
+void OkVertexLayout::setAttributes() const {
+  GLsizei stride = static_cast<GLsizei>(getStride());
+
+  glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE, stride,
+                        nullptr);
+  glEnableVertexAttribArray(positionAttribute);
+
+  if (texcoords != OkTexcoordFormat::None) {
+    GLenum type =
+        texcoords == OkTexcoordFormat::Half ? GL_HALF_FLOAT : GL_FLOAT;
+    glVertexAttribPointer(texcoordAttribute, 2, type, GL_FALSE, stride,
+                          (GLvoid *)getTexcoordOffset());
+    glEnableVertexAttribArray(texcoordAttribute);
+  }
+
+  if (normals == OkNormalFormat::Float) {
+    glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE, stride,
+                          (GLvoid *)getNormalOffset());
+    glEnableVertexAttribArray(normalAttribute);
+  } else if (normals == OkNormalFormat::Packed) {
+    // Four signed normalized components, the 2-bit w is unused
+    glVertexAttribPointer(normalAttribute, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                          stride, (GLvoid *)getNormalOffset());
+    glEnableVertexAttribArray(normalAttribute);
+  }
+}
+
+/**
+ * @brief Convert float vertices to this layout.
+ * @param source       The source vertices: position (3 floats), texture
+ *                     coordinates (2 floats) and, if sourceStride is at
+ *                     least 8, the normal (3 floats). Missing normals are 0.
+ * @param sourceStride The number of floats per source vertex, at least 5.
+ * @param vertexCount  The number of vertices.
+ * @param destination  Receives vertexCount * getStride() bytes.
+ */
+void OkVertexLayout::pack(const float *source, int sourceStride,
+                          size_t vertexCount,
+                          unsigned char *destination) const {
+  static const float noNormal[3] = {0.0f, 0.0f, 0.0f};
+
+  size_t stride = getStride();
+  for (size_t i = 0; i < vertexCount; i++) {
+    const float   *vertex = source + i * sourceStride;
+    const float   *normal = sourceStride >= 8 ? vertex + 5 : noNormal;
+    unsigned char *out    = destination + i * stride;
+
+    std::memcpy(out, vertex, 3 * sizeof(float));
+    out += 3 * sizeof(float);
+
+    if (texcoords == OkTexcoordFormat::Float) {
+      std::memcpy(out, vertex + 3, 2 * sizeof(float));
+    } else if (texcoords == OkTexcoordFormat::Half) {
+      uint16_t uv[2] = {floatToHalf(vertex[3]), floatToHalf(vertex[4])};
+      std::memcpy(out, uv, sizeof(uv));
+    }
+    out += texcoordSize(texcoords);
+
+    if (normals == OkNormalFormat::Float) {
+      std::memcpy(out, normal, 3 * sizeof(float));
+    } else if (normals == OkNormalFormat::Packed) {
+      uint32_t packed = packNormal(normal[0], normal[1], normal[2]);
+      std::memcpy(out, &packed, sizeof(packed));
+    }
+  }
+}
+
+/**
+ * @brief Convert vertices of this layout to floats, the reverse of pack.
+ *        Half texture coordinates and packed normals lose nothing more than
+ *        they did when packed.
+ * @param source      The vertices, vertexCount * getStride() bytes.
+ * @param vertexCount The number of vertices.
+ * @param destination Receives 8 floats per vertex: position, texture
+ *                    coordinates and normal, 0 for missing attributes.
+ */
+void OkVertexLayout::unpack(const unsigned char *source, size_t vertexCount,
+                            float *destination) const {
+  size_t stride = getStride();
+  for (size_t i = 0; i < vertexCount; i++) {
+    const unsigned char *in     = source + i * stride;
+    float               *vertex = destination + i * 8;
+
+    std::memcpy(vertex, in, 3 * sizeof(float));
+    in += 3 * sizeof(float);
+
+    vertex[3] = 0.0f;
+    vertex[4] = 0.0f;
+    if (texcoords == OkTexcoordFormat::Float) {
+      std::memcpy(vertex + 3, in, 2 * sizeof(float));
+    } else if (texcoords == OkTexcoordFormat::Half) {
+      uint16_t uv[2];
+      std::memcpy(uv, in, sizeof(uv));
+      vertex[3] = halfToFloat(uv[0]);
+      vertex[4] = halfToFloat(uv[1]);
+    }
+    in += texcoordSize(texcoords);
+
+    vertex[5] = 0.0f;
+    vertex[6] = 0.0f;
+    vertex[7] = 0.0f;
+    if (normals == OkNormalFormat::Float) {
+      std::memcpy(vertex + 5, in, 3 * sizeof(float));
+    } else if (normals == OkNormalFormat::Packed) {
+      uint32_t packed;
+      std::memcpy(&packed, in, sizeof(packed));
+      unpackNormal(packed, vertex + 5);
+    }
+  }
+}
+
+/**
+ * @brief Encode the layout in 32 bits, for binary mesh files.
+ * @return The texture coordinate format in the low byte, and the normal
+ *         format in the next one.
+ */
+uint32_t OkVertexLayout::encode() const {
+  return static_cast<uint32_t>(texcoords) |
+         (static_cast<uint32_t>(normals) << 8);
+}
+
+/**
+ * @brief Decode a layout encoded by encode.
+ * @param value  The encoded layout.
+ * @param layout Receives the layout.
+ * @return False if the value is not a valid layout.
+ */
+bool OkVertexLayout::decode(uint32_t value, OkVertexLayout &layout) {
+  uint32_t texcoordValue = value & 0xff;
+  uint32_t normalValue   = (value >> 8) & 0xff;
+  if ((value >> 16) != 0 ||
+      texcoordValue > static_cast<uint32_t>(OkTexcoordFormat::Half) ||
+      normalValue > static_cast<uint32_t>(OkNormalFormat::Packed)) {
+    return false;
+  }
+
+  layout.texcoords = static_cast<OkTexcoordFormat>(texcoordValue);
+  layout.normals   = static_cast<OkNormalFormat>(normalValue);
+  return true;
+}
+
+/**
+ * @brief Convert a float to a half float, rounding to the nearest value.
+ *        Values too large become infinities, values too small become
+ *        subnormals or zeros.
+ * @param value The float.
+ * @return The bits of the half float.
+ */
+uint16_t OkVertexLayout::floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign     = (bits >> 16) & 0x8000;
+  uint32_t exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  // Infinities and NaNs, keeping NaNs quiet
+  if (exponent == 0xff) {
+    return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+  }
+
+  int halfExponent = static_cast<int>(exponent) - 127 + 15;
+  if (halfExponent >= 0x1f) {
+    return static_cast<uint16_t>(sign | 0x7c00);
+  }
+
+  // Subnormal half floats, or zero
+  if (halfExponent <= 0) {
+    if (halfExponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    mantissa |= 0x800000;
+    int      shift     = 14 - halfExponent;
+    uint32_t half      = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway   = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  // Rounding can carry into the exponent, up to infinity, as it should
+  uint32_t half      = (static_cast<uint32_t>(halfExponent) << 10) |
+                       (mantissa >> 13);
+  uint32_t remainder = mantissa & 0x1fff;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    half++;
+  }
+  return static_cast<uint16_t>(sign | half);
+}
+
+/**
+ * @brief Convert a half float to a float. The conversion is exact.
+ * @param value The bits of the half float.
+ * @return The float.
+ */
+float OkVertexLayout::halfToFloat(uint16_t value) {
+  uint32_t sign     = static_cast<uint32_t>(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+
+  uint32_t bits = 0;
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  } else if (mantissa != 0) {
+    // Subnormal half float, normalized as a float
+    uint32_t floatExponent = 127 - 15 + 1;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      floatExponent--;
+    }
+    bits = sign | (floatExponent << 23) | ((mantissa & 0x3ff) << 13);
+  } else {
+    bits = sign;
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+/**
+ * @brief Pack a normal in the signed normalized 10_10_10_2 format read by
+ *        GL_INT_2_10_10_10_REV attributes: x in the lowest bits, w unused.
+ * @param x The x component, clamped to [-1, 1].
+ * @param y The y component, clamped to [-1, 1].
+ * @param z The z component, clamped to [-1, 1].
+ * @return The packed normal.
+ */
+uint32_t OkVertexLayout::packNormal(float x, float y, float z) {
+  auto component = [](float value) {
+    float   clamped   = std::min(std::max(value, -1.0f), 1.0f);
+    int32_t quantized = static_cast<int32_t>(std::lround(clamped * 511.0f));
+    return static_cast<uint32_t>(quantized) & 0x3ff;
+  };
+  return component(x) | (component(y) << 10) | (component(z) << 20);
+}
+
+/**
+ * @brief Unpack a normal packed by packNormal.
+ * @param packed The packed normal.
+ * @param normal Receives the 3 components, in [-1, 1].
+ */
+void OkVertexLayout::unpackNormal(uint32_t packed, float *normal) {
+  for (int i = 0; i < 3; i++) {
+    // Sign extend the 10-bit component
+    int32_t component = static_cast<int32_t>((packed >> (i * 10)) & 0x3ff);
+    if (component & 0x200) {
+      component -= 0x400;
+    }
+    normal[i] = std::max(static_cast<float>(component) / 511.0f, -1.0f);
+  }
+}
@@ -0,0 +1,76 @@
+#ifndef OK_LAYOUT_HPP
+#define OK_LAYOUT_HPP
+
+#include "../core/gl_config.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Storage of the texture coordinates of a vertex
+enum class OkTexcoordFormat : uint8_t {
+  None,   // No texture coordinates
+  Float,  // 2 floats
+  Half    // 2 half floats
+};
+
+// Storage of the normal of a vertex
+enum class OkNormalFormat : uint8_t {
+  None,   // No normal
+  Float,  // 3 floats
+  Packed  // Signed normalized 10_10_10_2 in one 32-bit word
+};
+
+/**
+ * @brief Description of the interleaved vertices of a mesh: a float
+ *        position, then the optional texture coordinates and normal in their
+ *        storage formats. Attributes use locations 0 (position),
+ *        1 (texture coordinates) and 2 (normal).
+ *        Source vertices are floats: position, texture coordinates and, when
+ *        the source stride allows it, the normal.
+ */
+struct OkVertexLayout {
+  OkTexcoordFormat texcoords;
+  OkNormalFormat   normals;
+
+  // Position and float texture coordinates, the 5-float vertices
+  static OkVertexLayout standard();
+
+  // Sizes and offsets in bytes
+  size_t getStride() const;
+  size_t getTexcoordOffset() const { return 3 * sizeof(float); }
+  size_t getNormalOffset() const;
+
+  // Set the attribute pointers of the bound vertex array and buffer
+  void setAttributes() const;
+
+  // Convert source vertices to this layout
+  void pack(const float *source, int sourceStride, size_t vertexCount,
+            unsigned char *destination) const;
+
+  // Convert vertices of this layout back to 8-float vertices
+  void unpack(const unsigned char *source, size_t vertexCount,
+              float *destination) const;
+
+  // Encoding stored in binary mesh files
+  uint32_t    encode() const;
+  static bool decode(uint32_t value, OkVertexLayout &layout);
+
+  bool operator==(const OkVertexLayout &other) const {
+    return texcoords == other.texcoords && normals == other.normals;
+  }
+  bool operator!=(const OkVertexLayout &other) const {
+    return !(*this == other);
+  }
+
+  // Attribute locations
+  static const GLuint positionAttribute = 0;
+  static const GLuint texcoordAttribute = 1;
+  static const GLuint normalAttribute   = 2;
+
+  // Conversions used by the packed formats
+  static uint16_t floatToHalf(float value);
+  static float    halfToFloat(uint16_t value);
+  static uint32_t packNormal(float x, float y, float z);
+  static void     unpackNormal(uint32_t packed, float *normal);
+};
+
+#endif
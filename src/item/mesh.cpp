@@ -0,0 +1,407 @@
+#include "mesh.hpp"
+#include "../core/gl_config.hpp"
+#include "../core/gl_state.hpp"
+#include "../handlers/geometry.hpp"
+#include "../render/queue.hpp"
+#include "../utils/files.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <utility>
+
+/**
+ * @brief Create a new mesh from 5-float vertices and indices.
+ *        The data is copied, and uploaded to GPU buffers.
+ * @param vertexData  The vertex data.
+ * @param vertexCount The number of floats in the vertex data.
+ * @param indexData   The index data.
+ * @param indexCount  The number of indices.
+ */
+OkMesh::OkMesh(const float *vertexData, long vertexCount,
+               const unsigned int *indexData, long indexCount)
+    : OkMesh(OkVertexLayout::standard(), vertexData, 5, vertexCount / 5,
+             indexData, indexCount) {}
+
+/**
+ * @brief Create a new mesh from float vertices, stored in a layout.
+ *        The vertices are converted to the layout, the indices are stored in
+ *        16 bits if possible, and both are uploaded to GPU buffers.
+ * @param vertexLayout The layout the vertices are stored in.
+ * @param vertexData   The vertex data: position, texture coordinates and
+ *                     optionally the normal, see OkVertexLayout::pack.
+ * @param vertexStride The number of floats per vertex in vertexData.
+ * @param vertexCount  The number of vertices.
+ * @param indexData    The index data.
+ * @param indexCount   The number of indices.
+ */
+OkMesh::OkMesh(const OkVertexLayout &vertexLayout, const float *vertexData,
+               int vertexStride, long vertexCount,
+               const unsigned int *indexData, long indexCount)
+    : layout(vertexLayout) {
+  VAO         = 0;
+  VBO         = 0;
+  EBO         = 0;
+  instanceVBO = 0;
+  allocation  = nullptr;
+
+  vertexStorage.resize(static_cast<size_t>(vertexCount) * layout.getStride());
+  layout.pack(vertexData, vertexStride, static_cast<size_t>(vertexCount),
+              vertexStorage.data());
+  vertices    = vertexStorage.data();
+  numVertices = vertexCount;
+
+  _storeIndices(indexData, indexCount);
+
+  _calculateRadius();
+
+  _initBuffers();
+}
+
+/**
+ * @brief Create a new mesh reading its data in place from a mapped file.
+ *        Nothing is copied: the data goes straight from the file mapping to
+ *        the GPU buffers, and the mapping is kept while the mesh exists.
+ * @param mappedFile   The mapped file holding the data.
+ * @param vertexLayout The layout of the vertices.
+ * @param vertexData   The vertex data, inside the file.
+ * @param vertexCount  The number of vertices.
+ * @param indexData    The index data, inside the file.
+ * @param type         GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ * @param indexCount   The number of indices.
+ * @param boundsCenter The center of the bounding box of the vertices.
+ * @param boundsRadius Half the diagonal of the bounding box.
+ */
+OkMesh::OkMesh(std::shared_ptr<const OkMappedFile> mappedFile,
+               const OkVertexLayout &vertexLayout, const void *vertexData,
+               long vertexCount, const void *indexData, GLenum type,
+               long indexCount, const glm::vec3 &boundsCenter,
+               float boundsRadius)
+    : layout(vertexLayout), file(std::move(mappedFile)) {
+  VAO         = 0;
+  VBO         = 0;
+  EBO         = 0;
+  instanceVBO = 0;
+  allocation  = nullptr;
+
+  vertices    = static_cast<const unsigned char *>(vertexData);
+  numVertices = vertexCount;
+  indices     = indexData;
+  indexType   = type;
+  numIndices  = indexCount;
+  center      = boundsCenter;
+  radius      = boundsRadius;
+
+  _initBuffers();
+}
+
+/**
+ * @brief Destructor for the OkMesh class.
+ *        Cleans up OpenGL objects, or gives back the ranges of a pooled
+ *        mesh. Owned data is freed with the mesh and mapped data with its
+ *        file.
+ */
+OkMesh::~OkMesh() {
+  if (allocation) {
+    OkGeometryPool::getInstance()->free(allocation);
+    return;
+  }
+
+  // Delete OpenGL objects
+  OkGLState::deleteVertexArray(VAO);
+  glDeleteBuffers(1, &VBO);
+  glDeleteBuffers(1, &EBO);
+  if (instanceVBO != 0) {
+    glDeleteBuffers(1, &instanceVBO);
+  }
+}
+
+/**
+ * @brief Store a copy of the indices, in 16 bits if every vertex can be
+ *        addressed with them, halving the index buffer.
+ * @param indexData  The index data.
+ * @param indexCount The number of indices.
+ */
+void OkMesh::_storeIndices(const unsigned int *indexData, long indexCount) {
+  numIndices = indexCount;
+
+  if (numVertices <= 65536) {
+    indexType = GL_UNSIGNED_SHORT;
+    indexStorage.resize(static_cast<size_t>(indexCount) * sizeof(uint16_t));
+    uint16_t *shortIndices = reinterpret_cast<uint16_t *>(indexStorage.data());
+    for (long i = 0; i < indexCount; i++) {
+      shortIndices[i] = static_cast<uint16_t>(indexData[i]);
+    }
+  } else {
+    indexType = GL_UNSIGNED_INT;
+    indexStorage.resize(static_cast<size_t>(indexCount) *
+                        sizeof(unsigned int));
+    std::memcpy(indexStorage.data(), indexData, indexStorage.size());
+  }
+
+  indices = indexStorage.data();
+}
+
+/**
+ * @brief Get the size of an index.
+ * @return 2 or 4 bytes, depending on the index type.
+ */
+size_t OkMesh::getIndexSize() const {
+  return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                        : sizeof(unsigned int);
+}
+
+/**
+ * @brief Get the position of a vertex.
+ * @param vertex The vertex index.
+ * @return The position, the first attribute of every layout.
+ */
+glm::vec3 OkMesh::getPosition(long vertex) const {
+  float position[3];
+  std::memcpy(position, vertices + vertex * layout.getStride(),
+              sizeof(position));
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
+/**
+ * @brief Get an index, whatever its stored size.
+ * @param index The position in the index buffer.
+ * @return The vertex index.
+ */
+unsigned int OkMesh::getIndex(long index) const {
+  if (indexType == GL_UNSIGNED_SHORT) {
+    return static_cast<const uint16_t *>(indices)[index];
+  }
+  return static_cast<const unsigned int *>(indices)[index];
+}
+
+/**
+ * @brief Initialize OpenGL buffers for the mesh.
+ *        With graphics.geometry-pool the geometry is stored in the shared
+ *        buffers of OkGeometryPool, and the mesh uses the vertex array of
+ *        its page. The pool keeps pointers to the data, which lives as long
+ *        as the mesh.
+ */
+void OkMesh::_initBuffers() {
+  if (OkGeometryPool::isEnabled()) {
+    OkGeometryPool *pool        = OkGeometryPool::getInstance();
+    size_t          vertexCount = static_cast<size_t>(numVertices);
+    size_t          indexCount  = static_cast<size_t>(numIndices);
+
+    allocation = pool->allocate(layout, indexType, vertices, vertexCount,
+                                indices, indexCount);
+    if (allocation) {
+      VAO = pool->getVAO(allocation);
+      return;
+    }
+  }
+
+  // Generate and bind VAO first
+  glGenVertexArrays(1, &VAO);
+  OkGLState::bindVertexArray(VAO);
+
+  // Generate and set up VBO
+  glGenBuffers(1, &VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER,
+               (GLsizeiptr)(numVertices * layout.getStride()), vertices,
+               GL_STATIC_DRAW);
+
+  // Position, texture coordinates and normal attributes
+  layout.setAttributes();
+
+  // Generate and set up EBO
+  glGenBuffers(1, &EBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               (GLsizeiptr)(numIndices * getIndexSize()), indices,
+               GL_STATIC_DRAW);
+
+  // Unbind VAO and VBO (but not EBO while VAO is active)
+  // Unbind VAO first, then VBO and EBO
+  // You can unbind the VAO afterwards so other VAO calls won't accidentally
+  // modify this VAO, but this rarely happens. Modifying other VAOs requires a
+  // call to glBindVertexArray anyways so we generally don't unbind VAOs (nor
+  // VBOs) when it's not directly necessary.
+  OkGLState::bindVertexArray(0);
+
+  // note that this is allowed, the call to glVertexAttribPointer registered
+  // VBO as the vertex attribute's bound vertex buffer object so afterwards we
+  // can safely unbind
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Get the instance buffer of the mesh, creating it on the first call.
+ *        The buffer holds one OkInstance per instance. Its world matrix is a
+ *        mat4 attribute taking four consecutive locations, one per column,
+ *        followed by the texture layer, all advancing once per instance.
+ *        Its content is streamed by every instanced draw. Pooled meshes
+ *        share the buffer of their page.
+ * @return The instance buffer name.
+ */
+GLuint OkMesh::getInstanceBuffer() {
+  if (allocation) {
+    return OkGeometryPool::getInstance()->getInstanceBuffer(allocation);
+  }
+  if (instanceVBO != 0) {
+    return instanceVBO;
+  }
+
+  glGenBuffers(1, &instanceVBO);
+
+  OkGLState::bindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  setInstanceAttributes();
+
+  OkGLState::bindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  return instanceVBO;
+}
+
+/**
+ * @brief Set the per-instance attributes of the bound vertex array, read
+ *        from the bound instance buffer.
+ */
+void OkMesh::setInstanceAttributes() {
+  for (GLuint column = 0; column < 4; column++) {
+    GLuint location = instanceAttribute + column;
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(OkInstance),
+                          (GLvoid *)(column * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);
+  }
+
+  glVertexAttribPointer(layerAttribute, 1, GL_FLOAT, GL_FALSE,
+                        sizeof(OkInstance),
+                        (GLvoid *)offsetof(OkInstance, layer));
+  glEnableVertexAttribArray(layerAttribute);
+  glVertexAttribDivisor(layerAttribute, 1);
+}
+
+/**
+ * @brief Get the base vertex of the draws of the mesh.
+ * @return The first vertex of the mesh in its pool page, 0 if not pooled.
+ */
+GLint OkMesh::getBaseVertex() const {
+  return allocation ? static_cast<GLint>(allocation->firstVertex) : 0;
+}
+
+/**
+ * @brief Get the byte offset of the indices of the mesh in its index
+ *        buffer.
+ * @return The offset, 0 if not pooled.
+ */
+GLintptr OkMesh::getIndexOffset() const {
+  return allocation ? OkGeometryPool::getInstance()->getIndexOffset(allocation)
+                    : 0;
+}
+
+/**
+ * @brief Calculate the radius of the mesh based on its vertices.
+ * @note  The radius is half the diagonal of the bounding box, so the sphere
+ *        around the center of the box contains every vertex.
+ */
+void OkMesh::_calculateRadius() {
+
+  // Return early if no vertices
+  if (numVertices <= 0 || !vertices) {
+    radius = 0.0f;
+    center = glm::vec3(0.0f);
+    OkLogger::warning("Mesh", "No vertices to calculate radius");
+    return;
+  }
+
+  glm::vec3 first = getPosition(0);
+  float     minX  = first.x;
+  float     maxX  = first.x;
+  float     minY  = first.y;
+  float     maxY  = first.y;
+  float     minZ  = first.z;
+  float     maxZ  = first.z;
+
+  for (long i = 1; i < numVertices; i++) {
+    glm::vec3 position = getPosition(i);
+
+    minX = std::min(minX, position.x);
+    maxX = std::max(maxX, position.x);
+    minY = std::min(minY, position.y);
+    maxY = std::max(maxY, position.y);
+    minZ = std::min(minZ, position.z);
+    maxZ = std::max(maxZ, position.z);
+  }
+
+  float width  = maxX - minX;
+  float height = maxY - minY;
+  float depth  = maxZ - minZ;
+  // Calculate radius as half the diagonal of the bounding box
+  radius = sqrt(width * width + height * height + depth * depth) * 0.5f;
+  center = glm::vec3(minX + maxX, minY + maxY, minZ + maxZ) * 0.5f;
+
+  OkLogger::info("Mesh",
+                 "Bounds: (" + std::to_string(minX) + ", " +
+                     std::to_string(minY) + ", " + std::to_string(minZ) +
+                     ") to (" + std::to_string(maxX) + ", " +
+                     std::to_string(maxY) + ", " + std::to_string(maxZ) + ")");
+  OkLogger::info("Mesh", "Calculated radius: " + std::to_string(radius));
+}
+
+/**
+ * @brief Check if the mesh holds exactly the given geometry.
+ * @param vertexData  The vertex data.
+ * @param vertexCount The number of floats in the vertex data.
+ * @param indexData   The index data.
+ * @param indexCount  The number of indices.
+ * @return True if vertices and indices are identical.
+ */
+bool OkMesh::matches(const float *vertexData, long vertexCount,
+                     const unsigned int *indexData, long indexCount) const {
+  // The standard layout stores the 5-float vertices unchanged
+  if (layout != OkVertexLayout::standard() || vertexCount != numVertices * 5 ||
+      indexCount != numIndices) {
+    return false;
+  }
+
+  if (std::memcmp(vertices, vertexData, vertexCount * sizeof(float)) != 0) {
+    return false;
+  }
+  for (long i = 0; i < indexCount; i++) {
+    if (getIndex(i) != indexData[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Hash vertex and index data (64-bit FNV-1a over the raw bytes).
+ * @param vertexData  The vertex data.
+ * @param vertexCount The number of floats in the vertex data.
+ * @param indexData   The index data.
+ * @param indexCount  The number of indices.
+ * @return The content hash.
+ */
+uint64_t OkMesh::hash(const float *vertexData, long vertexCount,
+                      const unsigned int *indexData, long indexCount) {
+  const uint64_t prime = 1099511628211ULL;
+  uint64_t       value = 14695981039346656037ULL;
+
+  const unsigned char *bytes =
+      reinterpret_cast<const unsigned char *>(vertexData);
+  for (size_t i = 0; i < vertexCount * sizeof(float); i++) {
+    value = (value ^ bytes[i]) * prime;
+  }
+
+  bytes = reinterpret_cast<const unsigned char *>(indexData);
+  for (size_t i = 0; i < indexCount * sizeof(unsigned int); i++) {
+    value = (value ^ bytes[i]) * prime;
+  }
+
+  return value;
+}
@@ -0,0 +1,119 @@
+#ifndef OK_MESH_HPP
+#define OK_MESH_HPP
+
+#include "../core/gl_config.hpp"
+#include "../handlers/geometry.hpp"
+#include "layout.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+class OkMappedFile;
+
+/**
+ * @brief Geometry shared by any number of items.
+ *        It owns a single copy of the vertex and index data, both in memory
+ *        and in GPU buffers, or reads it in place from a mapped file. Meshes
+ *        are created and reference counted by OkMeshHandler.
+ *        Vertices are stored in the compact layout given at creation, 5
+ *        floats (position and texture coordinates) by default. Indices are
+ *        16-bit when the mesh has few enough vertices, 32-bit otherwise.
+ *        Instanced draws read a world matrix per instance from an instance
+ *        buffer, bound to attribute locations 3 to 6 of the vertex array.
+ *        With graphics.geometry-pool the GPU copy lives in the shared
+ *        buffers of OkGeometryPool, drawn with a base vertex and an index
+ *        offset.
+ */
+class OkMesh {
+private:
+  void _initBuffers();
+  void _calculateRadius();
+  void _storeIndices(const unsigned int *indexData, long indexCount);
+
+  // Geometry, as uploaded to the GPU
+  OkVertexLayout       layout;
+  const unsigned char *vertices;     // numVertices * stride bytes
+  const void          *indices;      // Of type indexType
+  long                 numVertices;  // Number of vertices
+  long                 numIndices;
+  GLenum               indexType;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  float                radius;     // Half the diagonal of the bounding box
+  glm::vec3            center;     // Center of the bounding box
+
+  // Owned data, empty when the data is read from a file
+  std::vector<unsigned char> vertexStorage;
+  std::vector<unsigned char> indexStorage;
+
+  // File holding the geometry, null when the mesh owns a copy
+  std::shared_ptr<const OkMappedFile> file;
+
+  // OpenGL objects
+  GLuint VAO, VBO, EBO;
+  GLuint instanceVBO;  // Per-instance world matrices, created on first use
+
+  // Ranges in the shared buffers of OkGeometryPool, null when the mesh owns
+  // its buffers
+  OkGeometryPool::Allocation *allocation;
+
+public:
+  // 5-float vertices, vertexCount is the number of floats
+  OkMesh(const float *vertexData, long vertexCount,
+         const unsigned int *indexData, long indexCount);
+  // Float vertices of vertexStride floats converted to a layout
+  OkMesh(const OkVertexLayout &vertexLayout, const float *vertexData,
+         int vertexStride, long vertexCount, const unsigned int *indexData,
+         long indexCount);
+  // Geometry and bounds read in place from a file kept mapped by the mesh
+  OkMesh(std::shared_ptr<const OkMappedFile> mappedFile,
+         const OkVertexLayout &vertexLayout, const void *vertexData,
+         long vertexCount, const void *indexData, GLenum type,
+         long indexCount, const glm::vec3 &boundsCenter, float boundsRadius);
+  ~OkMesh();
+
+  // Delete copy constructor and assignment
+  OkMesh(const OkMesh &)            = delete;
+  OkMesh &operator=(const OkMesh &) = delete;
+
+  // Getters
+  GLuint                getVAO() const { return VAO; }
+  const OkVertexLayout &getLayout() const { return layout; }
+  const unsigned char  *getVertexData() const { return vertices; }
+  const void           *getIndexData() const { return indices; }
+  long                  getVertexCount() const { return numVertices; }
+  long                  getIndexCount() const { return numIndices; }
+  GLenum                getIndexType() const { return indexType; }
+  size_t                getIndexSize() const;
+  float                 getRadius() const { return radius; }
+  const glm::vec3      &getCenter() const { return center; }
+  bool                  isPooled() const { return allocation != nullptr; }
+
+  // Place of the geometry in the buffers of the vertex array
+  GLint    getBaseVertex() const;
+  GLintptr getIndexOffset() const;
+
+  // Single elements, read from the stored data
+  glm::vec3    getPosition(long vertex) const;
+  unsigned int getIndex(long index) const;
+
+  // Instance buffer for instanced draws, created on the first call
+  GLuint getInstanceBuffer();
+
+  // Set the per-instance attributes of the bound vertex array and buffer
+  static void setInstanceAttributes();
+
+  // First attribute location of the per-instance world matrix, and location
+  // of the per-instance texture layer
+  static const GLuint instanceAttribute = 3;
+  static const GLuint layerAttribute    = 7;
+
+  // Content comparison and hashing of 5-float vertices, used to share
+  // identical geometry
+  bool matches(const float *vertexData, long vertexCount,
+               const unsigned int *indexData, long indexCount) const;
+  static uint64_t hash(const float *vertexData, long vertexCount,
+                       const unsigned int *indexData, long indexCount);
+};
+
+#endif
@@ -0,0 +1,473 @@
+#include "optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Marks empty slots and vertices not assigned yet
+static const unsigned int invalidIndex = ~0u;
+
+// Forsyth scoring parameters
+static const float cacheDecayPower   = 1.5f;
+static const float lastTriangleScore = 0.75f;
+static const float valenceBoostScale = 2.0f;
+static const float valenceBoostPower = 0.5f;
+
+/**
+ * @brief Hash the attributes of a vertex.
+ *        Negative zeros are hashed as zeros, as they compare equal.
+ * @param data   The attributes of the vertex.
+ * @param stride The number of floats per vertex.
+ * @return The hash.
+ */
+static uint32_t hashVertex(const float *data, int stride) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < stride; i++) {
+    float    value = data[i] == 0.0f ? 0.0f : data[i];
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    hash = (hash ^ bits) * 16777619u;
+    hash ^= hash >> 15;
+  }
+  return hash;
+}
+
+/**
+ * @brief Check if two vertices have the same attributes.
+ * @param a      The attributes of the first vertex.
+ * @param b      The attributes of the second vertex.
+ * @param stride The number of floats per vertex.
+ * @return True if all the attributes are equal.
+ */
+static bool sameVertex(const float *a, const float *b, int stride) {
+  for (int i = 0; i < stride; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Score of a vertex for the Forsyth reordering.
+ *        Vertices of the last triangle get a fixed score, the others decay
+ *        with their position in the cache. Vertices with few triangles left
+ *        are boosted, so that they are finished and leave no holes behind.
+ * @param cachePosition The position in the cache, or -1 if not cached.
+ * @param remaining     The number of triangles left using the vertex.
+ * @return The score of the vertex.
+ */
+static float vertexScore(int cachePosition, unsigned int remaining) {
+  if (remaining == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      score = lastTriangleScore;
+    } else {
+      float scale = 1.0f / static_cast<float>(OkMeshOptimizer::cacheSize - 3);
+      score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale,
+                       cacheDecayPower);
+    }
+  }
+
+  return score + valenceBoostScale * std::pow(static_cast<float>(remaining),
+                                              -valenceBoostPower);
+}
+
+/**
+ * @brief FIFO cache simulation, as done by the post-transform cache.
+ *        Entries are stamped with the time they entered the cache, so
+ *        resetting it is a matter of moving the time forward.
+ */
+struct OkCacheSimulation {
+  std::vector<size_t> stamps;
+  size_t              time;
+  size_t              size;
+
+  OkCacheSimulation(size_t vertexCount, size_t cacheSize)
+      : stamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+  // Returns the number of vertices of the triangle not in the cache
+  unsigned int triangle(const unsigned int *vertices) {
+    unsigned int misses = 0;
+    for (int i = 0; i < 3; i++) {
+      if (time - stamps[vertices[i]] > size) {
+        stamps[vertices[i]] = time++;
+        misses++;
+      }
+    }
+    return misses;
+  }
+
+  void reset() { time += size + 1; }
+};
+
+/**
+ * @brief Merge vertices with identical attributes.
+ *        Vertices are hashed by value in an open addressing table, so
+ *        duplicates with different indices in the source file are merged too.
+ *        The vertex array is compacted in place, keeping the order of the
+ *        first occurrences, and the indices are remapped.
+ * @param vertices The vertex attributes, stride floats per vertex.
+ * @param indices  The triangle indices.
+ * @param stride   The number of floats per vertex.
+ * @return The number of vertices after welding.
+ */
+size_t OkMeshOptimizer::weldVertices(std::vector<float>        &vertices,
+                                     std::vector<unsigned int> &indices,
+                                     int                        stride) {
+  size_t vertexCount = vertices.size() / stride;
+
+  size_t tableSize = 16;
+  while (tableSize < vertexCount * 2) {
+    tableSize *= 2;
+  }
+  size_t                    mask = tableSize - 1;
+  std::vector<unsigned int> table(tableSize, invalidIndex);
+  std::vector<unsigned int> remap(vertexCount);
+
+  size_t unique = 0;
+  for (size_t v = 0; v < vertexCount; v++) {
+    const float *data = &vertices[v * stride];
+    size_t       slot = hashVertex(data, stride) & mask;
+
+    while (true) {
+      unsigned int found = table[slot];
+      if (found == invalidIndex) {
+        // New vertex, compacted in place: unique never exceeds v
+        if (unique != v) {
+          std::memmove(&vertices[unique * stride], data,
+                       stride * sizeof(float));
+        }
+        table[slot] = static_cast<unsigned int>(unique);
+        remap[v]    = static_cast<unsigned int>(unique++);
+        break;
+      }
+      if (sameVertex(&vertices[found * stride], data, stride)) {
+        remap[v] = found;
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+  }
+
+  vertices.resize(unique * stride);
+  for (unsigned int &index : indices) {
+    index = remap[index];
+  }
+  return unique;
+}
+
+/**
+ * @brief Reorder triangles for the post-transform vertex cache.
+ *        This is Tom Forsyth's linear-speed algorithm: triangles are scored
+ *        by the cache position and remaining valence of their vertices, and
+ *        the best triangle using a cached vertex is emitted next. When no
+ *        cached vertex has triangles left, the next triangle in the original
+ *        order is taken.
+ * @param indices     The triangle indices, reordered in place.
+ * @param vertexCount The number of vertices referenced by the indices.
+ */
+void OkMeshOptimizer::optimizeVertexCache(std::vector<unsigned int> &indices,
+                                          size_t vertexCount) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Triangles using each vertex, in one array
+  std::vector<unsigned int> remaining(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++) {
+    remaining[indices[i]]++;
+  }
+  std::vector<size_t> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++) {
+    offsets[v + 1] = offsets[v] + remaining[v];
+  }
+  std::vector<unsigned int> adjacency(offsets[vertexCount]);
+  std::vector<size_t>       fill(offsets.begin(), offsets.end() - 1);
+  for (size_t t = 0; t < triangleCount; t++) {
+    for (int i = 0; i < 3; i++) {
+      adjacency[fill[indices[t * 3 + i]]++] = static_cast<unsigned int>(t);
+    }
+  }
+
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) {
+    vertexScores[v] = vertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangleScores(triangleCount);
+  for (size_t t = 0; t < triangleCount; t++) {
+    triangleScores[t] = vertexScores[indices[t * 3]] +
+                        vertexScores[indices[t * 3 + 1]] +
+                        vertexScores[indices[t * 3 + 2]];
+  }
+
+  std::vector<bool>         emitted(triangleCount, false);
+  std::vector<unsigned int> result;
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> newCache;
+  result.reserve(triangleCount * 3);
+  cache.reserve(cacheSize + 3);
+  newCache.reserve(cacheSize + 3);
+
+  size_t cacheLimit  = cacheSize;
+  size_t nextInOrder = 0;
+  long   best        = 0;
+  while (result.size() < triangleCount * 3) {
+    if (best < 0) {
+      while (emitted[nextInOrder]) {
+        nextInOrder++;
+      }
+      best = static_cast<long>(nextInOrder);
+    }
+
+    const unsigned int *triangle = &indices[best * 3];
+    emitted[best]                = true;
+    result.insert(result.end(), triangle, triangle + 3);
+
+    // Remove the triangle from the adjacency of its vertices
+    for (int i = 0; i < 3; i++) {
+      unsigned int  v     = triangle[i];
+      unsigned int *begin = &adjacency[offsets[v]];
+      unsigned int *end   = begin + remaining[v];
+      *std::find(begin, end, static_cast<unsigned int>(best)) = *(end - 1);
+      remaining[v]--;
+    }
+
+    // Move the vertices of the triangle to the front of the cache
+    newCache.assign(triangle, triangle + 3);
+    for (unsigned int v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        newCache.push_back(v);
+      }
+    }
+
+    // Update the scores of the vertices whose position changed, including
+    // those leaving the cache, and of their triangles
+    for (size_t i = 0; i < newCache.size(); i++) {
+      unsigned int v        = newCache[i];
+      int          position = i < cacheLimit ? static_cast<int>(i) : -1;
+      float        score    = vertexScore(position, remaining[v]);
+      float        delta    = score - vertexScores[v];
+
+      vertexScores[v] = score;
+      for (size_t a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+        triangleScores[adjacency[a]] += delta;
+      }
+    }
+    if (newCache.size() > cacheLimit) {
+      newCache.resize(cacheLimit);
+    }
+    cache.swap(newCache);
+
+    // The next triangle is the best one using a cached vertex
+    best            = -1;
+    float bestScore = -1.0f;
+    for (unsigned int v : cache) {
+      for (size_t a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+        unsigned int t = adjacency[a];
+        if (triangleScores[t] > bestScore) {
+          bestScore = triangleScores[t];
+          best      = t;
+        }
+      }
+    }
+  }
+
+  indices.swap(result);
+}
+
+/**
+ * @brief Reorder clusters of triangles to reduce overdraw.
+ *        Following Sander et al., the cache-ordered triangles are split into
+ *        clusters where the cache would be cold anyway, or where restarting
+ *        it keeps the cluster under threshold times its original cost. The
+ *        clusters facing away from the center of the mesh are then drawn
+ *        first, as they tend to occlude the others from most viewpoints.
+ * @param indices   The triangle indices, reordered in place.
+ * @param vertices  The vertex attributes, positions first.
+ * @param stride    The number of floats per vertex.
+ * @param threshold The maximum cache cost ratio allowed, 1.05 loses at most
+ *                  5% of the cache efficiency.
+ */
+void OkMeshOptimizer::optimizeOverdraw(std::vector<unsigned int> &indices,
+                                       const std::vector<float>  &vertices,
+                                       int stride, float threshold) {
+  size_t triangleCount = indices.size() / 3;
+  size_t vertexCount   = vertices.size() / stride;
+  if (triangleCount < 2) {
+    return;
+  }
+
+  // Hard boundaries, where the triangle misses all its vertices
+  std::vector<size_t> hardBoundaries;
+  OkCacheSimulation   cache(vertexCount, cacheSize);
+  for (size_t t = 0; t < triangleCount; t++) {
+    if (cache.triangle(&indices[t * 3]) == 3) {
+      hardBoundaries.push_back(t);
+    }
+  }
+  hardBoundaries.push_back(triangleCount);
+
+  // Soft boundaries inside each hard cluster
+  std::vector<size_t> clusters;
+  for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+    size_t start = hardBoundaries[h];
+    size_t end   = hardBoundaries[h + 1];
+
+    cache.reset();
+    size_t misses = 0;
+    for (size_t t = start; t < end; t++) {
+      misses += cache.triangle(&indices[t * 3]);
+    }
+    float limit = threshold * static_cast<float>(misses) /
+                  static_cast<float>(end - start);
+
+    clusters.push_back(start);
+    cache.reset();
+    misses = 0;
+    for (size_t t = start; t + 1 < end; t++) {
+      misses += cache.triangle(&indices[t * 3]);
+      float acmr = static_cast<float>(misses) /
+                   static_cast<float>(t + 1 - clusters.back());
+      if (acmr <= limit) {
+        clusters.push_back(t + 1);
+        cache.reset();
+        misses = 0;
+      }
+    }
+  }
+  clusters.push_back(triangleCount);
+
+  // Area weighted centroid and normal of each cluster, and of the mesh
+  size_t                 clusterCount = clusters.size() - 1;
+  std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+  std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+  std::vector<float>     areas(clusterCount, 0.0f);
+  glm::vec3              meshCentroid(0.0f);
+  float                  meshArea = 0.0f;
+
+  for (size_t c = 0; c < clusterCount; c++) {
+    for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+      const float *a = &vertices[indices[t * 3] * stride];
+      const float *b = &vertices[indices[t * 3 + 1] * stride];
+      const float *d = &vertices[indices[t * 3 + 2] * stride];
+      glm::vec3    p0(a[0], a[1], a[2]);
+      glm::vec3    p1(b[0], b[1], b[2]);
+      glm::vec3    p2(d[0], d[1], d[2]);
+
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float     area   = glm::length(normal);
+
+      centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+      normals[c] += normal;
+      areas[c] += area;
+    }
+    meshCentroid += centroids[c];
+    meshArea += areas[c];
+    if (areas[c] > 0.0f) {
+      centroids[c] /= areas[c];
+    }
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid /= meshArea;
+  }
+
+  std::vector<float>  keys(clusterCount, 0.0f);
+  std::vector<size_t> order(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++) {
+    float length = glm::length(normals[c]);
+    if (length > 0.0f) {
+      keys[c] = glm::dot(centroids[c] - meshCentroid, normals[c] / length);
+    }
+    order[c] = c;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+  std::vector<unsigned int> result;
+  result.reserve(indices.size());
+  for (size_t c : order) {
+    result.insert(result.end(), indices.begin() + clusters[c] * 3,
+                  indices.begin() + clusters[c + 1] * 3);
+  }
+  indices.swap(result);
+}
+
+/**
+ * @brief Reorder vertices in the order the indices first use them.
+ *        This keeps the vertex fetches of consecutive triangles close in
+ *        memory. Vertices not used by any triangle are dropped.
+ * @param vertices The vertex attributes, reordered in place.
+ * @param indices  The triangle indices, remapped in place.
+ * @param stride   The number of floats per vertex.
+ */
+void OkMeshOptimizer::optimizeVertexFetch(std::vector<float>        &vertices,
+                                          std::vector<unsigned int> &indices,
+                                          int                        stride) {
+  size_t                    vertexCount = vertices.size() / stride;
+  std::vector<unsigned int> remap(vertexCount, invalidIndex);
+  std::vector<float>        result;
+  result.reserve(vertices.size());
+
+  unsigned int next = 0;
+  for (unsigned int &index : indices) {
+    if (remap[index] == invalidIndex) {
+      remap[index] = next++;
+      result.insert(result.end(), vertices.begin() + index * stride,
+                    vertices.begin() + (index + 1) * stride);
+    }
+    index = remap[index];
+  }
+  vertices.swap(result);
+}
+
+/**
+ * @brief Run all the optimizations on a mesh.
+ * @param vertices          The vertex attributes, positions first.
+ * @param indices           The triangle indices.
+ * @param stride            The number of floats per vertex.
+ * @param overdrawThreshold The cache cost ratio allowed to reduce overdraw,
+ *                          1 or less keeps the cache order.
+ */
+void OkMeshOptimizer::optimize(std::vector<float>        &vertices,
+                               std::vector<unsigned int> &indices, int stride,
+                               float overdrawThreshold) {
+  size_t vertexCount = weldVertices(vertices, indices, stride);
+  optimizeVertexCache(indices, vertexCount);
+  if (overdrawThreshold > 1.0f) {
+    optimizeOverdraw(indices, vertices, stride, overdrawThreshold);
+  }
+  optimizeVertexFetch(vertices, indices, stride);
+}
+
+/**
+ * @brief Get the average cache miss ratio of an index buffer.
+ *        This is the number of vertices transformed per triangle with a FIFO
+ *        cache, between 0.5 for a perfect grid and 3 without any reuse.
+ * @param indices     The triangle indices.
+ * @param vertexCount The number of vertices referenced by the indices.
+ * @param cacheSize   The number of entries of the simulated cache.
+ * @return The average cache miss ratio, 0 if there are no triangles.
+ */
+float OkMeshOptimizer::getACMR(const std::vector<unsigned int> &indices,
+                               size_t vertexCount, int cacheSize) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return 0.0f;
+  }
+
+  OkCacheSimulation cache(vertexCount, cacheSize);
+  size_t            misses = 0;
+  for (size_t t = 0; t < triangleCount; t++) {
+    misses += cache.triangle(&indices[t * 3]);
+  }
+  return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
@@ -0,0 +1,49 @@
+#ifndef OK_OPTIMIZER_HPP
+#define OK_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Index and vertex buffer optimizations for indexed triangle meshes.
+ *        Vertices are arrays of stride floats. The passes are meant to run in
+ *        order: welding, vertex cache, overdraw and vertex fetch.
+ */
+class OkMeshOptimizer {
+public:
+  // Static class - no instantiation
+  OkMeshOptimizer() = delete;
+
+  // Merge vertices with identical attributes, returns the vertex count
+  static size_t weldVertices(std::vector<float>        &vertices,
+                             std::vector<unsigned int> &indices, int stride);
+
+  // Reorder triangles for the post-transform vertex cache (Forsyth)
+  static void optimizeVertexCache(std::vector<unsigned int> &indices,
+                                  size_t                     vertexCount);
+
+  // Reorder clusters of triangles so that outer ones are drawn first,
+  // keeping the cache efficiency within a threshold
+  static void optimizeOverdraw(std::vector<unsigned int> &indices,
+                               const std::vector<float>  &vertices, int stride,
+                               float threshold);
+
+  // Reorder vertices in the order they are first used
+  static void optimizeVertexFetch(std::vector<float>        &vertices,
+                                  std::vector<unsigned int> &indices,
+                                  int                        stride);
+
+  // Run all the passes, positions must be the first 3 floats of a vertex
+  static void optimize(std::vector<float>        &vertices,
+                       std::vector<unsigned int> &indices, int stride,
+                       float overdrawThreshold);
+
+  // Average number of vertices transformed per triangle with a FIFO cache
+  static float getACMR(const std::vector<unsigned int> &indices,
+                       size_t vertexCount, int cacheSize);
+
+  // Cache size the reordering is tuned for
+  static const int cacheSize = 32;
+};
+
+#endif
@@ -1,12 +1,175 @@
 #include "texture.hpp"
 #include "../core/gl_config.hpp"
+#include "../core/gl_state.hpp"
+#include "../handlers/streamer.hpp"
+#include "../importers/ktx2.hpp"
 #include "../utils/logger.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 // Include stb_image for image loading
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+namespace {
+/**
+ * @brief Get the pixel format and sized internal format of an image.
+ * @param channels       Number of color channels, 1 to 4.
+ * @param format         Output pixel format.
+ * @param internalFormat Output sized internal format.
+ */
+void getPixelFormat(int channels, GLenum &format, GLenum &internalFormat) {
+  switch (channels) {
+  case 1:
+    format         = GL_RED;
+    internalFormat = GL_R8;
+    break;
+  case 2:
+    format         = GL_RG;
+    internalFormat = GL_RG8;
+    break;
+  case 4:
+    format         = GL_RGBA;
+    internalFormat = GL_RGBA8;
+    break;
+  default:
+    format         = GL_RGB;
+    internalFormat = GL_RGB8;
+    break;
+  }
+}
+
+/**
+ * @brief Get the number of mipmap levels of an image, down to 1x1.
+ * @param width  Width of the image.
+ * @param height Height of the image.
+ * @return The number of levels, 0 for an empty image.
+ */
+int getFullLevels(int width, int height) {
+  int levels = 0;
+  for (int side = std::max(width, height); side > 0; side /= 2) {
+    levels++;
+  }
+  return levels;
+}
+
+/**
+ * @brief Get the size of the first mipmap levels of an image.
+ * @param width         Width of the image.
+ * @param height        Height of the image.
+ * @param bytesPerPixel Bytes per pixel.
+ * @param levels        The number of levels.
+ * @return The size in bytes.
+ */
+size_t getChainSize(int width, int height, size_t bytesPerPixel,
+                    int levels) {
+  size_t size = 0;
+  for (int level = 0; level < levels; level++) {
+    size += static_cast<size_t>(std::max(width >> level, 1)) *
+            std::max(height >> level, 1) * bytesPerPixel;
+  }
+  return size;
+}
+}  // namespace
+
+uint64_t OkTexture::frame = 0;
+
+/**
+ * @brief Get the width of a mipmap level.
+ * @param level The level, 0 being the full image.
+ * @return The width in pixels, at least 1.
+ */
+int OkMipChain::getLevelWidth(int level) const {
+  return std::max(width >> level, 1);
+}
+
+/**
+ * @brief Get the height of a mipmap level.
+ * @param level The level, 0 being the full image.
+ * @return The height in pixels, at least 1.
+ */
+int OkMipChain::getLevelHeight(int level) const {
+  return std::max(height >> level, 1);
+}
+
+/**
+ * @brief Get the size of the pixels of a mipmap level.
+ * @param level The level, 0 being the full image.
+ * @return The size in bytes.
+ */
+size_t OkMipChain::getLevelSize(int level) const {
+  return static_cast<size_t>(getLevelWidth(level)) * getLevelHeight(level) *
+         channels;
+}
+
+/**
+ * @brief Build the mipmap levels of an image.
+ *        Each level averages 2x2 pixels of the previous one, down to 1x1.
+ *        Levels have the sizes OpenGL expects, odd sizes are rounded down
+ *        and their last row or column is averaged with itself.
+ * @param data     The pixels of the image, tightly packed.
+ * @param width    The width of the image.
+ * @param height   The height of the image.
+ * @param channels The number of color channels.
+ * @return The image and its levels, empty if the image is invalid.
+ */
+OkMipChain OkMipChain::build(const unsigned char *data, int width, int height,
+                             int channels) {
+  OkMipChain chain;
+  if (!data || width <= 0 || height <= 0 || channels <= 0) {
+    return chain;
+  }
+
+  chain.width    = width;
+  chain.height   = height;
+  chain.channels = channels;
+
+  // Offsets of all the levels, then a single allocation
+  size_t total = 0;
+  for (int level = 0;; level++) {
+    chain.offsets.push_back(total);
+    total += chain.getLevelSize(level);
+    if (chain.getLevelWidth(level) == 1 && chain.getLevelHeight(level) == 1) {
+      break;
+    }
+  }
+  chain.pixels.resize(total);
+  std::copy(data, data + chain.getLevelSize(0), chain.pixels.begin());
+
+  for (int level = 1; level < chain.getLevels(); level++) {
+    const unsigned char *source = chain.getLevel(level - 1);
+    unsigned char       *target = chain.pixels.data() + chain.offsets[level];
+
+    int sourceWidth = chain.getLevelWidth(level - 1);
+    int sourceRows  = chain.getLevelHeight(level - 1);
+    int levelWidth  = chain.getLevelWidth(level);
+    int levelHeight = chain.getLevelHeight(level);
+
+    for (int y = 0; y < levelHeight; y++) {
+      int y0 = std::min(y * 2, sourceRows - 1);
+      int y1 = std::min(y * 2 + 1, sourceRows - 1);
+      for (int x = 0; x < levelWidth; x++) {
+        int x0 = std::min(x * 2, sourceWidth - 1);
+        int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+        for (int c = 0; c < channels; c++) {
+          int sum = source[(y0 * sourceWidth + x0) * channels + c] +
+                    source[(y0 * sourceWidth + x1) * channels + c] +
+                    source[(y1 * sourceWidth + x0) * channels + c] +
+                    source[(y1 * sourceWidth + x1) * channels + c];
+          target[(y * levelWidth + x) * channels + c] =
+              static_cast<unsigned char>((sum + 2) / 4);
+        }
+      }
+    }
+  }
+
+  return chain;
+}
+
 /**
  * @brief Constructor for the OkTexture class.
  *        Loads the texture from the specified path.
@@ -19,22 +182,46 @@ OkTexture::OkTexture(const std::string &path) {
   width      = 0;
   height     = 0;
   channels   = 0;
+  source     = path;
 
   OkLogger::info("Texture", "Loading texture: " + path);
 
+  // KTX2 files are uploaded as they are, or replaced by an image next to
+  // them when the driver lacks their format
+  std::string imagePath = path;
+  if (OkKtx2File::isKtx2(path)) {
+    OkCompressedImage image;
+    if (OkKtx2File::read(path, image)) {
+      OkKtx2File::queryFormats();
+      if (OkKtx2File::isSupported(image)) {
+        _upload(image);
+        return;
+      }
+    }
+
+    imagePath = OkKtx2File::getFallbackName(path);
+    if (imagePath.empty()) {
+      OkLogger::error("Texture", "No fallback image for texture: " + path);
+      return;
+    }
+    OkLogger::warning("Texture", "Loading " + imagePath + " instead of " +
+                                     path);
+  }
+
   // Load image data
   stbi_set_flip_vertically_on_load(true);
-  unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+  unsigned char *data =
+      stbi_load(imagePath.c_str(), &width, &height, &channels, 0);
 
   if (!data) {
-    OkLogger::error("Texture", "Failed to load texture: " + path + " (" +
+    OkLogger::error("Texture", "Failed to load texture: " + imagePath + " (" +
                                    std::string(stbi_failure_reason()) + ")");
     return;
   }
 
   // Create OpenGL texture
   glGenTextures(1, &id);
-  glBindTexture(GL_TEXTURE_2D, id);
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
 
   // Set texture parameters
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -52,7 +239,9 @@ OkTexture::OkTexture(const std::string &path) {
   // Free image data
   stbi_image_free(data);
 
-  loaded = true;
+  levelCount = getFullLevels(width, height);
+  memorySize = getChainSize(width, height, channels == 4 ? 4 : 3, levelCount);
+  loaded     = true;
 }
 
 /**
@@ -71,7 +260,7 @@ OkTexture::OkTexture(int width, int height, int channels) {
 
   // Create OpenGL texture
   glGenTextures(1, &id);
-  glBindTexture(GL_TEXTURE_2D, id);
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
 
   // Set texture parameters
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -99,7 +288,7 @@ OkTexture::OkTexture(const unsigned char *data, int width, int height,
 
   // Create OpenGL texture
   glGenTextures(1, &id);
-  glBindTexture(GL_TEXTURE_2D, id);
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
 
   // Set texture parameters
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -114,33 +303,351 @@ OkTexture::OkTexture(const unsigned char *data, int width, int height,
                format, GL_UNSIGNED_BYTE, data);
   glGenerateMipmap(GL_TEXTURE_2D);
 
+  levelCount = getFullLevels(width, height);
+  memorySize = getChainSize(width, height, channels == 4 ? 4 : 3, levelCount);
+  loaded     = true;
+}
+
+/**
+ * @brief Constructor for a texture streamed level by level.
+ *        Storage for every level is allocated now, the pixels are uploaded
+ *        by OkTextureStreamer over the next frames, smallest level first.
+ *        The texture is loaded once the smallest level is uploaded, and
+ *        sharpens as larger levels arrive.
+ * @param name The name of the texture, usually its file path.
+ * @param mips The image and its mipmap levels.
+ */
+OkTexture::OkTexture(const std::string &name, std::unique_ptr<OkMipChain> mips)
+    : path(name), loaded(false), id(0), width(0), height(0), channels(0) {
+  if (!mips || mips->getLevels() == 0) {
+    OkLogger::error("Texture", "No pixels to stream for texture: " + name);
+    return;
+  }
+
+  width    = mips->width;
+  height   = mips->height;
+  channels = mips->channels;
+
+  int levels = mips->getLevels();
+
+  glGenTextures(1, &id);
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  GLenum format;
+  GLenum internalFormat;
+  getPixelFormat(channels, format, internalFormat);
+
+#if defined(__APPLE__)
+  // OpenGL 4.1 has no immutable storage, allocate each level instead
+  for (int level = 0; level < levels; level++) {
+    glTexImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(internalFormat),
+                 mips->getLevelWidth(level), mips->getLevelHeight(level), 0,
+                 format, GL_UNSIGNED_BYTE, nullptr);
+  }
+#else
+  glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+#endif
+
+  // Only sample the levels uploaded so far
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+  levelCount  = levels;
+  memorySize  = getChainSize(width, height, channels, levels);
+  streamMips  = std::move(mips);
+  streamLevel = levels - 1;
+  streamRow   = 0;
+  OkTextureStreamer::getInstance()->add(this);
+}
+
+/**
+ * @brief Constructor for a texture uploaded as it is stored, compressed
+ *        blocks going straight to glCompressedTexImage2D without decoding.
+ * @param name  The name of the texture, usually its file path.
+ * @param image The image and its levels.
+ */
+OkTexture::OkTexture(const std::string &name, const OkCompressedImage &image)
+    : path(name), loaded(false), id(0), width(0), height(0), channels(0) {
+  _upload(image);
+}
+
+/**
+ * @brief Upload every level of an image as it is stored.
+ *        Images without mipmap levels get them generated if uncompressed,
+ *        and are sampled without mipmaps if compressed.
+ * @param image The image and its levels.
+ */
+void OkTexture::_upload(const OkCompressedImage &image) {
+  if (image.levels.empty()) {
+    OkLogger::error("Texture", "No pixels for texture: " + path);
+    return;
+  }
+
+  width      = image.width;
+  height     = image.height;
+  channels   = image.channels;
+  compressed = image.isCompressed();
+
+  int  levels   = static_cast<int>(image.levels.size());
+  bool generate = levels == 1 && !image.isCompressed();
+
+  glGenTextures(1, &id);
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  levels > 1 || generate ? GL_LINEAR_MIPMAP_LINEAR
+                                         : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  if (!generate) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (int level = 0; level < levels; level++) {
+    const OkCompressedImage::Level &pixels = image.levels[level];
+
+    int levelWidth  = std::max(width >> level, 1);
+    int levelHeight = std::max(height >> level, 1);
+
+    if (image.isCompressed()) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, level, image.format, levelWidth,
+                             levelHeight, 0,
+                             static_cast<GLsizei>(pixels.size), pixels.data);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(image.format),
+                   levelWidth, levelHeight, 0, image.pixelFormat,
+                   GL_UNSIGNED_BYTE, pixels.data);
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  // Generated levels take the size per pixel of the image
+  levelCount = levels;
+  memorySize = 0;
+  for (const OkCompressedImage::Level &pixels : image.levels) {
+    memorySize += pixels.size;
+  }
+  if (generate) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+    levelCount = getFullLevels(width, height);
+    memorySize = getChainSize(width, height,
+                              memorySize / (static_cast<size_t>(width) *
+                                            height),
+                              levelCount);
+  }
+
   loaded = true;
 }
 
+/**
+ * @brief Constructor for an array texture.
+ *        The level 0 of every texture is read back from the GPU and copied
+ *        to its layer, then the mipmap levels are generated. Textures must
+ *        be loaded, uncompressed, not arrays, and share their size and
+ *        number of channels.
+ * @param name     The name of the array texture.
+ * @param textures The textures, one per layer, in layer order.
+ */
+OkTexture::OkTexture(const std::string                    &name,
+                     const std::vector<const OkTexture *> &textures)
+    : path(name), loaded(false), id(0), width(0), height(0), channels(0) {
+  if (textures.empty() || !textures[0]) {
+    OkLogger::error("Texture", "No layers for array texture: " + name);
+    return;
+  }
+
+  const OkTexture *first = textures[0];
+  for (const OkTexture *texture : textures) {
+    if (!texture || !texture->isLoaded() || texture->isArray() ||
+        texture->isCompressed() || texture->isStreaming() ||
+        texture->getWidth() != first->getWidth() ||
+        texture->getHeight() != first->getHeight() ||
+        texture->getChannels() != first->getChannels()) {
+      OkLogger::error("Texture", "Layers of array texture " + name +
+                                     " differ in size or format");
+      return;
+    }
+  }
+
+  width    = first->getWidth();
+  height   = first->getHeight();
+  channels = first->getChannels();
+  target   = GL_TEXTURE_2D_ARRAY;
+  layers   = static_cast<int>(textures.size());
+
+  GLenum format;
+  GLenum internalFormat;
+  getPixelFormat(channels, format, internalFormat);
+
+  glGenTextures(1, &id);
+  OkGLState::bindTexture(GL_TEXTURE_2D_ARRAY, id);
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(internalFormat),
+               width, height, layers, 0, format, GL_UNSIGNED_BYTE, nullptr);
+
+  // Copy each texture through client memory, OpenGL 4.1 has no direct
+  // copy between textures
+  std::vector<unsigned char> pixels(static_cast<size_t>(width) * height *
+                                    channels);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (int layer = 0; layer < layers; layer++) {
+    OkGLState::bindTexture(GL_TEXTURE_2D, textures[layer]->getId());
+    glGetTexImage(GL_TEXTURE_2D, 0, format, GL_UNSIGNED_BYTE, pixels.data());
+
+    OkGLState::bindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+                    format, GL_UNSIGNED_BYTE, pixels.data());
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+  levelCount = getFullLevels(width, height);
+  memorySize = getChainSize(width, height, channels, levelCount) * layers;
+  loaded     = true;
+}
+
 /**
  * @brief Destructor for the OkTexture class.
  *        Cleans up the texture resources.
  */
 OkTexture::~OkTexture() {
-  if (loaded) {
-    glDeleteTextures(1, &id);
+  if (streamMips) {
+    OkTextureStreamer::getInstance()->remove(this);
   }
+  OkGLState::deleteTexture(id);
 }
 
 /**
  * @brief Binds the texture for rendering.
+ * @param unit The texture unit to bind the texture to.
  */
-void OkTexture::bind() const {
+void OkTexture::bind(int unit) const {
   if (loaded) {
-    glBindTexture(GL_TEXTURE_2D, id);
+    OkGLState::bindTexture(target, id, unit);
+    lastUsedFrame = frame;
   }
 }
 
 /**
- * @brief Unbinds the currently bound texture.
+ * @brief Free the largest mipmap levels of the texture, keeping the others.
+ *        The kept levels are read back and uploaded to a new texture object,
+ *        sampled as before, only blurrier. The smallest level is always
+ *        kept, and arrays and textures still streaming are left alone.
+ * @param count The number of levels to drop.
+ * @return The number of bytes freed.
  */
-void OkTexture::unbind() {
-  glBindTexture(GL_TEXTURE_2D, 0);
+size_t OkTexture::dropLevels(int count) {
+  count = std::min(count, levelCount - 1);
+  if (!loaded || count <= 0 || isArray() || streamMips) {
+    return 0;
+  }
+
+  OkCompressedImage image;
+  image.width    = std::max(width >> count, 1);
+  image.height   = std::max(height >> count, 1);
+  image.channels = channels;
+
+  GLint internalFormat = 0;
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT,
+                           &internalFormat);
+  image.format = static_cast<GLenum>(internalFormat);
+
+  GLenum sizedFormat;
+  getPixelFormat(channels, image.pixelFormat, sizedFormat);
+  if (compressed) {
+    image.pixelFormat = 0;
+  } else if (internalFormat == 0) {
+    image.format = sizedFormat;
+  }
+
+  // Read back the kept levels
+  std::vector<std::vector<unsigned char>> levels;
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  for (int level = count; level < levelCount; level++) {
+    std::vector<unsigned char> pixels;
+    if (compressed) {
+      GLint size = 0;
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, level,
+                               GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+      pixels.resize(static_cast<size_t>(std::max(size, 0)));
+      glGetCompressedTexImage(GL_TEXTURE_2D, level, pixels.data());
+    } else {
+      pixels.resize(static_cast<size_t>(std::max(width >> level, 1)) *
+                    std::max(height >> level, 1) * channels);
+      glGetTexImage(GL_TEXTURE_2D, level, image.pixelFormat, GL_UNSIGNED_BYTE,
+                    pixels.data());
+    }
+    levels.push_back(std::move(pixels));
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+  for (const std::vector<unsigned char> &pixels : levels) {
+    image.levels.push_back({pixels.data(), pixels.size()});
+  }
+
+  GLuint previous = id;
+  size_t before   = memorySize;
+  int    dropped  = topLevel + count;
+  id              = 0;
+  loaded          = false;
+  _upload(image);
+  topLevel = dropped;
+  OkGLState::deleteTexture(previous);
+
+  return before > memorySize ? before - memorySize : 0;
+}
+
+/**
+ * @brief Take the texture object of a texture loaded again from the source
+ *        file, bringing back the dropped levels.
+ * @param reloaded The reloaded texture, left empty.
+ * @return True if the texture was replaced.
+ */
+bool OkTexture::restore(OkTexture &reloaded) {
+  if (!reloaded.loaded || reloaded.isArray() || reloaded.streamMips) {
+    return false;
+  }
+
+  OkGLState::deleteTexture(id);
+  id         = reloaded.id;
+  width      = reloaded.width;
+  height     = reloaded.height;
+  channels   = reloaded.channels;
+  compressed = reloaded.compressed;
+  levelCount = reloaded.levelCount;
+  memorySize = reloaded.memorySize;
+  topLevel   = 0;
+  loaded     = true;
+
+  reloaded.id         = 0;
+  reloaded.loaded     = false;
+  reloaded.memorySize = 0;
+  return true;
+}
+
+/**
+ * @brief Unbinds the texture bound to a texture unit.
+ * @param unit The texture unit.
+ */
+void OkTexture::unbind(int unit) {
+  OkGLState::bindTexture(GL_TEXTURE_2D, 0, unit);
 }
 
 /**
@@ -167,11 +674,93 @@ bool OkTexture::createFromRawData(const unsigned char *data, int width,
     glGenTextures(1, &id);
   }
 
-  glBindTexture(GL_TEXTURE_2D, id);
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
   glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), width,
                height, 0, format, GL_UNSIGNED_BYTE, data);
   glGenerateMipmap(GL_TEXTURE_2D);
 
-  loaded = true;
+  levelCount = getFullLevels(width, height);
+  memorySize = getChainSize(width, height, channels, levelCount);
+  loaded     = true;
   return true;
 }
+
+/**
+ * @brief Get the size of a row of the next level to stream.
+ * @return The size in bytes, 0 if the texture is not streaming.
+ */
+size_t OkTexture::getStreamRowSize() const {
+  if (!streamMips) {
+    return 0;
+  }
+  return static_cast<size_t>(streamMips->getLevelWidth(streamLevel)) *
+         channels;
+}
+
+/**
+ * @brief Upload the next rows of the level being streamed.
+ *        The rows are copied to the pixel buffer bound to
+ *        GL_PIXEL_UNPACK_BUFFER, which must have been orphaned this frame, and
+ *        copied from there to the texture by the GPU. Levels are uploaded
+ *        from the smallest, and each one is sampled once complete.
+ * @param offset Offset in the pixel buffer of the free space.
+ * @param space  Size of the free space in bytes.
+ * @return The number of bytes uploaded, 0 if not a single row fits.
+ */
+size_t OkTexture::stream(size_t offset, size_t space) {
+  size_t rowSize = getStreamRowSize();
+  if (rowSize == 0 || space < rowSize) {
+    return 0;
+  }
+
+  int    levelWidth  = streamMips->getLevelWidth(streamLevel);
+  int    levelHeight = streamMips->getLevelHeight(streamLevel);
+  int    rows        = std::min(levelHeight - streamRow,
+                                static_cast<int>(space / rowSize));
+  size_t size        = rows * rowSize;
+
+  const unsigned char *pixels =
+      streamMips->getLevel(streamLevel) + streamRow * rowSize;
+
+  GLenum format;
+  GLenum internalFormat;
+  getPixelFormat(channels, format, internalFormat);
+  OkGLState::bindTexture(GL_TEXTURE_2D, id);
+
+  void *mapped = glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(offset),
+      static_cast<GLsizeiptr>(size),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT);
+  if (mapped) {
+    std::copy(pixels, pixels + size, static_cast<unsigned char *>(mapped));
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glTexSubImage2D(GL_TEXTURE_2D, streamLevel, 0, streamRow, levelWidth, rows,
+                    format, GL_UNSIGNED_BYTE,
+                    reinterpret_cast<const void *>(offset));
+  } else {
+    // The buffer could not be mapped, upload from the client memory
+    GLint buffer = 0;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, streamLevel, 0, streamRow, levelWidth, rows,
+                    format, GL_UNSIGNED_BYTE, pixels);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, static_cast<GLuint>(buffer));
+  }
+
+  // A complete level can be sampled
+  streamRow += rows;
+  if (streamRow == levelHeight) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, streamLevel);
+    loaded    = true;
+    streamRow = 0;
+    streamLevel--;
+
+    if (streamLevel < 0) {
+      streamMips = nullptr;
+      OkLogger::info("Texture", "Streamed texture: " + path);
+    }
+  }
+
+  return size;
+}
@@ -2,7 +2,62 @@
 #define OK_TEXTURE_HPP
 
 #include "../core/gl_config.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
+
+/**
+ * @brief Pixels of an image and of all its mipmap levels, tightly packed,
+ *        level 0 first. Built off the main thread, then streamed to a texture.
+ */
+struct OkMipChain {
+  int                        width    = 0;
+  int                        height   = 0;
+  int                        channels = 0;
+  std::vector<unsigned char> pixels;
+  std::vector<size_t>        offsets;  // Start of each level in pixels
+
+  int    getLevels() const { return static_cast<int>(offsets.size()); }
+  int    getLevelWidth(int level) const;
+  int    getLevelHeight(int level) const;
+  size_t getLevelSize(int level) const;
+
+  const unsigned char *getLevel(int level) const {
+    return pixels.data() + offsets[level];
+  }
+
+  // Downsample an image with a box filter down to 1x1
+  static OkMipChain build(const unsigned char *data, int width, int height,
+                          int channels);
+};
+
+class OkMappedFile;
+
+/**
+ * @brief Image whose mipmap levels are ready to upload as they are, usually
+ *        blocks of a compressed format read from a KTX2 file. The levels
+ *        point into the file, kept open by the image.
+ */
+struct OkCompressedImage {
+  // Pixels of one level
+  struct Level {
+    const unsigned char *data;
+    size_t               size;
+  };
+
+  GLenum             format      = 0;  // Internal format
+  GLenum             pixelFormat = 0;  // Pixel format, 0 if compressed
+  int                width       = 0;
+  int                height      = 0;
+  int                channels    = 0;
+  std::vector<Level> levels;  // Level 0 first
+
+  std::shared_ptr<const OkMappedFile> file;
+
+  bool isCompressed() const { return pixelFormat == 0; }
+};
 
 /**
  * @brief OkTexture class for loading and managing textures.
@@ -15,6 +70,27 @@ private:
   int         width;
   int         height;
   int         channels;
+  GLenum      target     = GL_TEXTURE_2D;  // GL_TEXTURE_2D_ARRAY for arrays
+  int         layers     = 1;
+  bool        compressed = false;
+
+  // Levels in video memory and their size, levels dropped to save it, and
+  // the file they are reloaded from
+  int         levelCount = 0;
+  int         topLevel   = 0;  // Level of the full image stored as level 0
+  size_t      memorySize = 0;
+  std::string source;
+
+  // Last frame the texture was bound
+  mutable uint64_t lastUsedFrame = 0;
+  static uint64_t  frame;
+
+  // Levels not uploaded yet, and next rows to upload, while streaming
+  std::unique_ptr<OkMipChain> streamMips;
+  int                         streamLevel = 0;
+  int                         streamRow   = 0;
+
+  void _upload(const OkCompressedImage &image);
 
 public:
   // Constructor loads the texture from file
@@ -26,6 +102,19 @@ public:
   // Constructor for creating and initializing texture from raw data
   OkTexture(const unsigned char *data, int width, int height, int channels);
 
+  // Constructor allocating all the levels of an image, whose pixels are then
+  // uploaded by OkTextureStreamer, smallest level first
+  OkTexture(const std::string &name, std::unique_ptr<OkMipChain> mips);
+
+  // Constructor uploading every level of an image as it is, compressed
+  // blocks included
+  OkTexture(const std::string &name, const OkCompressedImage &image);
+
+  // Constructor for an array texture holding a copy of other textures of
+  // the same size and format, one per layer
+  OkTexture(const std::string                    &name,
+            const std::vector<const OkTexture *> &textures);
+
   // Destructor handles cleanup
   ~OkTexture();
 
@@ -34,16 +123,45 @@ public:
   OkTexture &operator=(const OkTexture &) = delete;
 
   // Texture operations
-  void        bind() const;
-  static void unbind();
+  void        bind(int unit = 0) const;
+  static void unbind(int unit = 0);
   bool        isLoaded() const { return loaded; }
 
   // Getters
+  GLuint             getId() const { return id; }
   int                getWidth() const { return width; }
   int                getHeight() const { return height; }
   int                getChannels() const { return channels; }
+  GLenum             getTarget() const { return target; }
+  int                getLayers() const { return layers; }
+  bool               isArray() const { return target == GL_TEXTURE_2D_ARRAY; }
+  bool               isCompressed() const { return compressed; }
   const std::string &getPath() const { return path; }
 
+  // Video memory: bytes of the levels stored, and levels dropped to stay
+  // within a budget, which only a reload from the source file brings back
+  size_t getMemorySize() const { return memorySize; }
+  int    getLevelCount() const { return levelCount; }
+  int    getDroppedLevels() const { return topLevel; }
+  size_t dropLevels(int count);
+  bool   restore(OkTexture &reloaded);
+
+  // File the texture is reloaded from, empty if it has none
+  const std::string &getSource() const { return source; }
+  void setSource(const std::string &file) { source = file; }
+
+  // Frames counted by OkTextureHandler::update, and the last one the texture
+  // was bound in
+  static uint64_t getFrame() { return frame; }
+  static void     advanceFrame() { frame++; }
+  uint64_t        getLastUsedFrame() const { return lastUsedFrame; }
+
+  // Streaming: upload rows of the next level from the pixel buffer bound to
+  // GL_PIXEL_UNPACK_BUFFER, at an offset, within a number of bytes
+  bool   isStreaming() const { return streamMips != nullptr; }
+  size_t getStreamRowSize() const;
+  size_t stream(size_t offset, size_t space);
+
   // Create texture from raw data
   bool createFromRawData(const unsigned char *data, int width, int height,
                          GLenum format, GLenum internalFormat = GL_RGBA);
@@ -78,6 +78,16 @@ float OkPoint::distance(const OkPoint &destination) const {
   return glm::distance(v, destination.v);
 }
 
+/**
+ * @brief Linearly interpolate between this point and another one.
+ * @param target The point reached when t is 1.
+ * @param t      The interpolation factor.
+ * @return The interpolated point.
+ */
+OkPoint OkPoint::lerp(const OkPoint &target, float t) const {
+  return OkPoint(v + (target.v - v) * t);
+}
+
 /**
  * @brief Convert the point to a string representation.
  * @return A string representation of the point.
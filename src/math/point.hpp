@@ -35,6 +35,7 @@ public:
   float   magnitude() const;
   OkPoint normalize() const;
   float   distance(const OkPoint &destination) const;
+  OkPoint lerp(const OkPoint &target, float t) const;
 
   // Vector operations
   float   dot(const OkPoint &other) const;
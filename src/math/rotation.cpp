@@ -162,6 +162,25 @@ OkRotation OkRotation::combine(const OkRotation &other) const {
   return OkRotation(pitch, yaw, roll);
 }
 
+/**
+ * @brief Interpolate between this rotation and another one.
+ *        Each Euler angle is blended along the shortest arc, so a wrap from
+ *        pi to -pi does not spin the whole way around.
+ * @param target The rotation reached when t is 1.
+ * @param t      The interpolation factor.
+ * @return The interpolated rotation.
+ */
+OkRotation OkRotation::interpolate(const OkRotation &target, float t) const {
+  glm::vec3 delta = target.angles - angles;
+
+  for (int i = 0; i < 3; i++) {
+    delta[i] = std::remainder(delta[i], glm::two_pi<float>());
+  }
+
+  glm::vec3 result = angles + delta * t;
+  return OkRotation(result.x, result.y, result.z);
+}
+
 /**
  * @brief Equality operator to compare two rotations.
  * @param other The other rotation to compare with.
@@ -36,6 +36,7 @@ public:
   // Transform methods
   OkPoint    transformPoint(const OkPoint &point) const;
   OkRotation combine(const OkRotation &other) const;
+  OkRotation interpolate(const OkRotation &target, float t) const;
 
   // Operators
   OkRotation &operator=(const OkRotation &other) = default;
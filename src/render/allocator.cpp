@@ -0,0 +1,116 @@
+#include "allocator.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+
+/**
+ * @brief Constructor for the OkRangeAllocator class.
+ * @param capacity The number of units, all free.
+ */
+OkRangeAllocator::OkRangeAllocator(size_t capacity) {
+  reset(capacity);
+}
+
+/**
+ * @brief Free everything, with a new capacity.
+ * @param capacity The number of units.
+ */
+void OkRangeAllocator::reset(size_t capacity) {
+  this->capacity = capacity;
+  freeSize       = capacity;
+
+  ranges.clear();
+  if (capacity > 0) {
+    ranges[0] = capacity;
+  }
+}
+
+/**
+ * @brief Take a range from the first free range large enough.
+ *        Empty ranges always succeed, at offset 0, and take nothing.
+ * @param size   The number of units.
+ * @param offset Set to the offset of the range.
+ * @return True if the range was taken.
+ */
+bool OkRangeAllocator::allocate(size_t size, size_t &offset) {
+  if (size == 0) {
+    offset = 0;
+    return true;
+  }
+
+  for (std::map<size_t, size_t>::iterator it = ranges.begin();
+       it != ranges.end(); ++it) {
+    if (it->second < size) {
+      continue;
+    }
+
+    offset      = it->first;
+    size_t rest = it->second - size;
+    ranges.erase(it);
+    if (rest > 0) {
+      ranges[offset + size] = rest;
+    }
+
+    freeSize -= size;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Give back a range, merging it with the free ranges around it.
+ * @param offset The offset returned by allocate.
+ * @param size   The size given to allocate.
+ */
+void OkRangeAllocator::free(size_t offset, size_t size) {
+  if (size == 0) {
+    return;
+  }
+
+  freeSize += size;
+
+  // Merge with the next free range
+  std::map<size_t, size_t>::iterator next = ranges.lower_bound(offset);
+  if (next != ranges.end() && next->first == offset + size) {
+    size += next->second;
+    next  = ranges.erase(next);
+  }
+
+  // Merge with the previous free range
+  if (next != ranges.begin()) {
+    std::map<size_t, size_t>::iterator previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      previous->second += size;
+      return;
+    }
+  }
+
+  ranges.emplace_hint(next, offset, size);
+}
+
+/**
+ * @brief Get the size of the largest free range.
+ * @return The number of units.
+ */
+size_t OkRangeAllocator::getLargestFree() const {
+  size_t largest = 0;
+  for (const auto &range : ranges) {
+    largest = std::max(largest, range.second);
+  }
+  return largest;
+}
+
+/**
+ * @brief Get how scattered the free units are.
+ * @return The share of the free units outside the largest free range,
+ *         between 0 and 1.
+ */
+float OkRangeAllocator::getFragmentation() const {
+  if (freeSize == 0) {
+    return 0.0f;
+  }
+  return 1.0f - static_cast<float>(getLargestFree()) /
+                    static_cast<float>(freeSize);
+}
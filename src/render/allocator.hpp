@@ -0,0 +1,45 @@
+#ifndef OK_ALLOCATOR_HPP
+#define OK_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <map>
+
+/**
+ * @brief Offset allocator for ranges of a fixed-size buffer.
+ *        It only does the bookkeeping: free ranges are kept sorted by
+ *        offset, allocations take the first range large enough (so they
+ *        pack towards the start of the buffer), and freed ranges merge with
+ *        their free neighbours. Units are up to the caller, bytes, vertices
+ *        or indices.
+ */
+class OkRangeAllocator {
+public:
+  explicit OkRangeAllocator(size_t capacity = 0);
+
+  // Take size units, false if no free range is large enough
+  bool allocate(size_t size, size_t &offset);
+
+  // Give back a range taken by allocate
+  void free(size_t offset, size_t size);
+
+  // Free everything, with a new capacity
+  void reset(size_t capacity);
+
+  // Getters
+  size_t getCapacity() const { return capacity; }
+  size_t getFree() const { return freeSize; }
+  size_t getUsed() const { return capacity - freeSize; }
+  size_t getLargestFree() const;
+  size_t getRangeCount() const { return ranges.size(); }
+
+  // Share of the free units outside the largest free range, 0 when all the
+  // free units are contiguous
+  float getFragmentation() const;
+
+private:
+  std::map<size_t, size_t> ranges;  // Free ranges, size by offset
+  size_t                   capacity;
+  size_t                   freeSize;
+};
+
+#endif
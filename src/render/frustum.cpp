@@ -0,0 +1,201 @@
+#include "frustum.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Get an empty bound, for objects that draw nothing.
+ * @return The empty bound.
+ */
+OkBoundingSphere OkBoundingSphere::empty() {
+  return {glm::vec3(0.0f), -1.0f, false};
+}
+
+/**
+ * @brief Get an infinite bound, for objects of unknown extent.
+ * @return The infinite bound.
+ */
+OkBoundingSphere OkBoundingSphere::unbounded() {
+  return {glm::vec3(0.0f), 0.0f, true};
+}
+
+/**
+ * @brief Get a finite bound.
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ * @return The bound.
+ */
+OkBoundingSphere OkBoundingSphere::sphere(const glm::vec3 &center,
+                                          float            radius) {
+  return {center, std::max(radius, 0.0f), false};
+}
+
+/**
+ * @brief Grow this bound to contain another one.
+ *        The result is the smallest sphere containing both spheres.
+ * @param other The bound to add.
+ */
+void OkBoundingSphere::merge(const OkBoundingSphere &other) {
+  if (infinite || other.isEmpty()) {
+    return;
+  }
+  if (other.infinite || isEmpty()) {
+    *this = other;
+    return;
+  }
+
+  glm::vec3 offset   = other.center - center;
+  float     distance = glm::length(offset);
+
+  // One sphere already contains the other
+  if (distance + other.radius <= radius) {
+    return;
+  }
+  if (distance + radius <= other.radius) {
+    *this = other;
+    return;
+  }
+
+  float newRadius = (distance + radius + other.radius) * 0.5f;
+  center += offset * ((newRadius - radius) / distance);
+  radius = newRadius;
+}
+
+/**
+ * @brief Transform the bound by a matrix.
+ *        The radius is scaled by the largest axis scale of the matrix, so
+ *        the result stays conservative with non-uniform scaling.
+ * @param matrix The transformation matrix.
+ * @return The transformed bound.
+ */
+OkBoundingSphere OkBoundingSphere::transformed(const glm::mat4 &matrix) const {
+  if (infinite || isEmpty()) {
+    return *this;
+  }
+
+  float scaleX = glm::length(glm::vec3(matrix[0]));
+  float scaleY = glm::length(glm::vec3(matrix[1]));
+  float scaleZ = glm::length(glm::vec3(matrix[2]));
+  float scale  = std::max(scaleX, std::max(scaleY, scaleZ));
+
+  return sphere(glm::vec3(matrix * glm::vec4(center, 1.0f)), radius * scale);
+}
+
+/**
+ * @brief Check if the bound intersects a sphere.
+ * @param point    The center of the sphere.
+ * @param distance The radius of the sphere.
+ * @return True if both spheres overlap.
+ */
+bool OkBoundingSphere::intersects(const glm::vec3 &point,
+                                  float            distance) const {
+  if (infinite || isEmpty()) {
+    return false;
+  }
+
+  glm::vec3 offset = point - center;
+  float     reach  = radius + distance;
+  return glm::dot(offset, offset) <= reach * reach;
+}
+
+/**
+ * @brief Check if the bound is hit by a ray.
+ * @param origin    The origin of the ray.
+ * @param direction The direction of the ray, normalized.
+ * @param distance  Receives the distance to the first hit along the ray, 0
+ *                  if the origin is inside the sphere.
+ * @return True if the ray hits the sphere.
+ */
+bool OkBoundingSphere::intersectsRay(const glm::vec3 &origin,
+                                     const glm::vec3 &direction,
+                                     float           &distance) const {
+  if (infinite || isEmpty()) {
+    return false;
+  }
+
+  glm::vec3 offset  = center - origin;
+  float     along   = glm::dot(offset, direction);
+  float     away    = glm::dot(offset, offset) - along * along;
+  float     radius2 = radius * radius;
+
+  if (away > radius2) {
+    return false;
+  }
+
+  float half = std::sqrt(radius2 - away);
+  if (along + half < 0.0f) {
+    return false;  // Behind the origin
+  }
+
+  distance = std::max(along - half, 0.0f);
+  return true;
+}
+
+/**
+ * @brief Constructor for the OkFrustum class.
+ *        The frustum starts infinite, every plane accepts all points.
+ */
+OkFrustum::OkFrustum() {
+  for (int i = 0; i < planeCount; i++) {
+    planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  }
+}
+
+/**
+ * @brief Extract the frustum planes from a view-projection matrix.
+ *        Each plane is a sum or difference of the fourth row of the matrix
+ *        and one of the others (Gribb and Hartmann).
+ * @param viewProjection The projection matrix multiplied by the view matrix.
+ */
+void OkFrustum::extract(const glm::mat4 &viewProjection) {
+  // glm matrices are column major, build the rows
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                        viewProjection[2][i], viewProjection[3][i]);
+  }
+
+  planes[0] = rows[3] + rows[0];  // Left
+  planes[1] = rows[3] - rows[0];  // Right
+  planes[2] = rows[3] + rows[1];  // Bottom
+  planes[3] = rows[3] - rows[1];  // Top
+  planes[4] = rows[3] + rows[2];  // Near
+  planes[5] = rows[3] - rows[2];  // Far
+
+  for (int i = 0; i < planeCount; i++) {
+    float length = glm::length(glm::vec3(planes[i]));
+    if (length > 0.0f) {
+      planes[i] /= length;
+    }
+  }
+}
+
+/**
+ * @brief Test a bounding sphere against the frustum.
+ * @param bounds The bound, in world coordinates.
+ * @return Outside if the sphere is fully behind a plane, Inside if it is in
+ *         front of all of them, Intersecting otherwise. Infinite bounds are
+ *         always intersecting.
+ */
+OkCullResult OkFrustum::test(const OkBoundingSphere &bounds) const {
+  if (bounds.infinite) {
+    return OkCullResult::Intersecting;
+  }
+  if (bounds.isEmpty()) {
+    return OkCullResult::Outside;
+  }
+
+  OkCullResult result = OkCullResult::Inside;
+  for (int i = 0; i < planeCount; i++) {
+    float distance =
+        glm::dot(glm::vec3(planes[i]), bounds.center) + planes[i].w;
+    if (distance < -bounds.radius) {
+      return OkCullResult::Outside;
+    }
+    if (distance < bounds.radius) {
+      result = OkCullResult::Intersecting;
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,65 @@
+#ifndef OK_FRUSTUM_HPP
+#define OK_FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief Bounding sphere in world or local coordinates.
+ *        Besides a finite sphere, a bound can be empty (nothing is drawn) or
+ *        infinite (the extent is unknown, so it is never culled).
+ */
+struct OkBoundingSphere {
+  glm::vec3 center;
+  float     radius;    // Negative for an empty bound
+  bool      infinite;  // Always considered visible
+
+  static OkBoundingSphere empty();
+  static OkBoundingSphere unbounded();
+  static OkBoundingSphere sphere(const glm::vec3 &center, float radius);
+
+  bool isEmpty() const { return !infinite && radius < 0.0f; }
+
+  // Smallest sphere containing this one and another
+  void merge(const OkBoundingSphere &other);
+
+  // Sphere containing this one once transformed by a matrix
+  OkBoundingSphere transformed(const glm::mat4 &matrix) const;
+
+  // Intersection tests, always false for empty and infinite bounds
+  bool intersects(const glm::vec3 &point, float distance) const;
+  bool intersectsRay(const glm::vec3 &origin, const glm::vec3 &direction,
+                     float &distance) const;
+};
+
+// Result of a frustum test
+enum class OkCullResult {
+  Outside,      // Fully outside, can be skipped
+  Intersecting, // Partially inside, children must be tested
+  Inside        // Fully inside, children need no test
+};
+
+/**
+ * @brief View frustum as six planes, extracted from a view-projection
+ *        matrix. Plane normals point inside, and are normalized so plane
+ *        distances are in world units.
+ */
+class OkFrustum {
+public:
+  OkFrustum();
+
+  // Extract the planes from a projection * view matrix
+  void extract(const glm::mat4 &viewProjection);
+
+  // Test a bounding sphere against the six planes
+  OkCullResult test(const OkBoundingSphere &bounds) const;
+
+  const glm::vec4 &getPlane(int index) const { return planes[index]; }
+
+  // Left, right, bottom, top, near, far
+  static const int planeCount = 6;
+
+private:
+  glm::vec4 planes[planeCount];  // xyz normal, w distance
+};
+
+#endif
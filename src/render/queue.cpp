@@ -0,0 +1,483 @@
+#include "queue.hpp"
+#include "../config/config.hpp"
+#include "../core/camera.hpp"
+#include "../core/gl_config.hpp"
+#include "../core/gl_state.hpp"
+#include "../core/object.hpp"
+#include "../item/texture.hpp"
+#include "../shaders/program.hpp"
+#include "../shaders/variants.hpp"
+#include "../utils/logger.hpp"
+#include "uniforms.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utility>
+
+/**
+ * @brief Constructor for the OkRenderQueue class.
+ */
+OkRenderQueue::OkRenderQueue() {
+  program        = nullptr;
+  viewPosition   = glm::vec3(0.0f);
+  viewDistance   = 1.0f;
+  submittedCount = 0;
+  callCount      = 0;
+  culling        = false;
+  culledCount    = 0;
+  visibleCount   = 0;
+}
+
+/**
+ * @brief Start a new frame.
+ *        Packets added without a program use the given one, and depths are
+ *        measured from the camera position up to its far plane. Unless
+ *        graphics.frustum-culling is unset, the view frustum of the camera is
+ *        extracted for the objects to cull themselves.
+ * @param program The program used by default.
+ * @param camera  The camera the frame is drawn from (can be null).
+ */
+void OkRenderQueue::begin(OkShaderProgram *program, const OkCamera *camera) {
+  this->program = program;
+
+  if (camera) {
+    viewPosition = glm::vec3(camera->getRenderMatrix()[3]);
+    viewDistance = std::max(camera->getFar(), 1.0f);
+    culling      = OkConfig::getBool("graphics.frustum-culling");
+    if (culling) {
+      frustum.extract(camera->getProjection() * camera->getView());
+    }
+  } else {
+    viewPosition = glm::vec3(0.0f);
+    viewDistance = 1.0f;
+    culling      = false;
+  }
+
+  culledCount  = 0;
+  visibleCount = 0;
+
+  clear();
+}
+
+/**
+ * @brief Get the distance from the view to the origin of a world matrix.
+ * @param matrix The world matrix.
+ * @return The distance mapped to [0, 1], 1 being the far plane or further.
+ */
+float OkRenderQueue::_normalizedDepth(const glm::mat4 &matrix) const {
+  float distance = glm::length(glm::vec3(matrix[3]) - viewPosition);
+  return std::min(distance / viewDistance, 1.0f);
+}
+
+/**
+ * @brief Build the sort key of a packet.
+ *        Only the low bits of each object name are used, so two names may
+ *        share a key. That only affects how well draws are grouped, never
+ *        what gets drawn.
+ * @param pass    The draw pass.
+ * @param program The program name.
+ * @param texture The texture name, 0 if untextured.
+ * @param vao     The vertex array name.
+ * @param depth   The normalized depth, in [0, 1].
+ * @return The 64-bit sort key.
+ */
+uint64_t OkRenderQueue::makeKey(OkDrawPass pass, GLuint program,
+                                GLuint texture, GLuint vao, float depth) {
+  float    clamped = std::min(std::max(depth, 0.0f), 1.0f);
+  uint64_t key     = (static_cast<uint64_t>(pass) & 0xF) << 60;
+  key |= (static_cast<uint64_t>(program) & 0xFFF) << 48;
+  key |= (static_cast<uint64_t>(texture) & 0xFFFF) << 32;
+  key |= (static_cast<uint64_t>(vao) & 0xFFFF) << 16;
+  key |= static_cast<uint64_t>(clamped * 65535.0f);
+  return key;
+}
+
+/**
+ * @brief Check if two packets, consecutive in draw order, can be drawn by
+ *        one multi-draw call: same program, state and vertex array, and the
+ *        same object uniforms, which the draws of a call share.
+ * @param a The first packet.
+ * @param b The packet drawn after it.
+ * @return True if b can join the call of a.
+ */
+bool OkRenderQueue::canMerge(const OkDrawPacket &a, const OkDrawPacket &b) {
+  if (a.pass == OkDrawPass::Custom || a.pass == OkDrawPass::Debug ||
+      a.instanceCount > 0 || b.instanceCount > 0 || !a.matrix || !b.matrix) {
+    return false;
+  }
+  if (a.pass == OkDrawPass::Textured && a.texture != b.texture) {
+    return false;
+  }
+  return a.program == b.program && a.pass == b.pass && a.vao == b.vao &&
+         a.mode == b.mode && a.indexType == b.indexType &&
+         a.color == b.color && a.layer == b.layer && *a.matrix == *b.matrix;
+}
+
+/**
+ * @brief Get the shader features a packet is drawn with.
+ *        Flat and wireframe packets only differ in polygon mode, they share
+ *        the untextured variant.
+ * @param packet The packet.
+ * @return The features, OR-ed together, 0 for custom and debug packets.
+ */
+uint32_t OkRenderQueue::getFeatures(const OkDrawPacket &packet) {
+  uint32_t features = 0;
+  if (packet.pass == OkDrawPass::Textured && packet.texture) {
+    features |= OkShaderVariants::textured;
+    if (packet.texture->isArray()) {
+      features |= OkShaderVariants::textureArray;
+    }
+  }
+  if (packet.pass != OkDrawPass::Custom && packet.pass != OkDrawPass::Debug &&
+      packet.instanceCount > 0 && packet.instances) {
+    features |= OkShaderVariants::instanced;
+  }
+  return features;
+}
+
+/**
+ * @brief Get the object uniforms of a packet.
+ * @param packet The packet.
+ * @return The record, with an identity world matrix if the packet has none.
+ */
+OkObjectUniforms OkRenderQueue::getObjectUniforms(const OkDrawPacket &packet) {
+  OkObjectUniforms object = {};
+  object.model            = packet.matrix ? *packet.matrix : glm::mat4(1.0f);
+  object.color            = packet.color;
+  object.layer            = packet.layer;
+  return object;
+}
+
+/**
+ * @brief Set the world matrix and color of a custom draw.
+ *        Programs with the OkObject block get a new record in the object
+ *        uniform ring, others get their model and wireframeColor uniforms.
+ * @param program The program in use.
+ * @param model   The world matrix.
+ * @param color   The color of untextured draws.
+ */
+void OkRenderQueue::setObject(OkShaderProgram *program, const glm::mat4 &model,
+                              const glm::vec4 &color) {
+  if (program->hasBlock(OkUniformBlock::Object)) {
+    OkObjectUniforms object = {};
+    object.model            = model;
+    object.color            = color;
+
+    OkUniformBuffers *buffers = OkUniformBuffers::getInstance();
+    buffers->bindObject(buffers->writeObject(object));
+    return;
+  }
+
+  program->setMat4(OkUniform::Model, model);
+  program->setBool(OkUniform::HasTexture, false);
+  program->setVec4(OkUniform::WireframeColor, color);
+}
+
+/**
+ * @brief Add a draw packet to the queue.
+ *        The sort key is computed here from the packet state. Packets drawn
+ *        with a variant get the variant matching their features, so the
+ *        sort groups them by variant.
+ * @param packet The packet to add, the world matrix must stay valid until
+ *               the queue is flushed.
+ */
+void OkRenderQueue::add(const OkDrawPacket &packet) {
+  packets.push_back(packet);
+
+  OkDrawPacket &added = packets.back();
+  if (added.program == nullptr) {
+    added.program = program;
+  }
+  if (added.program && added.program->getVariants()) {
+    added.program = added.program->getVariant(getFeatures(added));
+  }
+
+  GLuint programId = added.program ? added.program->getId() : 0;
+  GLuint textureId = 0;
+  if (added.pass == OkDrawPass::Textured && added.texture) {
+    textureId = added.texture->getId();
+  }
+  float depth = added.matrix ? _normalizedDepth(*added.matrix) : 0.0f;
+
+  added.key = makeKey(added.pass, programId, textureId, added.vao, depth);
+}
+
+/**
+ * @brief Add a packet for an object that draws itself.
+ * @param object The object.
+ * @param pass   OkDrawPass::Custom to call its drawSelf, or OkDrawPass::Debug
+ *               to draw its origin axes.
+ */
+void OkRenderQueue::addCustom(OkObject *object, OkDrawPass pass) {
+  OkDrawPacket packet = {};
+  packet.pass         = pass;
+  packet.object       = object;
+  packet.matrix       = &object->getRenderMatrix();
+  add(packet);
+}
+
+/**
+ * @brief Sort the packets by key and submit them.
+ *        Only the keys are sorted, the packets stay in place. The object
+ *        uniforms of all the packets are written first, with a single upload.
+ *        Runs of packets that canMerge are drawn with one multi-draw call.
+ *        The queue is empty afterwards.
+ */
+void OkRenderQueue::flush() {
+  order.clear();
+  order.reserve(packets.size());
+  for (size_t i = 0; i < packets.size(); i++) {
+    order.emplace_back(packets[i].key, i);
+  }
+
+  // Pairs compare the index after the key, so equal keys keep their order
+  std::sort(order.begin(), order.end());
+
+  _writeObjects();
+
+  submittedCount = 0;
+  callCount      = 0;
+
+  const OkDrawPacket *previous = nullptr;
+  bool                reported = false;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    const OkDrawPacket &packet = packets[order[i].second];
+
+    if (packet.program == nullptr || !packet.program->isValid()) {
+      if (!reported) {
+        OkLogger::error("RenderQueue", "No shader program for draw packets");
+        reported = true;
+      }
+      continue;
+    }
+
+    packet.program->use();
+    if (previous && previous->program != packet.program) {
+      previous = nullptr;
+    }
+
+    size_t end = i + 1;
+    while (end < order.size() &&
+           canMerge(packet, packets[order[end].second])) {
+      end++;
+    }
+
+    if (end - i > 1) {
+      drawCounts.clear();
+      drawOffsets.clear();
+      drawBaseVertices.clear();
+      for (size_t j = i; j < end; j++) {
+        const OkDrawPacket &draw = packets[order[j].second];
+        drawCounts.push_back(draw.indexCount);
+        drawOffsets.push_back(reinterpret_cast<const void *>(draw.indexOffset));
+        drawBaseVertices.push_back(draw.baseVertex);
+      }
+
+      OkDrawPacket merged = packet;
+      merged.drawCount    = static_cast<GLsizei>(end - i);
+      merged.counts       = drawCounts.data();
+      merged.offsets      = drawOffsets.data();
+      merged.baseVertices = drawBaseVertices.data();
+      drawPacket(merged, packet.program, previous);
+    } else {
+      drawPacket(packet, packet.program, previous);
+    }
+    submittedCount += end - i;
+    callCount++;
+
+    // Custom draws may change any state, do not rely on it afterwards
+    i        = end - 1;
+    previous = &packets[order[i].second];
+    if (packet.pass == OkDrawPass::Custom || packet.pass == OkDrawPass::Debug) {
+      previous = nullptr;
+    }
+  }
+
+  packets.clear();
+}
+
+/**
+ * @brief Write the object uniforms of the sorted packets to the ring, in
+ *        draw order, for the packets drawn with the OkObject block.
+ */
+void OkRenderQueue::_writeObjects() {
+  objects.clear();
+  for (size_t i = 0; i < order.size(); i++) {
+    OkDrawPacket &packet = packets[order[i].second];
+    if (packet.pass == OkDrawPass::Custom || packet.pass == OkDrawPass::Debug ||
+        !packet.program || !packet.program->hasBlock(OkUniformBlock::Object)) {
+      continue;
+    }
+
+    packet.hasObjectUniforms = true;
+    packet.objectOffset      = static_cast<GLintptr>(objects.size());
+    objects.push_back(getObjectUniforms(packet));
+  }
+
+  if (objects.empty()) {
+    return;
+  }
+
+  // Offsets held the record index until the records were written
+  OkUniformBuffers *buffers = OkUniformBuffers::getInstance();
+  GLintptr          stride  = buffers->getObjectStride();
+  size_t            count   = objects.size();
+  GLintptr          first   = buffers->writeObjects(objects.data(), count);
+  for (size_t i = 0; i < order.size(); i++) {
+    OkDrawPacket &packet = packets[order[i].second];
+    if (packet.hasObjectUniforms) {
+      packet.objectOffset = first + packet.objectOffset * stride;
+      packet.objectEpoch  = buffers->getOrphanCount();
+    }
+  }
+}
+
+/**
+ * @brief Drop all the packets without drawing them.
+ */
+void OkRenderQueue::clear() {
+  packets.clear();
+}
+
+/**
+ * @brief Issue the draw call of a single packet.
+ *        Bindings go through the GL state cache, and when the previous
+ *        packet was drawn in the same pass with the same program, the
+ *        uniforms it already set are not sent again. Instanced packets stream
+ *        their world matrices to the instance buffer and issue a single
+ *        instanced draw, and merged packets a single multi-draw. Draws start
+ *        at the base vertex and index offset of the packet, so pooled meshes
+ *        share the vertex array of their page.
+ *        Array textures are bound to unit 1, with their layer per packet or
+ *        per instance.
+ *        When the program is a variant, the variant with the features of the
+ *        packet is bound first, and it is left bound afterwards. Variants
+ *        have the features compiled in and ignore the uniforms selecting
+ *        them.
+ *        Programs with the OkObject block read the world matrix, color and
+ *        layer from the record of the packet, written now if the packet was
+ *        not flushed by a queue or the ring was orphaned since.
+ * @param packet   The packet to draw.
+ * @param program  The program in use.
+ * @param previous The packet drawn right before with the same program, or
+ *                 nullptr if unknown.
+ */
+void OkRenderQueue::drawPacket(const OkDrawPacket &packet,
+                               OkShaderProgram    *program,
+                               const OkDrawPacket *previous) {
+  if (packet.pass == OkDrawPass::Custom) {
+    packet.object->drawSelf();
+    return;
+  }
+
+  if (packet.pass == OkDrawPass::Debug) {
+    packet.object->drawAxis();
+    return;
+  }
+
+  if (program->getVariants()) {
+    OkShaderProgram *variant = program->getVariant(getFeatures(packet));
+    if (variant == nullptr) {
+      return;  // Reported when the variant failed to build
+    }
+    if (variant != program) {
+      variant->use();
+      program  = variant;
+      previous = nullptr;
+    }
+  }
+
+  bool samePass  = previous && previous->pass == packet.pass;
+  bool instanced = packet.instanceCount > 0 && packet.instances &&
+                   (program->hasFeature(OkShaderVariants::instanced) ||
+                    program->hasUniform(OkUniform::Instanced));
+
+  OkUniformBuffers *buffers     = OkUniformBuffers::getInstance();
+  bool              objectBlock = program->hasBlock(OkUniformBlock::Object);
+  if (objectBlock) {
+    bool written = packet.hasObjectUniforms &&
+                   packet.objectEpoch == buffers->getOrphanCount();
+    buffers->bindObject(written
+                            ? packet.objectOffset
+                            : buffers->writeObject(getObjectUniforms(packet)));
+  }
+
+  if (!previous || (previous->instanceCount > 0) != instanced) {
+    program->setBool(OkUniform::Instanced, instanced);
+  }
+  if (!instanced && !objectBlock) {
+    program->setMat4(OkUniform::Model, *packet.matrix);
+  }
+  OkGLState::bindVertexArray(packet.vao);
+
+  if (packet.pass == OkDrawPass::Textured) {
+    // Array textures use their own unit, samplers of different types must
+    // not share one
+    bool array = packet.texture->isArray();
+    OkGLState::polygonMode(GL_FILL);
+    packet.texture->bind(array ? 1 : 0);
+
+    if (!samePass) {
+      program->setInt(OkUniform::Texture0, 0);
+      program->setInt(OkUniform::TextureArray, 1);
+      program->setBool(OkUniform::HasTexture, true);
+    }
+    if (!samePass || previous->texture->isArray() != array) {
+      program->setBool(OkUniform::HasTextureArray, array);
+    }
+    if (array && !instanced) {
+      program->setFloat(OkUniform::TextureLayer, packet.layer);
+    }
+  } else {
+    bool wireframe = packet.pass == OkDrawPass::Wireframe;
+    OkGLState::polygonMode(wireframe ? GL_LINE : GL_FILL);
+
+    if (!samePass) {
+      program->setBool(OkUniform::HasTexture, false);
+    }
+    if (!samePass || previous->color != packet.color) {
+      program->setVec4(OkUniform::WireframeColor, packet.color);
+    }
+  }
+
+  // Pooled meshes start at an offset of the shared buffers
+  const void *indices = reinterpret_cast<const void *>(packet.indexOffset);
+
+  if (instanced) {
+    // Orphan the buffer while streaming, so the driver does not wait for the
+    // draws still reading the previous content
+    GLsizeiptr size = packet.instanceCount * sizeof(OkInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, packet.instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, packet.instances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDrawElementsInstancedBaseVertex(packet.mode, packet.indexCount,
+                                      packet.indexType, indices,
+                                      packet.instanceCount, packet.baseVertex);
+  } else if (packet.instanceCount > 0 && packet.instances) {
+    // The program has no instanced path, draw the instances one by one
+    OkObjectUniforms object = getObjectUniforms(packet);
+    for (GLsizei i = 0; i < packet.instanceCount; i++) {
+      if (objectBlock) {
+        object.model = packet.instances[i].matrix;
+        object.layer = packet.instances[i].layer;
+        buffers->bindObject(buffers->writeObject(object));
+      } else {
+        program->setMat4(OkUniform::Model, packet.instances[i].matrix);
+        program->setFloat(OkUniform::TextureLayer, packet.instances[i].layer);
+      }
+      glDrawElementsBaseVertex(packet.mode, packet.indexCount,
+                               packet.indexType, indices, packet.baseVertex);
+    }
+  } else if (packet.drawCount > 1) {
+    glMultiDrawElementsBaseVertex(packet.mode, packet.counts, packet.indexType,
+                                  packet.offsets, packet.drawCount,
+                                  packet.baseVertices);
+  } else {
+    glDrawElementsBaseVertex(packet.mode, packet.indexCount, packet.indexType,
+                             indices, packet.baseVertex);
+  }
+}
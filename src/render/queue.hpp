@@ -0,0 +1,174 @@
+#ifndef OK_QUEUE_HPP
+#define OK_QUEUE_HPP
+
+#include "../core/gl_config.hpp"
+#include "frustum.hpp"
+#include "uniforms.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+class OkCamera;
+class OkObject;
+class OkShaderProgram;
+class OkTexture;
+
+// Draw passes, in submission order
+enum class OkDrawPass {
+  Textured,   // Filled, textured geometry
+  Flat,       // Filled geometry with a flat color
+  Wireframe,  // Geometry drawn as lines with a flat color
+  Custom,     // Objects that draw themselves in immediate mode
+  Debug       // Origin axes
+};
+
+// Per-instance data streamed for instanced draws
+struct OkInstance {
+  glm::mat4 matrix;  // World matrix
+  float     layer;   // Layer of an array texture
+};
+
+/**
+ * @brief A single draw, as emitted by the scene traversal.
+ *        It holds everything needed to issue the draw call, so the queue can
+ *        reorder draws freely.
+ */
+struct OkDrawPacket {
+  uint64_t         key;          // Sort key, built by the queue
+  OkDrawPass       pass;         // Pass the packet belongs to
+  OkShaderProgram *program;      // nullptr uses the queue program
+  GLuint           vao;          // Vertex array to draw
+  GLenum           mode;         // GL_TRIANGLES, GL_LINES, ...
+  GLsizei          indexCount;   // Number of indices to draw
+  GLenum           indexType;    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  GLint            baseVertex;   // First vertex of a pooled mesh
+  GLintptr         indexOffset;  // Byte offset of the first index
+  const OkTexture *texture;      // Texture for the textured pass
+  float            layer;        // Layer of an array texture
+  glm::vec4        color;        // Color for the flat and wireframe passes
+  const glm::mat4 *matrix;       // World matrix, valid until the flush
+  OkObject        *object;       // Object for custom and debug packets
+
+  // Instanced packets draw instanceCount copies, with their own world matrix
+  // and texture layer
+  GLsizei           instanceCount;   // 0 for a regular draw
+  const OkInstance *instances;       // Instance data, valid until the flush
+  GLuint            instanceBuffer;  // Buffer the instances are streamed to
+
+  // Record of the packet in the object uniform ring, written by the queue
+  // for programs with the OkObject block. It is lost if the ring is orphaned
+  // before the packet is drawn, and then written again
+  bool     hasObjectUniforms;  // False until written
+  GLintptr objectOffset;       // Offset of the record in the ring
+  size_t   objectEpoch;        // Orphan count of the ring when written
+
+  // Merged packets are drawn with a single multi-draw call, set by the queue
+  // for drawCount > 1, each draw with its own index range and base vertex
+  GLsizei            drawCount;     // 0 or 1 for a single draw
+  const GLsizei     *counts;        // Index counts of the draws
+  const void *const *offsets;       // Index offsets of the draws
+  const GLint       *baseVertices;  // Base vertices of the draws
+};
+
+/**
+ * @brief Render queue that sorts the draws of a frame by state.
+ *        The scene traversal adds draw packets, which are sorted by a 64-bit
+ *        key and submitted in one pass, so consecutive draws share the
+ *        program, texture and vertex array as much as possible.
+ *        Key layout, from the most significant bit:
+ *        pass (4) | program (12) | texture (16) | vertex array (16) |
+ *        depth (16, front to back)
+ *        Consecutive packets that differ only by their geometry in the same
+ *        vertex array, as pooled meshes do, are merged into one multi-draw
+ *        call. Without gl_DrawID in OpenGL 4.1 the draws of a call share the
+ *        object uniforms, so only packets with the same world matrix, color
+ *        and layer are merged.
+ */
+class OkRenderQueue {
+public:
+  OkRenderQueue();
+
+  // Delete copy constructor and assignment
+  OkRenderQueue(const OkRenderQueue &)            = delete;
+  OkRenderQueue &operator=(const OkRenderQueue &) = delete;
+
+  // Start a new frame drawn with a program from a camera
+  void begin(OkShaderProgram *program, const OkCamera *camera);
+
+  // Add packets
+  void add(const OkDrawPacket &packet);
+  void addCustom(OkObject *object, OkDrawPass pass = OkDrawPass::Custom);
+
+  // Sort and submit all the packets, then clear the queue
+  void flush();
+
+  // Drop all the packets without drawing them
+  void clear();
+
+  // Build a sort key
+  static uint64_t makeKey(OkDrawPass pass, GLuint program, GLuint texture,
+                          GLuint vao, float depth);
+
+  // Tell if two sorted packets can be drawn by one multi-draw call
+  static bool canMerge(const OkDrawPacket &a, const OkDrawPacket &b);
+
+  // Shader features a packet is drawn with, see OkShaderVariants
+  static uint32_t getFeatures(const OkDrawPacket &packet);
+
+  // Object uniforms of a packet
+  static OkObjectUniforms getObjectUniforms(const OkDrawPacket &packet);
+
+  // Set the world matrix and color of custom draws, through the OkObject
+  // block or the uniforms of programs without it. The program must be bound
+  static void setObject(OkShaderProgram *program, const glm::mat4 &model,
+                        const glm::vec4 &color);
+
+  // Issue a single packet, the program must be bound. Variants bind the
+  // variant of the packet instead. Instanced packets are drawn one instance
+  // at a time if the program has no instanced path
+  static void drawPacket(const OkDrawPacket &packet, OkShaderProgram *program,
+                         const OkDrawPacket *previous = nullptr);
+
+  // Frustum of the camera, when graphics.frustum-culling is set
+  bool             isCulling() const { return culling; }
+  const OkFrustum &getFrustum() const { return frustum; }
+
+  // Objects culled or submitted since the frame began
+  void countCulled(size_t count) { culledCount += count; }
+  void countVisible(size_t count) { visibleCount += count; }
+
+  // Getters
+  size_t getPacketCount() const { return packets.size(); }
+  size_t getSubmittedCount() const { return submittedCount; }
+  size_t getCallCount() const { return callCount; }
+  size_t getCulledCount() const { return culledCount; }
+  size_t getVisibleCount() const { return visibleCount; }
+
+private:
+  float _normalizedDepth(const glm::mat4 &matrix) const;
+  void  _writeObjects();
+
+  std::vector<OkDrawPacket>                 packets;
+  std::vector<std::pair<uint64_t, size_t>> order;    // Key and packet index
+  std::vector<OkObjectUniforms>            objects;  // Records of a flush
+
+  // Arrays of the current multi-draw call, reused for every call
+  std::vector<GLsizei>      drawCounts;
+  std::vector<const void *> drawOffsets;
+  std::vector<GLint>        drawBaseVertices;
+
+  OkShaderProgram *program;
+  glm::vec3        viewPosition;
+  float            viewDistance;    // Distance mapped to the farthest depth
+  size_t           submittedCount;  // Packets submitted by the last flush
+  size_t           callCount;       // Draw calls issued by the last flush
+
+  OkFrustum frustum;
+  bool      culling;
+  size_t    culledCount;   // Objects skipped by culling in this frame
+  size_t    visibleCount;  // Objects submitted in this frame
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "uniforms.hpp"
+#include "../config/config.hpp"
+#include "../core/gl_config.hpp"
+#include "../shaders/program.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <glm/glm.hpp>
+
+OkUniformBuffers *OkUniformBuffers::instance = nullptr;
+
+/**
+ * @brief Constructor for the OkUniformBuffers class.
+ *        This class is a singleton, its buffers are created with the first
+ *        upload.
+ */
+OkUniformBuffers::OkUniformBuffers()
+    : frameBuffer(0), objectBuffer(0), capacity(0), offset(0), alignment(0),
+      boundOffset(-1), orphanCount(0), frame(), hasFrame(false) {}
+
+/**
+ * @brief Destructor for the OkUniformBuffers class.
+ *        Releases the buffers.
+ */
+OkUniformBuffers::~OkUniformBuffers() {
+  cleanup();
+}
+
+/**
+ * @brief Get the singleton instance of the OkUniformBuffers.
+ *        This method creates the instance if it doesn't exist.
+ * @return Pointer to the OkUniformBuffers instance.
+ */
+OkUniformBuffers *OkUniformBuffers::getInstance() {
+  if (!instance) {
+    instance = new OkUniformBuffers();
+  }
+
+  return instance;
+}
+
+/**
+ * @brief Create the buffers and bind them to the binding points of their
+ *        blocks. The ring holds graphics.object-buffer-bytes.
+ */
+void OkUniformBuffers::_create() {
+  if (frameBuffer != 0) {
+    return;
+  }
+
+  GLint value = 256;  // Largest alignment drivers usually ask for
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+  alignment = static_cast<size_t>(std::max(value, 1));
+
+  capacity = static_cast<size_t>(
+      std::max(OkConfig::getInt("graphics.object-buffer-bytes"), 0));
+  capacity = std::max(capacity, getObjectStride());
+  offset   = 0;
+
+  glGenBuffers(1, &frameBuffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(OkFrameUniforms), nullptr,
+               GL_STREAM_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER,
+                   static_cast<GLuint>(OkUniformBlock::Frame), frameBuffer);
+
+  glGenBuffers(1, &objectBuffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr,
+               GL_STREAM_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  hasFrame    = false;
+  boundOffset = -1;
+}
+
+/**
+ * @brief Upload the camera data read by every program.
+ *        Nothing is uploaded if the camera did not change.
+ * @param view       The view matrix.
+ * @param projection The projection matrix.
+ */
+void OkUniformBuffers::setFrame(const glm::mat4 &view,
+                                const glm::mat4 &projection) {
+  _create();
+  if (hasFrame && frame.view == view && frame.projection == projection) {
+    return;
+  }
+
+  frame.view           = view;
+  frame.projection     = projection;
+  frame.viewProjection = projection * view;
+  frame.cameraPosition = glm::inverse(view)[3];
+  hasFrame             = true;
+
+  // Uploading the whole block orphans the previous one
+  glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(OkFrameUniforms), &frame,
+               GL_STREAM_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/**
+ * @brief Get the distance between records in the ring: the size of a
+ *        record rounded up to the offset alignment of uniform buffers.
+ * @return The stride in bytes.
+ */
+size_t OkUniformBuffers::getObjectStride() {
+  if (alignment == 0) {
+    _create();
+  }
+  return (sizeof(OkObjectUniforms) + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Write records to the free part of the ring with a single upload.
+ *        If they do not fit, the ring is orphaned and they are written from
+ *        its start, a ring too small for them grows to fit.
+ * @param objects The records.
+ * @param count   The number of records.
+ * @return The offset of the first record, the next ones follow every
+ *         getObjectStride() bytes.
+ */
+GLintptr OkUniformBuffers::writeObjects(const OkObjectUniforms *objects,
+                                        size_t                  count) {
+  _create();
+  if (count == 0) {
+    return static_cast<GLintptr>(offset);
+  }
+
+  size_t stride = getObjectStride();
+  size_t bytes  = count * stride;
+
+  glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+  if (offset + bytes > capacity) {
+    capacity = std::max(capacity, bytes);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(capacity),
+                 nullptr, GL_STREAM_DRAW);
+    offset      = 0;
+    boundOffset = -1;
+    orphanCount++;
+  }
+
+  // Records are padded to the alignment, so each one can be bound alone
+  const void *data = objects;
+  if (stride != sizeof(OkObjectUniforms)) {
+    staging.resize(bytes);
+    for (size_t i = 0; i < count; i++) {
+      std::memcpy(&staging[i * stride], &objects[i], sizeof(OkObjectUniforms));
+    }
+    data = staging.data();
+  }
+
+  GLintptr first = static_cast<GLintptr>(offset);
+  glBufferSubData(GL_UNIFORM_BUFFER, first, static_cast<GLsizeiptr>(bytes),
+                  data);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  offset += bytes;
+  return first;
+}
+
+/**
+ * @brief Bind a record of the ring to the OkObject block.
+ *        Binding the record already bound is skipped.
+ * @param offset The offset of the record, as returned by writeObjects.
+ */
+void OkUniformBuffers::bindObject(GLintptr offset) {
+  if (offset == boundOffset || objectBuffer == 0) {
+    return;
+  }
+
+  glBindBufferRange(GL_UNIFORM_BUFFER,
+                    static_cast<GLuint>(OkUniformBlock::Object), objectBuffer,
+                    offset, sizeof(OkObjectUniforms));
+  boundOffset = offset;
+}
+
+/**
+ * @brief Release the buffers. They are created again the next time they
+ *        are used. Must be called while the OpenGL context exists.
+ */
+void OkUniformBuffers::cleanup() {
+  if (frameBuffer != 0) {
+    glDeleteBuffers(1, &frameBuffer);
+    frameBuffer = 0;
+  }
+  if (objectBuffer != 0) {
+    glDeleteBuffers(1, &objectBuffer);
+    objectBuffer = 0;
+  }
+
+  capacity    = 0;
+  offset      = 0;
+  alignment   = 0;
+  boundOffset = -1;
+  hasFrame    = false;
+  staging.clear();
+}
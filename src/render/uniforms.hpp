@@ -0,0 +1,93 @@
+#ifndef OK_UNIFORMS_HPP
+#define OK_UNIFORMS_HPP
+
+#include "../core/gl_config.hpp"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+// OkFrame uniform block (std140), camera data shared by every program
+struct OkFrameUniforms {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+  glm::vec4 cameraPosition;  // World position, w is 1
+};
+
+// OkObject uniform block (std140), data of a single draw
+struct OkObjectUniforms {
+  glm::mat4 model;       // World matrix, unused by instanced draws
+  glm::vec4 color;       // Color of the flat and wireframe passes
+  float     layer;       // Layer of an array texture, if not instanced
+  float     padding[3];  // std140 rounds blocks up to 16 bytes
+};
+
+static_assert(sizeof(OkFrameUniforms) == 208, "OkFrame must match std140");
+static_assert(sizeof(OkObjectUniforms) == 96, "OkObject must match std140");
+
+/**
+ * @brief Uniform buffers shared by all the programs.
+ *        The camera is uploaded once per frame to the buffer bound to the
+ *        OkFrame block, so every program and variant reads it without
+ *        uploading it again. Per-object data goes to a ring buffer bound to
+ *        the OkObject block: records are written in bulk, once per frame by
+ *        the render queue, to the free part of the ring, and each draw binds
+ *        the range of its record. When the ring is full it is orphaned, the
+ *        draws still in flight keep reading the previous storage.
+ */
+class OkUniformBuffers {
+private:
+  GLuint   frameBuffer;   // OkFrame block
+  GLuint   objectBuffer;  // OkObject ring
+  size_t   capacity;      // Bytes of the ring
+  size_t   offset;        // First free byte of the ring
+  size_t   alignment;     // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  GLintptr boundOffset;   // Record bound to the OkObject block, -1 if none
+  size_t   orphanCount;   // Times the ring was full
+
+  OkFrameUniforms            frame;
+  bool                       hasFrame;
+  std::vector<unsigned char> staging;  // Records padded to the alignment
+
+  // Private constructor - singleton
+  OkUniformBuffers();
+
+  // Singleton instance
+  static OkUniformBuffers *instance;
+
+  void _create();
+
+public:
+  // Delete copy constructor and assignment
+  OkUniformBuffers(const OkUniformBuffers &)            = delete;
+  OkUniformBuffers &operator=(const OkUniformBuffers &) = delete;
+
+  // Get singleton instance
+  static OkUniformBuffers *getInstance();
+
+  // Main thread, once per frame: camera data of all the programs
+  void                   setFrame(const glm::mat4 &view,
+                                  const glm::mat4 &projection);
+  const OkFrameUniforms &getFrame() const { return frame; }
+
+  // Write records to the ring, contiguous and getObjectStride() apart,
+  // returns the offset of the first one
+  GLintptr writeObjects(const OkObjectUniforms *objects, size_t count);
+  GLintptr writeObject(const OkObjectUniforms &object) {
+    return writeObjects(&object, 1);
+  }
+
+  // Bind the record at an offset to the OkObject block
+  void bindObject(GLintptr offset);
+
+  // Getters
+  size_t getObjectStride();
+  size_t getCapacity() const { return capacity; }
+  size_t getOrphanCount() const { return orphanCount; }
+
+  // Cleanup: release the buffers, created again when used
+  void cleanup();
+  ~OkUniformBuffers();
+};
+
+#endif
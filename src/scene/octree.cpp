@@ -0,0 +1,524 @@
+#include "octree.hpp"
+#include "../core/object.hpp"
+#include "../render/frustum.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Constructor for the OkOctree class.
+ * @param center   The center of the root cube.
+ * @param halfSize Half the size of the root cube.
+ * @param maxDepth The maximum depth of the nodes, the root is at depth 0.
+ */
+OkOctree::OkOctree(const glm::vec3 &center, float halfSize, int maxDepth) {
+  this->maxDepth = std::max(maxDepth, 0);
+  indexedSize    = 0;
+
+  Node root;
+  root.center   = center;
+  root.halfSize = std::max(halfSize, 1.0f);
+  root.depth    = 0;
+  root.parent   = -1;
+  root.count    = 0;
+  std::fill(root.children, root.children + 8, -1);
+  nodes.push_back(root);
+}
+
+/**
+ * @brief Destructor for the OkOctree class.
+ *        The objects are not deleted, they are only removed from the index.
+ */
+OkOctree::~OkOctree() {
+  clear();
+}
+
+/**
+ * @brief Add an object to the index.
+ *        Its bounds are not known until the next update, the object is
+ *        returned by every query until then.
+ * @param object The object, it must not have a parent.
+ */
+void OkOctree::insert(OkObject *object) {
+  if (object == nullptr) {
+    return;
+  }
+
+  if (object->_octree != nullptr) {
+    OkLogger::warning("Octree",
+                      "Object already indexed: " + object->getName());
+    return;
+  }
+
+  Entry entry;
+  entry.bounds = OkBoundingSphere::unbounded();
+  entry.size   = object->getSubtreeSize();
+  entry.dirty  = false;
+
+  Entry &added = entries[object];
+  added        = entry;
+  _attach(object, added, unboundedNode);
+  indexedSize += added.size;
+
+  object->_octree = this;
+  markDirty(object);
+}
+
+/**
+ * @brief Remove an object from the index.
+ * @param object The object.
+ */
+void OkOctree::remove(OkObject *object) {
+  std::unordered_map<OkObject *, Entry>::iterator it = entries.find(object);
+  if (it == entries.end()) {
+    return;
+  }
+
+  if (it->second.dirty) {
+    dirtyObjects.erase(
+        std::find(dirtyObjects.begin(), dirtyObjects.end(), object));
+  }
+
+  _detach(object, it->second);
+  indexedSize -= it->second.size;
+  entries.erase(it);
+
+  object->_octree = nullptr;
+}
+
+/**
+ * @brief Remove all the objects from the index and drop all the nodes.
+ */
+void OkOctree::clear() {
+  for (auto &entry : entries) {
+    entry.first->_octree = nullptr;
+  }
+
+  entries.clear();
+  dirtyObjects.clear();
+  unboundedObjects.clear();
+  outsideObjects.clear();
+  indexedSize = 0;
+
+  nodes.resize(1);
+  nodes[0].count = 0;
+  nodes[0].objects.clear();
+  std::fill(nodes[0].children, nodes[0].children + 8, -1);
+}
+
+/**
+ * @brief Flag an object as changed, so the next update moves it.
+ *        Objects call it when their subtree starts needing a transform pass.
+ * @param object The object.
+ */
+void OkOctree::markDirty(OkObject *object) {
+  std::unordered_map<OkObject *, Entry>::iterator it = entries.find(object);
+  if (it != entries.end() && !it->second.dirty) {
+    it->second.dirty = true;
+    dirtyObjects.push_back(object);
+  }
+}
+
+/**
+ * @brief Run the transform pass of the changed objects and move them to the
+ *        node matching their new bounds.
+ *        Objects still being interpolated stay flagged for the next update.
+ *        The cost is proportional to the number of changed objects, static
+ *        objects are never visited.
+ */
+void OkOctree::update() {
+  std::vector<OkObject *> pending;
+  pending.swap(dirtyObjects);
+
+  for (size_t i = 0; i < pending.size(); i++) {
+    std::unordered_map<OkObject *, Entry>::iterator it =
+        entries.find(pending[i]);
+    if (it == entries.end()) {
+      continue;
+    }
+
+    OkObject *object = pending[i];
+    it->second.dirty = false;
+
+    object->updateTransform();
+    _reindex(object, it->second);
+
+    // The transform pass did not finish, the object must be visited again
+    if (object->subtreeDirty) {
+      markDirty(object);
+    }
+  }
+}
+
+/**
+ * @brief Move an object to the node matching its current bounds.
+ * @param object The object.
+ * @param entry  The entry of the object.
+ */
+void OkOctree::_reindex(OkObject *object, Entry &entry) {
+  indexedSize -= entry.size;
+  entry.size   = object->getSubtreeSize();
+  entry.bounds = object->getSubtreeBounds();
+  indexedSize += entry.size;
+
+  int node = _findNode(entry.bounds);
+  if (node != entry.node) {
+    _detach(object, entry);
+    _attach(object, entry, node);
+  }
+}
+
+/**
+ * @brief Find the node an object belongs to, creating the missing nodes.
+ *        That is the deepest node whose cube contains the center, with a
+ *        half size not smaller than the radius.
+ * @param bounds The bounds of the object.
+ * @return The node index, or one of the flat lists.
+ */
+int OkOctree::_findNode(const OkBoundingSphere &bounds) {
+  if (bounds.infinite) {
+    return unboundedNode;
+  }
+
+  glm::vec3 offset = glm::abs(bounds.center - nodes[0].center);
+  float     half   = nodes[0].halfSize;
+  if (bounds.isEmpty() || bounds.radius > half || offset.x > half ||
+      offset.y > half || offset.z > half) {
+    return outsideNode;
+  }
+
+  int index = 0;
+  while (nodes[index].depth < maxDepth) {
+    float childHalf = nodes[index].halfSize * 0.5f;
+    if (bounds.radius > childHalf) {
+      break;
+    }
+
+    const glm::vec3 &center = nodes[index].center;
+    int              octant = 0;
+    glm::vec3        corner = center - glm::vec3(childHalf);
+    if (bounds.center.x >= center.x) {
+      octant |= 1;
+      corner.x += 2.0f * childHalf;
+    }
+    if (bounds.center.y >= center.y) {
+      octant |= 2;
+      corner.y += 2.0f * childHalf;
+    }
+    if (bounds.center.z >= center.z) {
+      octant |= 4;
+      corner.z += 2.0f * childHalf;
+    }
+
+    int child = nodes[index].children[octant];
+    if (child < 0) {
+      Node node;
+      node.center   = corner;
+      node.halfSize = childHalf;
+      node.depth    = nodes[index].depth + 1;
+      node.parent   = index;
+      node.count    = 0;
+      std::fill(node.children, node.children + 8, -1);
+
+      // Adding a node may move the others, do not keep references
+      child = static_cast<int>(nodes.size());
+      nodes.push_back(node);
+      nodes[index].children[octant] = child;
+    }
+
+    index = child;
+  }
+
+  return index;
+}
+
+/**
+ * @brief Get the object list of a node or a flat list.
+ * @param node The node index.
+ * @return The object list.
+ */
+std::vector<OkObject *> &OkOctree::_objectList(int node) {
+  if (node == unboundedNode) {
+    return unboundedObjects;
+  }
+  if (node == outsideNode) {
+    return outsideObjects;
+  }
+  return nodes[node].objects;
+}
+
+/**
+ * @brief Add an object to the list of a node.
+ * @param object The object.
+ * @param entry  The entry of the object.
+ * @param node   The node index.
+ */
+void OkOctree::_attach(OkObject *object, Entry &entry, int node) {
+  std::vector<OkObject *> &list = _objectList(node);
+
+  entry.node = node;
+  entry.slot = list.size();
+  list.push_back(object);
+
+  for (int index = node; index >= 0; index = nodes[index].parent) {
+    nodes[index].count++;
+  }
+}
+
+/**
+ * @brief Remove an object from the list of its node.
+ *        The last object of the list takes its slot.
+ * @param object The object.
+ * @param entry  The entry of the object.
+ */
+void OkOctree::_detach(OkObject *object, Entry &entry) {
+  std::vector<OkObject *> &list = _objectList(entry.node);
+
+  OkObject *last = list.back();
+
+  list[entry.slot]   = last;
+  entries[last].slot = entry.slot;
+  list.pop_back();
+
+  for (int index = entry.node; index >= 0; index = nodes[index].parent) {
+    nodes[index].count--;
+  }
+}
+
+/**
+ * @brief Get the objects that may be inside a frustum.
+ *        Objects with an infinite bound are always returned.
+ * @param frustum The frustum.
+ * @param result  Vector the objects are appended to.
+ */
+void OkOctree::queryFrustum(const OkFrustum        &frustum,
+                            std::vector<OkObject *> &result) const {
+  result.insert(result.end(), unboundedObjects.begin(),
+                unboundedObjects.end());
+
+  for (size_t i = 0; i < outsideObjects.size(); i++) {
+    const Entry &entry = entries.at(outsideObjects[i]);
+    if (frustum.test(entry.bounds) != OkCullResult::Outside) {
+      result.push_back(outsideObjects[i]);
+    }
+  }
+
+  _queryFrustum(0, frustum, result);
+}
+
+/**
+ * @brief Recursive part of queryFrustum.
+ * @param node    The node index.
+ * @param frustum The frustum.
+ * @param result  Vector the objects are appended to.
+ */
+void OkOctree::_queryFrustum(int node, const OkFrustum &frustum,
+                             std::vector<OkObject *> &result) const {
+  const Node &current = nodes[node];
+  if (current.count == 0) {
+    return;
+  }
+
+  // Sphere around the loose cube, twice the size of the node cube
+  const float      sqrt3 = 1.7320508f;
+  OkBoundingSphere loose =
+      OkBoundingSphere::sphere(current.center, current.halfSize * 2 * sqrt3);
+
+  OkCullResult test = frustum.test(loose);
+  if (test == OkCullResult::Outside) {
+    return;
+  }
+  if (test == OkCullResult::Inside) {
+    _collect(node, result);
+    return;
+  }
+
+  for (size_t i = 0; i < current.objects.size(); i++) {
+    const Entry &entry = entries.at(current.objects[i]);
+    if (frustum.test(entry.bounds) != OkCullResult::Outside) {
+      result.push_back(current.objects[i]);
+    }
+  }
+
+  for (int i = 0; i < 8; i++) {
+    if (current.children[i] >= 0) {
+      _queryFrustum(current.children[i], frustum, result);
+    }
+  }
+}
+
+/**
+ * @brief Get all the objects of a node and its descendants.
+ * @param node   The node index.
+ * @param result Vector the objects are appended to.
+ */
+void OkOctree::_collect(int node, std::vector<OkObject *> &result) const {
+  const Node &current = nodes[node];
+  if (current.count == 0) {
+    return;
+  }
+
+  result.insert(result.end(), current.objects.begin(), current.objects.end());
+
+  for (int i = 0; i < 8; i++) {
+    if (current.children[i] >= 0) {
+      _collect(current.children[i], result);
+    }
+  }
+}
+
+/**
+ * @brief Get the objects whose bounds intersect a sphere.
+ *        Objects with an infinite bound are always returned.
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ * @param result Vector the objects are appended to.
+ */
+void OkOctree::querySphere(const glm::vec3 &center, float radius,
+                           std::vector<OkObject *> &result) const {
+  result.insert(result.end(), unboundedObjects.begin(),
+                unboundedObjects.end());
+
+  for (size_t i = 0; i < outsideObjects.size(); i++) {
+    if (entries.at(outsideObjects[i]).bounds.intersects(center, radius)) {
+      result.push_back(outsideObjects[i]);
+    }
+  }
+
+  _querySphere(0, center, radius, result);
+}
+
+/**
+ * @brief Recursive part of querySphere.
+ * @param node   The node index.
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ * @param result Vector the objects are appended to.
+ */
+void OkOctree::_querySphere(int node, const glm::vec3 &center, float radius,
+                            std::vector<OkObject *> &result) const {
+  const Node &current = nodes[node];
+  if (current.count == 0) {
+    return;
+  }
+
+  // Distance from the sphere center to the loose cube
+  glm::vec3 offset = glm::abs(center - current.center);
+  glm::vec3 gap    = glm::max(offset - glm::vec3(current.halfSize * 2.0f),
+                              glm::vec3(0.0f));
+  if (glm::dot(gap, gap) > radius * radius) {
+    return;
+  }
+
+  for (size_t i = 0; i < current.objects.size(); i++) {
+    if (entries.at(current.objects[i]).bounds.intersects(center, radius)) {
+      result.push_back(current.objects[i]);
+    }
+  }
+
+  for (int i = 0; i < 8; i++) {
+    if (current.children[i] >= 0) {
+      _querySphere(current.children[i], center, radius, result);
+    }
+  }
+}
+
+/**
+ * @brief Get the objects whose bounds are hit by a ray, nearest first.
+ *        Objects with an infinite bound are always returned, at distance 0.
+ * @param origin      The origin of the ray.
+ * @param direction   The direction of the ray.
+ * @param maxDistance The length of the ray.
+ * @param result      Vector the hits are appended to.
+ */
+void OkOctree::queryRay(const glm::vec3 &origin, const glm::vec3 &direction,
+                        float                  maxDistance,
+                        std::vector<OkRayHit> &result) const {
+  size_t    first = result.size();
+  glm::vec3 unit  = glm::normalize(direction);
+
+  for (size_t i = 0; i < unboundedObjects.size(); i++) {
+    result.push_back({unboundedObjects[i], 0.0f});
+  }
+
+  for (size_t i = 0; i < outsideObjects.size(); i++) {
+    float distance;
+    if (entries.at(outsideObjects[i])
+            .bounds.intersectsRay(origin, unit, distance) &&
+        distance <= maxDistance) {
+      result.push_back({outsideObjects[i], distance});
+    }
+  }
+
+  _queryRay(0, origin, 1.0f / unit, maxDistance, unit, result);
+
+  std::stable_sort(result.begin() + first, result.end(),
+                   [](const OkRayHit &a, const OkRayHit &b) {
+                     return a.distance < b.distance;
+                   });
+}
+
+/**
+ * @brief Recursive part of queryRay.
+ * @param node             The node index.
+ * @param origin           The origin of the ray.
+ * @param inverseDirection One divided by each component of the direction,
+ *                         infinite for the components that are 0.
+ * @param maxDistance      The length of the ray.
+ * @param direction        The normalized direction of the ray.
+ * @param result           Vector the hits are appended to.
+ */
+void OkOctree::_queryRay(int node, const glm::vec3 &origin,
+                         const glm::vec3 &inverseDirection, float maxDistance,
+                         const glm::vec3       &direction,
+                         std::vector<OkRayHit> &result) const {
+  const Node &current = nodes[node];
+  if (current.count == 0) {
+    return;
+  }
+
+  // Slab test against the loose cube. On axes the ray is parallel to, the
+  // origin only has to be between the planes: the inverse direction is
+  // infinite there, and 0 * inf is NaN when the origin is on a plane
+  float half  = current.halfSize * 2.0f;
+  float enter = -std::numeric_limits<float>::infinity();
+  float exit  = std::numeric_limits<float>::infinity();
+  for (int axis = 0; axis < 3; axis++) {
+    float lower = current.center[axis] - half;
+    float upper = current.center[axis] + half;
+    if (direction[axis] == 0.0f) {
+      if (origin[axis] < lower || origin[axis] > upper) {
+        return;
+      }
+      continue;
+    }
+
+    float near = (lower - origin[axis]) * inverseDirection[axis];
+    float far  = (upper - origin[axis]) * inverseDirection[axis];
+    enter      = std::max(enter, std::min(near, far));
+    exit       = std::min(exit, std::max(near, far));
+  }
+  if (exit < std::max(enter, 0.0f) || enter > maxDistance) {
+    return;
+  }
+
+  for (size_t i = 0; i < current.objects.size(); i++) {
+    float distance;
+    if (entries.at(current.objects[i])
+            .bounds.intersectsRay(origin, direction, distance) &&
+        distance <= maxDistance) {
+      result.push_back({current.objects[i], distance});
+    }
+  }
+
+  for (int i = 0; i < 8; i++) {
+    if (current.children[i] >= 0) {
+      _queryRay(current.children[i], origin, inverseDirection, maxDistance,
+                direction, result);
+    }
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef OK_OCTREE_HPP
+#define OK_OCTREE_HPP
+
+#include "../render/frustum.hpp"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+class OkObject;
+
+// Object hit by a ray query
+struct OkRayHit {
+  OkObject *object;
+  float     distance;  // Distance to the bound along the ray
+};
+
+/**
+ * @brief Loose octree indexing objects by the bounds of their subtree.
+ *        Each node holds the objects whose center falls in its cube and whose
+ *        radius is at most half the cube size, so an object never straddles
+ *        nodes and can be moved in constant time per level. Nodes are tested
+ *        with their loose bounds, twice the size of their cube.
+ *        Indexed objects notify the octree when their transform changes, and
+ *        only those are updated and moved by update(). Objects with an
+ *        infinite bound, or too big or far for the root, are kept in flat
+ *        lists tested linearly.
+ */
+class OkOctree {
+public:
+  OkOctree(const glm::vec3 &center, float halfSize, int maxDepth);
+  ~OkOctree();
+
+  // Delete copy constructor and assignment
+  OkOctree(const OkOctree &)            = delete;
+  OkOctree &operator=(const OkOctree &) = delete;
+
+  // Object management, objects must be roots of their hierarchy
+  void insert(OkObject *object);
+  void remove(OkObject *object);
+  void clear();
+
+  // Called by the objects whose subtree needs a transform pass
+  void markDirty(OkObject *object);
+
+  // Run the transform pass of the changed objects and move them in the tree
+  void update();
+
+  // Queries, results are appended
+  void queryFrustum(const OkFrustum        &frustum,
+                    std::vector<OkObject *> &result) const;
+  void querySphere(const glm::vec3 &center, float radius,
+                   std::vector<OkObject *> &result) const;
+  void queryRay(const glm::vec3 &origin, const glm::vec3 &direction,
+                float maxDistance, std::vector<OkRayHit> &result) const;
+
+  // Getters
+  size_t getObjectCount() const { return entries.size(); }
+  size_t getIndexedSize() const { return indexedSize; }
+  size_t getDirtyCount() const { return dirtyObjects.size(); }
+  size_t getNodeCount() const { return nodes.size(); }
+
+private:
+  // Special node indices for the flat lists
+  static const int unboundedNode = -1;
+  static const int outsideNode   = -2;
+
+  struct Node {
+    glm::vec3               center;
+    float                   halfSize;  // Half the size of the cube
+    int                     depth;
+    int                     parent;
+    int                     children[8];  // -1 if not created
+    size_t                  count;        // Objects in this subtree
+    std::vector<OkObject *> objects;
+  };
+
+  struct Entry {
+    int              node;
+    size_t           slot;  // Position in the object list of the node
+    OkBoundingSphere bounds;
+    size_t           size;  // Objects in the indexed subtree
+    bool             dirty;
+  };
+
+  int                      _findNode(const OkBoundingSphere &bounds);
+  std::vector<OkObject *> &_objectList(int node);
+  void                     _attach(OkObject *object, Entry &entry, int node);
+  void                     _detach(OkObject *object, Entry &entry);
+  void                     _reindex(OkObject *object, Entry &entry);
+
+  void _collect(int node, std::vector<OkObject *> &result) const;
+  void _queryFrustum(int node, const OkFrustum &frustum,
+                     std::vector<OkObject *> &result) const;
+  void _querySphere(int node, const glm::vec3 &center, float radius,
+                    std::vector<OkObject *> &result) const;
+  void _queryRay(int node, const glm::vec3 &origin,
+                 const glm::vec3 &inverseDirection, float maxDistance,
+                 const glm::vec3 &direction,
+                 std::vector<OkRayHit> &result) const;
+
+  std::vector<Node>                     nodes;  // nodes[0] is the root
+  std::vector<OkObject *>               unboundedObjects;
+  std::vector<OkObject *>               outsideObjects;
+  std::unordered_map<OkObject *, Entry> entries;
+  std::vector<OkObject *>               dirtyObjects;
+  size_t                                indexedSize;
+  int                                   maxDepth;
+};
+
+#endif
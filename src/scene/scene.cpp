@@ -1,14 +1,21 @@
 #include "scene.hpp"
+#include "../config/config.hpp"
+#include "../shaders/program.hpp"
 #include "../utils/logger.hpp"
 #include "core/object.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <glm/glm.hpp>
 #include <string>
+#include <vector>
 
 /**
  * @brief Constructor for the OkScene class.
  * @param name The name of the scene.
  */
-OkScene::OkScene(const std::string &name) {
+OkScene::OkScene(const std::string &name)
+    : octree(glm::vec3(0.0f), OkConfig::getFloat("scene.octree-size"),
+             OkConfig::getInt("scene.octree-depth")) {
   this->name  = name;
   _isActive   = false;
   _isPlayable = false;
@@ -22,6 +29,8 @@ OkScene::OkScene(const std::string &name) {
  * Cleans up all root objects and their children.
  */
 OkScene::~OkScene() {
+  octree.clear();
+
   // Clean up root objects - their children will be deleted recursively
   for (size_t i = 0; i < rootObjects.size(); ++i) {
     delete rootObjects[i];
@@ -41,6 +50,7 @@ void OkScene::addObject(OkObject *object) {
   // Only add objects that don't have a parent
   if (object->getParent() == nullptr) {
     rootObjects.push_back(object);
+    octree.insert(object);
   } else {
     OkLogger::warning("Scene",
                       "Cannot add object with parent directly to scene");
@@ -63,17 +73,151 @@ void OkScene::step(float dt) {
 
 /**
  * @brief Draw the scene and all its objects.
+ *        Objects are submitted to the render queue, which sorts the draws by
+ *        state before issuing them, with the program currently in use. Only
+ *        the root objects found in the view frustum by the octree are
+ *        submitted.
+ * @param camera The camera the scene is drawn from.
  */
-void OkScene::draw() {
+void OkScene::draw(const OkCamera *camera) {
   if (!_isActive)
     return;
 
-  // Draw root objects (they will draw their children)
-  for (size_t i = 0; i < rootObjects.size(); ++i) {
-    rootObjects[i]->draw();
+  renderQueue.begin(OkShaderProgram::getCurrent(), camera);
+
+  // Transform pass of the objects that changed since the last frame
+  octree.update();
+
+  if (!renderQueue.isCulling()) {
+    // Submit root objects (they will submit their children)
+    for (size_t i = 0; i < rootObjects.size(); ++i) {
+      rootObjects[i]->submit(renderQueue);
+    }
+  } else {
+    visibleObjects.clear();
+    octree.queryFrustum(renderQueue.getFrustum(), visibleObjects);
+
+    // Subtrees left out by the octree count as culled
+    size_t queried = 0;
+    for (size_t i = 0; i < visibleObjects.size(); ++i) {
+      visibleObjects[i]->submit(renderQueue);
+      queried += visibleObjects[i]->getSubtreeSize();
+    }
+    renderQueue.countCulled(octree.getIndexedSize() - queried);
+  }
+
+  renderQueue.flush();
+}
+
+/**
+ * @brief Add the objects of a subtree intersecting a sphere to a vector.
+ * @param object The root of the subtree.
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ * @param result The vector the objects are added to.
+ */
+static void collectInRadius(OkObject *object, const glm::vec3 &center,
+                            float radius, std::vector<OkObject *> &result) {
+  const OkBoundingSphere &subtree = object->getSubtreeBounds();
+  if (!subtree.infinite && !subtree.intersects(center, radius)) {
+    return;
+  }
+
+  if (object->getBounds().intersects(center, radius)) {
+    result.push_back(object);
+  }
+
+  OkObject *current = object->getFirstChild();
+  while (current != nullptr) {
+    collectInRadius(current, center, radius, result);
+    current = current->getNextSibling();
   }
 }
 
+/**
+ * @brief Add the objects of a subtree hit by a ray to a vector.
+ * @param object      The root of the subtree.
+ * @param origin      The origin of the ray.
+ * @param direction   The normalized direction of the ray.
+ * @param maxDistance The length of the ray.
+ * @param result      The vector the hits are added to.
+ */
+static void collectOnRay(OkObject *object, const glm::vec3 &origin,
+                         const glm::vec3 &direction, float maxDistance,
+                         std::vector<OkRayHit> &result) {
+  float                   distance;
+  const OkBoundingSphere &subtree = object->getSubtreeBounds();
+  if (!subtree.infinite &&
+      (!subtree.intersectsRay(origin, direction, distance) ||
+       distance > maxDistance)) {
+    return;
+  }
+
+  if (object->getBounds().intersectsRay(origin, direction, distance) &&
+      distance <= maxDistance) {
+    result.push_back({object, distance});
+  }
+
+  OkObject *current = object->getFirstChild();
+  while (current != nullptr) {
+    collectOnRay(current, origin, direction, maxDistance, result);
+    current = current->getNextSibling();
+  }
+}
+
+/**
+ * @brief Get the objects whose bounds intersect a sphere.
+ *        Objects with an infinite bound are never returned, their
+ *        descendants are tested as usual.
+ * @param center The center of the sphere.
+ * @param radius The radius of the sphere.
+ * @return The objects, in no particular order.
+ */
+std::vector<OkObject *> OkScene::getObjectsInRadius(const glm::vec3 &center,
+                                                    float            radius) {
+  octree.update();
+
+  std::vector<OkObject *> roots;
+  octree.querySphere(center, radius, roots);
+
+  std::vector<OkObject *> result;
+  for (size_t i = 0; i < roots.size(); ++i) {
+    collectInRadius(roots[i], center, radius, result);
+  }
+
+  return result;
+}
+
+/**
+ * @brief Get the objects whose bounds are hit by a ray.
+ *        Objects with an infinite bound are never returned, their
+ *        descendants are tested as usual.
+ * @param origin      The origin of the ray.
+ * @param direction   The direction of the ray.
+ * @param maxDistance The length of the ray.
+ * @return The hits, nearest first.
+ */
+std::vector<OkRayHit> OkScene::raycast(const glm::vec3 &origin,
+                                       const glm::vec3 &direction,
+                                       float            maxDistance) {
+  octree.update();
+
+  std::vector<OkRayHit> roots;
+  octree.queryRay(origin, direction, maxDistance, roots);
+
+  glm::vec3             unit = glm::normalize(direction);
+  std::vector<OkRayHit> result;
+  for (size_t i = 0; i < roots.size(); ++i) {
+    collectOnRay(roots[i].object, origin, unit, maxDistance, result);
+  }
+
+  std::stable_sort(result.begin(), result.end(),
+                   [](const OkRayHit &a, const OkRayHit &b) {
+                     return a.distance < b.distance;
+                   });
+  return result;
+}
+
 /**
  * @brief Activate the scene.
  */
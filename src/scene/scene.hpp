@@ -1,14 +1,20 @@
 #ifndef OK_SCENE_HPP
 #define OK_SCENE_HPP
 
+#include "../core/camera.hpp"
 #include "../core/object.hpp"
+#include "../render/queue.hpp"
+#include "octree.hpp"
 #include <cstddef>
+#include <glm/glm.hpp>
 #include <string>
 #include <vector>
 
 /**
  * @brief Class representing a scene in the application.
- *        It manages a collection of items and their hierarchy.
+ *        It manages a collection of items and their hierarchy. Root objects
+ *        are indexed in a loose octree by the bounds of their subtree, so
+ *        culling and spatial queries do not scan the whole scene.
  */
 class OkScene {
 public:
@@ -22,16 +28,25 @@ public:
   // Scene management
   void addObject(OkObject *object);
   void step(float dt);
-  void draw();
+  void draw(const OkCamera *camera);
   void activate();
   void deactivate();
 
+  // Spatial queries, any object of the hierarchy can be returned
+  std::vector<OkObject *> getObjectsInRadius(const glm::vec3 &center,
+                                             float            radius);
+  std::vector<OkRayHit>   raycast(const glm::vec3 &origin,
+                                  const glm::vec3 &direction,
+                                  float            maxDistance);
+
   // Getters
   bool               isActive() const { return _isActive; }
   bool               isPlayable() const { return _isPlayable; }
   bool               isCurrent() const { return _isCurrent; }
   const std::string &getName() const { return name; }
   size_t             getObjectCount() const { return rootObjects.size(); }
+  const OkRenderQueue &getRenderQueue() const { return renderQueue; }
+  const OkOctree      &getOctree() const { return octree; }
 
 private:
   std::string             name;
@@ -39,6 +54,9 @@ private:
   bool                    _isPlayable;
   bool                    _isCurrent;
   std::vector<OkObject *> rootObjects;  // Only stores objects without parents
+  OkRenderQueue           renderQueue;
+  OkOctree                octree;
+  std::vector<OkObject *> visibleObjects;  // Octree query results
 };
 
 #endif
@@ -0,0 +1,273 @@
+#include "cache.hpp"
+#include "../config/config.hpp"
+#include "../core/gl_config.hpp"
+#include "../utils/files.hpp"
+#include "../utils/logger.hpp"
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Identifies program binary files
+static const char magicBytes[4] = {'O', 'K', 'P', 'B'};
+
+/**
+ * @brief Tell if programs are cached.
+ *        Drivers may support binaries without any format to save them in,
+ *        as some macOS drivers do.
+ * @return True if shaders.program-cache is set and the driver has at least
+ *         one binary format.
+ */
+bool OkProgramCache::isEnabled() {
+  if (!OkConfig::getBool("shaders.program-cache")) {
+    return false;
+  }
+
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+/**
+ * @brief Get the internal mutable reference to the cache directory.
+ * @return Reference to the static cache directory path.
+ */
+std::filesystem::path &OkProgramCache::getMutableDirectory() {
+  static std::filesystem::path directory;
+  return directory;
+}
+
+/**
+ * @brief Set the directory of the cache files, created when needed.
+ * @param path The directory.
+ */
+void OkProgramCache::setDirectory(const std::filesystem::path &path) {
+  getMutableDirectory() = path;
+}
+
+/**
+ * @brief Get the cache directory of the user, which persists across
+ *        reboots and is not shared with other users.
+ * @return okinawa/shaders in LOCALAPPDATA on Windows, ~/Library/Caches on
+ *         macOS, and XDG_CACHE_HOME or ~/.cache elsewhere. Empty if the
+ *         environment has none of them.
+ */
+static std::filesystem::path getUserDirectory() {
+  std::filesystem::path base;
+#ifdef _WIN32
+  const char *localAppData = std::getenv("LOCALAPPDATA");
+  if (localAppData && *localAppData) {
+    base = localAppData;
+  }
+#else
+  const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+  const char *home      = std::getenv("HOME");
+  if (cacheHome && *cacheHome) {
+    base = cacheHome;
+  } else if (home && *home) {
+#ifdef __APPLE__
+    base = std::filesystem::path(home) / "Library" / "Caches";
+#else
+    base = std::filesystem::path(home) / ".cache";
+#endif
+  }
+#endif
+
+  if (base.empty()) {
+    return base;
+  }
+  return base / "okinawa" / "shaders";
+}
+
+/**
+ * @brief Get the directory of the cache files.
+ * @return The directory set, else shaders.program-cache-dir, else the cache
+ *         directory of the user. Only without any of them, okinawa-shaders
+ *         in the temporary directory, which other users can write to.
+ */
+std::filesystem::path OkProgramCache::getDirectory() {
+  if (!getMutableDirectory().empty()) {
+    return getMutableDirectory();
+  }
+
+  std::string configured = OkConfig::getString("shaders.program-cache-dir");
+  if (!configured.empty()) {
+    return configured;
+  }
+
+  std::filesystem::path user = getUserDirectory();
+  if (!user.empty()) {
+    return user;
+  }
+
+  std::error_code       error;
+  std::filesystem::path temporary =
+      std::filesystem::temp_directory_path(error);
+  return error ? std::filesystem::path("okinawa-shaders")
+               : temporary / "okinawa-shaders";
+}
+
+/**
+ * @brief Create the cache directory if needed. A directory created here is
+ *        only accessible by its owner, binaries are given to the driver as
+ *        they are.
+ * @return False if the directory could not be created.
+ */
+bool OkProgramCache::createDirectory() {
+  std::filesystem::path directory = getDirectory();
+  std::error_code       error;
+  if (std::filesystem::is_directory(directory, error)) {
+    return true;
+  }
+
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    OkLogger::error("Shader", "Cannot create " + directory.string() + ": " +
+                                  error.message());
+    return false;
+  }
+
+  std::filesystem::permissions(directory, std::filesystem::perms::owner_all,
+                               std::filesystem::perm_options::replace, error);
+  return true;
+}
+
+/**
+ * @brief Get the key of a program, hashing its sources with the strings
+ *        identifying the driver, so binaries are never given to another
+ *        driver.
+ * @param vertexSource   The vertex shader source.
+ * @param fragmentSource The fragment shader source.
+ * @return The key.
+ */
+uint64_t OkProgramCache::getKey(const std::string &vertexSource,
+                                const std::string &fragmentSource) {
+  std::string key = vertexSource + '\0' + fragmentSource;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const GLubyte *value = glGetString(name);
+    key += '\0';
+    if (value) {
+      key += reinterpret_cast<const char *>(value);
+    }
+  }
+
+  return OkFiles::hashData(key.data(), key.size());
+}
+
+/**
+ * @brief Get the name of the cache file of a program.
+ * @param key The key of the program.
+ * @return The file name, in the cache directory.
+ */
+std::string OkProgramCache::getFileName(uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016" PRIx64 ".okprogram", key);
+  return (getDirectory() / name).string();
+}
+
+/**
+ * @brief Create a program from its cached binary.
+ *        Binaries the driver rejects, after an update for example, are
+ *        removed, so the program is compiled and saved again.
+ * @param key The key of the program.
+ * @return The linked program, 0 if there is no valid binary.
+ */
+GLuint OkProgramCache::load(uint64_t key) {
+  std::string     filename = getFileName(key);
+  std::error_code error;
+  if (!std::filesystem::exists(filename, error)) {
+    return 0;  // Not cached yet, no error to report
+  }
+
+  OkMappedFile file(filename);
+  if (!file.isOpen() || file.getSize() < sizeof(Header)) {
+    return 0;
+  }
+
+  const Header *header = reinterpret_cast<const Header *>(file.getData());
+  if (std::memcmp(header->magic, magicBytes, sizeof(magicBytes)) != 0 ||
+      header->version != version || header->key != key ||
+      file.getSize() - sizeof(Header) != header->size) {
+    OkLogger::warning("Shader", "Ignoring invalid program cache " + filename);
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, header->format, file.getData() + sizeof(Header),
+                  static_cast<GLsizei>(header->size));
+
+  GLint success = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    OkLogger::warning("Shader", "Driver rejected program cache " + filename);
+    glDeleteProgram(program);
+    std::remove(filename.c_str());
+    return 0;
+  }
+
+  return program;
+}
+
+/**
+ * @brief Save the binary of a linked program.
+ *        The file is written under a temporary name and then renamed, so an
+ *        interrupted write never leaves a truncated file behind.
+ * @param key     The key of the program.
+ * @param program The program.
+ * @return True if the file was written.
+ */
+bool OkProgramCache::save(uint64_t key, GLuint program) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+
+  std::vector<char> binary(static_cast<size_t>(length));
+  GLsizei           written = 0;
+  GLenum            format  = 0;
+  glGetProgramBinary(program, length, &written, &format, binary.data());
+  if (written <= 0) {
+    return false;
+  }
+
+  if (!createDirectory()) {
+    return false;
+  }
+
+  Header header;
+  std::memcpy(header.magic, magicBytes, sizeof(magicBytes));
+  header.version = version;
+  header.key     = key;
+  header.format  = format;
+  header.size    = static_cast<uint32_t>(written);
+
+  // Writes to a file that failed to open just set its error state
+  std::string   filename  = getFileName(key);
+  std::string   temporary = filename + ".tmp";
+  std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(binary.data(), written);
+  file.close();
+  if (file.fail()) {
+    OkLogger::error("Shader", "Error writing program cache " + filename);
+    std::remove(temporary.c_str());
+    return false;
+  }
+
+  // Renaming over an existing file fails on some platforms
+  std::remove(filename.c_str());
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    OkLogger::error("Shader", "Error writing program cache " + filename);
+    std::remove(temporary.c_str());
+    return false;
+  }
+
+  return true;
+}
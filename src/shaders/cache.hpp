@@ -0,0 +1,61 @@
+#ifndef OK_CACHE_HPP
+#define OK_CACHE_HPP
+
+#include "../core/gl_config.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief On-disk cache of linked shader programs.
+ *        Programs are saved with glGetProgramBinary after linking, and
+ *        loaded with glProgramBinary the next time, skipping compilation.
+ *        Files are named after a hash of the sources and of the driver
+ *        (vendor, renderer and version), so edited sources or a new driver
+ *        miss the cache, and binaries the driver rejects are compiled again.
+ */
+class OkProgramCache {
+public:
+  // Static class - no instantiation
+  OkProgramCache() = delete;
+
+  // Format version, files of other versions are ignored
+  static const uint32_t version = 1;
+
+  // Enabled by shaders.program-cache, when the driver has binary formats
+  static bool isEnabled();
+
+  // Directory of the cache files, shaders.program-cache-dir or the cache
+  // directory of the user by default
+  static void                  setDirectory(const std::filesystem::path &path);
+  static std::filesystem::path getDirectory();
+
+  // Create the directory, owner only, false on failure
+  static bool createDirectory();
+
+  // Key of a program: hash of its sources and of the driver
+  static uint64_t    getKey(const std::string &vertexSource,
+                            const std::string &fragmentSource);
+  static std::string getFileName(uint64_t key);
+
+  // Create a program from its cached binary, 0 if missing or rejected
+  static GLuint load(uint64_t key);
+
+  // Save the binary of a program, linked with
+  // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+  static bool save(uint64_t key, GLuint program);
+
+private:
+  // File header, followed by the binary
+  struct Header {
+    char     magic[4];  // "OKPB"
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;  // Binary format of the driver
+    uint32_t size;    // Bytes of the binary
+  };
+
+  static std::filesystem::path &getMutableDirectory();
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "program.hpp"
+#include "../core/gl_config.hpp"
+#include "../core/gl_state.hpp"
+#include "../utils/logger.hpp"
+#include "shaders.hpp"
+#include "variants.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <glm/gtc/type_ptr.hpp>
+#include <string>
+#include <vector>
+
+// Static member initialization
+OkShaderProgram *OkShaderProgram::_current = nullptr;
+
+// Names of the well-known uniforms, in OkUniform order
+static const char *uniformNames[] = {
+    "model",        "view",           "projection",      "texture0",
+    "hasTexture",   "wireframeColor", "instanced",       "textureArray",
+    "textureLayer", "hasTextureArray",
+};
+
+static_assert(sizeof(uniformNames) / sizeof(uniformNames[0]) ==
+                  static_cast<int>(OkUniform::Count),
+              "Missing uniform names");
+
+// Names of the shared uniform blocks, in OkUniformBlock order
+static const char *blockNames[] = {"OkFrame", "OkObject"};
+
+static_assert(sizeof(blockNames) / sizeof(blockNames[0]) ==
+                  static_cast<int>(OkUniformBlock::Count),
+              "Missing uniform block names");
+
+/**
+ * @brief Constructor for the OkShaderProgram class.
+ *        Reflects all the active uniforms and attributes of the program.
+ * @param programId A linked program, the object takes ownership of it.
+ */
+OkShaderProgram::OkShaderProgram(GLuint programId) {
+  id       = programId;
+  variants = nullptr;
+  features = 0;
+
+  for (int i = 0; i < static_cast<int>(OkUniform::Count); i++) {
+    slots[i] = -1;
+  }
+  for (int i = 0; i < static_cast<int>(OkUniformBlock::Count); i++) {
+    blocks[i] = false;
+  }
+
+  if (id != 0) {
+    _reflect();
+  }
+}
+
+/**
+ * @brief Destructor for the OkShaderProgram class.
+ *        Deletes the OpenGL program.
+ */
+OkShaderProgram::~OkShaderProgram() {
+  if (_current == this) {
+    _current = nullptr;
+  }
+
+  OkGLState::deleteProgram(id);
+  id = 0;
+}
+
+/**
+ * @brief Compile and link a program from vertex and fragment shader sources.
+ * @param vertexSource   The vertex shader source code.
+ * @param fragmentSource The fragment shader source code.
+ * @return The new program, or nullptr if compilation or linking failed.
+ */
+OkShaderProgram *OkShaderProgram::create(const std::string &vertexSource,
+                                         const std::string &fragmentSource) {
+  GLuint programId = OkShader::createProgram(vertexSource, fragmentSource);
+  if (programId == 0) {
+    return nullptr;
+  }
+
+  return new OkShaderProgram(programId);
+}
+
+/**
+ * @brief Query the active uniforms and attributes of the program, and resolve
+ *        the locations of the well-known uniforms.
+ * @note  Array uniforms are stored both with and without the "[0]" suffix.
+ *        Uniforms inside uniform blocks have no location and are skipped,
+ *        the shared blocks are bound to their binding points instead.
+ */
+void OkShaderProgram::_reflect() {
+  GLint count     = 0;
+  GLint maxLength = 0;
+
+  // Uniforms
+  glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  std::vector<char> nameBuffer(std::max(maxLength, 1));
+
+  for (GLint i = 0; i < count; i++) {
+    GLsizei  length = 0;
+    Variable variable;
+    glGetActiveUniform(id, static_cast<GLuint>(i), maxLength, &length,
+                       &variable.size, &variable.type, nameBuffer.data());
+
+    std::string name(nameBuffer.data(), length);
+    variable.location = glGetUniformLocation(id, name.c_str());
+    if (variable.location == -1) {
+      continue;
+    }
+
+    uniforms[name] = variable;
+
+    std::string::size_type bracket = name.find("[0]");
+    if (bracket != std::string::npos && bracket + 3 == name.size()) {
+      uniforms[name.substr(0, bracket)] = variable;
+    }
+  }
+
+  // Attributes
+  glGetProgramiv(id, GL_ACTIVE_ATTRIBUTES, &count);
+  glGetProgramiv(id, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+
+  nameBuffer.resize(std::max(maxLength, 1));
+
+  for (GLint i = 0; i < count; i++) {
+    GLsizei  length = 0;
+    Variable variable;
+    glGetActiveAttrib(id, static_cast<GLuint>(i), maxLength, &length,
+                      &variable.size, &variable.type, nameBuffer.data());
+
+    std::string name(nameBuffer.data(), length);
+    variable.location = glGetAttribLocation(id, name.c_str());
+    if (variable.location == -1) {
+      continue;  // Built-in attributes like gl_VertexID
+    }
+
+    attributes[name] = variable;
+  }
+
+  // Well-known uniforms
+  for (int i = 0; i < static_cast<int>(OkUniform::Count); i++) {
+    slots[i] = getUniformLocation(uniformNames[i]);
+  }
+
+  // Shared uniform blocks, GLSL 4.10 cannot set their binding points
+  for (int i = 0; i < static_cast<int>(OkUniformBlock::Count); i++) {
+    GLuint index = glGetUniformBlockIndex(id, blockNames[i]);
+    blocks[i]    = index != GL_INVALID_INDEX;
+    if (blocks[i]) {
+      glUniformBlockBinding(id, index, static_cast<GLuint>(i));
+    }
+  }
+
+  OkLogger::info("Shader", "Program " + std::to_string(id) + " has " +
+                               std::to_string(uniforms.size()) +
+                               " uniforms and " +
+                               std::to_string(attributes.size()) +
+                               " attributes");
+}
+
+/**
+ * @brief Bind the program for rendering.
+ *        The bound program is tracked, binding it again is skipped by the
+ *        GL state cache.
+ */
+void OkShaderProgram::use() {
+  OkGLState::useProgram(id);
+  _current = this;
+}
+
+/**
+ * @brief Get the program built from the same sources with other features.
+ * @param features The features, OR-ed together.
+ * @return The variant, compiled if needed (nullptr if it does not compile),
+ *         or this program if it was not built as a variant.
+ */
+OkShaderProgram *OkShaderProgram::getVariant(uint32_t features) {
+  if (!variants) {
+    return this;
+  }
+  return variants->get(features);
+}
+
+/**
+ * @brief Get the location of a uniform by name.
+ * @param name The name of the uniform.
+ * @return The location of the uniform, or -1 if it is not active.
+ */
+GLint OkShaderProgram::getUniformLocation(const std::string &name) const {
+  auto it = uniforms.find(name);
+  if (it == uniforms.end()) {
+    return -1;
+  }
+  return it->second.location;
+}
+
+/**
+ * @brief Get the location of a vertex attribute by name.
+ * @param name The name of the attribute.
+ * @return The location of the attribute, or -1 if it is not active.
+ */
+GLint OkShaderProgram::getAttributeLocation(const std::string &name) const {
+  auto it = attributes.find(name);
+  if (it == attributes.end()) {
+    return -1;
+  }
+  return it->second.location;
+}
+
+/**
+ * @brief Get the name of a well-known uniform.
+ * @param uniform The uniform.
+ * @return The name of the uniform in the shader sources.
+ */
+const char *OkShaderProgram::getUniformName(OkUniform uniform) {
+  if (uniform == OkUniform::Count) {
+    return "";
+  }
+  return uniformNames[static_cast<int>(uniform)];
+}
+
+/**
+ * @brief Get the name of a shared uniform block.
+ * @param block The block.
+ * @return The name of the block in the shader sources.
+ */
+const char *OkShaderProgram::getBlockName(OkUniformBlock block) {
+  if (block == OkUniformBlock::Count) {
+    return "";
+  }
+  return blockNames[static_cast<int>(block)];
+}
+
+/**
+ * @brief Set an integer (or sampler) uniform.
+ * @param uniform The uniform to set, ignored if the program does not use it.
+ * @param value   The value.
+ */
+void OkShaderProgram::setInt(OkUniform uniform, int value) {
+  GLint location = getUniformLocation(uniform);
+  if (location != -1) {
+    glUniform1i(location, value);
+  }
+}
+
+/**
+ * @brief Set a boolean uniform.
+ * @param uniform The uniform to set, ignored if the program does not use it.
+ * @param value   The value.
+ */
+void OkShaderProgram::setBool(OkUniform uniform, bool value) {
+  setInt(uniform, value ? 1 : 0);
+}
+
+/**
+ * @brief Set a float uniform.
+ * @param uniform The uniform to set, ignored if the program does not use it.
+ * @param value   The value.
+ */
+void OkShaderProgram::setFloat(OkUniform uniform, float value) {
+  GLint location = getUniformLocation(uniform);
+  if (location != -1) {
+    glUniform1f(location, value);
+  }
+}
+
+/**
+ * @brief Set a vec3 uniform.
+ * @param uniform The uniform to set, ignored if the program does not use it.
+ * @param value   The value.
+ */
+void OkShaderProgram::setVec3(OkUniform uniform, const glm::vec3 &value) {
+  GLint location = getUniformLocation(uniform);
+  if (location != -1) {
+    glUniform3f(location, value.x, value.y, value.z);
+  }
+}
+
+/**
+ * @brief Set a vec4 uniform.
+ * @param uniform The uniform to set, ignored if the program does not use it.
+ * @param value   The value.
+ */
+void OkShaderProgram::setVec4(OkUniform uniform, const glm::vec4 &value) {
+  GLint location = getUniformLocation(uniform);
+  if (location != -1) {
+    glUniform4f(location, value.x, value.y, value.z, value.w);
+  }
+}
+
+/**
+ * @brief Set a mat4 uniform.
+ * @param uniform The uniform to set, ignored if the program does not use it.
+ * @param value   The value.
+ */
+void OkShaderProgram::setMat4(OkUniform uniform, const glm::mat4 &value) {
+  setMat4(uniform, glm::value_ptr(value));
+}
+
+/**
+ * @brief Set a mat4 uniform from 16 column-major floats.
+ * @param uniform The uniform to set, ignored if the program does not use it.
+ * @param value   Pointer to the matrix data.
+ */
+void OkShaderProgram::setMat4(OkUniform uniform, const float *value) {
+  GLint location = getUniformLocation(uniform);
+  if (location != -1) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+  }
+}
@@ -0,0 +1,131 @@
+#ifndef OK_PROGRAM_HPP
+#define OK_PROGRAM_HPP
+
+#include "../core/gl_config.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+
+class OkShaderVariants;
+
+// Uniforms used by the engine, resolved once when the program is linked
+enum class OkUniform {
+  Model,
+  View,
+  Projection,
+  Texture0,
+  HasTexture,
+  WireframeColor,
+  Instanced,
+  TextureArray,
+  TextureLayer,
+  HasTextureArray,
+  Count
+};
+
+// Uniform blocks shared by the engine programs, each bound to the binding
+// point of its value when the program is created
+enum class OkUniformBlock {
+  Frame,   // OkFrame: camera, see OkFrameUniforms
+  Object,  // OkObject: object being drawn, see OkObjectUniforms
+  Count
+};
+
+/**
+ * @brief Linked shader program with reflected uniforms and attributes.
+ *        All the active uniforms and attributes are queried once when the
+ *        program is created, so drawing never has to look up locations by
+ *        name or ask the driver which program is bound.
+ */
+class OkShaderProgram {
+public:
+  // Reflected uniform or attribute
+  struct Variable {
+    GLint  location;
+    GLenum type;
+    GLint  size;  // Number of elements for arrays, 1 otherwise
+  };
+
+  // Takes ownership of an already linked program
+  OkShaderProgram(GLuint programId);
+  ~OkShaderProgram();
+
+  // Delete copy constructor and assignment
+  OkShaderProgram(const OkShaderProgram &)            = delete;
+  OkShaderProgram &operator=(const OkShaderProgram &) = delete;
+
+  // Compile and link a program, returns nullptr on failure
+  static OkShaderProgram *create(const std::string &vertexSource,
+                                 const std::string &fragmentSource);
+
+  // Bind the program (does nothing if it is already bound)
+  void use();
+
+  // Program bound through use(), nullptr if none
+  static OkShaderProgram *getCurrent() { return _current; }
+
+  // Getters
+  GLuint getId() const { return id; }
+  bool   isValid() const { return id != 0; }
+
+  // Variants: set the program belongs to, nullptr if built on its own, and
+  // the features it was compiled with
+  OkShaderVariants *getVariants() const { return variants; }
+  uint32_t          getFeatures() const { return features; }
+  bool              hasFeature(uint32_t feature) const {
+    return (features & feature) != 0;
+  }
+  OkShaderProgram *getVariant(uint32_t features);
+
+  // Reflection
+  GLint getUniformLocation(OkUniform uniform) const {
+    return slots[static_cast<int>(uniform)];
+  }
+  GLint getUniformLocation(const std::string &name) const;
+  GLint getAttributeLocation(const std::string &name) const;
+  bool  hasUniform(OkUniform uniform) const {
+    return getUniformLocation(uniform) != -1;
+  }
+  bool hasBlock(OkUniformBlock block) const {
+    return blocks[static_cast<int>(block)];
+  }
+  const std::unordered_map<std::string, Variable> &getUniforms() const {
+    return uniforms;
+  }
+  const std::unordered_map<std::string, Variable> &getAttributes() const {
+    return attributes;
+  }
+
+  // Name of a well-known uniform or block in the shader sources
+  static const char *getUniformName(OkUniform uniform);
+  static const char *getBlockName(OkUniformBlock block);
+
+  // Typed setters, they apply to this program, which must be bound
+  void setInt(OkUniform uniform, int value);
+  void setBool(OkUniform uniform, bool value);
+  void setFloat(OkUniform uniform, float value);
+  void setVec3(OkUniform uniform, const glm::vec3 &value);
+  void setVec4(OkUniform uniform, const glm::vec4 &value);
+  void setMat4(OkUniform uniform, const glm::mat4 &value);
+  void setMat4(OkUniform uniform, const float *value);
+
+private:
+  friend class OkShaderVariants;
+
+  void _reflect();
+
+  GLuint id;
+
+  OkShaderVariants *variants;
+  uint32_t          features;
+
+  std::unordered_map<std::string, Variable> uniforms;
+  std::unordered_map<std::string, Variable> attributes;
+  GLint slots[static_cast<int>(OkUniform::Count)];
+  bool  blocks[static_cast<int>(OkUniformBlock::Count)];  // Active blocks
+
+  static OkShaderProgram *_current;
+};
+
+#endif
@@ -2,6 +2,8 @@
 #include "../config/config.hpp"
 #include "../core/gl_config.hpp"
 #include "../utils/logger.hpp"
+#include "cache.hpp"
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -43,8 +45,26 @@ GLuint OkShader::compile(const std::string &source, GLenum shaderType,
   return shader;
 }
 
+/**
+ * @brief Create a shader program from vertex and fragment shader sources.
+ *        Programs linked before are loaded from OkProgramCache, others are
+ *        compiled, linked and saved there.
+ * @param vertexSource   The vertex shader source code.
+ * @param fragmentSource The fragment shader source code.
+ * @return The linked program ID, or 0 on failure.
+ */
 GLuint OkShader::createProgram(const std::string &vertexSource,
                                const std::string &fragmentSource) {
+  bool     cache = OkProgramCache::isEnabled();
+  uint64_t key   = 0;
+  if (cache) {
+    key            = OkProgramCache::getKey(vertexSource, fragmentSource);
+    GLuint program = OkProgramCache::load(key);
+    if (program) {
+      return program;
+    }
+  }
+
   // Compile shaders
   GLuint vertexShader = compile(vertexSource, GL_VERTEX_SHADER, "vertex");
   if (!vertexShader) {
@@ -60,6 +80,9 @@ GLuint OkShader::createProgram(const std::string &vertexSource,
 
   // Create and link program
   GLuint program = glCreateProgram();
+  if (cache) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
   glAttachShader(program, vertexShader);
   glAttachShader(program, fragmentShader);
   glLinkProgram(program);
@@ -75,6 +98,8 @@ GLuint OkShader::createProgram(const std::string &vertexSource,
     OkLogger::error("Shader", "Linking error:\n" + std::string(infoLog.data()));
     glDeleteProgram(program);
     program = 0;
+  } else if (cache) {
+    OkProgramCache::save(key, program);
   }
 
   // Clean up shaders
@@ -0,0 +1,126 @@
+#include "variants.hpp"
+#include "../utils/logger.hpp"
+#include "program.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Names of the feature defines, in bit order
+static const char *featureNames[] = {"TEXTURED", "TEXTURE_ARRAY", "INSTANCED"};
+
+static_assert(sizeof(featureNames) / sizeof(featureNames[0]) ==
+                  OkShaderVariants::featureCount,
+              "Missing feature names");
+
+/**
+ * @brief Constructor for the OkShaderVariants class.
+ *        Nothing is compiled until a variant is asked for.
+ * @param vertexSource   The vertex shader source code.
+ * @param fragmentSource The fragment shader source code.
+ */
+OkShaderVariants::OkShaderVariants(const std::string &vertexSource,
+                                   const std::string &fragmentSource)
+    : vertexSource(vertexSource), fragmentSource(fragmentSource),
+      programs(size_t(1) << featureCount, nullptr),
+      failed(size_t(1) << featureCount, false) {}
+
+/**
+ * @brief Destructor for the OkShaderVariants class.
+ *        Deletes all the compiled variants.
+ */
+OkShaderVariants::~OkShaderVariants() {
+  for (size_t i = 0; i < programs.size(); i++) {
+    delete programs[i];
+    programs[i] = nullptr;
+  }
+}
+
+/**
+ * @brief Get the program with a set of features, compiling it the first
+ *        time. A variant that fails to compile is reported once and never
+ *        compiled again.
+ * @param features The features, OR-ed together.
+ * @return The program, or nullptr if it does not compile.
+ */
+OkShaderProgram *OkShaderVariants::get(uint32_t features) {
+  features = normalize(features);
+  if (programs[features] || failed[features]) {
+    return programs[features];
+  }
+
+  OkShaderProgram *program =
+      OkShaderProgram::create(addDefines(vertexSource, features),
+                              addDefines(fragmentSource, features));
+  if (!program) {
+    OkLogger::error("Shader", "Cannot build variant " +
+                                  std::to_string(features) + " of program");
+    failed[features] = true;
+    return nullptr;
+  }
+
+  program->variants  = this;
+  program->features  = features;
+  programs[features] = program;
+  return program;
+}
+
+/**
+ * @brief Get the number of variants compiled so far.
+ * @return The number of variants.
+ */
+size_t OkShaderVariants::getCompiledCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < programs.size(); i++) {
+    if (programs[i]) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Get the features a variant is built with.
+ *        Unknown bits are dropped, and texture arrays without textures,
+ *        which would sample nothing, become untextured.
+ * @param features The features asked for.
+ * @return The features of the variant.
+ */
+uint32_t OkShaderVariants::normalize(uint32_t features) {
+  features &= (1u << featureCount) - 1;
+  if (!(features & textured)) {
+    features &= ~textureArray;
+  }
+  return features;
+}
+
+/**
+ * @brief Add the #define lines of a set of features to a shader source.
+ *        They go right after the #version line, which must come first.
+ * @param source   The shader source code.
+ * @param features The features, OR-ed together.
+ * @return The source with the defines.
+ */
+std::string OkShaderVariants::addDefines(const std::string &source,
+                                         uint32_t           features) {
+  std::string defines;
+  for (uint32_t i = 0; i < featureCount; i++) {
+    if (features & (1u << i)) {
+      defines += std::string("#define ") + featureNames[i] + "\n";
+    }
+  }
+  if (defines.empty()) {
+    return source;
+  }
+
+  // Sources without a version line get the defines first
+  std::string::size_type position = source.find("#version");
+  if (position == std::string::npos) {
+    return defines + source;
+  }
+
+  std::string::size_type end = source.find('\n', position);
+  if (end == std::string::npos) {
+    return source + "\n" + defines;
+  }
+  return source.substr(0, end + 1) + defines + source.substr(end + 1);
+}
@@ -0,0 +1,55 @@
+#ifndef OK_VARIANTS_HPP
+#define OK_VARIANTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class OkShaderProgram;
+
+/**
+ * @brief Programs built from the same sources with different features.
+ *        Each feature is compiled in as a #define, so the shaders branch at
+ *        compile time instead of per fragment, and the state they used to
+ *        read from uniforms is never sent while drawing. Variants are
+ *        compiled the first time they are asked for and kept until the set
+ *        is deleted.
+ */
+class OkShaderVariants {
+public:
+  // Features, each defined with the name in the comment
+  static constexpr uint32_t textured     = 1u << 0;  // TEXTURED
+  static constexpr uint32_t textureArray = 1u << 1;  // TEXTURE_ARRAY
+  static constexpr uint32_t instanced    = 1u << 2;  // INSTANCED
+  static constexpr uint32_t featureCount = 3;
+
+  OkShaderVariants(const std::string &vertexSource,
+                   const std::string &fragmentSource);
+  ~OkShaderVariants();
+
+  // Delete copy constructor and assignment
+  OkShaderVariants(const OkShaderVariants &)            = delete;
+  OkShaderVariants &operator=(const OkShaderVariants &) = delete;
+
+  // Program with a set of features, nullptr if it does not compile
+  OkShaderProgram *get(uint32_t features);
+
+  // Number of variants compiled so far
+  size_t getCompiledCount() const;
+
+  // Features a variant is really built with, texture arrays need textures
+  static uint32_t normalize(uint32_t features);
+
+  // Source with the #define lines of a set of features
+  static std::string addDefines(const std::string &source, uint32_t features);
+
+private:
+  std::string vertexSource;
+  std::string fragmentSource;
+
+  std::vector<OkShaderProgram *> programs;  // By features, nullptr until built
+  std::vector<bool>              failed;    // Variants not compiled again
+};
+
+#endif
@@ -1,9 +1,21 @@
 #include "files.hpp"
 #include "logger.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <ios>
 #include <sstream>
 #include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /**
  * @brief Read the contents of a file into a string.
@@ -24,3 +36,136 @@ std::string OkFiles::readFile(const std::string &filename) {
 
   return buffer.str();
 }
+
+/**
+ * @brief Get the size and modification time of a file.
+ * @param filename The name of the file.
+ * @param size     Receives the size in bytes.
+ * @param modified Receives the modification time, in seconds since the epoch.
+ * @return True if the file exists, false otherwise. Nothing is logged, so
+ *         this can be used to check for optional files.
+ */
+bool OkFiles::getFileInfo(const std::string &filename, uint64_t &size,
+                          int64_t &modified) {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0) {
+    return false;
+  }
+
+  size     = static_cast<uint64_t>(info.st_size);
+  modified = static_cast<int64_t>(info.st_mtime);
+  return true;
+}
+
+/**
+ * @brief Get the name of a file without its path and extension.
+ * @param filename The name of the file.
+ * @return The base name.
+ */
+std::string OkFiles::getBaseName(const std::string &filename) {
+  size_t      lastSlash = filename.find_last_of("/\\");
+  std::string baseName  = (lastSlash == std::string::npos)
+                              ? filename
+                              : filename.substr(lastSlash + 1);
+  size_t      dot       = baseName.find_last_of('.');
+  return (dot == std::string::npos) ? baseName : baseName.substr(0, dot);
+}
+
+/**
+ * @brief Hash a block of data.
+ *        The data is read 8 bytes at a time and mixed with multiplications,
+ *        so hashing runs close to memory speed. It detects changes in files,
+ *        it is not meant to resist deliberate collisions.
+ * @param data The data.
+ * @param size The size of the data in bytes.
+ * @return The hash.
+ */
+uint64_t OkFiles::hashData(const char *data, size_t size) {
+  const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+  uint64_t       hash       = 0xcbf29ce484222325ull ^ size;
+
+  size_t offset = 0;
+  for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + offset, sizeof(word));
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 29;
+  }
+
+  // Remaining bytes
+  uint64_t tail = 0;
+  if (offset < size) {
+    std::memcpy(&tail, data + offset, size - offset);
+  }
+  hash = (hash ^ tail) * multiplier;
+  return hash ^ (hash >> 32);
+}
+
+/**
+ * @brief Open a file and map it in memory.
+ *        If mapping fails (or is not supported), the file is read into a
+ *        buffer instead. Use isOpen to check for errors.
+ * @param filename The name of the file.
+ */
+OkMappedFile::OkMappedFile(const std::string &filename) {
+  data   = nullptr;
+  size   = 0;
+  open   = false;
+  mapped = false;
+
+#ifndef _WIN32
+  int descriptor = ::open(filename.c_str(), O_RDONLY);
+  if (descriptor >= 0) {
+    struct stat info;
+    if (fstat(descriptor, &info) == 0) {
+      size = static_cast<size_t>(info.st_size);
+      open = true;
+
+      // Empty files cannot be mapped, there is nothing to read anyway
+      if (size > 0) {
+        void *address =
+            mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address != MAP_FAILED) {
+          data   = static_cast<const char *>(address);
+          mapped = true;
+          madvise(address, size, MADV_SEQUENTIAL);
+        }
+      }
+    }
+    close(descriptor);
+
+    if (mapped || (open && size == 0)) {
+      return;
+    }
+  }
+#endif
+
+  // Fallback, read the whole file
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    OkLogger::error("Utils", "Failed to open file: " + filename);
+    open = false;
+    size = 0;
+    return;
+  }
+
+  size = static_cast<size_t>(file.tellg());
+  buffer.resize(size);
+  file.seekg(0);
+  file.read(buffer.data(), static_cast<std::streamsize>(size));
+
+  data = buffer.data();
+  open = true;
+}
+
+/**
+ * @brief Destructor for the OkMappedFile class.
+ *        Unmaps the file, the data pointer is not valid afterwards.
+ */
+OkMappedFile::~OkMappedFile() {
+#ifndef _WIN32
+  if (mapped) {
+    munmap(const_cast<char *>(data), size);
+  }
+#endif
+}
@@ -1,7 +1,10 @@
 #ifndef OK_FILES_HPP
 #define OK_FILES_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 class OkFiles {
 public:
@@ -10,8 +13,40 @@ public:
 
   // File operations
   static std::string readFile(const std::string &filename);
+  static bool        getFileInfo(const std::string &filename, uint64_t &size,
+                                 int64_t &modified);
+  static std::string getBaseName(const std::string &filename);
+
+  // Fast non-cryptographic hash of file contents
+  static uint64_t hashData(const char *data, size_t size);
+
+private:
+};
+
+/**
+ * @brief Read-only view of a whole file, memory mapped when the platform
+ *        supports it, so large files are read without copies. Otherwise the
+ *        file is read into a buffer.
+ */
+class OkMappedFile {
+public:
+  explicit OkMappedFile(const std::string &filename);
+  ~OkMappedFile();
+
+  // Delete copy constructor and assignment
+  OkMappedFile(const OkMappedFile &)            = delete;
+  OkMappedFile &operator=(const OkMappedFile &) = delete;
+
+  bool        isOpen() const { return open; }
+  const char *getData() const { return data; }
+  size_t      getSize() const { return size; }
 
 private:
+  const char       *data;
+  size_t            size;
+  bool              open;
+  bool              mapped;  // data must be unmapped, not owned by buffer
+  std::vector<char> buffer;  // Contents when the file is not mapped
 };
 
 #endif
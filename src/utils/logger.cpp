@@ -3,6 +3,7 @@
 #include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -28,6 +29,9 @@ namespace {
   const char *WARNING_COLOR = "\x1b[33m";  // Yellow
   const char *ERROR_COLOR   = "\x1b[31m";  // Red
 
+  // Serializes messages logged from several threads
+  std::mutex logMutex;
+
   /**
    * @brief Get the string representation of a log level.
    * @param level The log level (Info, Warning, Error).
@@ -91,6 +95,7 @@ void OkLogger::log(LogLevel level, const std::string &type,
     return;
   }
 
+  std::lock_guard<std::mutex> lock(logMutex);
   std::cerr << getLevelColor(level) << getCurrentTimestamp() << " ["
             << getLevelString(level) << "]: ";
 
@@ -0,0 +1,67 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/render/allocator.hpp"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+
+TEST_CASE("OkRangeAllocator", "[allocator]") {
+  OkRangeAllocator allocator(100);
+  size_t           first  = 0;
+  size_t           second = 0;
+  size_t           third  = 0;
+
+  REQUIRE(allocator.allocate(10, first));
+  REQUIRE(allocator.allocate(20, second));
+  REQUIRE(allocator.allocate(30, third));
+  REQUIRE(first == 0);
+  REQUIRE(second == 10);
+  REQUIRE(third == 30);
+  REQUIRE(allocator.getUsed() == 60);
+  REQUIRE(allocator.getFragmentation() == 0.0f);
+
+  SECTION("Ranges larger than any free range fail") {
+    size_t offset = 0;
+    REQUIRE_FALSE(allocator.allocate(41, offset));
+    REQUIRE(allocator.getUsed() == 60);
+  }
+
+  SECTION("Freed ranges are reused first") {
+    allocator.free(second, 20);
+    REQUIRE(allocator.getRangeCount() == 2);
+    REQUIRE(allocator.getLargestFree() == 40);
+    REQUIRE(allocator.getFragmentation() == Catch::Approx(1.0f / 3.0f));
+
+    size_t offset = 0;
+    REQUIRE(allocator.allocate(15, offset));
+    REQUIRE(offset == 10);
+  }
+
+  SECTION("Freed ranges merge with their free neighbours") {
+    allocator.free(first, 10);
+    allocator.free(third, 30);
+    REQUIRE(allocator.getRangeCount() == 2);
+
+    allocator.free(second, 20);
+    REQUIRE(allocator.getRangeCount() == 1);
+    REQUIRE(allocator.getFree() == 100);
+    REQUIRE(allocator.getLargestFree() == 100);
+  }
+
+  SECTION("Empty ranges take nothing") {
+    size_t offset = 7;
+    REQUIRE(allocator.allocate(0, offset));
+    REQUIRE(offset == 0);
+    allocator.free(offset, 0);
+    REQUIRE(allocator.getUsed() == 60);
+  }
+
+  SECTION("Reset frees everything") {
+    allocator.reset(50);
+    REQUIRE(allocator.getCapacity() == 50);
+    REQUIRE(allocator.getFree() == 50);
+    REQUIRE(allocator.getRangeCount() == 1);
+  }
+}
+
+// NOLINTEND(readability-magic-numbers)
@@ -47,6 +47,14 @@ TEST_CASE("OkConfig value modifications", "[config]") {
     OkConfig::setBool("graphics.textures", false);
     REQUIRE_FALSE(OkConfig::getBool("graphics.textures"));
   }
+
+  SECTION("Modify string values") {
+    REQUIRE(OkConfig::getString("shaders.program-cache-dir").empty());
+
+    OkConfig::setString("shaders.program-cache-dir", "cache");
+    REQUIRE(OkConfig::getString("shaders.program-cache-dir") == "cache");
+    OkConfig::setString("shaders.program-cache-dir", "");
+  }
 }
 
 TEST_CASE("OkConfig error handling", "[config]") {
@@ -54,6 +62,7 @@ TEST_CASE("OkConfig error handling", "[config]") {
     REQUIRE(OkConfig::getInt("nonexistent.int") == 0);
     REQUIRE(OkConfig::getFloat("nonexistent.float") == 0.0f);
     REQUIRE_FALSE(OkConfig::getBool("nonexistent.bool"));
+    REQUIRE(OkConfig::getString("nonexistent.string").empty());
   }
 
   SECTION("Wrong type access") {
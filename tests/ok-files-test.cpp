@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 TEST_CASE("OkFiles basic operations", "[files]") {
@@ -34,3 +35,35 @@ TEST_CASE("OkFiles basic operations", "[files]") {
     REQUIRE(content.back() == '\n');  // Last character should be newline
   }
 }
+
+TEST_CASE("OkFiles names, information and hashes", "[files]") {
+  SECTION("Base names have no path or extension") {
+    REQUIRE(OkFiles::getBaseName("assets/models/cube.obj") == "cube");
+    REQUIRE(OkFiles::getBaseName("C:\\models\\cube.obj") == "cube");
+    REQUIRE(OkFiles::getBaseName("cube") == "cube");
+  }
+
+  SECTION("File information") {
+    uint64_t size     = 0;
+    int64_t  modified = 0;
+    REQUIRE(OkFiles::getFileInfo("tests/test-file.txt", size, modified));
+    REQUIRE(size == OkFiles::readFile("tests/test-file.txt").size());
+    REQUIRE(modified > 0);
+    REQUIRE_FALSE(
+        OkFiles::getFileInfo("non-existent-file.txt", size, modified));
+  }
+
+  SECTION("Hashes depend on every byte") {
+    std::string data = "Some data that is longer than a word";
+    uint64_t    hash = OkFiles::hashData(data.data(), data.size());
+    REQUIRE(hash == OkFiles::hashData(data.data(), data.size()));
+
+    for (size_t i = 0; i < data.size(); i++) {
+      std::string changed = data;
+      changed[i]          = '_';
+      REQUIRE(OkFiles::hashData(changed.data(), changed.size()) != hash);
+    }
+    REQUIRE(OkFiles::hashData(data.data(), data.size() - 1) != hash);
+    REQUIRE(OkFiles::hashData(nullptr, 0) != hash);
+  }
+}
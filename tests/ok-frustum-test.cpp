@@ -0,0 +1,180 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/core/camera.hpp"
+#include "../src/core/object.hpp"
+#include "../src/render/frustum.hpp"
+#include "../src/render/queue.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+using Catch::Matchers::WithinAbs;
+
+// Object with a unit bounding sphere that counts its submissions
+class OkBoundedObject : public OkObject {
+public:
+  OkBoundedObject(const std::string &name) : OkObject(name), submissions(0) {}
+
+  int submissions;
+
+protected:
+  void drawSelf() override {}
+  void stepSelf(float dt) override {}
+  void updateTransformSelf() override {}
+  void submitSelf(OkRenderQueue &queue) override { submissions++; }
+
+  OkBoundingSphere getLocalBounds() const override {
+    return OkBoundingSphere::sphere(glm::vec3(0.0f), 1.0f);
+  }
+};
+
+TEST_CASE("OkFrustum sphere tests", "[frustum]") {
+  // Looking down -Z from the origin, planes at 1 and 100
+  glm::mat4 projection =
+      glm::perspective(glm::radians(60.0f), 1.0f, 1.0f, 100.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+
+  OkFrustum frustum;
+  frustum.extract(projection * view);
+
+  SECTION("Planes are normalized") {
+    for (int i = 0; i < OkFrustum::planeCount; i++) {
+      REQUIRE_THAT(glm::length(glm::vec3(frustum.getPlane(i))),
+                   WithinAbs(1.0f, 0.0001f));
+    }
+  }
+
+  SECTION("Spheres are classified") {
+    auto test = [&](float x, float y, float z, float radius) {
+      return frustum.test(OkBoundingSphere::sphere(glm::vec3(x, y, z), radius));
+    };
+
+    REQUIRE(test(0.0f, 0.0f, -10.0f, 1.0f) == OkCullResult::Inside);
+    REQUIRE(test(0.0f, 0.0f, 10.0f, 1.0f) == OkCullResult::Outside);
+    REQUIRE(test(0.0f, 0.0f, -200.0f, 1.0f) == OkCullResult::Outside);
+    REQUIRE(test(100.0f, 0.0f, -10.0f, 1.0f) == OkCullResult::Outside);
+    REQUIRE(test(0.0f, 0.0f, -100.0f, 5.0f) == OkCullResult::Intersecting);
+    REQUIRE(test(0.0f, 0.0f, 0.0f, 2.0f) == OkCullResult::Intersecting);
+  }
+
+  SECTION("Empty and infinite bounds") {
+    REQUIRE(frustum.test(OkBoundingSphere::empty()) == OkCullResult::Outside);
+    REQUIRE(frustum.test(OkBoundingSphere::unbounded()) ==
+            OkCullResult::Intersecting);
+  }
+}
+
+TEST_CASE("OkBoundingSphere merging", "[frustum]") {
+  OkBoundingSphere bounds =
+      OkBoundingSphere::sphere(glm::vec3(-2.0f, 0.0f, 0.0f), 1.0f);
+
+  SECTION("Disjoint spheres") {
+    bounds.merge(OkBoundingSphere::sphere(glm::vec3(2.0f, 0.0f, 0.0f), 1.0f));
+    REQUIRE_THAT(bounds.center.x, WithinAbs(0.0f, 0.0001f));
+    REQUIRE_THAT(bounds.radius, WithinAbs(3.0f, 0.0001f));
+  }
+
+  SECTION("Contained sphere") {
+    bounds.merge(OkBoundingSphere::sphere(glm::vec3(-2.0f, 0.5f, 0.0f), 0.2f));
+    REQUIRE_THAT(bounds.center.x, WithinAbs(-2.0f, 0.0001f));
+    REQUIRE_THAT(bounds.radius, WithinAbs(1.0f, 0.0001f));
+  }
+
+  SECTION("Empty and infinite bounds") {
+    bounds.merge(OkBoundingSphere::empty());
+    REQUIRE_THAT(bounds.radius, WithinAbs(1.0f, 0.0001f));
+
+    bounds.merge(OkBoundingSphere::unbounded());
+    REQUIRE(bounds.infinite);
+  }
+
+  SECTION("Transformed by a scaled matrix") {
+    glm::mat4 matrix =
+        glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 10.0f, 0.0f));
+    matrix = glm::scale(matrix, glm::vec3(1.0f, 3.0f, 1.0f));
+
+    OkBoundingSphere moved = bounds.transformed(matrix);
+    REQUIRE_THAT(moved.center.y, WithinAbs(10.0f, 0.0001f));
+    REQUIRE_THAT(moved.radius, WithinAbs(3.0f, 0.0001f));
+  }
+}
+
+TEST_CASE("OkObject hierarchical culling", "[frustum]") {
+  OkCamera camera("camera", 800, 600);
+  camera.updateTransform(1.0f);
+  glm::vec3 forward = camera.getRotation().getForwardVector().toVec3();
+
+  OkBoundedObject parent("parent");
+  OkBoundedObject child("child");
+  OkBoundedObject grandchild("grandchild");
+  child.attachTo(&parent);
+  grandchild.attachTo(&child);
+
+  OkRenderQueue queue;
+
+  SECTION("Subtree bounds contain the descendants") {
+    child.setPosition(10.0f, 0.0f, 0.0f);
+    parent.updateTransform(1.0f);
+
+    const OkBoundingSphere &bounds = parent.getSubtreeBounds();
+    REQUIRE_THAT(bounds.center.x, WithinAbs(5.0f, 0.0001f));
+    REQUIRE_THAT(bounds.radius, WithinAbs(6.0f, 0.0001f));
+
+    // Detaching shrinks the bounds of the former parent
+    child.detachFromParent();
+    parent.updateTransform(1.0f);
+    REQUIRE_THAT(parent.getSubtreeBounds().radius, WithinAbs(1.0f, 0.0001f));
+    child.attachTo(&parent);
+  }
+
+  SECTION("A subtree behind the camera is skipped as a whole") {
+    glm::vec3 behind = forward * -20.0f;
+    parent.setPosition(behind.x, behind.y, behind.z);
+    parent.updateTransform(1.0f);
+
+    queue.begin(nullptr, &camera);
+    parent.submit(queue);
+
+    REQUIRE(parent.submissions == 0);
+    REQUIRE(grandchild.submissions == 0);
+    REQUIRE(queue.getCulledCount() == 3);
+    REQUIRE(queue.getVisibleCount() == 0);
+  }
+
+  SECTION("Only the visible part of a subtree is submitted") {
+    // The parent is in front of the camera, its child behind
+    glm::vec3 ahead = forward * 20.0f;
+    parent.setPosition(ahead.x, ahead.y, ahead.z);
+    glm::vec3 back = forward * -40.0f;
+    child.setPosition(back.x, back.y, back.z);
+    parent.updateTransform(1.0f);
+
+    queue.begin(nullptr, &camera);
+    parent.submit(queue);
+
+    REQUIRE(parent.submissions == 1);
+    REQUIRE(child.submissions == 0);
+    REQUIRE(grandchild.submissions == 0);
+    REQUIRE(queue.getCulledCount() == 2);
+    REQUIRE(queue.getVisibleCount() == 1);
+  }
+
+  SECTION("Nothing is culled without a camera") {
+    glm::vec3 behind = forward * -20.0f;
+    parent.setPosition(behind.x, behind.y, behind.z);
+    parent.updateTransform(1.0f);
+
+    queue.begin(nullptr, nullptr);
+    parent.submit(queue);
+
+    REQUIRE(grandchild.submissions == 1);
+    REQUIRE(queue.getCulledCount() == 0);
+  }
+
+  queue.clear();
+}
+
+// NOLINTEND(readability-magic-numbers)
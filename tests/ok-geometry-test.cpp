@@ -0,0 +1,115 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/config/config.hpp"
+#include "../src/handlers/geometry.hpp"
+#include "../src/item/mesh.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "test-opengl.hpp"
+
+// Quad with texture coordinates (3 pos + 2 tex per vertex)
+static const float quadVertices[] = {
+    -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,  // Vertex 0
+    1.0f,  0.0f, 0.0f, 1.0f, 0.0f,  // Vertex 1
+    1.0f,  2.0f, 0.0f, 1.0f, 1.0f,  // Vertex 2
+    -1.0f, 2.0f, 0.0f, 0.0f, 1.0f,  // Vertex 3
+};
+static const unsigned int quadIndices[] = {0, 1, 2, 0, 2, 3};
+
+TEST_CASE("OkGeometryPool", "[geometry]") {
+  TestGLFWContext context;  // OpenGL context
+
+  OkGeometryPool *pool  = OkGeometryPool::getInstance();
+  int             bytes = OkConfig::getInt("graphics.geometry-page-bytes");
+  REQUIRE(OkGeometryPool::isEnabled());
+
+  SECTION("Meshes of a layout share the vertex array of a page") {
+    OkMesh first(quadVertices, 20, quadIndices, 6);
+    OkMesh second(quadVertices, 20, quadIndices, 6);
+
+    REQUIRE(first.isPooled());
+    REQUIRE(second.isPooled());
+    REQUIRE(first.getVAO() == second.getVAO());
+    REQUIRE(pool->getPageCount() == 1);
+    REQUIRE(pool->getAllocationCount() == 2);
+
+    // The second mesh follows the first in both buffers
+    REQUIRE(first.getBaseVertex() == 0);
+    REQUIRE(second.getBaseVertex() == 4);
+    REQUIRE(first.getIndexOffset() == 0);
+    REQUIRE(second.getIndexOffset() ==
+            static_cast<GLintptr>(6 * sizeof(uint16_t)));
+    REQUIRE(first.getInstanceBuffer() == second.getInstanceBuffer());
+  }
+
+  SECTION("Empty pages are deleted") {
+    {
+      OkMesh mesh(quadVertices, 20, quadIndices, 6);
+      REQUIRE(pool->getPageCount() == 1);
+    }
+    REQUIRE(pool->getPageCount() == 0);
+    REQUIRE(pool->getUsedBytes() == 0);
+  }
+
+  SECTION("Full pages are compacted before a new page is created") {
+    // Room for four quads
+    size_t stride = OkVertexLayout::standard().getStride();
+    OkConfig::setInt("graphics.geometry-page-bytes",
+                     static_cast<int>(16 * stride));
+
+    OkMesh  first(quadVertices, 20, quadIndices, 6);
+    OkMesh *second = new OkMesh(quadVertices, 20, quadIndices, 6);
+    OkMesh  third(quadVertices, 20, quadIndices, 6);
+    delete second;
+
+    // Neither the hole nor the tail holds a mesh of two quads, both do
+    std::vector<float>        vertices(quadVertices, quadVertices + 20);
+    std::vector<unsigned int> indices(quadIndices, quadIndices + 6);
+    vertices.insert(vertices.end(), quadVertices, quadVertices + 20);
+    indices.insert(indices.end(), quadIndices, quadIndices + 6);
+
+    size_t moved = pool->getMovedBytes();
+    OkMesh large(vertices.data(), 40, indices.data(), 12);
+    REQUIRE(pool->getPageCount() == 1);
+    REQUIRE(pool->getMovedBytes() > moved);
+    REQUIRE(third.getBaseVertex() == 4);
+    REQUIRE(large.getBaseVertex() == 8);
+    REQUIRE(large.getVAO() == first.getVAO());
+  }
+
+  SECTION("Scattered pages are compacted by update") {
+    std::vector<OkMesh *> meshes;
+    for (int i = 0; i < 4; i++) {
+      meshes.push_back(new OkMesh(quadVertices, 20, quadIndices, 6));
+    }
+    delete meshes[0];
+    delete meshes[2];
+
+    // The free tail of the page dwarfs the holes
+    REQUIRE(pool->update() == 0);
+
+    size_t moved = pool->defragment();
+    REQUIRE(moved > 0);
+    REQUIRE(meshes[1]->getBaseVertex() == 0);
+    REQUIRE(meshes[3]->getBaseVertex() == 4);
+    REQUIRE(pool->defragment() == 0);
+
+    delete meshes[1];
+    delete meshes[3];
+  }
+
+  SECTION("Meshes own their buffers when the pool is disabled") {
+    OkConfig::setBool("graphics.geometry-pool", false);
+    OkMesh mesh(quadVertices, 20, quadIndices, 6);
+    REQUIRE_FALSE(mesh.isPooled());
+    REQUIRE(mesh.getBaseVertex() == 0);
+    REQUIRE(pool->getPageCount() == 0);
+    OkConfig::setBool("graphics.geometry-pool", true);
+  }
+
+  OkConfig::setInt("graphics.geometry-page-bytes", bytes);
+}
+
+// NOLINTEND(readability-magic-numbers)
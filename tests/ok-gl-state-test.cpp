@@ -0,0 +1,75 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/core/gl_config.hpp"
+#include "../src/core/gl_state.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+#include "test-opengl.hpp"
+
+TEST_CASE("OkGLState redundant call elimination", "[glstate]") {
+  TestGLFWContext context;  // OpenGL context
+
+  OkGLState::invalidate();
+  OkGLState::resetCounters();
+
+  SECTION("Repeated state changes are skipped") {
+    OkGLState::enable(GL_DEPTH_TEST);
+    OkGLState::enable(GL_DEPTH_TEST);
+    OkGLState::polygonMode(GL_LINE);
+    OkGLState::polygonMode(GL_LINE);
+    OkGLState::polygonMode(GL_FILL);
+
+    REQUIRE(OkGLState::getIssuedCalls(OkGLStateCall::Capability) == 1);
+    REQUIRE(OkGLState::getSkippedCalls(OkGLStateCall::Capability) == 1);
+    REQUIRE(OkGLState::getIssuedCalls(OkGLStateCall::PolygonMode) == 2);
+    REQUIRE(OkGLState::getSkippedCalls(OkGLStateCall::PolygonMode) == 1);
+    REQUIRE(OkGLState::getSkippedCalls() == 2);
+    REQUIRE(glIsEnabled(GL_DEPTH_TEST) == GL_TRUE);
+
+    OkGLState::disable(GL_DEPTH_TEST);
+    REQUIRE(glIsEnabled(GL_DEPTH_TEST) == GL_FALSE);
+  }
+
+  SECTION("Texture bindings are tracked per unit") {
+    GLuint textures[2];
+    glGenTextures(2, textures);
+
+    OkGLState::bindTexture(GL_TEXTURE_2D, textures[0], 0);
+    OkGLState::bindTexture(GL_TEXTURE_2D, textures[1], 1);
+    OkGLState::bindTexture(GL_TEXTURE_2D, textures[0], 0);
+    OkGLState::bindTexture(GL_TEXTURE_2D, textures[1], 1);
+
+    REQUIRE(OkGLState::getIssuedCalls(OkGLStateCall::Texture) == 2);
+    REQUIRE(OkGLState::getSkippedCalls(OkGLStateCall::Texture) == 2);
+
+    GLint bound = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    REQUIRE(static_cast<GLuint>(bound) == textures[1]);
+
+    // Deleting a bound texture resets the shadowed binding
+    OkGLState::deleteTexture(textures[1]);
+    OkGLState::bindTexture(GL_TEXTURE_2D, 0, 1);
+    REQUIRE(OkGLState::getSkippedCalls(OkGLStateCall::Texture) == 3);
+
+    OkGLState::deleteTexture(textures[0]);
+  }
+
+  SECTION("Invalidate forces the next change") {
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+
+    OkGLState::bindVertexArray(vao);
+    OkGLState::bindVertexArray(vao);
+    OkGLState::invalidate();
+    OkGLState::bindVertexArray(vao);
+
+    REQUIRE(OkGLState::getIssuedCalls(OkGLStateCall::VertexArray) == 2);
+    REQUIRE(OkGLState::getSkippedCalls(OkGLStateCall::VertexArray) == 1);
+
+    OkGLState::deleteVertexArray(vao);
+    OkGLState::bindVertexArray(0);
+    REQUIRE(OkGLState::getSkippedCalls(OkGLStateCall::VertexArray) == 2);
+  }
+}
+
+// NOLINTEND(readability-magic-numbers)
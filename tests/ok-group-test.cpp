@@ -0,0 +1,238 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/config/config.hpp"
+#include "../src/handlers/meshes.hpp"
+#include "../src/handlers/textures.hpp"
+#include "../src/item/group.hpp"
+#include "../src/item/item.hpp"
+#include "../src/render/queue.hpp"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+#include "test-opengl.hpp"
+
+// Single textured triangle (3 pos + 2 tex per vertex)
+static float triangleVertices[] = {
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f,  // Vertex 0
+    1.0f, 0.0f, 0.0f, 1.0f, 0.0f,  // Vertex 1
+    0.0f, 1.0f, 0.0f, 0.0f, 1.0f,  // Vertex 2
+};
+static unsigned int triangleIndices[] = {0, 1, 2};
+static unsigned int reversedIndices[] = {2, 1, 0};
+
+TEST_CASE("OkItemGroup instanced draws", "[group]") {
+  TestGLFWContext context;  // OpenGL context
+  int minItems = OkConfig::getInt("graphics.instancing-min-items");
+
+  OkItem *tree = new OkItem("tree", triangleVertices, 15, triangleIndices, 3);
+  OkItem *rock = new OkItem("rock", triangleVertices, 15, reversedIndices, 3);
+
+  OkItemGroup group("forest");
+  group.addItem(tree);
+  group.addItem(rock);
+
+  std::vector<OkItem *> instances;
+  for (int i = 0; i < 4; i++) {
+    OkItem *instance = tree->createInstance("tree" + std::to_string(i));
+    instance->setPosition(static_cast<float>(i), 0.0f, 0.0f);
+    instances.push_back(instance);
+    group.addItem(instance);
+  }
+
+  OkRenderQueue queue;
+  queue.begin(nullptr, nullptr);
+
+  SECTION("Items sharing a mesh are merged into one packet") {
+    OkConfig::setInt("graphics.instancing-min-items", 2);
+    group.submit(queue);
+
+    // One instanced packet for the five trees, one packet for the rock
+    REQUIRE(queue.getPacketCount() == 2);
+    REQUIRE(group.getInstancedDrawCount() == 1);
+  }
+
+  SECTION("Small runs are not instanced") {
+    OkConfig::setInt("graphics.instancing-min-items", 6);
+    group.submit(queue);
+
+    REQUIRE(queue.getPacketCount() == 6);
+    REQUIRE(group.getInstancedDrawCount() == 0);
+  }
+
+  SECTION("Hidden items are not drawn") {
+    OkConfig::setInt("graphics.instancing-min-items", 2);
+    instances[0]->setVisible(false);
+    rock->setVisible(false);
+    group.submit(queue);
+
+    REQUIRE(queue.getPacketCount() == 1);
+    REQUIRE(group.getInstancedDrawCount() == 1);
+  }
+
+  queue.clear();
+  OkConfig::setInt("graphics.instancing-min-items", minItems);
+
+  group.clearItems();
+  for (size_t i = 0; i < instances.size(); i++) {
+    delete instances[i];
+  }
+  delete tree;
+  delete rock;
+  OkMeshHandler::getInstance()->cleanup();
+}
+
+TEST_CASE("OkItemGroup texture arrays", "[group]") {
+  TestGLFWContext   context;  // OpenGL context
+  OkTextureHandler *handler = OkTextureHandler::getInstance();
+  OkConfig::setInt("graphics.instancing-min-items", 2);
+
+  std::vector<unsigned char> pixels(4 * 4 * 4, 255);
+  const char *names[] = {"grass", "sand", "grass", "stone"};
+  int         sizes[] = {2, 2, 2, 4};
+
+  OkItemGroup           group("terrain");
+  std::vector<OkItem *> tiles;
+  for (int i = 0; i < 4; i++) {
+    OkItem *tile = new OkItem("tile" + std::to_string(i), triangleVertices,
+                              15, triangleIndices, 3);
+    tile->setTexture(names[i],
+                     handler->createTextureFromRawData(
+                         names[i], pixels.data(), sizes[i], sizes[i], 4));
+    tiles.push_back(tile);
+    group.addItem(tile);
+  }
+
+  // Grass and sand share a size, stone is left alone
+  REQUIRE(group.packTextures("terrain") == 1);
+  OkTexture *array = tiles[0]->getTexture();
+  REQUIRE(array->isArray());
+  REQUIRE(array->getLayers() == 2);
+  REQUIRE(tiles[1]->getTexture() == array);
+  REQUIRE(tiles[2]->getTexture() == array);
+  REQUIRE(tiles[0]->getTextureLayer() == 0);
+  REQUIRE(tiles[1]->getTextureLayer() == 1);
+  REQUIRE(tiles[2]->getTextureLayer() == 0);
+  REQUIRE_FALSE(tiles[3]->getTexture()->isArray());
+
+  // The source textures are released by the items
+  REQUIRE(handler->getTexture("grass") == nullptr);
+
+  // Tiles on the array are drawn with one instanced packet
+  OkRenderQueue queue;
+  queue.begin(nullptr, nullptr);
+  group.submit(queue);
+  REQUIRE(queue.getPacketCount() == 2);
+  REQUIRE(group.getInstancedDrawCount() == 1);
+  queue.clear();
+
+  // Array names are never reused, a taken name fails instead of returning
+  // the array holding other layers
+  REQUIRE(handler->createTextureArray("terrain0", {"stone", "stone"}) ==
+          nullptr);
+
+  // Packing again only packs the new tiles, on their own array
+  const char *newNames[] = {"dirt", "mud"};
+  for (int i = 0; i < 2; i++) {
+    OkItem *tile = new OkItem("tile" + std::to_string(4 + i),
+                              triangleVertices, 15, triangleIndices, 3);
+    tile->setTexture(newNames[i], handler->createTextureFromRawData(
+                                      newNames[i], pixels.data(), 2, 2, 4));
+    tiles.push_back(tile);
+    group.addItem(tile);
+  }
+
+  REQUIRE(group.packTextures("terrain") == 1);
+  OkTexture *second = tiles[4]->getTexture();
+  REQUIRE(second != array);
+  REQUIRE(second->isArray());
+  REQUIRE(second->getLayers() == 2);
+  REQUIRE(tiles[4]->getTextureName() == "terrain1");
+  REQUIRE(tiles[5]->getTexture() == second);
+  REQUIRE(tiles[4]->getTextureLayer() == 0);
+  REQUIRE(tiles[5]->getTextureLayer() == 1);
+  REQUIRE(tiles[0]->getTexture() == array);
+  REQUIRE(array->getLayers() == 2);
+
+  group.clearItems();
+  for (OkItem *tile : tiles) {
+    delete tile;
+  }
+  REQUIRE(handler->getTexture("terrain0") == nullptr);
+  REQUIRE(handler->getTexture("terrain1") == nullptr);
+
+  handler->cleanup();
+  OkMeshHandler::getInstance()->cleanup();
+}
+
+TEST_CASE("OkItemGroup static batches", "[group]") {
+  TestGLFWContext context;  // OpenGL context
+
+  float chunkSize = OkConfig::getFloat("scene.static-chunk-size");
+  OkConfig::setFloat("scene.static-chunk-size", 10.0f);
+
+  // Two chunks of rocks, and a rock that moves
+  OkItemGroup           group("rocks");
+  std::vector<OkItem *> rocks;
+  float                 positions[] = {1.0f, 2.0f, 3.0f, 11.0f, 12.0f, 4.0f};
+  for (int i = 0; i < 6; i++) {
+    OkItem *rock = new OkItem("rock" + std::to_string(i), triangleVertices,
+                              15, triangleIndices, 3);
+    rock->setPosition(positions[i], 0.0f, 0.0f);
+    rock->setStatic(i < 5);
+    rocks.push_back(rock);
+    group.addItem(rock);
+  }
+
+  OkRenderQueue queue;
+  queue.begin(nullptr, nullptr);
+
+  SECTION("Static items are merged per chunk") {
+    REQUIRE(group.bake() == 2);
+    REQUIRE(group.getStaticBatchCount() == 2);
+    REQUIRE(group.getBakedItemCount() == 5);
+
+    // Two batches and the moving rock
+    group.submit(queue);
+    REQUIRE(queue.getPacketCount() == 3);
+  }
+
+  SECTION("Batches are in world space") {
+    OkConfig::setFloat("scene.static-chunk-size", 100.0f);
+    REQUIRE(group.bake() == 1);
+
+    OkMesh *mesh = nullptr;
+    OkMeshHandler *handler = OkMeshHandler::getInstance();
+    for (const std::string &name : handler->getMeshNames()) {
+      if (name.rfind("rocks:static:", 0) == 0) {
+        mesh = handler->getMesh(name);
+      }
+    }
+    REQUIRE(mesh != nullptr);
+
+    // The second vertex of the second rock, 1 along x from its position
+    REQUIRE(mesh->getVertexCount() == 15);
+    REQUIRE(mesh->getIndexCount() == 15);
+    REQUIRE(mesh->getPosition(4).x == Catch::Approx(3.0f));
+    REQUIRE(mesh->getIndex(4) == 4);
+  }
+
+  SECTION("Removing a baked item unbakes the group") {
+    group.bake();
+    group.removeItem(rocks[0]);
+    REQUIRE(group.getStaticBatchCount() == 0);
+    REQUIRE(group.getBakedItemCount() == 0);
+  }
+
+  queue.clear();
+  OkConfig::setFloat("scene.static-chunk-size", chunkSize);
+
+  group.clearItems();
+  for (OkItem *rock : rocks) {
+    delete rock;
+  }
+  OkMeshHandler::getInstance()->cleanup();
+}
+
+// NOLINTEND(readability-magic-numbers)
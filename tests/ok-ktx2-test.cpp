@@ -0,0 +1,88 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/handlers/textures.hpp"
+#include "../src/importers/ktx2.hpp"
+#include "../src/item/texture.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <string>
+
+#include "test-ktx2.hpp"
+#include "test-opengl.hpp"
+
+TEST_CASE("OkKtx2File reading", "[ktx2]") {
+  const std::string filename = "ok-ktx2-test.ktx2";
+  OkCompressedImage image;
+
+  SECTION("BC1 blocks") {
+    REQUIRE(writeKtx2(filename, 131, 8, 8, true));
+    REQUIRE(OkKtx2File::read(filename, image));
+    REQUIRE(image.isCompressed());
+    REQUIRE(image.format == 0x83F0);
+    REQUIRE(image.width == 8);
+    REQUIRE(image.levels.size() == 4);
+
+    // 8x8 is 2x2 blocks, smaller levels take a whole block
+    REQUIRE(image.levels[0].size == 32);
+    REQUIRE(image.levels[3].size == 8);
+    REQUIRE(image.levels[0].data[0] == 0);
+    REQUIRE(image.levels[2].data[0] == 2);
+  }
+
+  SECTION("Uncompressed pixels") {
+    REQUIRE(writeKtx2(filename, 37, 4, 4, false));
+    REQUIRE(OkKtx2File::read(filename, image));
+    REQUIRE_FALSE(image.isCompressed());
+    REQUIRE(image.pixelFormat == GL_RGBA);
+    REQUIRE(image.levels.size() == 3);
+    REQUIRE(image.levels[1].size == 16);
+    REQUIRE(OkKtx2File::isSupported(image));
+  }
+
+  SECTION("Invalid files") {
+    // Unknown format
+    REQUIRE(writeKtx2(filename, 1000, 4, 4, false));
+    REQUIRE_FALSE(OkKtx2File::read(filename, image));
+
+    // Level sizes not matching the format
+    REQUIRE(writeKtx2(filename, 131, 8, 16, true));
+    REQUIRE_FALSE(OkKtx2File::read(filename, image));
+
+    REQUIRE_FALSE(OkKtx2File::read("missing.ktx2", image));
+  }
+
+  REQUIRE(OkKtx2File::isKtx2("textures/wall.KTX2"));
+  REQUIRE_FALSE(OkKtx2File::isKtx2("textures/wall.png"));
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("OkTexture from KTX2 files", "[ktx2]") {
+  TestGLFWContext   context;  // OpenGL context
+  OkTextureHandler *handler  = OkTextureHandler::getInstance();
+  const std::string filename = "ok-ktx2-texture.ktx2";
+
+  SECTION("Supported formats are uploaded as they are") {
+    // BC4 is core in OpenGL, always supported
+    REQUIRE(writeKtx2(filename, 139, 16, 8, true));
+    OkTexture *texture = handler->createTextureFromFile(filename);
+    REQUIRE(texture != nullptr);
+    REQUIRE(texture->isLoaded());
+    REQUIRE(texture->getWidth() == 16);
+    REQUIRE(texture->getChannels() == 1);
+  }
+
+  SECTION("Unsupported formats without a fallback image fail") {
+    // Invalid format for the driver
+    OkCompressedImage image;
+    image.format = 0x1234;
+    REQUIRE_FALSE(OkKtx2File::isSupported(image));
+
+    REQUIRE(writeKtx2(filename, 1000, 4, 4, false));
+    REQUIRE(handler->createTextureFromFile(filename) == nullptr);
+  }
+
+  handler->cleanup();
+  std::remove(filename.c_str());
+}
+
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,102 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/item/layout.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+TEST_CASE("OkVertexLayout sizes", "[layout]") {
+  OkVertexLayout layout = OkVertexLayout::standard();
+  REQUIRE(layout.getStride() == 20);
+
+  layout.normals = OkNormalFormat::Float;
+  REQUIRE(layout.getStride() == 32);
+  REQUIRE(layout.getNormalOffset() == 20);
+
+  layout = {OkTexcoordFormat::Half, OkNormalFormat::Packed};
+  REQUIRE(layout.getStride() == 20);
+  REQUIRE(layout.getNormalOffset() == 16);
+
+  layout = {OkTexcoordFormat::None, OkNormalFormat::None};
+  REQUIRE(layout.getStride() == 12);
+}
+
+TEST_CASE("OkVertexLayout encoding", "[layout]") {
+  OkVertexLayout layout = {OkTexcoordFormat::Half, OkNormalFormat::Float};
+  OkVertexLayout decoded;
+  REQUIRE(OkVertexLayout::decode(layout.encode(), decoded));
+  REQUIRE(decoded == layout);
+
+  REQUIRE_FALSE(OkVertexLayout::decode(0x7, decoded));
+  REQUIRE_FALSE(OkVertexLayout::decode(0x10000, decoded));
+}
+
+TEST_CASE("OkVertexLayout half floats", "[layout]") {
+  // Values exact in half precision round trip
+  for (float value :
+       {0.0f, 1.0f, -2.5f, 0.5f, 0.25f, 65504.0f, 6.103515625e-5f}) {
+    REQUIRE(OkVertexLayout::halfToFloat(OkVertexLayout::floatToHalf(value)) ==
+            value);
+  }
+
+  REQUIRE(OkVertexLayout::floatToHalf(1.0f) == 0x3c00);
+  REQUIRE(OkVertexLayout::floatToHalf(-2.0f) == 0xc000);
+
+  // Rounding to nearest, ties to even
+  REQUIRE(OkVertexLayout::floatToHalf(1.0f + 1.0f / 2048.0f) == 0x3c00);
+  REQUIRE(OkVertexLayout::floatToHalf(1.0f + 3.0f / 2048.0f) == 0x3c02);
+
+  // Out of range values
+  REQUIRE(OkVertexLayout::floatToHalf(1e6f) == 0x7c00);
+  REQUIRE(OkVertexLayout::floatToHalf(1e-10f) == 0);
+  REQUIRE(OkVertexLayout::floatToHalf(
+              std::numeric_limits<float>::infinity()) == 0x7c00);
+
+  // Smallest subnormal half float
+  REQUIRE(OkVertexLayout::floatToHalf(5.9604645e-8f) == 1);
+  REQUIRE(OkVertexLayout::halfToFloat(1) == 5.9604645e-8f);
+}
+
+TEST_CASE("OkVertexLayout packing", "[layout]") {
+  REQUIRE(OkVertexLayout::packNormal(0.0f, 0.0f, 1.0f) == (511u << 20));
+  REQUIRE(OkVertexLayout::packNormal(-1.0f, 0.0f, 0.0f) == 0x201);
+  REQUIRE(OkVertexLayout::packNormal(2.0f, 0.0f, 0.0f) == 511);
+
+  const float vertices[] = {
+      1.0f, 2.0f, 3.0f, 0.5f, 0.25f, 0.0f, 1.0f, 0.0f,
+  };
+
+  OkVertexLayout             layout = {OkTexcoordFormat::Half,
+                                       OkNormalFormat::Packed};
+  std::vector<unsigned char> packed(layout.getStride());
+  layout.pack(vertices, 8, 1, packed.data());
+
+  float    position[3];
+  uint16_t uv[2];
+  uint32_t normal;
+  std::memcpy(position, packed.data(), sizeof(position));
+  std::memcpy(uv, packed.data() + layout.getTexcoordOffset(), sizeof(uv));
+  std::memcpy(&normal, packed.data() + layout.getNormalOffset(),
+              sizeof(normal));
+  REQUIRE(position[2] == 3.0f);
+  REQUIRE(OkVertexLayout::halfToFloat(uv[0]) == 0.5f);
+  REQUIRE(OkVertexLayout::halfToFloat(uv[1]) == 0.25f);
+  REQUIRE(normal == OkVertexLayout::packNormal(0.0f, 1.0f, 0.0f));
+
+  // Unpacking gives the source back
+  float unpacked[8];
+  layout.unpack(packed.data(), 1, unpacked);
+  for (int i = 0; i < 8; i++) {
+    REQUIRE(unpacked[i] == vertices[i]);
+  }
+
+  // Sources without normals get zero normals
+  layout.pack(vertices, 5, 1, packed.data());
+  std::memcpy(&normal, packed.data() + layout.getNormalOffset(),
+              sizeof(normal));
+  REQUIRE(normal == 0);
+}
+
+// NOLINTEND(readability-magic-numbers)
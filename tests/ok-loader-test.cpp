@@ -0,0 +1,177 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/config/config.hpp"
+#include "../src/handlers/loader.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("OkAssetLoader threads", "[loader]") {
+  OkAssetLoader  *loader     = OkAssetLoader::getInstance();
+  std::thread::id mainThread = std::this_thread::get_id();
+  std::thread::id workThread;
+  std::thread::id uploadThread;
+
+  std::shared_ptr<OkLoadRequest> request = loader->load(
+      "threads",
+      [&workThread] {
+        workThread = std::this_thread::get_id();
+        return true;
+      },
+      [&uploadThread](OkLoadRequest &) {
+        uploadThread = std::this_thread::get_id();
+        return true;
+      });
+  loader->finishAll();
+
+  // Work runs on a worker, upload on the thread calling the loader
+  REQUIRE(request->getState() == OkLoadState::Ready);
+  REQUIRE(workThread != mainThread);
+  REQUIRE(uploadThread == mainThread);
+  REQUIRE(loader->getPendingCount() == 0);
+}
+
+TEST_CASE("OkAssetLoader callbacks", "[loader]") {
+  OkAssetLoader *loader = OkAssetLoader::getInstance();
+  int            calls  = 0;
+
+  std::shared_ptr<OkLoadRequest> request = loader->load(
+      "callbacks", [] { return true; }, nullptr);
+  request->then(&calls, [&calls](OkLoadRequest &) { calls++; });
+  request->then(&loader, [&calls](OkLoadRequest &) { calls += 10; });
+  REQUIRE(calls == 0);
+
+  loader->finishAll();
+  REQUIRE(calls == 11);
+
+  // Callbacks added once the request is done are called right away
+  request->then(&calls, [&calls](OkLoadRequest &) { calls++; });
+  REQUIRE(calls == 12);
+}
+
+TEST_CASE("OkAssetLoader failures", "[loader]") {
+  OkAssetLoader *loader   = OkAssetLoader::getInstance();
+  bool           uploaded = false;
+
+  SECTION("Failed work") {
+    std::shared_ptr<OkLoadRequest> request = loader->load(
+        "failed", [] { return false; },
+        [&uploaded](OkLoadRequest &) {
+          uploaded = true;
+          return true;
+        });
+    loader->finishAll();
+
+    // The upload is skipped
+    REQUIRE(request->getState() == OkLoadState::Failed);
+    REQUIRE_FALSE(uploaded);
+  }
+
+  SECTION("Failed upload") {
+    std::shared_ptr<OkLoadRequest> request = loader->load(
+        "failed", [] { return true; }, [](OkLoadRequest &) { return false; });
+    loader->finishAll();
+    REQUIRE(request->getState() == OkLoadState::Failed);
+  }
+}
+
+TEST_CASE("OkAssetLoader cancel", "[loader]") {
+  OkAssetLoader *loader = OkAssetLoader::getInstance();
+  OkConfig::setInt("loader.threads", 1);
+  loader->cleanup();
+
+  // Keep the only worker busy until the other requests are cancelled
+  std::atomic<bool>              release(false);
+  std::shared_ptr<OkLoadRequest> blocker = loader->load(
+      "blocker",
+      [&release] {
+        while (!release) {
+          std::this_thread::yield();
+        }
+        return true;
+      },
+      nullptr);
+
+  std::atomic<int>               worked(0);
+  int                            calls   = 0;
+  std::shared_ptr<OkLoadRequest> request = loader->load(
+      "cancelled",
+      [&worked] {
+        worked++;
+        return true;
+      },
+      nullptr);
+  request->then(&calls, [&calls](OkLoadRequest &) { calls++; });
+  request->then(&worked, [&calls](OkLoadRequest &) { calls++; });
+
+  SECTION("Cancelled by every owner") {
+    request->cancel(&calls);
+    REQUIRE_FALSE(request->isCancelled());
+    request->cancel(&worked);
+    REQUIRE(request->isCancelled());
+
+    release = true;
+    loader->finishAll();
+    REQUIRE(worked == 0);
+    REQUIRE(calls == 0);
+    REQUIRE(request->getState() == OkLoadState::Failed);
+  }
+
+  SECTION("Owner left") {
+    request->cancel(&calls);
+
+    release = true;
+    loader->finishAll();
+    REQUIRE(worked == 1);
+    REQUIRE(calls == 1);
+    REQUIRE(request->getState() == OkLoadState::Ready);
+  }
+
+  loader->cleanup();
+  OkConfig::setInt("loader.threads", 0);
+}
+
+TEST_CASE("OkAssetLoader budget", "[loader]") {
+  OkAssetLoader *loader = OkAssetLoader::getInstance();
+
+  std::vector<std::shared_ptr<OkLoadRequest>> requests;
+  for (int i = 0; i < 3; i++) {
+    requests.push_back(loader->load("budget", [] { return true; }, nullptr));
+  }
+
+  // Without budget, one request is still uploaded per update
+  int uploaded = 0;
+  while (uploaded == 0) {
+    uploaded = loader->update(0.0f);
+    std::this_thread::yield();
+  }
+  REQUIRE(uploaded == 1);
+  REQUIRE(loader->getPendingCount() == 2);
+
+  loader->finishAll();
+  REQUIRE(loader->getPendingCount() == 0);
+  for (std::shared_ptr<OkLoadRequest> &request : requests) {
+    REQUIRE(request->getState() == OkLoadState::Ready);
+  }
+}
+
+TEST_CASE("OkAssetLoader cleanup", "[loader]") {
+  OkAssetLoader *loader = OkAssetLoader::getInstance();
+
+  std::shared_ptr<OkLoadRequest> request = loader->load(
+      "dropped", [] { return true; }, nullptr);
+  loader->cleanup();
+
+  // Requests not uploaded yet fail
+  REQUIRE(request->getState() == OkLoadState::Failed);
+  REQUIRE(loader->getPendingCount() == 0);
+
+  // Loading starts again after a cleanup
+  request = loader->load("restarted", [] { return true; }, nullptr);
+  loader->finishAll();
+  REQUIRE(request->getState() == OkLoadState::Ready);
+}
+
+// NOLINTEND(readability-magic-numbers)
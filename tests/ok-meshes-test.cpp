@@ -0,0 +1,127 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/handlers/loader.hpp"
+#include "../src/handlers/meshes.hpp"
+#include "../src/item/item.hpp"
+#include "../src/item/mesh.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+
+#include "test-opengl.hpp"
+
+// Single textured triangle (3 pos + 2 tex per vertex)
+static float triangleVertices[] = {
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f,  // Vertex 0
+    1.0f, 0.0f, 0.0f, 1.0f, 0.0f,  // Vertex 1
+    0.0f, 1.0f, 0.0f, 0.0f, 1.0f,  // Vertex 2
+};
+static unsigned int triangleIndices[] = {0, 1, 2};
+
+TEST_CASE("OkMeshHandler shared meshes", "[meshes]") {
+  TestGLFWContext context;  // OpenGL context
+  OkMeshHandler  *handler = OkMeshHandler::getInstance();
+
+  SECTION("Items with identical geometry share one mesh") {
+    OkItem *first  = new OkItem("first", triangleVertices, 15,
+                                triangleIndices, 3);
+    OkItem *second = new OkItem("second", triangleVertices, 15,
+                                triangleIndices, 3);
+
+    REQUIRE(first->getMesh() == second->getMesh());
+    REQUIRE(first->getMeshName() == second->getMeshName());
+    REQUIRE(handler->getReferenceCount(first->getMeshName()) == 2);
+
+    // Lookups by name or handle do not add references
+    OkHandle handle = handler->getHandle(first->getMeshName());
+    REQUIRE(handler->getMesh(first->getMeshName()) == first->getMesh());
+    REQUIRE(handler->getMesh(handle) == first->getMesh());
+    REQUIRE(handler->getReferenceCount(first->getMeshName()) == 2);
+
+    std::string meshName = first->getMeshName();
+    delete first;
+    REQUIRE(handler->getReferenceCount(meshName) == 1);
+
+    // The mesh is deleted with its last item
+    delete second;
+    REQUIRE(handler->getReferenceCount(meshName) == 0);
+    REQUIRE(handler->getMesh(meshName) == nullptr);
+    REQUIRE(handler->getMesh(handle) == nullptr);
+  }
+
+  SECTION("Instances reference the mesh of the original item") {
+    OkItem *item     = new OkItem("item", triangleVertices, 15,
+                                  triangleIndices, 3);
+    OkItem *instance = item->createInstance("instance");
+
+    REQUIRE(instance->getMesh() == item->getMesh());
+    REQUIRE(handler->getReferenceCount(item->getMeshName()) == 2);
+
+    std::string meshName = item->getMeshName();
+    delete item;
+    delete instance;
+    REQUIRE(handler->getReferenceCount(meshName) == 0);
+  }
+
+  SECTION("Different geometry gets its own mesh") {
+    unsigned int reversed[] = {2, 1, 0};
+
+    OkItem *item  = new OkItem("item", triangleVertices, 15,
+                               triangleIndices, 3);
+    OkItem *other = new OkItem("other", triangleVertices, 15, reversed, 3);
+
+    REQUIRE(item->getMesh() != other->getMesh());
+    REQUIRE(other->getMesh()->getIndex(0) == 2);
+
+    delete item;
+    delete other;
+  }
+
+  handler->cleanup();
+}
+
+TEST_CASE("OkItem meshes loaded in the background", "[meshes]") {
+  TestGLFWContext context;  // OpenGL context
+  OkMeshHandler  *handler = OkMeshHandler::getInstance();
+  OkAssetLoader  *loader  = OkAssetLoader::getInstance();
+
+  std::shared_ptr<OkLoadRequest> request = loader->load(
+      "async-triangle", nullptr, [handler](OkLoadRequest &loading) {
+        loading.setMesh(handler->createMesh("async-triangle",
+                                            triangleVertices, 15,
+                                            triangleIndices, 3));
+        return loading.getMesh() != nullptr;
+      });
+
+  OkItem *item = new OkItem("item", nullptr, "");
+  item->setPendingMesh(request);
+  OkItem *instance = item->createInstance("instance");
+  REQUIRE(item->isLoading());
+  REQUIRE(item->getMesh() == nullptr);
+
+  // Both items take the mesh when it is uploaded
+  loader->finishAll();
+  REQUIRE_FALSE(item->isLoading());
+  REQUIRE(item->getMesh() != nullptr);
+  REQUIRE(instance->getMesh() == item->getMesh());
+  REQUIRE(handler->getReferenceCount("async-triangle") == 3);
+
+  // The mesh is deleted with the request and the items
+  request = nullptr;
+  delete item;
+  delete instance;
+  REQUIRE(handler->getMesh("async-triangle") == nullptr);
+
+  loader->cleanup();
+  handler->cleanup();
+}
+
+TEST_CASE("OkMesh content hash", "[meshes]") {
+  unsigned int reversed[] = {2, 1, 0};
+
+  REQUIRE(OkMesh::hash(triangleVertices, 15, triangleIndices, 3) ==
+          OkMesh::hash(triangleVertices, 15, triangleIndices, 3));
+  REQUIRE(OkMesh::hash(triangleVertices, 15, triangleIndices, 3) !=
+          OkMesh::hash(triangleVertices, 15, reversed, 3));
+}
+
+// NOLINTEND(readability-magic-numbers)
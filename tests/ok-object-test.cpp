@@ -0,0 +1,81 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/core/object.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <glm/gtc/constants.hpp>
+
+using Catch::Matchers::WithinAbs;
+
+// Minimal object that counts the transform notifications it receives
+class OkTestObject : public OkObject {
+public:
+  OkTestObject(const std::string &name) : OkObject(name), transformUpdates(0) {
+  }
+
+  int transformUpdates;
+
+protected:
+  void drawSelf() override {}
+  void stepSelf(float dt) override {}
+  void updateTransformSelf() override { transformUpdates++; }
+};
+
+TEST_CASE("OkObject cached world transforms", "[object]") {
+  OkTestObject parent("parent");
+  OkTestObject child("child");
+  child.attachTo(&parent);
+  child.setPosition(1.0f, 0.0f, 0.0f);
+
+  SECTION("World position follows the parent") {
+    parent.setPosition(0.0f, 5.0f, 0.0f);
+
+    OkPoint pos = child.getPosition();
+    REQUIRE_THAT(pos.x(), WithinAbs(1.0f, 0.0001f));
+    REQUIRE_THAT(pos.y(), WithinAbs(5.0f, 0.0001f));
+
+    // Moving the parent again invalidates the cached child transform
+    parent.move(0.0f, 0.0f, 2.0f);
+    pos = child.getPosition();
+    REQUIRE_THAT(pos.z(), WithinAbs(2.0f, 0.0001f));
+    REQUIRE_THAT(child.getTransformMatrix()[3][2], WithinAbs(2.0f, 0.0001f));
+  }
+
+  SECTION("Parent rotation is applied to the child") {
+    parent.setRotation(0.0f, glm::half_pi<float>(), 0.0f);
+
+    OkPoint pos = child.getPosition();
+    REQUIRE_THAT(pos.x(), WithinAbs(0.0f, 0.0001f));
+    REQUIRE_THAT(pos.z(), WithinAbs(-1.0f, 0.0001f));
+    REQUIRE_THAT(child.getRotation().getYaw(),
+                 WithinAbs(glm::half_pi<float>(), 0.0001f));
+  }
+
+  SECTION("Transform pass only visits changed subtrees") {
+    parent.updateTransform(1.0f);
+    REQUIRE(parent.transformUpdates == 1);
+    REQUIRE(child.transformUpdates == 1);
+
+    // Nothing changed, nothing is visited
+    parent.updateTransform(1.0f);
+    REQUIRE(parent.transformUpdates == 1);
+    REQUIRE(child.transformUpdates == 1);
+
+    // A child change does not notify the parent
+    child.move(1.0f, 0.0f, 0.0f);
+    parent.updateTransform(1.0f);
+    REQUIRE(parent.transformUpdates == 1);
+    REQUIRE(child.transformUpdates == 2);
+    REQUIRE_THAT(child.getRenderMatrix()[3][0], WithinAbs(2.0f, 0.0001f));
+
+    // A parent change notifies the whole subtree
+    parent.move(0.0f, 1.0f, 0.0f);
+    parent.updateTransform(1.0f);
+    REQUIRE(parent.transformUpdates == 2);
+    REQUIRE(child.transformUpdates == 3);
+    REQUIRE_THAT(child.getRenderMatrix()[3][1], WithinAbs(1.0f, 0.0001f));
+  }
+}
+
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,199 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/core/object.hpp"
+#include "../src/render/frustum.hpp"
+#include "../src/scene/octree.hpp"
+#include "../src/scene/scene.hpp"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+using Catch::Matchers::WithinAbs;
+
+// Object with a unit bounding sphere
+class OkSphereObject : public OkObject {
+public:
+  OkSphereObject(const std::string &name) : OkObject(name) {}
+
+protected:
+  void drawSelf() override {}
+  void stepSelf(float dt) override {}
+  void updateTransformSelf() override {}
+
+  OkBoundingSphere getLocalBounds() const override {
+    return OkBoundingSphere::sphere(glm::vec3(0.0f), 1.0f);
+  }
+};
+
+static std::vector<OkObject *> sorted(std::vector<OkObject *> objects) {
+  std::sort(objects.begin(), objects.end());
+  return objects;
+}
+
+TEST_CASE("OkOctree queries", "[octree]") {
+  OkOctree octree(glm::vec3(0.0f), 256.0f, 6);
+
+  // 20 x 20 grid of objects, 10 units apart
+  std::vector<OkSphereObject *> objects;
+  for (int x = 0; x < 20; x++) {
+    for (int z = 0; z < 20; z++) {
+      OkSphereObject *object = new OkSphereObject("object");
+      object->setPosition(x * 10.0f - 100.0f, 0.0f, z * 10.0f - 100.0f);
+      objects.push_back(object);
+      octree.insert(object);
+    }
+  }
+
+  octree.update();
+  REQUIRE(octree.getObjectCount() == 400);
+  REQUIRE(octree.getDirtyCount() == 0);
+
+  SECTION("Sphere queries match a linear scan") {
+    glm::vec3 center(13.0f, 0.0f, -27.0f);
+    float     radius = 25.0f;
+
+    std::vector<OkObject *> expected;
+    for (size_t i = 0; i < objects.size(); i++) {
+      if (objects[i]->getBounds().intersects(center, radius)) {
+        expected.push_back(objects[i]);
+      }
+    }
+
+    std::vector<OkObject *> found;
+    octree.querySphere(center, radius, found);
+    REQUIRE(!expected.empty());
+    REQUIRE(sorted(found) == sorted(expected));
+  }
+
+  SECTION("Frustum queries match a linear scan") {
+    glm::mat4 projection =
+        glm::perspective(glm::radians(45.0f), 1.0f, 1.0f, 80.0f);
+    glm::mat4 view =
+        glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(1.0f, 5.0f, 0.0f),
+                    glm::vec3(0.0f, 1.0f, 0.0f));
+    OkFrustum frustum;
+    frustum.extract(projection * view);
+
+    std::vector<OkObject *> expected;
+    for (size_t i = 0; i < objects.size(); i++) {
+      if (frustum.test(objects[i]->getBounds()) != OkCullResult::Outside) {
+        expected.push_back(objects[i]);
+      }
+    }
+
+    std::vector<OkObject *> found;
+    octree.queryFrustum(frustum, found);
+    REQUIRE(!expected.empty());
+    REQUIRE(expected.size() < objects.size());
+    REQUIRE(sorted(found) == sorted(expected));
+  }
+
+  SECTION("Ray hits are sorted by distance") {
+    std::vector<OkRayHit> hits;
+    octree.queryRay(glm::vec3(-150.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+                    1000.0f, hits);
+
+    REQUIRE(hits.size() == 20);
+    REQUIRE_THAT(hits[0].distance, WithinAbs(49.0f, 0.0001f));
+    for (size_t i = 1; i < hits.size(); i++) {
+      REQUIRE(hits[i - 1].distance <= hits[i].distance);
+    }
+  }
+
+  SECTION("Axis-aligned rays starting on cell boundaries") {
+    // Row of objects on y = 64 and z = 0, where loose cells of several
+    // depths start or end
+    std::vector<OkSphereObject *> row;
+    for (int x = 0; x < 10; x++) {
+      OkSphereObject *object = new OkSphereObject("row");
+      object->setPosition(x * 10.0f - 45.0f, 64.0f, 0.0f);
+      row.push_back(object);
+      octree.insert(object);
+    }
+    octree.update();
+
+    glm::vec3 directions[] = {glm::vec3(1.0f, 0.0f, 0.0f),
+                              glm::vec3(-1.0f, 0.0f, 0.0f)};
+    for (const glm::vec3 &direction : directions) {
+      glm::vec3 origin = -direction * 150.0f + glm::vec3(0.0f, 64.0f, 0.0f);
+
+      std::vector<OkRayHit> hits;
+      octree.queryRay(origin, direction, 1000.0f, hits);
+
+      std::vector<OkObject *> found;
+      for (size_t i = 0; i < hits.size(); i++) {
+        found.push_back(hits[i].object);
+      }
+      REQUIRE(sorted(found) ==
+              sorted(std::vector<OkObject *>(row.begin(), row.end())));
+    }
+
+    for (size_t i = 0; i < row.size(); i++) {
+      octree.remove(row[i]);
+      delete row[i];
+    }
+  }
+
+  SECTION("Moved objects are found at their new position") {
+    objects[0]->setPosition(500.0f, 0.0f, 0.0f);  // Outside the root cube
+    objects[1]->setPosition(30.0f, 40.0f, 50.0f);
+    REQUIRE(octree.getDirtyCount() == 2);
+    octree.update();
+
+    std::vector<OkObject *> found;
+    octree.querySphere(glm::vec3(500.0f, 0.0f, 0.0f), 1.0f, found);
+    REQUIRE(found == std::vector<OkObject *>{objects[0]});
+
+    found.clear();
+    octree.querySphere(glm::vec3(30.0f, 40.0f, 50.0f), 1.0f, found);
+    REQUIRE(found == std::vector<OkObject *>{objects[1]});
+  }
+
+  SECTION("Deleted objects leave the index") {
+    delete objects.back();
+    objects.pop_back();
+    REQUIRE(octree.getObjectCount() == 399);
+  }
+
+  for (size_t i = 0; i < objects.size(); i++) {
+    delete objects[i];
+  }
+  REQUIRE(octree.getObjectCount() == 0);
+  REQUIRE(octree.getIndexedSize() == 0);
+}
+
+TEST_CASE("OkScene spatial queries", "[octree]") {
+  OkScene scene("scene");
+
+  OkSphereObject *parent = new OkSphereObject("parent");
+  OkSphereObject *child  = new OkSphereObject("child");
+  child->attachTo(parent);
+  child->setPosition(0.0f, 0.0f, 20.0f);
+  parent->setPosition(100.0f, 0.0f, 0.0f);
+  scene.addObject(parent);
+
+  SECTION("Children are found through their root") {
+    std::vector<OkObject *> found =
+        scene.getObjectsInRadius(glm::vec3(100.0f, 0.0f, 20.0f), 2.0f);
+    REQUIRE(found == std::vector<OkObject *>{child});
+  }
+
+  SECTION("Ray queries return every object on the way") {
+    std::vector<OkRayHit> hits = scene.raycast(
+        glm::vec3(100.0f, 0.0f, -50.0f), glm::vec3(0.0f, 0.0f, 1.0f), 100.0f);
+    REQUIRE(hits.size() == 2);
+    REQUIRE(hits[0].object == parent);
+    REQUIRE(hits[1].object == child);
+    REQUIRE_THAT(hits[1].distance, WithinAbs(69.0f, 0.0001f));
+  }
+
+  // The scene only deletes its root objects
+  parent->detachAllChildren();
+  delete child;
+}
+
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,141 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/handlers/meshes.hpp"
+#include "../src/importers/okmesh.hpp"
+#include "../src/importers/wavefront.hpp"
+#include "../src/item/item.hpp"
+#include "../src/item/mesh.hpp"
+#include "../src/utils/files.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test-opengl.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+// Quad with texture coordinates (3 pos + 2 tex per vertex)
+static const float quadVertices[] = {
+    -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,  // Vertex 0
+    1.0f,  0.0f, 0.0f, 1.0f, 0.0f,  // Vertex 1
+    1.0f,  2.0f, 0.0f, 1.0f, 1.0f,  // Vertex 2
+    -1.0f, 2.0f, 0.0f, 0.0f, 1.0f,  // Vertex 3
+};
+static const unsigned int quadIndices[] = {0, 1, 2, 0, 2, 3};
+
+static void writeText(const std::string &filename, const std::string &text) {
+  std::ofstream file(filename, std::ios::binary);
+  file << text;
+}
+
+static bool writeQuad(const std::string        &filename,
+                      const OkVertexLayout     &layout,
+                      const OkMeshFile::Source &source) {
+  OkMesh mesh(layout, quadVertices, 5, 4, quadIndices, 6);
+  return OkMeshFile::writeFile(filename, mesh, source);
+}
+
+TEST_CASE("OkMeshFile binary meshes", "[okmesh]") {
+  TestGLFWContext    context;  // OpenGL context
+  OkMeshHandler     *handler  = OkMeshHandler::getInstance();
+  std::string        filename = "ok-okmesh-test.okmesh";
+  OkMeshFile::Source source   = {1, 2, 3};
+
+  SECTION("Meshes are read back in place with their bounds") {
+    REQUIRE(writeQuad(filename, OkVertexLayout::standard(), source));
+
+    OkItem *item = OkMeshFile::importFile(filename);
+    REQUIRE(item != nullptr);
+    REQUIRE(item->getName() == "ok-okmesh-test");
+
+    const OkMesh *mesh = item->getMesh();
+    REQUIRE(mesh->getVertexCount() == 4);
+    REQUIRE(mesh->getIndexCount() == 6);
+    REQUIRE(mesh->getIndexType() == GL_UNSIGNED_SHORT);
+    REQUIRE(std::memcmp(mesh->getVertexData(), quadVertices,
+                        sizeof(quadVertices)) == 0);
+    for (long i = 0; i < 6; i++) {
+      REQUIRE(mesh->getIndex(i) == quadIndices[i]);
+    }
+    REQUIRE(mesh->getCenter() == glm::vec3(0.0f, 1.0f, 0.0f));
+    REQUIRE_THAT(mesh->getRadius(), WithinAbs(std::sqrt(2.0f), 0.0001f));
+
+    delete item;
+    REQUIRE(handler->getMesh(filename) == nullptr);
+  }
+
+  SECTION("Compact layouts are kept") {
+    OkVertexLayout layout = {OkTexcoordFormat::Half, OkNormalFormat::Packed};
+    REQUIRE(writeQuad(filename, layout, source));
+
+    OkMesh *mesh = OkMeshFile::loadMesh(filename, filename);
+    REQUIRE(mesh != nullptr);
+    REQUIRE(mesh->getLayout() == layout);
+    REQUIRE(mesh->getVertexCount() == 4);
+    REQUIRE(mesh->getPosition(2) == glm::vec3(1.0f, 2.0f, 0.0f));
+    handler->removeReference(filename);
+  }
+
+  SECTION("Invalid files are rejected") {
+    writeText(filename, "Not a mesh");
+    REQUIRE(OkMeshFile::loadMesh(filename, filename) == nullptr);
+
+    // Truncated file
+    REQUIRE(writeQuad(filename, OkVertexLayout::standard(), source));
+    std::string data = OkFiles::readFile(filename);
+    writeText(filename, data.substr(0, data.size() - 4));
+    REQUIRE(OkMeshFile::loadMesh(filename, filename) == nullptr);
+
+    REQUIRE(OkMeshFile::loadMesh("non-existent.okmesh", "none") == nullptr);
+  }
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("OkMeshFile import cache", "[okmesh]") {
+  TestGLFWContext context;  // OpenGL context
+  OkMeshHandler  *handler   = OkMeshHandler::getInstance();
+  std::string     filename  = "ok-okmesh-test.obj";
+  std::string     cacheName = OkMeshFile::getCacheName(filename);
+
+  writeText(filename, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+  std::remove(cacheName.c_str());
+
+  // The first import writes the cache
+  OkItem *item = OkWavefrontImporter::importFile(filename);
+  REQUIRE(item != nullptr);
+  delete item;
+  REQUIRE(handler->getMesh(filename) == nullptr);
+
+  uint64_t size     = 0;
+  int64_t  modified = 0;
+  REQUIRE(OkFiles::getFileInfo(cacheName, size, modified));
+
+  OkVertexLayout layout = OkWavefrontImporter::getLayout(true);
+
+  SECTION("The cache is used while the source does not change") {
+    OkMesh *mesh = OkMeshFile::loadCache(filename, filename, layout);
+    REQUIRE(mesh != nullptr);
+    REQUIRE(mesh->getIndexCount() == 3);
+    handler->removeReference(filename);
+  }
+
+  SECTION("The cache is ignored when the source changes") {
+    writeText(filename, "v 0 0 0\nv 2 0 0\nv 0 2 0\nf 1 2 3\n");
+    REQUIRE(OkMeshFile::loadCache(filename, filename, layout) == nullptr);
+
+    item = OkWavefrontImporter::importFile(filename);
+    REQUIRE(item->getMesh()->getPosition(1) == glm::vec3(2.0f, 0.0f, 0.0f));
+    delete item;
+  }
+
+  std::remove(filename.c_str());
+  std::remove(cacheName.c_str());
+}
+
+// NOLINTEND(readability-magic-numbers)
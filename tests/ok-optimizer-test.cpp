@@ -0,0 +1,131 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/item/optimizer.hpp"
+#include <algorithm>
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <vector>
+
+// Grid of size x size quads, 5 floats per vertex, with the quads emitted
+// column by column over rows longer than the cache
+static void buildGrid(int size, std::vector<float> &vertices,
+                      std::vector<unsigned int> &indices) {
+  int row = size + 1;
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      vertices.insert(vertices.end(),
+                      {static_cast<float>(x), static_cast<float>(y), 0.0f,
+                       static_cast<float>(x) / size,
+                       static_cast<float>(y) / size});
+    }
+  }
+  for (int x = 0; x < size; x++) {
+    for (int y = 0; y < size; y++) {
+      unsigned int a = y * row + x;
+      indices.insert(indices.end(),
+                     {a, a + 1, a + row + 1, a, a + row + 1, a + row});
+    }
+  }
+}
+
+// Triangles as sorted lists of vertex attributes, to compare meshes whatever
+// the order of their vertices and triangles
+static std::vector<std::array<float, 15>>
+getTriangles(const std::vector<float>        &vertices,
+             const std::vector<unsigned int> &indices) {
+  std::vector<std::array<float, 15>> triangles;
+  for (size_t t = 0; t < indices.size() / 3; t++) {
+    // Rotate the triangle to start with its smallest index, keeping winding
+    std::array<std::array<float, 5>, 3> corners;
+    for (int i = 0; i < 3; i++) {
+      std::copy_n(&vertices[indices[t * 3 + i] * 5], 5, corners[i].begin());
+    }
+    std::rotate(corners.begin(),
+                std::min_element(corners.begin(), corners.end()),
+                corners.end());
+
+    std::array<float, 15> triangle;
+    for (int i = 0; i < 3; i++) {
+      std::copy(corners[i].begin(), corners[i].end(), &triangle[i * 5]);
+    }
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+TEST_CASE("OkMeshOptimizer vertex welding", "[optimizer]") {
+  // Two triangles of a quad with their own copies of the shared corners
+  std::vector<float> vertices = {
+      0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 1,
+      0, 0, 0, 0, 0, 1, 1, 0, 1, 1, 0, 1, 0, 0, 1,
+  };
+  std::vector<unsigned int> indices = {0, 1, 2, 3, 4, 5};
+
+  SECTION("Identical vertices are merged") {
+    REQUIRE(OkMeshOptimizer::weldVertices(vertices, indices, 5) == 4);
+    REQUIRE(vertices.size() == 4 * 5);
+    REQUIRE(indices == std::vector<unsigned int>{0, 1, 2, 0, 2, 3});
+  }
+
+  SECTION("Vertices differing only in texture coordinates are kept") {
+    vertices[18] = 0.5f;
+    REQUIRE(OkMeshOptimizer::weldVertices(vertices, indices, 5) == 5);
+    REQUIRE(indices == std::vector<unsigned int>{0, 1, 2, 3, 2, 4});
+  }
+}
+
+TEST_CASE("OkMeshOptimizer reordering", "[optimizer]") {
+  std::vector<float>        vertices;
+  std::vector<unsigned int> indices;
+  buildGrid(48, vertices, indices);
+  size_t vertexCount = vertices.size() / 5;
+  auto   triangles   = getTriangles(vertices, indices);
+  float  acmr        = OkMeshOptimizer::getACMR(indices, vertexCount,
+                                                OkMeshOptimizer::cacheSize);
+
+  SECTION("Vertex cache order reduces the miss ratio") {
+    OkMeshOptimizer::optimizeVertexCache(indices, vertexCount);
+    REQUIRE(getTriangles(vertices, indices) == triangles);
+
+    float optimized = OkMeshOptimizer::getACMR(indices, vertexCount,
+                                               OkMeshOptimizer::cacheSize);
+    REQUIRE(optimized < acmr);
+    REQUIRE(optimized < 0.8f);
+  }
+
+  SECTION("Overdraw order stays within the threshold") {
+    OkMeshOptimizer::optimizeVertexCache(indices, vertexCount);
+    float optimized = OkMeshOptimizer::getACMR(indices, vertexCount,
+                                               OkMeshOptimizer::cacheSize);
+
+    OkMeshOptimizer::optimizeOverdraw(indices, vertices, 5, 1.05f);
+    REQUIRE(getTriangles(vertices, indices) == triangles);
+    REQUIRE(OkMeshOptimizer::getACMR(indices, vertexCount,
+                                     OkMeshOptimizer::cacheSize) <=
+            optimized * 1.05f + 0.01f);
+  }
+
+  SECTION("Vertex fetch order follows the indices") {
+    OkMeshOptimizer::optimizeVertexCache(indices, vertexCount);
+    OkMeshOptimizer::optimizeVertexFetch(vertices, indices, 5);
+    REQUIRE(getTriangles(vertices, indices) == triangles);
+
+    unsigned int next    = 0;
+    bool         ordered = true;
+    for (unsigned int index : indices) {
+      ordered = ordered && index <= next;
+      next    = std::max(next, index + 1);
+    }
+    REQUIRE(ordered);
+  }
+
+  SECTION("All the passes keep the triangles") {
+    OkMeshOptimizer::optimize(vertices, indices, 5, 1.05f);
+    REQUIRE(vertices.size() == vertexCount * 5);
+    REQUIRE(getTriangles(vertices, indices) == triangles);
+  }
+}
+
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,82 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/core/pacer.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <chrono>
+
+using Catch::Matchers::WithinAbs;
+
+TEST_CASE("OkFramePacer fixed step accumulator", "[pacer]") {
+  SECTION("First frame always runs one step") {
+    OkFramePacer pacer(10.0f, 10.0f, 5);
+    REQUIRE(pacer.advance(0.0) == 1);
+    REQUIRE_THAT(pacer.getAlpha(), WithinAbs(0.0f, 0.0001f));
+  }
+
+  SECTION("Elapsed time is consumed in fixed steps") {
+    OkFramePacer pacer(10.0f, 10.0f, 5);
+    pacer.advance(0.0);
+
+    REQUIRE(pacer.advance(25.0) == 2);
+    REQUIRE_THAT(pacer.getAlpha(), WithinAbs(0.5f, 0.0001f));
+
+    // The leftover time is carried to the next frame
+    REQUIRE(pacer.advance(5.0) == 1);
+    REQUIRE_THAT(pacer.getAlpha(), WithinAbs(0.0f, 0.0001f));
+  }
+
+  SECTION("Frames shorter than a step run no simulation") {
+    OkFramePacer pacer(5.0f, 20.0f, 5);
+    pacer.advance(0.0);
+
+    REQUIRE(pacer.advance(5.0) == 0);
+    REQUIRE_THAT(pacer.getAlpha(), WithinAbs(0.25f, 0.0001f));
+    REQUIRE(pacer.advance(5.0) == 0);
+    REQUIRE_THAT(pacer.getAlpha(), WithinAbs(0.5f, 0.0001f));
+    REQUIRE_THAT(pacer.getFrameDelta(), WithinAbs(5.0f, 0.0001f));
+  }
+
+  SECTION("Steps are limited after a long stall") {
+    OkFramePacer pacer(10.0f, 10.0f, 3);
+    pacer.advance(0.0);
+
+    REQUIRE(pacer.advance(100.0) == 3);
+    REQUIRE(pacer.getDroppedSteps() == 7);
+    REQUIRE(pacer.advance(10.0) == 1);
+  }
+
+  SECTION("Invalid settings are sanitized") {
+    OkFramePacer pacer(16.0f, 0.0f, 0);
+    REQUIRE(pacer.getTimePerStep() == 16.0f);
+    REQUIRE(pacer.getMaxStepsPerFrame() == 1);
+  }
+}
+
+TEST_CASE("OkFramePacer frame waiting", "[pacer]") {
+  SECTION("Waits until the frame deadline") {
+    OkFramePacer pacer(20.0f, 20.0f, 5);
+    pacer.reset();
+
+    auto start = std::chrono::steady_clock::now();
+    pacer.waitForNextFrame();
+    pacer.waitForNextFrame();
+    auto elapsed = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+    REQUIRE(elapsed >= 39.0);
+  }
+
+  SECTION("Measures the time between frames") {
+    OkFramePacer pacer(10.0f, 10.0f, 5);
+    pacer.reset();
+    pacer.waitForNextFrame();
+    pacer.beginFrame();
+
+    REQUIRE(pacer.getFrameDelta() >= 9.0f);
+  }
+}
+
+// NOLINTEND(readability-magic-numbers)
@@ -103,6 +103,18 @@ TEST_CASE("OkPoint vector operations", "[point]") {
     OkPoint up(0.0f, 1.0f, 0.0f);
     REQUIRE(right.dot(up) == 0.0f);
   }
+
+  SECTION("Linear interpolation") {
+    OkPoint from(0.0f, 2.0f, -4.0f);
+    OkPoint to(10.0f, 4.0f, 4.0f);
+    REQUIRE(from.lerp(to, 0.0f) == from);
+    REQUIRE(from.lerp(to, 1.0f) == to);
+
+    OkPoint half = from.lerp(to, 0.5f);
+    REQUIRE(half.x() == Catch::Approx(5.0f));
+    REQUIRE(half.y() == Catch::Approx(3.0f));
+    REQUIRE(half.z() == Catch::Approx(0.0f));
+  }
 }
 
 TEST_CASE("OkPoint compound assignment operators", "[point]") {
@@ -0,0 +1,121 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/handlers/registry.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Resource counting how many are alive
+struct TestResource {
+  static std::atomic<int> alive;
+
+  explicit TestResource(int value) : value(value) { alive++; }
+  ~TestResource() { alive--; }
+
+  int value;
+};
+
+std::atomic<int> TestResource::alive(0);
+
+TEST_CASE("OkRegistry handles", "[registry]") {
+  OkRegistry<TestResource> registry;
+
+  OkHandle first  = registry.add("first", new TestResource(1));
+  OkHandle second = registry.add("second", new TestResource(2));
+  REQUIRE(first.isValid());
+  REQUIRE(first != second);
+  REQUIRE(registry.get(first)->value == 1);
+  REQUIRE(registry.getName(second) == "second");
+  REQUIRE(registry.getCount() == 2);
+  REQUIRE_FALSE(OkHandle().isValid());
+  REQUIRE(registry.get(OkHandle()) == nullptr);
+
+  SECTION("Names resolve to the same handle") {
+    REQUIRE(registry.find("first") == first);
+    REQUIRE(registry.getReferenceCount(first) == 1);
+
+    // Adding a taken name references the stored resource
+    TestResource *duplicate = new TestResource(3);
+    REQUIRE(registry.add("first", duplicate) == first);
+    REQUIRE(registry.get(first)->value == 1);
+    REQUIRE(registry.getReferenceCount(first) == 2);
+    delete duplicate;
+
+    REQUIRE(registry.acquire("second") == second);
+    REQUIRE(registry.getReferenceCount(second) == 2);
+    REQUIRE_FALSE(registry.acquire("missing").isValid());
+  }
+
+  SECTION("Released handles become stale") {
+    REQUIRE(registry.acquire(first));
+    REQUIRE_FALSE(registry.release(first));
+    REQUIRE(registry.release(first));
+    REQUIRE(TestResource::alive == 1);
+    REQUIRE(registry.get(first) == nullptr);
+    REQUIRE_FALSE(registry.find("first").isValid());
+    REQUIRE_FALSE(registry.acquire(first));
+    REQUIRE_FALSE(registry.release(first));
+
+    // The slot is reused with a new generation
+    OkHandle third = registry.add("third", new TestResource(3));
+    REQUIRE(third.getIndex() == first.getIndex());
+    REQUIRE(third.getGeneration() != first.getGeneration());
+    REQUIRE(registry.get(first) == nullptr);
+    REQUIRE(registry.get(third)->value == 3);
+  }
+
+  SECTION("Clearing deletes every resource") {
+    registry.acquire(first);
+    registry.clear();
+    REQUIRE(TestResource::alive == 0);
+    REQUIRE(registry.getCount() == 0);
+    REQUIRE(registry.get(first) == nullptr);
+    REQUIRE(registry.getNames().empty());
+  }
+
+  registry.clear();
+  REQUIRE(TestResource::alive == 0);
+}
+
+TEST_CASE("OkRegistry from several threads", "[registry]") {
+  OkRegistry<TestResource> registry;
+  const int                names = 64;
+  std::atomic<int>         wrong(0);  // Names resolving to another resource
+
+  // Every thread adds, references and releases the same names
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&registry, &wrong]() {
+      for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < names; i++) {
+          std::string   name     = "resource" + std::to_string(i);
+          TestResource *resource = new TestResource(i);
+          OkHandle      handle   = registry.add(name, resource);
+          if (registry.get(handle) != resource) {
+            delete resource;
+          }
+
+          OkHandle found = registry.acquire(name);
+          if (found.isValid()) {
+            if (registry.get(found)->value != i) {
+              wrong++;
+            }
+            registry.release(found);
+          }
+          registry.release(handle);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  REQUIRE(wrong == 0);
+  REQUIRE(registry.getCount() == 0);
+  REQUIRE(TestResource::alive == 0);
+}
+
+// NOLINTEND(readability-magic-numbers)
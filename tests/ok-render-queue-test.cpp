@@ -0,0 +1,116 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/render/queue.hpp"
+#include "../src/shaders/variants.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <glm/glm.hpp>
+
+TEST_CASE("OkRenderQueue sort keys", "[queue]") {
+  SECTION("Pass has the highest priority") {
+    uint64_t textured =
+        OkRenderQueue::makeKey(OkDrawPass::Textured, 9, 9, 9, 1.0f);
+    uint64_t wireframe =
+        OkRenderQueue::makeKey(OkDrawPass::Wireframe, 1, 0, 1, 0.0f);
+    REQUIRE(textured < wireframe);
+  }
+
+  SECTION("State is ordered by program, texture, vertex array and depth") {
+    uint64_t base = OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 1, 1, 0.5f);
+
+    REQUIRE(base < OkRenderQueue::makeKey(OkDrawPass::Flat, 2, 0, 0, 0.0f));
+    REQUIRE(base < OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 2, 0, 0.0f));
+    REQUIRE(base < OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 1, 2, 0.0f));
+    REQUIRE(base < OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 1, 1, 0.6f));
+  }
+
+  SECTION("Depth is clamped") {
+    REQUIRE(OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 1, 1, -1.0f) ==
+            OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 1, 1, 0.0f));
+    REQUIRE(OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 1, 1, 5.0f) ==
+            OkRenderQueue::makeKey(OkDrawPass::Flat, 1, 1, 1, 1.0f));
+  }
+}
+
+TEST_CASE("OkRenderQueue packets", "[queue]") {
+  OkRenderQueue queue;
+  queue.begin(nullptr, nullptr);
+
+  glm::mat4 matrix(1.0f);
+
+  OkDrawPacket packet = {};
+  packet.pass         = OkDrawPass::Flat;
+  packet.vao          = 3;
+  packet.indexCount   = 6;
+  packet.matrix       = &matrix;
+
+  queue.add(packet);
+  queue.add(packet);
+  REQUIRE(queue.getPacketCount() == 2);
+
+  // Starting a new frame drops the packets that were not flushed
+  queue.begin(nullptr, nullptr);
+  REQUIRE(queue.getPacketCount() == 0);
+}
+
+TEST_CASE("OkRenderQueue shader features", "[queue]") {
+  OkInstance instances[2] = {};
+
+  OkDrawPacket packet = {};
+  packet.pass         = OkDrawPass::Flat;
+  REQUIRE(OkRenderQueue::getFeatures(packet) == 0);
+
+  // Wireframe only changes the polygon mode
+  packet.pass = OkDrawPass::Wireframe;
+  REQUIRE(OkRenderQueue::getFeatures(packet) == 0);
+
+  packet.instanceCount = 2;
+  packet.instances     = instances;
+  REQUIRE(OkRenderQueue::getFeatures(packet) == OkShaderVariants::instanced);
+
+  // Textured packets without a texture fall back to the flat variant
+  packet.pass = OkDrawPass::Textured;
+  REQUIRE(OkRenderQueue::getFeatures(packet) == OkShaderVariants::instanced);
+
+  packet.pass = OkDrawPass::Custom;
+  REQUIRE(OkRenderQueue::getFeatures(packet) == 0);
+}
+
+TEST_CASE("OkRenderQueue multi-draw merging", "[queue]") {
+  glm::mat4 matrix(1.0f);
+  glm::mat4 moved = glm::mat4(1.0f);
+  moved[3]        = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+
+  OkDrawPacket a = {};
+  a.pass         = OkDrawPass::Flat;
+  a.vao          = 3;
+  a.indexCount   = 6;
+  a.matrix       = &matrix;
+
+  // Another mesh of the same page
+  OkDrawPacket b = a;
+  b.baseVertex   = 4;
+  b.indexOffset  = 12;
+  REQUIRE(OkRenderQueue::canMerge(a, b));
+
+  SECTION("Draws of a call share the object uniforms") {
+    b.matrix = &moved;
+    REQUIRE_FALSE(OkRenderQueue::canMerge(a, b));
+  }
+
+  SECTION("Draws of a call share the vertex array") {
+    b.vao = 4;
+    REQUIRE_FALSE(OkRenderQueue::canMerge(a, b));
+  }
+
+  SECTION("Instanced and custom packets are never merged") {
+    b.instanceCount = 2;
+    REQUIRE_FALSE(OkRenderQueue::canMerge(a, b));
+
+    b.instanceCount = 0;
+    a.pass          = OkDrawPass::Custom;
+    b.pass          = OkDrawPass::Custom;
+    REQUIRE_FALSE(OkRenderQueue::canMerge(a, b));
+  }
+}
+
+// NOLINTEND(readability-magic-numbers)
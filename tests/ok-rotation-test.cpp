@@ -211,4 +211,28 @@ TEST_CASE("OkRotation combine operations", "[rotation]") {
   }
 }
 
+TEST_CASE("OkRotation interpolation", "[rotation]") {
+  SECTION("Interpolate between two rotations") {
+    OkRotation from(0.0f, 0.0f, 0.0f);
+    OkRotation to(0.2f, 0.4f, -0.6f);
+
+    OkRotation half = from.interpolate(to, 0.5f);
+    REQUIRE_THAT(half.getPitch(), WithinAbs(0.1f, 0.0001f));
+    REQUIRE_THAT(half.getYaw(), WithinAbs(0.2f, 0.0001f));
+    REQUIRE_THAT(half.getRoll(), WithinAbs(-0.3f, 0.0001f));
+
+    OkRotation end = from.interpolate(to, 1.0f);
+    REQUIRE_THAT(end.getYaw(), WithinAbs(0.4f, 0.0001f));
+  }
+
+  SECTION("Interpolation takes the shortest arc") {
+    // From just below pi to just above -pi is a small step, not a full turn
+    OkRotation from(0.0f, glm::pi<float>() - 0.1f, 0.0f);
+    OkRotation to(0.0f, -glm::pi<float>() + 0.1f, 0.0f);
+
+    OkRotation half = from.interpolate(to, 0.5f);
+    REQUIRE_THAT(std::cos(half.getYaw()), WithinAbs(-1.0f, 0.0001f));
+  }
+}
+
 // NOLINTEND(readability-magic-numbers)
@@ -1,7 +1,15 @@
 
+#include "../src/config/config.hpp"
 #include "../src/core/gl_config.hpp"
+#include "../src/shaders/cache.hpp"
+#include "../src/shaders/program.hpp"
 #include "../src/shaders/shaders.hpp"
+#include "../src/shaders/variants.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 
 #include "test-opengl.hpp"
 
@@ -149,3 +157,199 @@ TEST_CASE("OkShader program creation error cases", "[shaders]") {
     REQUIRE(program == 0);
   }
 }
+
+TEST_CASE("OkProgramCache", "[shaders]") {
+  TestGLFWContext context;  // OpenGL context
+  OkProgramCache::setDirectory("ok-program-cache");
+  std::filesystem::remove_all("ok-program-cache");
+
+  uint64_t key = OkProgramCache::getKey(validVertexShader, validFragmentShader);
+  REQUIRE(key ==
+          OkProgramCache::getKey(validVertexShader, validFragmentShader));
+  REQUIRE(key !=
+          OkProgramCache::getKey(validVertexShader, invalidFragmentShader));
+  REQUIRE(OkProgramCache::load(key) == 0);
+
+  SECTION("Linked programs are loaded back from their binary") {
+    // Some drivers have no binary format to save programs in
+    if (OkProgramCache::isEnabled()) {
+      GLuint program =
+          OkShader::createProgram(validVertexShader, validFragmentShader);
+      REQUIRE(program != 0);
+      glDeleteProgram(program);
+
+      GLuint cached = OkProgramCache::load(key);
+      REQUIRE(cached != 0);
+      glDeleteProgram(cached);
+    }
+  }
+
+  SECTION("Invalid files are ignored") {
+    std::filesystem::create_directories("ok-program-cache");
+    std::ofstream(OkProgramCache::getFileName(key), std::ios::binary)
+        << "Not a program binary, but long enough for a header";
+    REQUIRE(OkProgramCache::load(key) == 0);
+  }
+
+  SECTION("Directories are per user unless configured") {
+    OkProgramCache::setDirectory("");
+    OkConfig::setString("shaders.program-cache-dir", "ok-program-cache");
+    REQUIRE(OkProgramCache::getDirectory() == "ok-program-cache");
+
+    // Created directories are only accessible by their owner
+    REQUIRE(OkProgramCache::createDirectory());
+    std::filesystem::perms perms =
+        std::filesystem::status("ok-program-cache").permissions();
+    REQUIRE((perms & (std::filesystem::perms::group_all |
+                      std::filesystem::perms::others_all)) ==
+            std::filesystem::perms::none);
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+    OkConfig::setString("shaders.program-cache-dir", "");
+    const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+    std::string previous  = cacheHome ? cacheHome : "";
+
+    setenv("XDG_CACHE_HOME", "ok-user-cache", 1);
+    REQUIRE(OkProgramCache::getDirectory() ==
+            std::filesystem::path("ok-user-cache") / "okinawa" / "shaders");
+
+    if (cacheHome) {
+      setenv("XDG_CACHE_HOME", previous.c_str(), 1);
+    } else {
+      unsetenv("XDG_CACHE_HOME");
+    }
+#endif
+    OkConfig::setString("shaders.program-cache-dir", "");
+  }
+
+  std::filesystem::remove_all("ok-program-cache");
+  OkProgramCache::setDirectory("");
+}
+
+TEST_CASE("OkShaderVariants", "[shaders]") {
+  SECTION("Features are defined after the version line") {
+    std::string source = "#version 410\nvoid main() {}\n";
+    REQUIRE(OkShaderVariants::addDefines(source, 0) == source);
+    REQUIRE(OkShaderVariants::addDefines(
+                source, OkShaderVariants::textured |
+                            OkShaderVariants::instanced) ==
+            "#version 410\n#define TEXTURED\n#define INSTANCED\n"
+            "void main() {}\n");
+    REQUIRE(OkShaderVariants::addDefines("void main() {}",
+                                         OkShaderVariants::textured) ==
+            "#define TEXTURED\nvoid main() {}");
+  }
+
+  SECTION("Texture arrays need textures") {
+    REQUIRE(OkShaderVariants::normalize(OkShaderVariants::textureArray) == 0);
+    REQUIRE(OkShaderVariants::normalize(OkShaderVariants::textured |
+                                        OkShaderVariants::textureArray) ==
+            (OkShaderVariants::textured | OkShaderVariants::textureArray));
+    REQUIRE(OkShaderVariants::normalize(0xFF) ==
+            (OkShaderVariants::textured | OkShaderVariants::textureArray |
+             OkShaderVariants::instanced));
+  }
+
+  SECTION("Variants are compiled once, when asked for") {
+    TestGLFWContext context;  // OpenGL context
+
+    const char *fragmentShader = R"(
+      #version 330 core
+      out vec4 FragColor;
+      #ifdef TEXTURED
+      uniform sampler2D texture0;
+      #else
+      uniform vec4 wireframeColor;
+      #endif
+      void main() {
+      #ifdef TEXTURED
+        FragColor = texture(texture0, vec2(0.0));
+      #else
+        FragColor = wireframeColor;
+      #endif
+      }
+    )";
+
+    OkShaderVariants variants(validVertexShader, fragmentShader);
+    REQUIRE(variants.getCompiledCount() == 0);
+
+    OkShaderProgram *flat     = variants.get(0);
+    OkShaderProgram *textured = variants.get(OkShaderVariants::textured);
+    REQUIRE(flat != nullptr);
+    REQUIRE(textured != nullptr);
+    REQUIRE(flat != textured);
+    REQUIRE(variants.getCompiledCount() == 2);
+    REQUIRE(variants.get(OkShaderVariants::textureArray) == flat);
+
+    REQUIRE(textured->hasFeature(OkShaderVariants::textured));
+    REQUIRE(textured->getVariant(0) == flat);
+    REQUIRE(textured->hasUniform(OkUniform::Texture0));
+    REQUIRE_FALSE(textured->hasUniform(OkUniform::WireframeColor));
+    REQUIRE(flat->hasUniform(OkUniform::WireframeColor));
+  }
+}
+
+TEST_CASE("OkShaderProgram reflection", "[shaders]") {
+  TestGLFWContext context;
+
+  const char *vertexShader   = R"(
+      #version 330 core
+      layout (location = 0) in vec3 aPos;
+      layout (location = 1) in vec2 aTexCoord;
+      uniform mat4 model;
+      uniform mat4 view;
+      uniform mat4 projection;
+      out vec2 TexCoord;
+      void main() {
+          gl_Position = projection * view * model * vec4(aPos, 1.0);
+          TexCoord = aTexCoord;
+      }
+  )";
+  const char *fragmentShader = R"(
+      #version 330 core
+      in vec2 TexCoord;
+      uniform vec4 wireframeColor;
+      uniform float weights[4];
+      out vec4 FragColor;
+      void main() {
+          FragColor = wireframeColor * weights[3] + vec4(TexCoord, 0.0, 0.0);
+      }
+  )";
+
+  OkShaderProgram *program =
+      OkShaderProgram::create(vertexShader, fragmentShader);
+  REQUIRE(program != nullptr);
+
+  SECTION("Well-known uniforms are resolved at link time") {
+    REQUIRE(program->hasUniform(OkUniform::Model));
+    REQUIRE(program->hasUniform(OkUniform::View));
+    REQUIRE(program->hasUniform(OkUniform::Projection));
+    REQUIRE(program->hasUniform(OkUniform::WireframeColor));
+    REQUIRE_FALSE(program->hasUniform(OkUniform::Texture0));
+    REQUIRE(program->getUniformLocation(OkUniform::Model) ==
+            glGetUniformLocation(program->getId(), "model"));
+  }
+
+  SECTION("Uniforms and attributes are reflected by name") {
+    REQUIRE(program->getUniformLocation("weights") != -1);
+    REQUIRE(program->getUniformLocation("weights[0]") ==
+            program->getUniformLocation("weights"));
+    REQUIRE(program->getUniforms().at("weights").size == 4);
+    REQUIRE(program->getUniformLocation("missing") == -1);
+
+    REQUIRE(program->getAttributeLocation("aPos") == 0);
+    REQUIRE(program->getAttributeLocation("aTexCoord") == 1);
+  }
+
+  SECTION("Current program is tracked") {
+    program->use();
+    REQUIRE(OkShaderProgram::getCurrent() == program);
+
+    GLint current = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    REQUIRE(static_cast<GLuint>(current) == program->getId());
+  }
+
+  delete program;
+  REQUIRE(OkShaderProgram::getCurrent() == nullptr);
+}
@@ -0,0 +1,154 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/config/config.hpp"
+#include "../src/handlers/loader.hpp"
+#include "../src/handlers/streamer.hpp"
+#include "../src/handlers/textures.hpp"
+#include "../src/item/texture.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "test-ktx2.hpp"
+#include "test-opengl.hpp"
+
+TEST_CASE("OkMipChain levels", "[texture]") {
+  // 4x2 RGB image, left half black and right half white
+  std::vector<unsigned char> pixels(4 * 2 * 3, 0);
+  for (int y = 0; y < 2; y++) {
+    for (int i = 6; i < 12; i++) {
+      pixels[y * 12 + i] = 255;
+    }
+  }
+
+  OkMipChain chain = OkMipChain::build(pixels.data(), 4, 2, 3);
+  REQUIRE(chain.getLevels() == 3);
+  REQUIRE(chain.getLevelWidth(1) == 2);
+  REQUIRE(chain.getLevelHeight(1) == 1);
+  REQUIRE(chain.getLevelSize(2) == 3);
+  REQUIRE(chain.pixels.size() == 24 + 6 + 3);
+
+  // Each level averages 2x2 pixels of the previous one
+  REQUIRE(chain.getLevel(1)[0] == 0);
+  REQUIRE(chain.getLevel(1)[3] == 255);
+  REQUIRE(chain.getLevel(2)[0] == 128);
+
+  SECTION("Odd sizes") {
+    std::vector<unsigned char> odd(3 * 5, 100);
+    chain = OkMipChain::build(odd.data(), 3, 5, 1);
+    REQUIRE(chain.getLevels() == 3);
+    REQUIRE(chain.getLevelWidth(1) == 1);
+    REQUIRE(chain.getLevelHeight(1) == 2);
+    REQUIRE(chain.getLevel(2)[0] == 100);
+  }
+
+  SECTION("Invalid images") {
+    REQUIRE(OkMipChain::build(nullptr, 4, 2, 3).getLevels() == 0);
+    REQUIRE(OkMipChain::build(pixels.data(), 0, 2, 3).getLevels() == 0);
+  }
+}
+
+TEST_CASE("OkTextureStreamer budget", "[texture]") {
+  TestGLFWContext    context;  // OpenGL context
+  OkTextureHandler  *handler  = OkTextureHandler::getInstance();
+  OkTextureStreamer *streamer = OkTextureStreamer::getInstance();
+
+  // 8x4 RGBA image: levels of 128, 32, 8 and 4 bytes
+  std::vector<unsigned char> pixels(8 * 4 * 4, 200);
+  OkTexture *texture = handler->createStreamingTexture(
+      "streamed", std::make_unique<OkMipChain>(
+                      OkMipChain::build(pixels.data(), 8, 4, 4)));
+  REQUIRE(texture != nullptr);
+  REQUIRE(texture->isStreaming());
+  REQUIRE_FALSE(texture->isLoaded());
+  REQUIRE(streamer->getPendingCount() == 1);
+
+  // The smallest level comes first, and loads the texture
+  REQUIRE(streamer->update(1) == 4);
+  REQUIRE(texture->isLoaded());
+  REQUIRE(streamer->update(8) == 8);
+
+  // Levels larger than the budget are split in rows
+  REQUIRE(streamer->update(20) == 16);
+  REQUIRE(texture->isStreaming());
+
+  streamer->finishAll();
+  REQUIRE_FALSE(texture->isStreaming());
+  REQUIRE(streamer->getPendingCount() == 0);
+
+  SECTION("Deleted while streaming") {
+    OkTexture *other = handler->createStreamingTexture(
+        "deleted", std::make_unique<OkMipChain>(
+                       OkMipChain::build(pixels.data(), 8, 4, 4)));
+    REQUIRE(other != nullptr);
+    REQUIRE(streamer->getPendingCount() == 1);
+
+    handler->removeReference("deleted");
+    REQUIRE(streamer->getPendingCount() == 0);
+  }
+
+  handler->cleanup();
+  streamer->cleanup();
+}
+
+TEST_CASE("OkTextureHandler memory budget", "[texture]") {
+  TestGLFWContext   context;  // OpenGL context
+  OkTextureHandler *handler = OkTextureHandler::getInstance();
+
+  // 16x16 RGBA textures, 1364 bytes with their levels
+  REQUIRE(writeKtx2("ok-texture-used.ktx2", 37, 16, 4, false));
+  REQUIRE(writeKtx2("ok-texture-idle.ktx2", 37, 16, 4, false));
+  OkTexture *used = handler->createTextureFromFile("ok-texture-used.ktx2");
+  OkTexture *idle = handler->createTextureFromFile("ok-texture-idle.ktx2");
+  REQUIRE(idle->getMemorySize() == 1364);
+  REQUIRE(handler->getMemoryUsage() == 2728);
+
+  // About 2000 bytes
+  OkConfig::setFloat("textures.memory-budget", 0.002f);
+  OkConfig::setInt("textures.idle-frames", 2);
+
+  // The texture not bound for a while loses its largest level
+  for (int frame = 0; frame < 3; frame++) {
+    used->bind();
+    handler->update();
+  }
+  REQUIRE(used->getDroppedLevels() == 0);
+  REQUIRE(idle->getDroppedLevels() == 1);
+  REQUIRE(idle->getWidth() == 8);
+  REQUIRE(idle->getMemorySize() == 340);
+
+  OkTextureMemoryStats stats = handler->getMemoryStats();
+  REQUIRE(stats.usage == 1704);
+  REQUIRE(stats.freedBytes == 1024);
+  REQUIRE(stats.droppedLevels == 1);
+  REQUIRE(stats.textures == 2);
+
+  // Used again while the other texture is still in use, nothing can make
+  // room for it
+  idle->bind();
+  handler->update();
+  OkAssetLoader::getInstance()->finishAll();
+  REQUIRE(idle->getDroppedLevels() == 1);
+  REQUIRE(handler->getMemoryStats().reloads == 0);
+
+  // Once the other texture is idle, it loses a level to make room
+  idle->bind();
+  handler->update();
+  OkAssetLoader::getInstance()->finishAll();
+  REQUIRE(used->getDroppedLevels() == 1);
+  REQUIRE(idle->getDroppedLevels() == 0);
+  REQUIRE(idle->getWidth() == 16);
+  REQUIRE(handler->getMemoryStats().reloads == 1);
+  REQUIRE(handler->getMemoryStats().freedBytes == 2048);
+  REQUIRE(handler->getMemoryUsage() == 1704);
+
+  OkConfig::setFloat("textures.memory-budget", 512.0f);
+  OkConfig::setInt("textures.idle-frames", 120);
+  OkAssetLoader::getInstance()->cleanup();
+  handler->cleanup();
+  std::remove("ok-texture-used.ktx2");
+  std::remove("ok-texture-idle.ktx2");
+}
+
+// NOLINTEND(readability-magic-numbers)
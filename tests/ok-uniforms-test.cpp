@@ -0,0 +1,68 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/config/config.hpp"
+#include "../src/render/uniforms.hpp"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+#include "test-opengl.hpp"
+
+TEST_CASE("OkUniformBuffers", "[uniforms]") {
+  TestGLFWContext context;  // OpenGL context
+
+  OkUniformBuffers *buffers = OkUniformBuffers::getInstance();
+  int               bytes   = OkConfig::getInt("graphics.object-buffer-bytes");
+  buffers->cleanup();
+
+  SECTION("Frame data is derived from the camera") {
+    glm::mat4 view = glm::lookAt(glm::vec3(1.0f, 2.0f, 3.0f), glm::vec3(0.0f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection =
+        glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    buffers->setFrame(view, projection);
+
+    const OkFrameUniforms &frame = buffers->getFrame();
+    REQUIRE(frame.viewProjection == projection * view);
+    REQUIRE(frame.cameraPosition.x == Catch::Approx(1.0f));
+    REQUIRE(frame.cameraPosition.y == Catch::Approx(2.0f));
+    REQUIRE(frame.cameraPosition.z == Catch::Approx(3.0f));
+  }
+
+  SECTION("Records are aligned and written one after the other") {
+    size_t stride = buffers->getObjectStride();
+    REQUIRE(stride >= sizeof(OkObjectUniforms));
+
+    size_t                        orphans = buffers->getOrphanCount();
+    std::vector<OkObjectUniforms> objects(3);
+
+    GLintptr first  = buffers->writeObjects(objects.data(), objects.size());
+    GLintptr second = buffers->writeObject(objects[0]);
+    REQUIRE(second == first + static_cast<GLintptr>(3 * stride));
+    REQUIRE(buffers->getOrphanCount() == orphans);
+  }
+
+  SECTION("A full ring is orphaned and written from its start") {
+    OkConfig::setInt("graphics.object-buffer-bytes", 1);
+    size_t stride = buffers->getObjectStride();
+    REQUIRE(buffers->getCapacity() == stride);
+
+    size_t           orphans = buffers->getOrphanCount();
+    OkObjectUniforms object  = {};
+    REQUIRE(buffers->writeObject(object) == 0);
+    REQUIRE(buffers->writeObject(object) == 0);
+    REQUIRE(buffers->getOrphanCount() == orphans + 1);
+
+    // Ring too small for a bulk write grows to fit it
+    std::vector<OkObjectUniforms> objects(4);
+    REQUIRE(buffers->writeObjects(objects.data(), objects.size()) == 0);
+    REQUIRE(buffers->getCapacity() == 4 * stride);
+  }
+
+  OkConfig::setInt("graphics.object-buffer-bytes", bytes);
+  buffers->cleanup();
+}
+
+// NOLINTEND(readability-magic-numbers)
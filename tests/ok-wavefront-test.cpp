@@ -0,0 +1,147 @@
+// NOLINTBEGIN(readability-magic-numbers)
+
+#include "../src/importers/wavefront.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static bool parseString(const std::string             &data,
+                        OkWavefrontImporter::MeshData &mesh) {
+  return OkWavefrontImporter::parse(data.data(), data.size(), mesh);
+}
+
+TEST_CASE("OkWavefrontImporter face formats", "[wavefront]") {
+  OkWavefrontImporter::MeshData mesh;
+
+  SECTION("Positions only, quads are triangulated") {
+    REQUIRE(parseString("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                        "f 1 2 3 4\n",
+                        mesh));
+    REQUIRE(mesh.vertices.size() == 4 * 5);
+    REQUIRE(mesh.indices == std::vector<unsigned int>{0, 1, 2, 0, 2, 3});
+
+    // Missing texture coordinates are zero
+    REQUIRE(mesh.vertices[5] == 1.0f);
+    REQUIRE(mesh.vertices[8] == 0.0f);
+    REQUIRE(mesh.vertices[9] == 0.0f);
+  }
+
+  SECTION("Texture coordinates and normals") {
+    REQUIRE(parseString("v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                        "vt 0.25 0.5\nvt 1 0\nvt 0 1\n"
+                        "vn 0 0 1\n"
+                        "f 1/1/1 2/2/1 3/3/1\n",
+                        mesh));
+    REQUIRE(mesh.hasNormals);
+    REQUIRE(mesh.vertices.size() == 3 * 8);
+    REQUIRE(mesh.vertices[3] == 0.25f);
+    REQUIRE(mesh.vertices[4] == 0.5f);
+    REQUIRE(mesh.vertices[7] == 1.0f);
+  }
+
+  SECTION("Normals without texture coordinates") {
+    REQUIRE(parseString("v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\n"
+                        "f 1//1 2//1 3//1\n",
+                        mesh));
+    REQUIRE(mesh.indices.size() == 3);
+    REQUIRE(mesh.vertices.size() == 3 * 8);
+  }
+
+  SECTION("Vertices are shared only with the same normal") {
+    REQUIRE(parseString("v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                        "vn 0 0 1\nvn 0 0 -1\n"
+                        "f 1//1 2//1 3//1\nf 1//2 3//2 2//2\n",
+                        mesh));
+    REQUIRE(mesh.vertices.size() == 6 * 8);
+    REQUIRE(mesh.vertices[3 * 8 + 7] == -1.0f);
+  }
+
+  SECTION("Vertices are shared only with the same texture coordinates") {
+    REQUIRE(parseString("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+                        "vt 0 0\nvt 1 1\n"
+                        "f 1/1 2/1 3/1\nf 2/1 4/1 3/2\n",
+                        mesh));
+    REQUIRE(mesh.vertices.size() == 5 * 5);
+    REQUIRE(mesh.indices == std::vector<unsigned int>{0, 1, 2, 1, 3, 4});
+  }
+
+  SECTION("Negative indices, comments, blanks and CRLF") {
+    REQUIRE(parseString("# comment\r\n"
+                        "o object\r\n"
+                        "  v 0 0 0\r\n"
+                        "v\t1 0 0\r\n"
+                        "v 0 1.5e0 0 # trailing\r\n"
+                        "\r\n"
+                        "f -3 -2 -1\r\n",
+                        mesh));
+    REQUIRE(mesh.indices == std::vector<unsigned int>{0, 1, 2});
+    REQUIRE(mesh.vertices[11] == 1.5f);
+  }
+
+  SECTION("No line feed at the end") {
+    REQUIRE(parseString("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3", mesh));
+    REQUIRE(mesh.indices.size() == 3);
+  }
+
+  SECTION("Invalid data is rejected") {
+    REQUIRE_FALSE(parseString("v 0 0 0\nf 1 2 3\n", mesh));
+    REQUIRE_FALSE(parseString("v 0 0\n", mesh));
+    REQUIRE_FALSE(parseString("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1/4 2 3\n", mesh));
+    REQUIRE_FALSE(parseString("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 x\n", mesh));
+  }
+}
+
+TEST_CASE("OkWavefrontImporter chunked parsing", "[wavefront]") {
+  // Strip of quads with shared texture coordinates, larger than a few chunks,
+  // with faces using negative indices that cross chunk boundaries
+  std::string data = "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n";
+  data.reserve(OkWavefrontImporter::minChunkSize * 6);
+  for (int i = 0; data.size() < OkWavefrontImporter::minChunkSize * 5; i++) {
+    data += "v " + std::to_string(i * 0.5f) + " 0 0.125\n";
+    data += "v " + std::to_string(i * 0.5f) + " 1 -0.25\n";
+    if (i > 0) {
+      data += i % 2 ? "f -4/1 -2/2 -1/3 -3/4\n" : "f -4/1/1 -2/2/1 -1/3/1\n";
+      data += "vn 0 0 1\n";
+    }
+  }
+
+  OkWavefrontImporter::MeshData serial;
+  REQUIRE(OkWavefrontImporter::parse(data.data(), data.size(), serial, 1));
+  REQUIRE(serial.indices.size() > 0);
+
+  for (int threads : {2, 3, 4, 0}) {
+    OkWavefrontImporter::MeshData parallel;
+    REQUIRE(OkWavefrontImporter::parse(data.data(), data.size(), parallel,
+                                       threads));
+    REQUIRE(parallel.indices == serial.indices);
+    REQUIRE(parallel.vertices.size() == serial.vertices.size());
+    REQUIRE(std::memcmp(parallel.vertices.data(), serial.vertices.data(),
+                        serial.vertices.size() * sizeof(float)) == 0);
+  }
+
+  // Errors are found in any chunk
+  data += "f 1 2 x\n";
+  OkWavefrontImporter::MeshData invalid;
+  REQUIRE_FALSE(
+      OkWavefrontImporter::parse(data.data(), data.size(), invalid, 4));
+}
+
+TEST_CASE("OkWavefrontImporter files", "[wavefront]") {
+  std::string filename = "ok-wavefront-test.obj";
+  {
+    std::ofstream file(filename);
+    file << "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nf 1/1 2/1 3/1\n";
+  }
+
+  OkWavefrontImporter::MeshData mesh;
+  REQUIRE(OkWavefrontImporter::parseFile(filename, mesh));
+  REQUIRE(mesh.vertices.size() == 3 * 5);
+  REQUIRE(mesh.indices.size() == 3);
+
+  std::remove(filename.c_str());
+  REQUIRE_FALSE(OkWavefrontImporter::parseFile(filename, mesh));
+}
+
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,53 @@
+#ifndef TEST_KTX2_HPP
+#define TEST_KTX2_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Write a KTX2 file with a square image and all its levels, every byte of
+// level n being n
+inline bool writeKtx2(const std::string &filename, uint32_t vkFormat,
+                      uint32_t size, uint32_t blockSize, bool compressed) {
+  const unsigned char identifier[12] = {0xAB, 'K',  'T',  'X',  ' ',  '2',
+                                        '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+
+  std::vector<std::vector<unsigned char>> levels;
+  for (uint32_t side = size;; side /= 2) {
+    uint32_t blocks = compressed ? (side + 3) / 4 : side;
+    levels.emplace_back(blocks * blocks * blockSize,
+                        static_cast<unsigned char>(levels.size()));
+    if (side == 1) {
+      break;
+    }
+  }
+
+  uint32_t header[13] = {vkFormat, 1, size, size, 0, 0, 1,
+                         static_cast<uint32_t>(levels.size())};
+  uint64_t sgd[2]     = {0, 0};
+
+  // Level index, then the levels, smallest first as in real files
+  uint64_t              offset = 80 + levels.size() * 24;
+  std::vector<uint64_t> index(levels.size() * 3);
+  for (size_t i = levels.size(); i-- > 0;) {
+    index[i * 3]     = offset;
+    index[i * 3 + 1] = levels[i].size();
+    index[i * 3 + 2] = levels[i].size();
+    offset += levels[i].size();
+  }
+
+  std::ofstream file(filename, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(identifier), sizeof(identifier));
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(sgd), sizeof(sgd));
+  file.write(reinterpret_cast<const char *>(index.data()),
+             static_cast<std::streamsize>(index.size() * sizeof(uint64_t)));
+  for (size_t i = levels.size(); i-- > 0;) {
+    file.write(reinterpret_cast<const char *>(levels[i].data()),
+               static_cast<std::streamsize>(levels[i].size()));
+  }
+  return file.good();
+}
+
+#endif  // TEST_KTX2_HPP